@@ -41,6 +41,7 @@ enum : NSInteger {
     PWGenericError                                                  = 60,
     
     PWDispatchIOChannelError                                        = 100,
+    PWDispatchIOCompressionError                                    = 101,
     PWMediaDescriptionDigestValidationError                         = 200,
     PWMediaDescriptionUnsupportedSymbolicLinkError                  = 201,
 
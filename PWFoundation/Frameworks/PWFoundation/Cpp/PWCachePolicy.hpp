@@ -0,0 +1,289 @@
+//
+//  PWCachePolicy.hpp
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#ifndef PWFoundation_cache_policy_hpp
+#define PWFoundation_cache_policy_hpp
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <vector>
+
+namespace PWFoundation {
+
+    // A count-min sketch with four rows of 4-bit counters, which estimates how often a hash has been recorded.
+    //
+    // The rows are at least four times as wide as the capacity of the cache, rounded up to a power of two, which keeps
+    // collisions rare even when the cache sees many more keys than it holds. After ten times as many recordings as
+    // counters in a row, all counters are halved, so the estimates follow changes in popularity.
+    class frequency_sketch
+    {
+    public:
+        explicit frequency_sketch (size_t capacity)
+        {
+            size_t width = 16;
+            while (width < 4 * capacity)
+                width <<= 1;
+            width_mask_  = width - 1;
+            sample_size_ = 10 * width;
+            additions_   = 0;
+            table_.assign (width / 4, 0);       // four rows of 'width' counters, 16 counters per word
+        }
+
+        void increment (size_t hash)
+        {
+            bool added = false;
+            for (unsigned row = 0; row < 4; row++)
+            {
+                size_t index = counter_index (hash, row);
+                uint64_t& word = table_[index >> 4];
+                unsigned shift = (index & 15) << 2;
+                if (((word >> shift) & 0xf) < 15)
+                {
+                    word += uint64_t (1) << shift;
+                    added = true;
+                }
+            }
+            if (added && ++additions_ >= sample_size_)
+                age();
+        }
+
+        unsigned frequency (size_t hash) const
+        {
+            unsigned frequency = 15;
+            for (unsigned row = 0; row < 4; row++)
+            {
+                size_t index = counter_index (hash, row);
+                frequency = std::min (frequency, unsigned ((table_[index >> 4] >> ((index & 15) << 2)) & 0xf));
+            }
+            return frequency;
+        }
+
+        void clear()
+        {
+            std::fill (table_.begin(), table_.end(), 0);
+            additions_ = 0;
+        }
+
+        size_t width() const { return width_mask_ + 1; }
+
+    private:
+        // The counters of a row are spread over the whole table. Rows use different seeds, so hashes which collide in
+        // one row are unlikely to collide in the others.
+        size_t counter_index (size_t hash, unsigned row) const
+        {
+            static const uint64_t seeds[4] = { 0x97cb3127ee4d2b65ULL, 0xb492b66fbe98f273ULL,
+                                               0x9ae16a3b2f90404fULL, 0xcbf29ce484222325ULL };
+            uint64_t h = (uint64_t (hash) + seeds[row]) * 0x9e3779b97f4a7c15ULL;
+            h ^= h >> 32;
+            return size_t ((h & width_mask_) + (width_mask_ + 1) * row);
+        }
+
+        void age()
+        {
+            for (uint64_t& word : table_)
+                word = (word >> 1) & 0x7777777777777777ULL;
+            additions_ /= 2;
+        }
+
+        std::vector<uint64_t>   table_;
+        size_t                  width_mask_;
+        size_t                  sample_size_;
+        size_t                  additions_;
+    };
+
+    enum class cache_segment : uint8_t { window, probation, protected_main };
+
+    // The replacement policy of PWLRUCache and PWAsyncLRUCache.
+    //
+    // Entries live in three lists, each ordered from the most to the least recently used entry. Entry must have an
+    // 'id first' key and a 'cache_segment segment' member, Hash hashes the keys.
+    //
+    // In LRU mode all entries stay in the window and the least recently used one is the victim.
+    //
+    // In W-TinyLFU mode (Einziger, Friedman, Manes: "TinyLFU: A Highly Efficient Cache Admission Policy") new entries
+    // enter a window of 1% of the capacity. Entries pushed out of the window become candidates at the front of the
+    // probation segment of the main region. An entry hit in probation is promoted to the protected segment, which holds
+    // up to 80% of the main region and demotes its least recently used entry back to probation when it overflows. When
+    // the cache is full, the newest candidate competes with the least recently used probation entry and the one with the
+    // lower estimated frequency is the victim, ties go against the candidate. Frequencies come from a sketch of all
+    // lookups, so a scan through many keys which are used once cannot displace the entries which are used repeatedly.
+    template <typename Entry, typename Hash> class cache_policy
+    {
+    public:
+        typedef std::list<Entry>                list_type;
+        typedef typename list_type::iterator    iterator;
+
+        // The caches keep the policy as an instance variable and configure it in their initializers.
+        cache_policy() : sketch_ (0)
+        {
+            configure (1, false);
+        }
+
+        // Discards all entries.
+        void configure (size_t capacity, bool tiny_lfu)
+        {
+            clear();
+            tiny_lfu_           = tiny_lfu;
+            sketch_             = frequency_sketch (tiny_lfu ? capacity : 0);
+            window_capacity_    = tiny_lfu ? std::max (size_t (1), capacity / 100) : capacity;
+            protected_capacity_ = (capacity - window_capacity_) * 4 / 5;
+        }
+
+        bool is_tiny_lfu() const { return tiny_lfu_; }
+
+        size_t size() const { return window_.size() + probation_.size() + protected_.size(); }
+
+        // Lookups are recorded, insertions are not. The caches record a miss before inserting the created object.
+        template <typename Key> void record_miss (const Key& key)
+        {
+            if (tiny_lfu_)
+                sketch_.increment (Hash() (key));
+        }
+
+        iterator insert (const Entry& entry)
+        {
+            window_.push_front (entry);
+            window_.front().segment = cache_segment::window;
+            iterator inserted = window_.begin();
+            if (tiny_lfu_)
+                while (window_.size() > window_capacity_)
+                {
+                    move_to_front (std::prev (window_.end()), probation_, cache_segment::probation);
+                    candidate_ = probation_.begin();
+                    has_candidate_ = true;
+                }
+            return inserted;
+        }
+
+        // Records a hit of the entry.
+        void touch (iterator it)
+        {
+            if (!tiny_lfu_)
+            {
+                window_.splice (window_.begin(), window_, it);
+                return;
+            }
+
+            sketch_.increment (Hash() (it->first));
+            switch (it->segment)
+            {
+                case cache_segment::window:
+                    window_.splice (window_.begin(), window_, it);
+                    break;
+                case cache_segment::probation:
+                    if (has_candidate_ && candidate_ == it)
+                        has_candidate_ = false;
+                    move_to_front (it, protected_, cache_segment::protected_main);
+                    if (protected_.size() > protected_capacity_)
+                        move_to_front (std::prev (protected_.end()), probation_, cache_segment::probation);
+                    break;
+                case cache_segment::protected_main:
+                    protected_.splice (protected_.begin(), protected_, it);
+                    break;
+            }
+        }
+
+        // Moves the entry to the front of its list without recording a hit, so entries whose eviction has been refused
+        // are not offered again right away.
+        void refresh (iterator it)
+        {
+            list_type& list = list_for_segment (it->segment);
+            list.splice (list.begin(), list, it);
+        }
+
+        // Returns the iterator following 'it' in its list.
+        iterator erase (iterator it)
+        {
+            if (has_candidate_ && candidate_ == it)
+                has_candidate_ = false;
+            return list_for_segment (it->segment).erase (it);
+        }
+
+        // The entry to remove when the cache exceeds its capacity. Returns false if the cache is empty.
+        bool victim (iterator& victim)
+        {
+            if (!probation_.empty())
+            {
+                victim = std::prev (probation_.end());
+                if (has_candidate_ && candidate_ != victim && sketch_.frequency (Hash() (candidate_->first)) <= sketch_.frequency (Hash() (victim->first)))
+                    victim = candidate_;
+                return true;
+            }
+            if (!protected_.empty())
+            {
+                victim = std::prev (protected_.end());
+                return true;
+            }
+            if (!window_.empty())
+            {
+                victim = std::prev (window_.end());
+                return true;
+            }
+            return false;
+        }
+
+        // The lists from the least to the most valuable one. Iterating each list backwards visits the entries roughly
+        // in the order in which they would be evicted.
+        std::array<list_type*, 3> lists_in_eviction_order()
+        {
+            std::array<list_type*, 3> lists = {{ &probation_, &window_, &protected_ }};
+            return lists;
+        }
+
+        template <typename Function> void for_each (Function function)
+        {
+            for (list_type* list : lists_in_eviction_order())
+                for (Entry& entry : *list)
+                    function (entry);
+        }
+
+        void clear()
+        {
+            window_.clear();
+            probation_.clear();
+            protected_.clear();
+            has_candidate_ = false;
+        }
+
+    private:
+        list_type& list_for_segment (cache_segment segment)
+        {
+            switch (segment)
+            {
+                case cache_segment::window:         return window_;
+                case cache_segment::probation:      return probation_;
+                case cache_segment::protected_main: return protected_;
+            }
+            return window_;
+        }
+
+        // Splicing keeps all iterators valid.
+        void move_to_front (iterator it, list_type& list, cache_segment segment)
+        {
+            list.splice (list.begin(), list_for_segment (it->segment), it);
+            it->segment = segment;
+        }
+
+        bool                tiny_lfu_;
+        frequency_sketch    sketch_;
+        size_t              window_capacity_;
+        size_t              protected_capacity_;
+        list_type           window_;
+        list_type           probation_;
+        list_type           protected_;
+        iterator            candidate_;         // the newest entry moved from the window to probation
+        bool                has_candidate_;
+    };
+
+}
+
+#endif
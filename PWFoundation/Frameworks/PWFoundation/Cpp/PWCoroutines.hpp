@@ -0,0 +1,703 @@
+//
+//  PWCoroutines.hpp
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#ifndef PWFoundation_coroutines_hpp
+#define PWFoundation_coroutines_hpp
+
+// Note: the framework is built as gnu++11. Files using this header need to be compiled with -std=gnu++20.
+#if !defined (__cpp_impl_coroutine) || !__has_include (<coroutine>)
+#error "PWCoroutines.hpp requires C++20 coroutines"
+#endif
+
+#include <dispatch/dispatch.h>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#ifdef __OBJC__
+#import <PWFoundation/PWDispatchQueue.h>
+#import <PWFoundation/PWDispatchIOStreamChannel.h>
+#import <PWFoundation/PWDispatchIORandomChannel.h>
+#import <PWFoundation/PWAsyncLRUCache.h>
+#endif
+
+namespace PWFoundation {
+
+    // Coroutine support for dispatch queues, IO channels and the asynchronous cache.
+    //
+    // task<T> is a lazily started coroutine returning T. Awaiting a task starts it and resumes the awaiting coroutine
+    // when it completes, by symmetric transfer, so long chains of tasks which complete synchronously do not grow the
+    // stack. Coroutine frames are allocated from per thread pools instead of malloc.
+    //
+    //     task<NSUInteger> countBytes (PWDispatchIORandomChannel* channel, PWDispatchQueue* queue)
+    //     {
+    //         io_result result = co_await async_read (channel, 0, NSNotFound, queue);    // continues on queue
+    //         co_await PWDispatchQueue.mainQueue;                                        // continues on the main queue
+    //         co_return result.error ? 0 : dispatch_data_get_size (result.data);
+    //     }
+    //
+    // Awaiting a queue (a dispatch_queue_t or an id<PWDispatchQueueing>) inside a task continues on this queue.
+    // Dispatching to a PWDispatchQueue does not copy a block and the queue is current while the coroutine runs.
+    //
+    // Tasks are started by awaiting them from another task, by spawn() or by sync_wait().
+
+    namespace coroutine_detail {
+
+        // Recycles coroutine frames in per thread free lists with size classes of 64 bytes up to 1 KB. Frames are
+        // returned to the list of the thread which frees them, which is typically a long living dispatch worker thread.
+        class frame_pool
+        {
+        public:
+            static void* allocate (size_t size)
+            {
+                size_t size_class = size_class_for_size (size);
+                if (size_class < class_count) {
+                    thread_cache& cache = cache_of_thread();
+                    if (free_frame* frame = cache.heads[size_class]) {
+                        cache.heads[size_class] = frame->next;
+                        --cache.counts[size_class];
+                        return frame;
+                    }
+                    return ::operator new ((size_class + 1) * granularity);
+                }
+                return ::operator new (size);
+            }
+
+            static void deallocate (void* pointer, size_t size) noexcept
+            {
+                size_t size_class = size_class_for_size (size);
+                if (size_class < class_count && !is_cache_destroyed()) {
+                    thread_cache& cache = cache_of_thread();
+                    if (cache.counts[size_class] < max_cached_count) {
+                        free_frame* frame = static_cast<free_frame*>(pointer);
+                        frame->next = cache.heads[size_class];
+                        cache.heads[size_class] = frame;
+                        ++cache.counts[size_class];
+                        return;
+                    }
+                }
+                ::operator delete (pointer);
+            }
+
+            // The number of frames in the pool of the current thread.
+            static size_t cached_frame_count()
+            {
+                if (is_cache_destroyed())
+                    return 0;
+                size_t count = 0;
+                for (size_t size_class = 0; size_class < class_count; ++size_class)
+                    count += cache_of_thread().counts[size_class];
+                return count;
+            }
+
+        private:
+            static constexpr size_t granularity      = 64;
+            static constexpr size_t class_count      = 16;
+            static constexpr size_t max_cached_count = 64;     // per size class and thread
+
+            struct free_frame
+            {
+                free_frame* next;
+            };
+
+            struct thread_cache
+            {
+                free_frame* heads[class_count]  = {};
+                size_t      counts[class_count] = {};
+
+                ~thread_cache()
+                {
+                    // Frames freed by destructors of other thread locals bypass the destroyed cache.
+                    is_cache_destroyed() = true;
+                    for (free_frame* head : heads)
+                        while (head) {
+                            free_frame* next = head->next;
+                            ::operator delete (head);
+                            head = next;
+                        }
+                }
+            };
+
+            static size_t size_class_for_size (size_t size)
+            {
+                return (size + granularity - 1) / granularity - 1;
+            }
+
+            static thread_cache& cache_of_thread()
+            {
+                static thread_local thread_cache cache;
+                return cache;
+            }
+
+            static bool& is_cache_destroyed()
+            {
+                static thread_local bool is_destroyed = false;
+                return is_destroyed;
+            }
+        };
+
+        // Resumes the awaiting coroutine on a GCD queue without copying a block.
+        class dispatch_queue_awaiter
+        {
+        public:
+            explicit dispatch_queue_awaiter (dispatch_queue_t queue) : queue_ (queue) {}
+
+            bool await_ready() const noexcept { return false; }
+            void await_resume() const noexcept {}
+
+            void await_suspend (std::coroutine_handle<> handle) const
+            {
+                dispatch_async_f (queue_, handle.address(), &resume);
+            }
+
+        private:
+            static void resume (void* address)
+            {
+                std::coroutine_handle<>::from_address (address).resume();
+            }
+
+            dispatch_queue_t queue_;
+        };
+
+#ifdef __OBJC__
+        // Resumes the awaiting coroutine on a PWDispatchQueueing. The coroutine runs with the queue being current, like
+        // a block dispatched through the PWDispatch API, but no block is copied.
+        class queue_awaiter
+        {
+        public:
+            explicit queue_awaiter (id<PWDispatchQueueing> queue) : queue_ (queue)
+            {
+                NSCParameterAssert (queue);
+            }
+
+            bool await_ready() const noexcept { return false; }
+            void await_resume() const noexcept {}
+
+            void await_suspend (std::coroutine_handle<> handle)
+            {
+                handle_ = handle;
+                dispatch_async_f (queue_.dispatchQueueForNativeAPIs.underlyingQueue, this, &resume);
+            }
+
+        private:
+            static void resume (void* context)
+            {
+                @autoreleasepool {
+                    queue_awaiter& awaiter = *static_cast<queue_awaiter*>(context);
+                    // Resuming can destroy the coroutine frame and with it the awaiter.
+                    id<PWDispatchQueueing> queue = awaiter.queue_;
+                    std::coroutine_handle<> handle = awaiter.handle_;
+                    PWDispatchCallBlockFromNativeAPI (queue, ^{ handle.resume(); });
+                }
+            }
+
+            id<PWDispatchQueueing>  queue_;
+            std::coroutine_handle<> handle_;
+        };
+#endif
+
+        class promise_base
+        {
+        public:
+            static void* operator new (size_t size)               { return frame_pool::allocate (size); }
+            static void  operator delete (void* pointer, size_t size) { frame_pool::deallocate (pointer, size); }
+
+            std::suspend_always initial_suspend() const noexcept { return {}; }
+
+            // Transfers control to the awaiting coroutine without a nested call.
+            struct final_awaiter
+            {
+                bool await_ready() const noexcept { return false; }
+                void await_resume() const noexcept {}
+
+                template <typename Promise>
+                std::coroutine_handle<> await_suspend (std::coroutine_handle<Promise> handle) const noexcept
+                {
+                    std::coroutine_handle<> continuation = handle.promise().continuation_;
+                    return continuation ? continuation : std::noop_coroutine();
+                }
+            };
+
+            final_awaiter final_suspend() const noexcept { return {}; }
+
+            void unhandled_exception() noexcept { exception_ = std::current_exception(); }
+
+            // Awaiting a queue continues on this queue. Other awaitables are passed through.
+            template <typename Awaitable,
+                      typename = typename std::enable_if<std::is_class<typename std::remove_reference<Awaitable>::type>::value>::type>
+            Awaitable&& await_transform (Awaitable&& awaitable) const noexcept
+            {
+                return std::forward<Awaitable>(awaitable);
+            }
+
+            dispatch_queue_awaiter await_transform (dispatch_queue_t queue) const noexcept
+            {
+                return dispatch_queue_awaiter (queue);
+            }
+
+#ifdef __OBJC__
+            queue_awaiter await_transform (id<PWDispatchQueueing> queue) const
+            {
+                return queue_awaiter (queue);
+            }
+#endif
+
+            void set_continuation (std::coroutine_handle<> continuation) noexcept { continuation_ = continuation; }
+
+        protected:
+            void rethrow_if_failed() const
+            {
+                if (exception_)
+                    std::rethrow_exception (exception_);
+            }
+
+        private:
+            std::coroutine_handle<> continuation_;
+            std::exception_ptr      exception_;
+        };
+
+        template <typename T>
+        class promise : public promise_base
+        {
+        public:
+            template <typename Value>
+            void return_value (Value&& value) { value_.emplace (std::forward<Value>(value)); }
+
+            T take_result()
+            {
+                rethrow_if_failed();
+                return std::move (*value_);
+            }
+
+        private:
+            std::optional<T> value_;
+        };
+
+        template <>
+        class promise<void> : public promise_base
+        {
+        public:
+            void return_void() const noexcept {}
+
+            void take_result() const { rethrow_if_failed(); }
+        };
+
+    }   // namespace coroutine_detail
+
+
+    // Awaiting a task can be done only once. Destroying a task which has not completed destroys its frame, so a task
+    // must be kept until it completes, which is automatic when it is awaited.
+    template <typename T = void>
+    class task
+    {
+    public:
+        class promise_type : public coroutine_detail::promise<T>
+        {
+        public:
+            task get_return_object() noexcept { return task (std::coroutine_handle<promise_type>::from_promise (*this)); }
+        };
+
+        task (task&& other) noexcept : handle_ (std::exchange (other.handle_, nullptr)) {}
+
+        task& operator= (task&& other) noexcept
+        {
+            if (this != &other) {
+                if (handle_)
+                    handle_.destroy();
+                handle_ = std::exchange (other.handle_, nullptr);
+            }
+            return *this;
+        }
+
+        ~task()
+        {
+            if (handle_)
+                handle_.destroy();
+        }
+
+        bool is_done() const noexcept { return !handle_ || handle_.done(); }
+
+        auto operator co_await() && noexcept
+        {
+            struct awaiter
+            {
+                std::coroutine_handle<promise_type> handle;
+
+                bool await_ready() const noexcept { return handle.done(); }
+
+                // Starts the task by symmetric transfer.
+                std::coroutine_handle<> await_suspend (std::coroutine_handle<> continuation) const noexcept
+                {
+                    handle.promise().set_continuation (continuation);
+                    return handle;
+                }
+
+                T await_resume() const { return handle.promise().take_result(); }
+            };
+            return awaiter { handle_ };
+        }
+
+    private:
+        explicit task (std::coroutine_handle<promise_type> handle) noexcept : handle_ (handle) {}
+
+        task (const task&);                 // made inaccessible
+        void operator= (const task&);       // made inaccessible
+
+        std::coroutine_handle<promise_type> handle_;
+    };
+
+
+    namespace coroutine_detail {
+
+        // A coroutine which starts immediately and destroys itself when done.
+        struct detached_task
+        {
+            struct promise_type
+            {
+                static void* operator new (size_t size)               { return frame_pool::allocate (size); }
+                static void  operator delete (void* pointer, size_t size) { frame_pool::deallocate (pointer, size); }
+
+                detached_task       get_return_object() const noexcept { return {}; }
+                std::suspend_never  initial_suspend() const noexcept   { return {}; }
+                std::suspend_never  final_suspend() const noexcept     { return {}; }
+                void                return_void() const noexcept       {}
+                void                unhandled_exception() const noexcept { std::terminate(); }
+            };
+        };
+
+        template <typename T>
+        detached_task run_detached (task<T> awaited)
+        {
+            co_await std::move (awaited);
+        }
+
+        struct completion_signal
+        {
+            std::mutex              mutex;
+            std::condition_variable condition;
+            bool                    is_done = false;
+
+            void signal()
+            {
+                // Notifying while holding the lock keeps the waiter from destroying the signal before it is notified.
+                std::lock_guard<std::mutex> lock (mutex);
+                is_done = true;
+                condition.notify_one();
+            }
+
+            void wait()
+            {
+                std::unique_lock<std::mutex> lock (mutex);
+                condition.wait (lock, [this] { return is_done; });
+            }
+        };
+
+        template <typename T>
+        detached_task run_and_signal (task<T> awaited, std::optional<T>& result, std::exception_ptr& exception,
+                                      completion_signal& signal)
+        {
+            try {
+                result.emplace (co_await std::move (awaited));
+            } catch (...) {
+                exception = std::current_exception();
+            }
+            signal.signal();
+        }
+
+        inline detached_task run_and_signal (task<void> awaited, std::exception_ptr& exception, completion_signal& signal)
+        {
+            try {
+                co_await std::move (awaited);
+            } catch (...) {
+                exception = std::current_exception();
+            }
+            signal.signal();
+        }
+
+    }   // namespace coroutine_detail
+
+
+    // Starts the task without waiting for it. An exception thrown by the task terminates the process.
+    template <typename T>
+    void spawn (task<T> task)
+    {
+        coroutine_detail::run_detached (std::move (task));
+    }
+
+    // Starts the task and blocks the calling thread until it completes. Must not be called on a queue which the task
+    // needs in order to complete.
+    template <typename T>
+    T sync_wait (task<T> task)
+    {
+        coroutine_detail::completion_signal signal;
+        std::optional<T> result;
+        std::exception_ptr exception;
+        coroutine_detail::run_and_signal (std::move (task), result, exception, signal);
+        signal.wait();
+        if (exception)
+            std::rethrow_exception (exception);
+        return std::move (*result);
+    }
+
+    inline void sync_wait (task<void> task)
+    {
+        coroutine_detail::completion_signal signal;
+        std::exception_ptr exception;
+        coroutine_detail::run_and_signal (std::move (task), exception, signal);
+        signal.wait();
+        if (exception)
+            std::rethrow_exception (exception);
+    }
+
+    // For coroutine types other than task, which do not transform awaited queues.
+    inline coroutine_detail::dispatch_queue_awaiter resume_on (dispatch_queue_t queue)
+    {
+        return coroutine_detail::dispatch_queue_awaiter (queue);
+    }
+
+
+#ifdef __OBJC__
+
+    inline coroutine_detail::queue_awaiter resume_on (id<PWDispatchQueueing> queue)
+    {
+        return coroutine_detail::queue_awaiter (queue);
+    }
+
+    // The result of awaiting a channel operation.
+    struct io_result
+    {
+        dispatch_data_t   data;       // reads: the data read, empty at EOF. writes: the data not written.
+        NSError*          error;
+    };
+
+    namespace coroutine_detail {
+
+        // Collects the partial results of a channel operation and resumes the coroutine when it is done, on the
+        // queue passed to the channel.
+        class io_awaiter
+        {
+        public:
+            bool await_ready() const noexcept { return false; }
+
+            io_result await_resume() noexcept { return std::move (result_); }
+
+        protected:
+            typedef void (^io_handler)(BOOL done, dispatch_data_t data, NSError* error);
+
+            explicit io_awaiter (id<PWDispatchQueueing> queue) : queue_ (queue)
+            {
+                NSCParameterAssert (queue);
+            }
+
+            io_handler read_handler (std::coroutine_handle<> handle)
+            {
+                io_awaiter* awaiter = this;
+                return ^(BOOL done, dispatch_data_t data, NSError* error) {
+                    io_result& result = awaiter->result_;
+                    if (data)
+                        result.data = result.data ? dispatch_data_create_concat (result.data, data) : data;
+                    if (error && !result.error)
+                        result.error = error;
+                    if (done) {
+                        if (!result.data)
+                            result.data = dispatch_data_empty;
+                        handle.resume();
+                    }
+                };
+            }
+
+            io_handler write_handler (std::coroutine_handle<> handle)
+            {
+                io_awaiter* awaiter = this;
+                return ^(BOOL done, dispatch_data_t remainingData, NSError* error) {
+                    io_result& result = awaiter->result_;
+                    result.data = remainingData;
+                    if (error && !result.error)
+                        result.error = error;
+                    if (done)
+                        handle.resume();
+                };
+            }
+
+            id<PWDispatchQueueing> queue_;
+
+        private:
+            io_result              result_;
+        };
+
+        // Note: the awaiters copy their members to locals before starting the operation, because its handler can
+        // resume and destroy the coroutine frame containing the awaiter before the starting method returns.
+
+        class stream_read_awaiter : public io_awaiter
+        {
+        public:
+            stream_read_awaiter (PWDispatchIOStreamChannel* channel, NSUInteger length, id<PWDispatchQueueing> queue)
+                : io_awaiter (queue), channel_ (channel), length_ (length)
+            {
+                NSCParameterAssert (channel);
+            }
+
+            void await_suspend (std::coroutine_handle<> handle)
+            {
+                PWDispatchIOStreamChannel* channel = channel_;
+                [channel readDispatchDataWithLength:length_ queue:queue_ handler:read_handler (handle)];
+            }
+
+        private:
+            PWDispatchIOStreamChannel*  channel_;
+            NSUInteger                  length_;
+        };
+
+        class stream_write_awaiter : public io_awaiter
+        {
+        public:
+            stream_write_awaiter (id<PWOutputStream> stream, dispatch_data_t data, id<PWDispatchQueueing> queue)
+                : io_awaiter (queue), stream_ (stream), data_ (data)
+            {
+                NSCParameterAssert (stream);
+                NSCParameterAssert (data);
+            }
+
+            void await_suspend (std::coroutine_handle<> handle)
+            {
+                id<PWOutputStream> stream = stream_;
+                [stream writeDispatchData:data_ queue:queue_ handler:write_handler (handle)];
+            }
+
+        private:
+            id<PWOutputStream>  stream_;
+            dispatch_data_t     data_;
+        };
+
+        class random_read_awaiter : public io_awaiter
+        {
+        public:
+            random_read_awaiter (PWDispatchIORandomChannel* channel, NSUInteger offset, NSUInteger length,
+                                 id<PWDispatchQueueing> queue)
+                : io_awaiter (queue), channel_ (channel), offset_ (offset), length_ (length)
+            {
+                NSCParameterAssert (channel);
+            }
+
+            void await_suspend (std::coroutine_handle<> handle)
+            {
+                PWDispatchIORandomChannel* channel = channel_;
+                [channel readDispatchDataStartingFromOffset:offset_ length:length_ queue:queue_ handler:read_handler (handle)];
+            }
+
+        private:
+            PWDispatchIORandomChannel*  channel_;
+            NSUInteger                  offset_;
+            NSUInteger                  length_;
+        };
+
+        class random_write_awaiter : public io_awaiter
+        {
+        public:
+            random_write_awaiter (PWDispatchIORandomChannel* channel, dispatch_data_t data, NSUInteger offset,
+                                  id<PWDispatchQueueing> queue)
+                : io_awaiter (queue), channel_ (channel), data_ (data), offset_ (offset)
+            {
+                NSCParameterAssert (channel);
+                NSCParameterAssert (data);
+            }
+
+            void await_suspend (std::coroutine_handle<> handle)
+            {
+                PWDispatchIORandomChannel* channel = channel_;
+                [channel writeDispatchData:data_ startingFromOffset:offset_ queue:queue_ handler:write_handler (handle)];
+            }
+
+        private:
+            PWDispatchIORandomChannel*  channel_;
+            dispatch_data_t             data_;
+            NSUInteger                  offset_;
+        };
+
+        // The cache calls its completion handlers on its internal queue, from where the lookup continues on the
+        // passed queue.
+        class cache_lookup_awaiter
+        {
+        public:
+            cache_lookup_awaiter (PWAsyncLRUCache* cache, id key, PWLRUCacheObjectCreationBlock creationBlock,
+                                  id<PWDispatchQueueing> queue)
+                : cache_ (cache), key_ (key), creationBlock_ (creationBlock), resumption_ (queue)
+            {
+                NSCParameterAssert (cache);
+                NSCParameterAssert (key);
+            }
+
+            bool await_ready() const noexcept { return false; }
+
+            void await_suspend (std::coroutine_handle<> handle)
+            {
+                PWAsyncLRUCache* cache = cache_;
+                cache_lookup_awaiter* awaiter = this;
+                [cache objectForKey:key_ creationBlock:creationBlock_ completionHandler:^(id object) {
+                    awaiter->object_ = object;
+                    awaiter->resumption_.await_suspend (handle);
+                }];
+            }
+
+            id await_resume() noexcept { return object_; }
+
+        private:
+            PWAsyncLRUCache*               cache_;
+            id                             key_;
+            PWLRUCacheObjectCreationBlock  creationBlock_;
+            queue_awaiter                  resumption_;
+            id                             object_;
+        };
+
+    }   // namespace coroutine_detail
+
+    // co_await async_read (...) reads until 'length' bytes or EOF have been read and continues on 'queue'.
+    inline coroutine_detail::stream_read_awaiter async_read (PWDispatchIOStreamChannel* channel, NSUInteger length,
+                                                             id<PWDispatchQueueing> queue)
+    {
+        return coroutine_detail::stream_read_awaiter (channel, length, queue);
+    }
+
+    inline coroutine_detail::random_read_awaiter async_read (PWDispatchIORandomChannel* channel, NSUInteger offset,
+                                                             NSUInteger length, id<PWDispatchQueueing> queue)
+    {
+        return coroutine_detail::random_read_awaiter (channel, offset, length, queue);
+    }
+
+    // co_await async_write (...) writes all of 'data' or until an error occurs and continues on 'queue'.
+    inline coroutine_detail::stream_write_awaiter async_write (id<PWOutputStream> stream, dispatch_data_t data,
+                                                               id<PWDispatchQueueing> queue)
+    {
+        return coroutine_detail::stream_write_awaiter (stream, data, queue);
+    }
+
+    inline coroutine_detail::random_write_awaiter async_write (PWDispatchIORandomChannel* channel, dispatch_data_t data,
+                                                               NSUInteger offset, id<PWDispatchQueueing> queue)
+    {
+        return coroutine_detail::random_write_awaiter (channel, data, offset, queue);
+    }
+
+    // co_await async_object_for_key (...) returns the cached or created object, or nil, and continues on 'queue'.
+    inline coroutine_detail::cache_lookup_awaiter async_object_for_key (PWAsyncLRUCache* cache, id key,
+                                                                        PWLRUCacheObjectCreationBlock creationBlock,
+                                                                        id<PWDispatchQueueing> queue)
+    {
+        return coroutine_detail::cache_lookup_awaiter (cache, key, creationBlock, queue);
+    }
+
+#endif  // __OBJC__
+
+}   // namespace PWFoundation
+
+#endif
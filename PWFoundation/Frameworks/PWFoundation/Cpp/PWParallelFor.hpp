@@ -0,0 +1,261 @@
+//
+//  PWParallelFor.hpp
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#ifndef PWFoundation_parallel_for_hpp
+#define PWFoundation_parallel_for_hpp
+
+#include <dispatch/dispatch.h>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace PWFoundation {
+
+    // Range based parallel loops with work stealing.
+    //
+    // The index range is split evenly between the workers, which are started by dispatch_apply on the passed queue.
+    // Each worker takes grain size chunks from the front of its own part. A worker without work steals the back half of
+    // another worker's remaining part, so unevenly expensive indexes are balanced without a central counter.
+    //
+    // A grain size of 0 selects about eight chunks per worker.
+    //
+    // The number of workers is limited by the processors which are not busy with other parallel loops. Loops nested in
+    // the body of another loop therefore use only the idle capacity and run inline on the calling worker if there is
+    // none, instead of oversubscribing the thread pool.
+    //
+    // Like dispatch_apply, the functions return when all indexes have been processed and must not be called on a
+    // serial queue from a block running on this queue. On a serial queue the chunks are processed one after the other.
+
+    namespace parallel_detail {
+
+        inline std::atomic<long>& busy_worker_count()
+        {
+            static std::atomic<long> count (0);
+            return count;
+        }
+
+        inline bool& is_worker_thread()
+        {
+            static thread_local bool is_worker = false;
+            return is_worker;
+        }
+
+        // Marks the current thread as busy with a parallel loop while in scope. Nested loops count only once.
+        class busy_worker_scope
+        {
+        public:
+            busy_worker_scope() : is_outermost_ (!is_worker_thread())
+            {
+                if (is_outermost_) {
+                    is_worker_thread() = true;
+                    busy_worker_count().fetch_add (1, std::memory_order_relaxed);
+                }
+            }
+
+            ~busy_worker_scope()
+            {
+                if (is_outermost_) {
+                    busy_worker_count().fetch_sub (1, std::memory_order_relaxed);
+                    is_worker_thread() = false;
+                }
+            }
+
+        private:
+            bool is_outermost_;
+
+            busy_worker_scope (const busy_worker_scope&);       // made inaccessible
+            void operator= (const busy_worker_scope&);          // made inaccessible
+        };
+
+        inline size_t worker_count_for_length (size_t length)
+        {
+            long processor_count = std::max (1L, (long)std::thread::hardware_concurrency());
+            // The calling thread counts as busy if it is a worker of an outer loop, but takes part in this loop, too.
+            long busy_count = busy_worker_count().load (std::memory_order_relaxed) - (is_worker_thread() ? 1 : 0);
+            long available_count = std::max (1L, processor_count - busy_count);
+            return (size_t)std::min ((long)std::min (length, (size_t)LONG_MAX), available_count);
+        }
+
+        // The part of a worker. Begin and end are packed into a single atomic, so that the owner taking from the
+        // front and thieves taking from the back can use compare and swap. Padded to a cache line to avoid false sharing.
+        struct worker_part
+        {
+            std::atomic<uint64_t> bounds;
+            char                  padding[64 - sizeof (std::atomic<uint64_t>)];
+
+            static uint64_t pack (uint32_t begin, uint32_t end) { return ((uint64_t)begin << 32) | end; }
+            static uint32_t begin_of (uint64_t bounds)           { return (uint32_t)(bounds >> 32); }
+            static uint32_t end_of (uint64_t bounds)             { return (uint32_t)bounds; }
+        };
+
+        // Processes the indexes [0, length) relative to 'base'. 'length' must fit into 32 bits.
+        template <typename Body>
+        class work_stealing_loop
+        {
+        public:
+            work_stealing_loop (size_t base, uint32_t length, size_t worker_count, uint32_t grain, Body& body)
+                : base_ (base), grain_ (grain), worker_count_ (worker_count), parts_ (worker_count), body_ (body)
+            {
+                for (size_t index = 0; index < worker_count; ++index)
+                    parts_[index].bounds.store (worker_part::pack ((uint32_t)((uint64_t)length * index / worker_count),
+                                                                   (uint32_t)((uint64_t)length * (index + 1) / worker_count)),
+                                                std::memory_order_relaxed);
+            }
+
+            void run (dispatch_queue_t queue)
+            {
+                dispatch_apply_f (worker_count_, queue, this, &work_stealing_loop::run_worker);
+            }
+
+        private:
+            static void run_worker (void* context, size_t worker)
+            {
+                work_stealing_loop& loop = *static_cast<work_stealing_loop*>(context);
+                busy_worker_scope busy_scope;
+                do {
+                    loop.process_own_part (worker);
+                } while (loop.steal (worker));
+            }
+
+            void process_own_part (size_t worker)
+            {
+                std::atomic<uint64_t>& bounds = parts_[worker].bounds;
+                uint64_t current = bounds.load (std::memory_order_relaxed);
+                for (;;) {
+                    uint32_t begin = worker_part::begin_of (current);
+                    uint32_t end   = worker_part::end_of (current);
+                    if (begin >= end)
+                        return;
+                    uint32_t chunk_end = begin + std::min (grain_, end - begin);
+                    if (bounds.compare_exchange_weak (current, worker_part::pack (chunk_end, end),
+                                                      std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                        body_ (worker, base_ + begin, base_ + chunk_end);
+                        current = bounds.load (std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            // Moves work of another worker into the part of 'worker'. Returns false if all parts are empty.
+            bool steal (size_t worker)
+            {
+                for (size_t offset = 1; offset < worker_count_; ++offset) {
+                    std::atomic<uint64_t>& victim = parts_[(worker + offset) % worker_count_].bounds;
+                    uint64_t current = victim.load (std::memory_order_relaxed);
+                    for (;;) {
+                        uint32_t begin = worker_part::begin_of (current);
+                        uint32_t end   = worker_part::end_of (current);
+                        if (begin >= end)
+                            break;
+                        uint32_t middle = (end - begin <= grain_) ? begin : begin + (end - begin) / 2;
+                        if (victim.compare_exchange_weak (current, worker_part::pack (begin, middle),
+                                                          std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                            // Only the owner stores into its own part when it is empty, thieves skip empty parts.
+                            parts_[worker].bounds.store (worker_part::pack (middle, end), std::memory_order_release);
+                            return true;
+                        }
+                    }
+                }
+                return false;
+            }
+
+            size_t                      base_;
+            uint32_t                    grain_;
+            size_t                      worker_count_;
+            std::vector<worker_part>    parts_;
+            Body&                       body_;
+        };
+
+        // Calls body (worker, begin, end) for chunks of [begin, end) with worker < the returned worker count.
+        // 'prepare' is called with the worker count before any chunk is processed.
+        template <typename Prepare, typename Body>
+        void run (dispatch_queue_t queue, size_t begin, size_t end, size_t grain, Prepare prepare, Body body)
+        {
+            if (begin >= end) {
+                prepare (0);
+                return;
+            }
+
+            size_t length = end - begin;
+            size_t worker_count = worker_count_for_length (length);
+            prepare (worker_count);
+
+            if (worker_count == 1) {
+                busy_worker_scope busy_scope;
+                body (0, begin, end);
+                return;
+            }
+
+            if (grain == 0)
+                grain = std::max ((size_t)1, length / (worker_count * 8));
+
+            // Ranges beyond 32 bits are processed in consecutive segments.
+            const size_t max_segment_length = UINT32_MAX;
+            for (size_t segment_begin = begin; segment_begin < end; ) {
+                size_t segment_length = std::min (end - segment_begin, max_segment_length);
+                work_stealing_loop<Body> loop (segment_begin, (uint32_t)segment_length, worker_count,
+                                               (uint32_t)std::min (grain, max_segment_length), body);
+                loop.run (queue);
+                segment_begin += segment_length;
+            }
+        }
+
+    }   // namespace parallel_detail
+
+
+    // Calls body (begin, end) concurrently for disjoint chunks covering [begin, end).
+    template <typename Body>
+    void parallel_for (dispatch_queue_t queue, size_t begin, size_t end, size_t grain, Body body)
+    {
+        parallel_detail::run (queue, begin, end, grain, [](size_t) {},
+                              [&body](size_t, size_t chunk_begin, size_t chunk_end) { body (chunk_begin, chunk_end); });
+    }
+
+    // Calls body (begin, end, accumulator) concurrently for disjoint chunks covering [begin, end). Each worker uses an
+    // accumulator of its own, which is created by make_identity() when the worker processes its first chunk.
+    // Afterwards the accumulators are combined in worker order by reduce (accumulator, other_accumulator), which must be
+    // associative. Returns make_identity() for an empty range.
+    template <typename MakeIdentity, typename Body, typename Reduce>
+    auto parallel_reduce (dispatch_queue_t queue, size_t begin, size_t end, size_t grain,
+                          MakeIdentity make_identity, Body body, Reduce reduce) -> decltype (make_identity())
+    {
+        typedef decltype (make_identity()) accumulator_type;
+
+        std::vector<accumulator_type> accumulators;
+        std::vector<char> is_used;      // not vector<bool>, whose elements share bytes
+        parallel_detail::run (queue, begin, end, grain,
+                              [&](size_t worker_count) {
+                                  accumulators.resize (worker_count);
+                                  is_used.resize (worker_count);
+                              },
+                              [&](size_t worker, size_t chunk_begin, size_t chunk_end) {
+                                  if (!is_used[worker]) {
+                                      accumulators[worker] = make_identity();
+                                      is_used[worker] = true;
+                                  }
+                                  body (chunk_begin, chunk_end, accumulators[worker]);
+                              });
+
+        bool has_result = false;
+        accumulator_type result = accumulator_type();
+        for (size_t worker = 0; worker < accumulators.size(); ++worker) {
+            if (!is_used[worker])
+                continue;
+            result = has_result ? reduce (std::move (result), std::move (accumulators[worker]))
+                                : std::move (accumulators[worker]);
+            has_result = true;
+        }
+        return has_result ? result : make_identity();
+    }
+
+}   // namespace PWFoundation
+
+#endif
@@ -8,6 +8,9 @@
 
 #import <PWFoundation/PWDispatch.h>
 #import <PWFoundation/PWEnumerable.h>
+#import <PWFoundation/PWCacheBudgetCoordinator.h>
+#import <PWFoundation/PWCacheSpillStore.h>
+#import <PWFoundation/PWLRUCache.h>     // for PWLRUCachePolicy
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -26,6 +29,13 @@ typedef void(^PWLRUCacheRemovalHandler)(id key, id object, BOOL isOptional, PWLR
 typedef void(^PWLRUCacheShouldEvictHandler)(id key, id object, PWLRUCacheRemovalResponseHandler responseHandler);
 typedef void(^PWLRUCacheWillRemoveHandler)(id key, id object, PWDispatchBlock responseHandler);
 
+// The batch removal handler receives up to removalBatchSize objects at once, which allows for bulk I/O when objects are
+// written back. A batch contains either only optional or only non-optional removals. The handler answers with the
+// indexes of the objects which may be removed, for non-optional removals these need to be all indexes.
+// The same rules as for the removal handler apply otherwise.
+typedef void(^PWLRUCacheBatchRemovalResponseHandler)(NSIndexSet* removableIndexes);
+typedef void(^PWLRUCacheBatchRemovalHandler)(NSArray* keys, NSArray* objects, BOOL isOptional, PWLRUCacheBatchRemovalResponseHandler responseHandler);
+
 typedef void(^PWLRUCacheObjectResponseBlock)(id object);
 typedef void(^PWLRUCacheObjectCreationBlock)(id key, PWLRUCacheObjectResponseBlock responseBlock);
 
@@ -33,15 +43,26 @@ typedef void(^PWLRUCacheObjectCreationBlock)(id key, PWLRUCacheObjectResponseBlo
 
 // Simple implementation of a least-recently-used cache with asynchronous interfaces.
 // Automatically evicts objects when the system comes under memory pressure.
-@interface PWAsyncLRUCache <KeyType, ObjectType> : NSObject
+@interface PWAsyncLRUCache <KeyType, ObjectType> : NSObject <PWBudgetedCache>
 
 - (instancetype)init NS_UNAVAILABLE;
 
 // Capacity needs to be > 0.
 // Note that the count can grow larger than the given capacity if the evict handler refuses an object
 // to be evicted.
+// The policy only decides which object is evicted, the removal handler is called the same way for all policies.
+- (instancetype)initWithCapacity:(NSUInteger)capacity
+                          policy:(PWLRUCachePolicy)policy
+             batchRemovalHandler:(PWLRUCacheBatchRemovalHandler)batchRemovalHandler NS_DESIGNATED_INITIALIZER;
+
+// Offers the objects to the removal handler one after the other.
+- (instancetype)initWithCapacity:(NSUInteger)capacity
+                          policy:(PWLRUCachePolicy)policy
+                  removalHandler:(PWLRUCacheRemovalHandler)removalHandler;
+
+// Uses PWLRUCachePolicyLRU.
 - (instancetype)initWithCapacity:(NSUInteger)capacity
-                  removalHandler:(PWLRUCacheRemovalHandler)removalHandler NS_DESIGNATED_INITIALIZER;
+                  removalHandler:(PWLRUCacheRemovalHandler)removalHandler;
 
 - (instancetype)initWithCapacity:(NSUInteger)capacity
               shouldEvictHandler:(PWLRUCacheShouldEvictHandler)shouldEvictHandler
@@ -50,7 +71,14 @@ typedef void(^PWLRUCacheObjectCreationBlock)(id key, PWLRUCacheObjectResponseBlo
 - (void)disposeWithCompletionHandler:(PWDispatchBlock)completionHandler;
 
 @property (nonatomic, readonly)         NSUInteger                  capacity;
-@property (nonatomic, readonly, copy)   PWLRUCacheRemovalHandler    removalHandler;
+@property (nonatomic, readonly)         PWLRUCachePolicy            policy;
+@property (nonatomic, readonly, copy, nullable) PWLRUCacheRemovalHandler    removalHandler;    // nil for a batch removal handler
+@property (nonatomic, readonly, copy)   PWLRUCacheBatchRemovalHandler   batchRemovalHandler;
+
+// The maximum number of objects passed to the batch removal handler at once. Defaults to 128.
+// Optional evictions of many objects release the cache between the batches, so lookups are only held up while the
+// handler decides about one batch. Explicit removals keep the cache on hold until all objects are removed.
+@property (atomic, readwrite)           NSUInteger                  removalBatchSize;
 
 - (void)setObject:(nullable ObjectType)object
            forKey:(KeyType)key;
@@ -72,6 +100,20 @@ typedef void(^PWLRUCacheObjectCreationBlock)(id key, PWLRUCacheObjectResponseBlo
 // Is called when memory pressure occurs.
 - (void)evictAsManyObjectsAsPossibleWithCompletionHandler:(PWDispatchBlock)completionHandler;
 
+// Asynchronously makes the receiver share the budget of 'coordinator', which then also handles memory pressure for it.
+// Can only be called once. Evictions on behalf of the coordinator are optional removals.
+- (void)joinBudgetCoordinator:(PWCacheBudgetCoordinator*)coordinator
+                         name:(NSString*)name
+                       weight:(double)weight
+                costEstimator:(nullable PWCacheCostEstimator)costEstimator;
+
+@property (atomic, readonly, strong, nullable) PWCacheBudgetRegistration* budgetRegistration;
+
+// Optional disk tier, should be set before the cache is used. Evicted objects which conform to PWCacheSpillable are
+// spilled to the store, and misses take objects back from the store before calling the creation block. Objects which are
+// set or explicitly removed are removed from the store. Keys need to be property list objects.
+@property (atomic, readwrite, strong, nullable) PWCacheSpillStore* spillStore;
+
 #pragma mark - For unit testing
 
 @property (nonatomic, readonly)         NSUInteger              count;
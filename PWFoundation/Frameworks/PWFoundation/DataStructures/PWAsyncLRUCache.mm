@@ -10,6 +10,9 @@
 #import "NSArray-PWExtensions.h"
 #import <unordered_map>
 #import <list>
+#import <memory>
+#import <vector>
+#import "PWCachePolicy.hpp"
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -29,15 +32,48 @@ struct EqualTo
     }
 };
 
-typedef std::pair<id, id> KeyObjectPair;
-typedef std::list<KeyObjectPair> List;
-typedef std::list<KeyObjectPair>::iterator ListIterator;
+// The cost is only estimated while the cache has joined a budget coordinator.
+struct KeyObjectPair
+{
+    id                              first;
+    id                              second;
+    NSUInteger                      cost;
+    PWFoundation::cache_segment     segment;
+};
+
+typedef PWFoundation::cache_policy<KeyObjectPair, Hash> Policy;
+typedef Policy::iterator ListIterator;
+typedef std::vector<ListIterator> Batch;
+
+static const NSUInteger PWAsyncLRUCacheDefaultRemovalBatchSize = 128;
 
-typedef void (^EnumerationObjectCompletionHandler) (BOOL eraseObjectFromList);
+// Offers the objects of a batch one after the other to 'removalHandler'.
+static PWLRUCacheBatchRemovalHandler PWBatchRemovalHandlerWithRemovalHandler (PWLRUCacheRemovalHandler removalHandler)
+{
+    return ^(NSArray* keys, NSArray* objects, BOOL isOptional, PWLRUCacheBatchRemovalResponseHandler responseHandler) {
+        NSMutableIndexSet* removableIndexes = [NSMutableIndexSet indexSet];
+        __block NSUInteger index = 0;
+        [keys asynchronouslyEnumerateObjectsUsingBlock:^(id key,
+                                                         PWAsynchronousEnumerationObjectCompletionHandler objectCompletionHandler) {
+            NSUInteger objectIndex = index++;
+            removalHandler(key, objects[objectIndex], isOptional, ^(BOOL shouldRemove) {
+                if(shouldRemove)
+                    [removableIndexes addIndex:objectIndex];
+                objectCompletionHandler(/* stop */ NO, /* error */nil);
+            });
+        } completionHandler:^(BOOL didFinish, NSError * _Nullable lastError) {
+            responseHandler(removableIndexes);
+        }];
+    };
+}
+
+@interface PWAsyncLRUCache ()
+@property (atomic, readwrite, strong, nullable) PWCacheBudgetRegistration* budgetRegistration;
+@end
 
 @implementation PWAsyncLRUCache
 {
-    List _leastRecentUsageList;
+    Policy _policy;
     std::unordered_map<__unsafe_unretained id, ListIterator, Hash, EqualTo> _map;
     PWDispatchMemoryPressureObserver* _memoryPressureObserver;
     PWDispatchQueue* _dispatchQueue;
@@ -45,22 +81,49 @@ typedef void (^EnumerationObjectCompletionHandler) (BOOL eraseObjectFromList);
 }
 
 - (instancetype)initWithCapacity:(NSUInteger)capacity
-                  removalHandler:(PWLRUCacheRemovalHandler)removalHandler
+                          policy:(PWLRUCachePolicy)policy
+             batchRemovalHandler:(PWLRUCacheBatchRemovalHandler)batchRemovalHandler
 {
     NSParameterAssert(capacity != NSNotFound && capacity > 0);
-    NSParameterAssert(removalHandler);
+    NSParameterAssert(batchRemovalHandler);
 
     self = [super init];
 
     _capacity = capacity;
+    _policy.configure(capacity, /* tiny_lfu */ policy == PWLRUCachePolicyWTinyLFU);
     _dispatchQueue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWAsyncLRUCache"];
     _callbackQueue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWAsyncLRUCache_callback"];
-    _removalHandler = [removalHandler copy];
+    _batchRemovalHandler = [batchRemovalHandler copy];
+    _removalBatchSize = PWAsyncLRUCacheDefaultRemovalBatchSize;
     [self createMemoryPressureObserver];
 
     return self;
 }
 
+- (instancetype)initWithCapacity:(NSUInteger)capacity
+                          policy:(PWLRUCachePolicy)policy
+                  removalHandler:(PWLRUCacheRemovalHandler)removalHandler
+{
+    NSParameterAssert(removalHandler);
+
+    if (self = [self initWithCapacity:capacity
+                               policy:policy
+                  batchRemovalHandler:PWBatchRemovalHandlerWithRemovalHandler(removalHandler)])
+        _removalHandler = [removalHandler copy];
+    return self;
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity
+                  removalHandler:(PWLRUCacheRemovalHandler)removalHandler
+{
+    return [self initWithCapacity:capacity policy:PWLRUCachePolicyLRU removalHandler:removalHandler];
+}
+
+- (PWLRUCachePolicy)policy
+{
+    return _policy.is_tiny_lfu() ? PWLRUCachePolicyWTinyLFU : PWLRUCachePolicyLRU;
+}
+
 - (instancetype)initWithCapacity:(NSUInteger)capacity
               shouldEvictHandler:(PWLRUCacheShouldEvictHandler)shouldEvictHandler
                willRemoveHandler:(PWLRUCacheWillRemoveHandler)willRemoveHandler
@@ -101,11 +164,13 @@ typedef void (^EnumerationObjectCompletionHandler) (BOOL eraseObjectFromList);
     NSParameterAssert(completionHandler);
     
     [_dispatchQueue asynchronouslyDispatchBlock:^{
-        if(_removalHandler)
+        if(_batchRemovalHandler)
         {
             [_memoryPressureObserver cancel];
             [self removeAllObjectsWithCompletionHandler:^{
+                [self.budgetRegistration invalidate];
                 _removalHandler = nil;
+                _batchRemovalHandler = nil;
                 completionHandler();
             }];
         }
@@ -124,33 +189,76 @@ typedef void (^EnumerationObjectCompletionHandler) (BOOL eraseObjectFromList);
         auto match = _map.find(key);
         if (match == _map.end())
         {
-            if(creationBlock)
+            [self.budgetRegistration recordMiss];
+            _policy.record_miss(key);
+            // The queue of the spill store can be busy with serializing and compacting, only wait for it if the object
+            // may have been spilled.
+            PWCacheSpillStore* spillStore = self.spillStore;
+            if(![spillStore mayContainObjectForKey:key])
+                spillStore = nil;
+            if(spillStore || creationBlock)
             {
-                // While we are creating a new object, no further modifications and requests to the cache
+                // While we are reading back or creating a new object, no further modifications and requests to the cache
                 // are allowed to avoid uniqueness races.
                 [_dispatchQueue suspend];
-                [_callbackQueue asynchronouslyDispatchBlock:^{
-                    creationBlock(key, ^(id object) {
-                        [_callbackQueue dynamicallyDispatchBlock:^{
-                            [self _setObject:object forKey:key];
-                            [_dispatchQueue resume];
-                            completionHandler(/* object */ object);
-                        }];
-                    });
-                }];
+                if(spillStore)
+                    [spillStore takeObjectForKey:key
+                                           queue:_callbackQueue
+                               completionHandler:^(id _Nullable spilledObject) {
+                                   if(spilledObject)
+                                       [self didCreateObject:spilledObject forKey:key completionHandler:completionHandler];
+                                   else
+                                       [self createObjectForKey:key creationBlock:creationBlock completionHandler:completionHandler];
+                               }];
+                else
+                    [_callbackQueue asynchronouslyDispatchBlock:^{
+                        [self createObjectForKey:key creationBlock:creationBlock completionHandler:completionHandler];
+                    }];
             }
             else
                 completionHandler(/* object */ nil);
         }
         else
         {
-            // Everytime an object is returned, move it to the front of the least recent usage list.
-            _leastRecentUsageList.splice(_leastRecentUsageList.begin(), _leastRecentUsageList, match->second);
+            [self.budgetRegistration recordHit];
+            // Everytime an object is returned, move it to the front of its usage list.
+            _policy.touch(match->second);
             completionHandler(match->second->second);
         }
     }];
 }
 
+// Needs to be called on the callback queue while _dispatchQueue is suspended.
+- (void)createObjectForKey:(id)key
+             creationBlock:(nullable PWLRUCacheObjectCreationBlock)creationBlock
+         completionHandler:(void (^)(id _Nullable object))completionHandler
+{
+    NSAssert(_callbackQueue.isCurrentDispatchQueue, nil);
+
+    if(!creationBlock)
+    {
+        [_dispatchQueue resume];
+        completionHandler(/* object */ nil);
+        return;
+    }
+    creationBlock(key, ^(id object) {
+        [_callbackQueue dynamicallyDispatchBlock:^{
+            [self didCreateObject:object forKey:key completionHandler:completionHandler];
+        }];
+    });
+}
+
+- (void)didCreateObject:(id)object
+                 forKey:(id)key
+      completionHandler:(void (^)(id _Nullable object))completionHandler
+{
+    NSAssert(_callbackQueue.isCurrentDispatchQueue, nil);
+
+    [self _setObject:object forKey:key];
+    [_dispatchQueue resume];
+    completionHandler(/* object */ object);
+}
+
 - (void)objectForKey:(id)key
    completionHandler:(void (^)(id _Nullable object))completionHandler
 {
@@ -164,6 +272,9 @@ typedef void (^EnumerationObjectCompletionHandler) (BOOL eraseObjectFromList);
     NSParameterAssert(key);
 
     [_dispatchQueue asynchronouslyDispatchBlock:^{
+        // An older object for the key must not come back from the spill store. Evictions only happen while
+        // _dispatchQueue is suspended, so an older object cannot be spilled after this.
+        [self.spillStore removeObjectForKey:key];
         [self _removeObjectForKey:key
                 completionHandler:^{
                     NSAssert(_dispatchQueue.isCurrentDispatchQueue || _callbackQueue.isCurrentDispatchQueue, nil);
@@ -172,7 +283,7 @@ typedef void (^EnumerationObjectCompletionHandler) (BOOL eraseObjectFromList);
                         [self _setObject:object forKey:key];
 
                         if (_map.size() > _capacity)
-                            [self removeLeastRecentlyUsedObject];
+                            [self removeVictimObject];
                     }
                 }];
     }];
@@ -188,23 +299,15 @@ typedef void (^EnumerationObjectCompletionHandler) (BOOL eraseObjectFromList);
     auto it = _map.find(key);
     if (it != _map.end())
     {
+        Batch batch(1, it->second);
         [_dispatchQueue suspend];
         [_callbackQueue asynchronouslyDispatchBlock:^{
-            NSCAssert(_removalHandler, @"cache has been disposed");
-            _removalHandler(/* key */ it->second->first,
-                            /* object */ it->second->second,
-                            /* isOptional */ NO,
-                            /* responseHandler */^(BOOL shouldRemove) {
-                                [_callbackQueue dynamicallyDispatchBlock:^{
-                                    // Note: It is correct to access the ivars on the removal queue
-                                    //       because _dispatchQueue is suspended.
-                                    NSCAssert(shouldRemove, nil);
-                                    _leastRecentUsageList.erase(it->second);
-                                    _map.erase(it);
-                                    completionHandler();    // Note: It is intentional, that the completion handler gets called before resume
-                                    [_dispatchQueue resume];
-                                }];
-                            });
+            [self removeBatch:batch
+                   isOptional:NO
+            completionHandler:^(unsigned long long removedByteCount) {
+                completionHandler();    // Note: It is intentional, that the completion handler gets called before resume
+                [_dispatchQueue resume];
+            }];
         }];
     }
     else
@@ -215,36 +318,25 @@ typedef void (^EnumerationObjectCompletionHandler) (BOOL eraseObjectFromList);
           completionHandler:(PWDispatchBlock)completionHandler
 {
     [_dispatchQueue asynchronouslyDispatchBlock:^{
-        [_dispatchQueue suspend];
-        [_callbackQueue asynchronouslyDispatchBlock:^{
-            [keys asynchronouslyEnumerateObjectsUsingBlock:^(id iKey,
-                                                             PWAsynchronousEnumerationObjectCompletionHandler objectCompletionHandler) {
-                auto it = _map.find(iKey);
-                if(it != _map.end())
-                {
-                    NSCAssert(_removalHandler, @"cache has been disposed");
-                    _removalHandler(/* key */ it->second->first,
-                                    /* object */ it->second->second,
-                                    /* isOptional */ NO,
-                                    /* responseHandler */^(BOOL shouldRemove) {
-                                        [_callbackQueue dynamicallyDispatchBlock:^{
-                                            // Note: It is correct to access the ivars on the removal queue
-                                            //       because _dispatchQueue is suspended.
-                                            NSCAssert(shouldRemove, nil);
-                                            _leastRecentUsageList.erase(it->second);
-                                            _map.erase(it);
-                                            objectCompletionHandler(/* stop */ NO, /* error */nil);
-                                        }];
-                                    });
-                }
-                else
-                    objectCompletionHandler(/* stop */ NO, /* error */nil);
+        PWCacheSpillStore* spillStore = self.spillStore;
+        for(id iKey in keys)
+            [spillStore removeObjectForKey:iKey];
 
-            } completionHandler:^(BOOL didFinish, NSError * _Nullable lastError) {
-                [_dispatchQueue resume];
-                completionHandler();
-            }];
-        }];
+        // Duplicate keys must not end up twice in a batch.
+        auto entries = std::make_shared<Batch>();
+        for(id iKey in [NSOrderedSet orderedSetWithArray:keys])
+        {
+            auto it = _map.find(iKey);
+            if(it != _map.end())
+                entries->push_back(it->second);
+        }
+        [_dispatchQueue suspend];
+        [self removeEntries:entries
+                 fromIndex:0
+         completionHandler:^{
+             [_dispatchQueue resume];
+             completionHandler();
+         }];
     }];
 }
 
@@ -253,8 +345,10 @@ typedef void (^EnumerationObjectCompletionHandler) (BOOL eraseObjectFromList);
 {
     NSAssert(_dispatchQueue.isCurrentDispatchQueue || _callbackQueue.isCurrentDispatchQueue, nil);
 
-    _leastRecentUsageList.push_front(KeyObjectPair(key, object));
-    _map[key] = _leastRecentUsageList.begin();
+    PWCacheBudgetRegistration* registration = self.budgetRegistration;
+    NSUInteger cost = registration ? [registration costForKey:key object:object] : 0;
+    _map[key] = _policy.insert(KeyObjectPair{key, object, cost});
+    [registration didAddCost:cost];
 }
 
 - (void)allObjectsWithCompletionHandler:(void (^)(NSArray* allObjects))completionHandler
@@ -267,36 +361,25 @@ typedef void (^EnumerationObjectCompletionHandler) (BOOL eraseObjectFromList);
     }];
 }
 
-- (void)removeLeastRecentlyUsedObject
+- (void)removeVictimObject
 {
     NSAssert(_dispatchQueue.isCurrentDispatchQueue || _callbackQueue.isCurrentDispatchQueue, nil);
 
-    if(_leastRecentUsageList.empty())
+    // The least recently used object, or the less frequently used one of two candidates in W-TinyLFU mode.
+    ListIterator last;
+    if(!_policy.victim(last))
         return;
 
-    auto last = _leastRecentUsageList.end();
-    last--;
-
     // While we are asking the remove handler for permission to remove we need to put
     // pending and future requests to the cache on hold.
+    Batch batch(1, last);
     [_dispatchQueue suspend];
     [_callbackQueue dynamicallyDispatchBlock:^{
-        NSCAssert(_removalHandler, @"cache has been disposed");
-        _removalHandler(/* key */ last->first,
-                        /* object */ last->second,
-                        /* isOptional */ YES,
-                        /* responseHandler */^(BOOL shouldRemove) {
-                            [_callbackQueue dynamicallyDispatchBlock:^{
-                                // Note: It is correct to access the ivars on the removal queue
-                                //       because _dispatchQueue is suspended.
-                                if(shouldRemove)
-                                {
-                                    _map.erase(last->first);
-                                    _leastRecentUsageList.pop_back();
-                                }
-                                [_dispatchQueue resume];
-                            }];
-                        });
+        [self removeBatch:batch
+               isOptional:YES
+        completionHandler:^(unsigned long long removedByteCount) {
+            [_dispatchQueue resume];
+        }];
     }];
 }
 
@@ -305,30 +388,20 @@ typedef void (^EnumerationObjectCompletionHandler) (BOOL eraseObjectFromList);
     NSParameterAssert(completionHandler);
 
     [_dispatchQueue asynchronouslyDispatchBlock:^{
+        [self.spillStore removeAllObjects];
+        auto entries = std::make_shared<Batch>();
+        entries->reserve(_map.size());
+        for(auto list : _policy.lists_in_eviction_order())
+            for(auto it = list->begin(); it != list->end(); ++it)
+                entries->push_back(it);
         [_dispatchQueue suspend];
-        [self asynchronouslyEnumerateList:_leastRecentUsageList
-                                  onQueue:_callbackQueue
-                               usingBlock:^(id iKey,
-                                            id iObject,
-                                            EnumerationObjectCompletionHandler objectCompletionHandler) {
-                                   NSCAssert(_callbackQueue.isCurrentDispatchQueue, nil);
-                                   NSCAssert(_removalHandler, @"cache has been disposed");
-                                   _removalHandler(iKey, iObject,
-                                                   /* isOptional */ NO,
-                                                   /* responseHandler */^(BOOL shouldRemove) {
-                                                       NSCAssert(shouldRemove, nil);
-                                                       objectCompletionHandler(/* eraseObjectFromList */ NO);
-                                                   });
-
-                               } completionHandler:^{
-                                   NSCAssert(_callbackQueue.isCurrentDispatchQueue, nil);
-                                   // Note: It is correct to access the ivars on the removal queue
-                                   //       because _dispatchQueue is suspended.
-                                   _map.clear();
-                                   _leastRecentUsageList.clear();
-                                   [_dispatchQueue resume];
-                                   completionHandler();
-                               }];
+        [self removeEntries:entries
+                 fromIndex:0
+         completionHandler:^{
+             NSCAssert(_map.empty(), nil);
+             [_dispatchQueue resume];
+             completionHandler();
+         }];
     }];
 }
 
@@ -336,92 +409,166 @@ typedef void (^EnumerationObjectCompletionHandler) (BOOL eraseObjectFromList);
 - (void)evictAsManyObjectsAsPossibleWithCompletionHandler:(PWDispatchBlock)completionHandler
 {
     [_dispatchQueue asynchronouslyDispatchBlock:^{
-        [_dispatchQueue suspend];
-        [self asynchronouslyEnumerateList:_leastRecentUsageList
-                                  onQueue:_callbackQueue
-                               usingBlock:^(id iKey,
-                                            id iObject,
-                                            EnumerationObjectCompletionHandler objectCompletionHandler) {
-                                   NSCAssert(_callbackQueue.isCurrentDispatchQueue, nil);
-                                   NSCAssert(_removalHandler, @"cache has been disposed");
-                                   _removalHandler(iKey, iObject,
-                                                   /* isOptional */ YES,
-                                                   /* responseHandler */^(BOOL shouldRemove) {
-                                                       [_callbackQueue dynamicallyDispatchBlock:^{
-                                                           // Note: It is correct to access the ivars on the removal queue
-                                                           //       because _dispatchQueue is suspended.
-                                                           if(shouldRemove)
-                                                               _map.erase(iKey);
-                                                           objectCompletionHandler(/* eraseObjectFromList */ shouldRemove);
-                                                       }];
-                                                   });
-
-                               } completionHandler:^{
-                                   NSCAssert(_callbackQueue.isCurrentDispatchQueue, nil);
-                                   [_dispatchQueue resume];
-                                   completionHandler();
-                               }];
+        [self evictObjectsWorthBytes:ULLONG_MAX
+                        maximumCount:_map.size()
+                   completionHandler:completionHandler];
     }];
 }
 
-- (void) asynchronouslyEnumerateList:(List&)list
-                             onQueue:(PWDispatchQueue*)queue
-                          usingBlock:(void(^)(id iKey,
-                                              id iObject,
-                                              EnumerationObjectCompletionHandler objectCompletionHandler))block
-                   completionHandler:(PWDispatchBlock)completionHandler
-{
-    NSParameterAssert (block);
-    NSParameterAssert (queue);
-    NSParameterAssert (completionHandler);
-
-    // Start with the first element.
-    [self asynchronouslyVisitObject:list.begin()
-                             ofList:list
-                            onQueue:queue
-                         usingBlock:block
-                  completionHandler:completionHandler];
+// Needs to be called on the callback queue while _dispatchQueue is suspended. Offers the entries of the batch to the
+// removal handler and erases the ones it accepts, evicted objects go to the spill store. Entries whose optional removal
+// has been refused move to the front of their usage list. Calls 'completionHandler' on the callback queue with the cost of the erased entries.
+- (void)removeBatch:(const Batch&)batch
+         isOptional:(BOOL)isOptional
+  completionHandler:(void (^)(unsigned long long removedByteCount))completionHandler
+{
+    NSParameterAssert(completionHandler);
+    NSAssert(_callbackQueue.isCurrentDispatchQueue, nil);
+    NSAssert(_batchRemovalHandler, @"cache has been disposed");
+
+    NSMutableArray* keys    = [NSMutableArray arrayWithCapacity:batch.size()];
+    NSMutableArray* objects = [NSMutableArray arrayWithCapacity:batch.size()];
+    for(auto it : batch)
+    {
+        [keys addObject:it->first];
+        [objects addObject:it->second];
+    }
+
+    Batch entries = batch;
+    _batchRemovalHandler(keys, objects, isOptional, ^(NSIndexSet* removableIndexes) {
+        [_callbackQueue dynamicallyDispatchBlock:^{
+            // Note: It is correct to access the ivars on the removal queue
+            //       because _dispatchQueue is suspended.
+            NSCAssert(isOptional || removableIndexes.count == entries.size(), nil);
+            PWCacheBudgetRegistration* registration = self.budgetRegistration;
+            PWCacheSpillStore* spillStore = isOptional ? self.spillStore : nil;
+            unsigned long long removedByteCount = 0;
+            for(NSUInteger index = 0; index < entries.size(); index++)
+            {
+                ListIterator it = entries[index];
+                if([removableIndexes containsIndex:index])
+                {
+                    removedByteCount += it->cost;
+                    [registration didRemoveCost:it->cost evicted:isOptional];
+                    if([it->second conformsToProtocol:@protocol(PWCacheSpillable)])
+                        [spillStore spillObject:it->second forKey:it->first];
+                    _map.erase(it->first);
+                    _policy.erase(it);
+                }
+                else
+                    _policy.refresh(it);
+            }
+            completionHandler(removedByteCount);
+        }];
+    });
 }
 
-- (void) asynchronouslyVisitObject:(ListIterator)objectIt
-                            ofList:(List&)list
-                           onQueue:(PWDispatchQueue*)queue
-                        usingBlock:(void(^)(id iKey,
-                                            id iObject,
-                                            EnumerationObjectCompletionHandler objectCompletionHandler))block
-                 completionHandler:(PWDispatchBlock)completionHandler
+// Needs to be called while _dispatchQueue is suspended. Removes the entries from 'index' on in batches.
+- (void)removeEntries:(std::shared_ptr<const Batch>)entries
+            fromIndex:(size_t)index
+    completionHandler:(PWDispatchBlock)completionHandler
 {
-    NSParameterAssert (block);
-    NSParameterAssert (completionHandler);
+    NSParameterAssert(completionHandler);
+
+    size_t batchSize = MAX(self.removalBatchSize, (NSUInteger)1);
 
-    [queue asynchronouslyDispatchBlock:^{
-        if (objectIt == list.end()) {
-            completionHandler ();
+    // Every batch starts with a queue hop, so the stack does not grow with the number of batches.
+    [_callbackQueue asynchronouslyDispatchBlock:^{
+        if(index >= entries->size())
+        {
+            completionHandler();
             return;
         }
-        block (/* iKey */ objectIt->first,
-               /* iObject */ objectIt->second,
-               /* objectCompletionHandler */ ^(BOOL eraseObjectFromList)
-               {
-                   if(eraseObjectFromList)
-                   {
-                       [self asynchronouslyVisitObject:_leastRecentUsageList.erase(objectIt)
-                                                ofList:list
-                                               onQueue:queue
-                                            usingBlock:block
-                                     completionHandler:completionHandler];
-                   }
-                   else
-                   {
-                       ListIterator nextObjectIt = objectIt;
-                       ++nextObjectIt;
-                       [self asynchronouslyVisitObject:nextObjectIt
-                                                ofList:list
-                                               onQueue:queue
-                                            usingBlock:block
-                                     completionHandler:completionHandler];
-                   }
-               });
+        size_t endIndex = MIN(index + batchSize, entries->size());
+        Batch batch(entries->begin() + index, entries->begin() + endIndex);
+        [self removeBatch:batch
+               isOptional:NO
+        completionHandler:^(unsigned long long removedByteCount) {
+            [self removeEntries:entries
+                      fromIndex:endIndex
+              completionHandler:completionHandler];
+        }];
+    }];
+}
+
+// Needs to be called on _dispatchQueue. Offers the objects from the least valuable one on in batches for optional
+// removal, until objects worth 'byteCount' bytes are removed or 'maximumCount' objects have been offered. As refused
+// objects move to the front of their usage lists, every object is offered at most once. _dispatchQueue is only suspended
+// while the removal handler decides about a batch. Calls 'completionHandler' on any queue.
+- (void)evictObjectsWorthBytes:(unsigned long long)byteCount
+                  maximumCount:(NSUInteger)maximumCount
+             completionHandler:(PWDispatchBlock)completionHandler
+{
+    NSParameterAssert(completionHandler);
+    NSAssert(_dispatchQueue.isCurrentDispatchQueue, nil);
+
+    Batch batch;
+    if(_batchRemovalHandler)
+    {
+        NSUInteger batchSize = MIN(MAX(self.removalBatchSize, (NSUInteger)1), maximumCount);
+        unsigned long long batchByteCount = 0;
+        for(auto list : _policy.lists_in_eviction_order())
+            for(auto it = list->end(); it != list->begin() && batch.size() < batchSize && batchByteCount < byteCount; )
+            {
+                --it;
+                batch.push_back(it);
+                batchByteCount += it->cost;
+            }
+    }
+    if(batch.empty() || byteCount == 0)
+    {
+        completionHandler();
+        return;
+    }
+
+    [_dispatchQueue suspend];
+    [_callbackQueue asynchronouslyDispatchBlock:^{
+        [self removeBatch:batch
+               isOptional:YES
+        completionHandler:^(unsigned long long removedByteCount) {
+            [_dispatchQueue resume];
+            [_dispatchQueue asynchronouslyDispatchBlock:^{
+                [self evictObjectsWorthBytes:byteCount - MIN(byteCount, removedByteCount)
+                                maximumCount:maximumCount - batch.size()
+                           completionHandler:completionHandler];
+            }];
+        }];
+    }];
+}
+
+#pragma mark - Budget
+
+- (void)joinBudgetCoordinator:(PWCacheBudgetCoordinator*)coordinator
+                         name:(NSString*)name
+                       weight:(double)weight
+                costEstimator:(nullable PWCacheCostEstimator)costEstimator
+{
+    NSParameterAssert(coordinator);
+
+    [_dispatchQueue asynchronouslyDispatchBlock:^{
+        NSAssert(!self.budgetRegistration, @"cache has already joined a budget coordinator");
+
+        PWCacheBudgetRegistration* registration = [coordinator registerCache:self name:name weight:weight costEstimator:costEstimator];
+        _policy.for_each([&](KeyObjectPair& iPair) {
+            iPair.cost = [registration costForKey:iPair.first object:iPair.second];
+            [registration didAddCost:iPair.cost];
+        });
+        self.budgetRegistration = registration;
+
+        // From now on the coordinator handles memory pressure.
+        [_memoryPressureObserver cancel];
+        _memoryPressureObserver = nil;
+    }];
+}
+
+- (void)shedBytes:(unsigned long long)byteCount completionHandler:(PWDispatchBlock)completionHandler
+{
+    NSParameterAssert(completionHandler);
+
+    [_dispatchQueue asynchronouslyDispatchBlock:^{
+        [self evictObjectsWorthBytes:byteCount
+                        maximumCount:_map.size()
+                   completionHandler:completionHandler];
     }];
 }
 
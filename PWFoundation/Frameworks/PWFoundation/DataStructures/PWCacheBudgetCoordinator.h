@@ -0,0 +1,113 @@
+//
+//  PWCacheBudgetCoordinator.h
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import <PWFoundation/PWDispatchObject.h>    // for PWDispatchBlock
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class PWCacheBudgetRegistration;
+
+// Estimates the number of bytes an entry of a cache keeps alive. Must not have side effects, it is called on the queue
+// of the cache.
+typedef NSUInteger (^PWCacheCostEstimator)(id key, id object);
+
+// Rough default: the instance sizes of key and object plus the contents of data and strings.
+PWCacheCostEstimator PWCacheDefaultCostEstimator (void);
+
+// Implemented by caches which can join a PWCacheBudgetCoordinator.
+@protocol PWBudgetedCache <NSObject>
+
+// Asks the cache to evict its least recently used objects worth at least 'byteCount' bytes, or as many as it can.
+// Called on an arbitrary queue. The cache reports the evictions through its registration and calls 'completionHandler'
+// on any queue when it is done.
+- (void)shedBytes:(unsigned long long)byteCount completionHandler:(PWDispatchBlock)completionHandler;
+
+@end
+
+// A snapshot of the counters of one registered cache.
+@interface PWCacheStatistics : NSObject
+
+@property (nonatomic, readonly, copy)   NSString*           name;
+@property (nonatomic, readonly)         double              weight;
+@property (nonatomic, readonly)         unsigned long long  byteSize;
+@property (nonatomic, readonly)         NSUInteger          count;
+@property (nonatomic, readonly)         unsigned long long  hitCount;
+@property (nonatomic, readonly)         unsigned long long  missCount;
+@property (nonatomic, readonly)         unsigned long long  evictionCount;
+@property (nonatomic, readonly)         double              hitRate;    // 0.0 without any lookup
+
+@end
+
+// A process-wide memory budget shared by all caches which join the coordinator.
+//
+// Each cache registers with a weight and a cost estimator and reports lookups, additions and removals through its
+// registration. When the total size of all caches exceeds the budget, the coordinator asks the caches to shed down to
+// 90% of the budget. The bytes to shed are distributed proportionally to the size of a cache divided by its weight and
+// by its hit rate since the last enforcement, so cold caches shed most and hot caches keep their working sets.
+//
+// The coordinator also handles memory pressure for its caches, which therefore no longer flush on their own: on a
+// warning the caches shed half of their total size by the same rule, on a critical event they shed everything they can.
+@interface PWCacheBudgetCoordinator : NSObject
+
+// Is created on first use with a budget of an eighth of the physical memory.
++ (PWCacheBudgetCoordinator*)sharedCoordinator;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+- (instancetype)initWithByteBudget:(unsigned long long)byteBudget NS_DESIGNATED_INITIALIZER;   // 0 means unlimited
+
+// Can be changed at any time, a lower budget is enforced immediately.
+@property (atomic, readwrite)   unsigned long long  byteBudget;
+
+@property (atomic, readonly)    unsigned long long  totalByteSize;
+
+// The cache is referenced weakly. It leaves the coordinator when the registration is invalidated or deallocated.
+// 'costEstimator' defaults to PWCacheDefaultCostEstimator().
+- (PWCacheBudgetRegistration*)registerCache:(id<PWBudgetedCache>)cache
+                                       name:(NSString*)name
+                                     weight:(double)weight                  // > 0, relative to the other caches
+                              costEstimator:(nullable PWCacheCostEstimator)costEstimator;
+
+// The statistics of all registered caches, ordered by registration.
+@property (atomic, readonly, copy) NSArray<PWCacheStatistics*>* statistics;
+
+// Is called automatically when a cache grows beyond the budget. 'completionHandler' is called on a private queue when
+// all caches asked so far have finished shedding, including the ones asked by earlier calls.
+- (void)enforceBudgetWithCompletionHandler:(nullable PWDispatchBlock)completionHandler;
+
+// Is called when memory pressure occurs.
+- (void)shedForMemoryPressure:(dispatch_source_memorypressure_flags_t)level
+            completionHandler:(nullable PWDispatchBlock)completionHandler;
+
+@end
+
+// The connection of one cache to its coordinator. The reporting methods can be called on any queue and are cheap.
+@interface PWCacheBudgetRegistration : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
+
+@property (nonatomic, readonly, weak)   PWCacheBudgetCoordinator*   coordinator;
+@property (nonatomic, readonly, copy)   NSString*                   name;
+@property (nonatomic, readonly)         double                      weight;
+@property (nonatomic, readonly)         BOOL                        isValid;
+@property (atomic, readonly, strong)    PWCacheStatistics*          statistics;
+
+// Applies the cost estimator of the registration.
+- (NSUInteger)costForKey:(id)key object:(id)object;
+
+- (void)recordHit;
+- (void)recordMiss;
+- (void)didAddCost:(NSUInteger)cost;
+- (void)didRemoveCost:(NSUInteger)cost evicted:(BOOL)evicted;     // 'evicted' for removals the cache decided on
+
+// Leaves the coordinator and takes the remaining size of the cache out of its total.
+- (void)invalidate;
+
+@end
+
+NS_ASSUME_NONNULL_END
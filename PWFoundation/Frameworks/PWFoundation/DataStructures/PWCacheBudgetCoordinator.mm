@@ -0,0 +1,407 @@
+//
+//  PWCacheBudgetCoordinator.mm
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import "PWCacheBudgetCoordinator.h"
+#import "PWDispatch.h"
+#import <objc/runtime.h>
+#import <atomic>
+#import <vector>
+
+NS_ASSUME_NONNULL_BEGIN
+
+// Caches shed down to this fraction of the budget, which keeps the enforcement from running on every addition.
+static const double PWCacheBudgetLowWatermark = 0.9;
+
+// Added to the hit rates, so caches without lookups since the last enforcement still compare by weight and size.
+static const double PWCacheBudgetHitRateBias = 0.01;
+
+static NSUInteger PWCacheEntryCost (id entry)
+{
+    NSUInteger cost = class_getInstanceSize (object_getClass (entry));
+    if ([entry isKindOfClass:NSData.class])
+        cost += [(NSData*)entry length];
+    else if ([entry isKindOfClass:NSString.class])
+        cost += [(NSString*)entry length] * sizeof (unichar);
+    return cost;
+}
+
+PWCacheCostEstimator PWCacheDefaultCostEstimator (void)
+{
+    return ^NSUInteger (id key, id object) {
+        return PWCacheEntryCost (key) + PWCacheEntryCost (object);
+    };
+}
+
+@interface PWCacheStatistics ()
+@property (nonatomic, readwrite, copy)  NSString*           name;
+@property (nonatomic, readwrite)        double              weight;
+@property (nonatomic, readwrite)        unsigned long long  byteSize;
+@property (nonatomic, readwrite)        NSUInteger          count;
+@property (nonatomic, readwrite)        unsigned long long  hitCount;
+@property (nonatomic, readwrite)        unsigned long long  missCount;
+@property (nonatomic, readwrite)        unsigned long long  evictionCount;
+@end
+
+@implementation PWCacheStatistics
+
+- (double)hitRate
+{
+    unsigned long long lookupCount = _hitCount + _missCount;
+    return lookupCount > 0 ? (double)_hitCount / (double)lookupCount : 0.0;
+}
+
+- (NSString*)description
+{
+    return [NSString stringWithFormat:@"<%@ %@: %llu bytes, %lu objects, hit rate %.2f, %llu evictions>",
+            self.class, _name, _byteSize, (unsigned long)_count, self.hitRate, _evictionCount];
+}
+
+@end
+
+#pragma mark
+
+@interface PWCacheBudgetCoordinator ()
+- (void)cacheDidGrowByCost:(NSUInteger)cost;
+- (void)cacheDidShrinkByCost:(unsigned long long)cost;
+@end
+
+@interface PWCacheBudgetRegistration ()
+{
+@public
+    __weak id<PWBudgetedCache>      _cache;
+    PWCacheCostEstimator            _costEstimator;
+    std::atomic<bool>               _isValid;
+    std::atomic<unsigned long long> _byteSize;
+    std::atomic<NSUInteger>         _count;
+    std::atomic<unsigned long long> _hitCount;
+    std::atomic<unsigned long long> _missCount;
+    std::atomic<unsigned long long> _evictionCount;
+
+    // Only accessed on the internal queue of the coordinator.
+    unsigned long long              _lastHitCount;
+    unsigned long long              _lastMissCount;
+}
+@end
+
+@implementation PWCacheBudgetRegistration
+
+- (instancetype)initWithCoordinator:(PWCacheBudgetCoordinator*)coordinator
+                              cache:(id<PWBudgetedCache>)cache
+                               name:(NSString*)name
+                             weight:(double)weight
+                      costEstimator:(PWCacheCostEstimator)costEstimator
+{
+    NSParameterAssert(coordinator);
+    NSParameterAssert(cache);
+    NSParameterAssert(name);
+    NSParameterAssert(weight > 0.0);
+    NSParameterAssert(costEstimator);
+
+    if ((self = [super init]) != nil)
+    {
+        _coordinator   = coordinator;
+        _cache         = cache;
+        _name          = [name copy];
+        _weight        = weight;
+        _costEstimator = [costEstimator copy];
+        _isValid       = true;
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [self invalidate];
+}
+
+- (BOOL)isValid
+{
+    return _isValid;
+}
+
+- (PWCacheStatistics*)statistics
+{
+    PWCacheStatistics* statistics = [[PWCacheStatistics alloc] init];
+    statistics.name          = _name;
+    statistics.weight        = _weight;
+    statistics.byteSize      = _byteSize;
+    statistics.count         = _count;
+    statistics.hitCount      = _hitCount;
+    statistics.missCount     = _missCount;
+    statistics.evictionCount = _evictionCount;
+    return statistics;
+}
+
+- (NSUInteger)costForKey:(id)key object:(id)object
+{
+    return _costEstimator(key, object);
+}
+
+- (void)recordHit
+{
+    _hitCount.fetch_add (1, std::memory_order_relaxed);
+}
+
+- (void)recordMiss
+{
+    _missCount.fetch_add (1, std::memory_order_relaxed);
+}
+
+- (void)didAddCost:(NSUInteger)cost
+{
+    if (!_isValid)
+        return;
+    _byteSize += cost;
+    _count++;
+    [_coordinator cacheDidGrowByCost:cost];
+}
+
+- (void)didRemoveCost:(NSUInteger)cost evicted:(BOOL)evicted
+{
+    if (!_isValid)
+        return;
+    if (evicted)
+        _evictionCount.fetch_add (1, std::memory_order_relaxed);
+    _count--;
+    _byteSize -= cost;
+    [_coordinator cacheDidShrinkByCost:cost];
+}
+
+- (void)invalidate
+{
+    if (_isValid.exchange (false))
+        [_coordinator cacheDidShrinkByCost:_byteSize];
+}
+
+@end
+
+#pragma mark
+
+@implementation PWCacheBudgetCoordinator
+{
+    PWDispatchQueue*                    _internalQueue;
+    NSPointerArray*                     _registrations;         // weak
+    PWDispatchMemoryPressureObserver*   _memoryPressureObserver;
+    std::atomic<unsigned long long>     _byteBudget;
+    std::atomic<unsigned long long>     _totalByteSize;
+    std::atomic<bool>                   _isEnforcementScheduled;
+    PWDispatchGroup*                    _sheddingGroup;         // entered for each cache asked to shed
+    unsigned long long                  _requestedByteCount;    // only accessed on _internalQueue
+}
+
++ (PWCacheBudgetCoordinator*)sharedCoordinator
+{
+    static PWCacheBudgetCoordinator* coordinator;
+    PWDispatchOnce(^{
+        coordinator = [[PWCacheBudgetCoordinator alloc] initWithByteBudget:NSProcessInfo.processInfo.physicalMemory / 8];
+    });
+    return coordinator;
+}
+
+- (instancetype)initWithByteBudget:(unsigned long long)byteBudget
+{
+    if ((self = [super init]) != nil)
+    {
+        _byteBudget    = byteBudget;
+        _internalQueue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWCacheBudgetCoordinator"];
+        _registrations = [NSPointerArray weakObjectsPointerArray];
+        _sheddingGroup = [[PWDispatchGroup alloc] init];
+        [self createMemoryPressureObserver];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [_memoryPressureObserver cancel];
+}
+
+- (unsigned long long)byteBudget
+{
+    return _byteBudget;
+}
+
+- (void)setByteBudget:(unsigned long long)byteBudget
+{
+    _byteBudget = byteBudget;
+    [self enforceBudgetWithCompletionHandler:nil];
+}
+
+- (unsigned long long)totalByteSize
+{
+    return _totalByteSize;
+}
+
+- (PWCacheBudgetRegistration*)registerCache:(id<PWBudgetedCache>)cache
+                                       name:(NSString*)name
+                                     weight:(double)weight
+                              costEstimator:(nullable PWCacheCostEstimator)costEstimator
+{
+    PWCacheBudgetRegistration* registration = [[PWCacheBudgetRegistration alloc] initWithCoordinator:self
+                                                                                               cache:cache
+                                                                                                name:name
+                                                                                              weight:weight
+                                                                                       costEstimator:costEstimator ? costEstimator : PWCacheDefaultCostEstimator()];
+    [_internalQueue synchronouslyDispatchBlock:^{
+        [_registrations compact];
+        [_registrations addPointer:(__bridge void*)registration];
+    }];
+    return registration;
+}
+
+- (NSArray<PWCacheStatistics*>*)statistics
+{
+    __block NSArray<PWCacheStatistics*>* statistics;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        NSMutableArray<PWCacheStatistics*>* array = [NSMutableArray array];
+        for (PWCacheBudgetRegistration* iRegistration in self.validRegistrations)
+            [array addObject:iRegistration.statistics];
+        statistics = array;
+    }];
+    return statistics;
+}
+
+- (NSArray<PWCacheBudgetRegistration*>*)validRegistrations
+{
+    PWAssert(_internalQueue.isCurrentDispatchQueue);
+
+    NSMutableArray<PWCacheBudgetRegistration*>* registrations = [NSMutableArray array];
+    for (PWCacheBudgetRegistration* iRegistration in _registrations)
+        if (iRegistration.isValid)
+            [registrations addObject:iRegistration];
+    return registrations;
+}
+
+#pragma mark - Accounting
+
+- (void)cacheDidGrowByCost:(NSUInteger)cost
+{
+    unsigned long long total = (_totalByteSize += cost);
+    unsigned long long budget = _byteBudget;
+    if (budget > 0 && total > budget && !_isEnforcementScheduled.exchange (true))
+        [_internalQueue asynchronouslyDispatchBlock:^{
+            _isEnforcementScheduled = false;
+            [self enforceBudgetAndCallHandler:nil];
+        }];
+}
+
+- (void)cacheDidShrinkByCost:(unsigned long long)cost
+{
+    _totalByteSize -= cost;
+}
+
+#pragma mark - Shedding
+
+- (void)enforceBudgetWithCompletionHandler:(nullable PWDispatchBlock)completionHandler
+{
+    [_internalQueue asynchronouslyDispatchBlock:^{
+        [self enforceBudgetAndCallHandler:completionHandler];
+    }];
+}
+
+- (void)enforceBudgetAndCallHandler:(nullable PWDispatchBlock)completionHandler
+{
+    PWAssert(_internalQueue.isCurrentDispatchQueue);
+
+    // Bytes which have been requested from the caches but not yet shed are not asked for again.
+    unsigned long long budget = _byteBudget;
+    unsigned long long total = _totalByteSize;
+    unsigned long long expectedTotal = total - MIN (total, _requestedByteCount);
+    if (budget > 0 && expectedTotal > budget)
+    {
+        unsigned long long target = (unsigned long long)((double)budget * PWCacheBudgetLowWatermark);
+        [self requestBytes:expectedTotal - target everything:NO];
+    }
+    if (completionHandler)
+        [_sheddingGroup onCompletionDispatchBlock:completionHandler onQueue:_internalQueue];
+}
+
+- (void)shedForMemoryPressure:(dispatch_source_memorypressure_flags_t)level
+            completionHandler:(nullable PWDispatchBlock)completionHandler
+{
+    [_internalQueue asynchronouslyDispatchBlock:^{
+        if (level & DISPATCH_MEMORYPRESSURE_CRITICAL)
+            [self requestBytes:_totalByteSize everything:YES];
+        else if (level & DISPATCH_MEMORYPRESSURE_WARN)
+            [self requestBytes:_totalByteSize / 2 everything:NO];
+        if (completionHandler)
+            [_sheddingGroup onCompletionDispatchBlock:completionHandler onQueue:_internalQueue];
+    }];
+}
+
+// Distributes 'byteCount' over the registered caches proportionally to their sizes divided by their weights and their
+// hit rates since the last call. With 'everything', each cache is asked to shed all of its objects.
+- (void)requestBytes:(unsigned long long)byteCount everything:(BOOL)everything
+{
+    PWAssert(_internalQueue.isCurrentDispatchQueue);
+
+    NSArray<PWCacheBudgetRegistration*>* registrations = self.validRegistrations;
+    std::vector<double> shares;
+    shares.reserve (registrations.count);
+    double shareSum = 0.0;
+    for (PWCacheBudgetRegistration* iRegistration in registrations)
+    {
+        unsigned long long hitCount  = iRegistration->_hitCount;
+        unsigned long long missCount = iRegistration->_missCount;
+        unsigned long long recentHitCount  = hitCount  - iRegistration->_lastHitCount;
+        unsigned long long recentMissCount = missCount - iRegistration->_lastMissCount;
+        iRegistration->_lastHitCount  = hitCount;
+        iRegistration->_lastMissCount = missCount;
+
+        unsigned long long recentLookupCount = recentHitCount + recentMissCount;
+        double hitRate = recentLookupCount > 0 ? (double)recentHitCount / (double)recentLookupCount : 0.0;
+        double share = (double)iRegistration->_byteSize / (iRegistration.weight * (PWCacheBudgetHitRateBias + hitRate));
+        shares.push_back (share);
+        shareSum += share;
+    }
+
+    [registrations enumerateObjectsUsingBlock:^(PWCacheBudgetRegistration* iRegistration, NSUInteger index, BOOL* stop) {
+        unsigned long long size = iRegistration->_byteSize;
+        unsigned long long cacheByteCount = size;
+        if (!everything)
+            cacheByteCount = shareSum > 0.0 ? MIN (size, (unsigned long long)ceil ((double)byteCount * shares[index] / shareSum)) : 0;
+        id<PWBudgetedCache> cache = iRegistration->_cache;
+        if (cacheByteCount == 0 || !cache)
+            return;
+
+        [_sheddingGroup enter];
+        _requestedByteCount += cacheByteCount;
+        [cache shedBytes:cacheByteCount completionHandler:^{
+            [_internalQueue asynchronouslyDispatchBlock:^{
+                _requestedByteCount -= cacheByteCount;
+                // The cache may have shed less than requested or grown meanwhile. Another round only makes sense if it
+                // made progress, caches can refuse evictions.
+                if (iRegistration->_byteSize < size)
+                    [self enforceBudgetAndCallHandler:nil];
+                [_sheddingGroup leave];
+            }];
+        }];
+    }];
+}
+
+#pragma mark - Memory Pressure
+
+- (void)createMemoryPressureObserver
+{
+    NSAssert(!_memoryPressureObserver, nil);
+
+    _memoryPressureObserver = [[PWDispatchMemoryPressureObserver alloc] initWithFlags:DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL
+                                                                        dispatchQueue:_internalQueue];
+    __weak typeof(self) weakSelf = self;
+    __weak PWDispatchMemoryPressureObserver* weakObserver = _memoryPressureObserver;
+    _memoryPressureObserver.eventBlock = ^{
+        typeof(self) strongSelf = weakSelf;
+        dispatch_source_memorypressure_flags_t level = dispatch_source_get_data (weakObserver.underlyingSource);
+        [strongSelf shedForMemoryPressure:level completionHandler:nil];
+    };
+    [_memoryPressureObserver enable];
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,81 @@
+//
+//  PWCacheSpillStore.h
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import <PWFoundation/PWDispatch.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+// Implemented by objects which can be spilled to a PWCacheSpillStore.
+@protocol PWCacheSpillable <NSObject>
+
+// Called on the private queue of the store. Returns nil if the object cannot be spilled.
+- (nullable NSData*)spillData;
+
+// Called on the private queue of the store with data returned by -spillData.
++ (nullable id)objectWithSpillData:(NSData*)data;
+
+@end
+
+// A disk tier for objects evicted from a cache, so that a later miss reads them back instead of creating them again.
+//
+// Objects are appended to segment files in a directory owned by the store and are read back through memory mappings.
+// An in-memory index maps the keys to their records. Each record carries a checksum, so when the store is opened after a
+// crash, the index is rebuilt by scanning the segments and a torn record at the end of a segment is cut off.
+//
+// Taking or removing an object appends a small removal record. Segments in which less than half of the bytes are still
+// live are compacted in the background by copying their live records to the current segment. When the segments exceed
+// the maximum size, the oldest segment is dropped with all its objects.
+//
+// Keys must be property list objects, usually strings or numbers. All methods can be called on any queue, requests are
+// processed in the order in which they are made.
+@interface PWCacheSpillStore : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
+
+// Creates the directory if needed and recovers the objects spilled by an earlier store in it.
+// A segment is a sixteenth of 'maximumByteSize', but at least 64 KB.
+- (nullable instancetype)initWithDirectoryURL:(NSURL*)directoryURL
+                              maximumByteSize:(unsigned long long)maximumByteSize
+                                        error:(NSError**)outError NS_DESIGNATED_INITIALIZER;
+
+@property (nonatomic, readonly, copy)   NSURL*              directoryURL;
+@property (nonatomic, readonly)         unsigned long long  maximumByteSize;
+
+// The size of all segment files, including removed and superseded records.
+@property (atomic, readonly)            unsigned long long  byteSize;
+@property (atomic, readonly)            NSUInteger          count;
+
+// Returns NO if the store has no object for the key and no spill request for it is pending. Does not wait for the
+// pending requests, so it is cheap enough to be asked on every cache miss.
+- (BOOL)mayContainObjectForKey:(id)key;
+
+// Asynchronously serializes the object and appends it. Replaces an earlier object for the key. If the object returns
+// nil from -spillData, an earlier object for the key is removed.
+- (void)spillObject:(id<PWCacheSpillable>)object forKey:(id)key;
+
+// Removes the object for the key from the store and calls 'completionHandler' on 'queue' with it, or with nil if there
+// is none or it could not be read back.
+- (void)takeObjectForKey:(id)key
+                   queue:(id<PWDispatchQueueing>)queue
+       completionHandler:(void (^)(id _Nullable object))completionHandler;
+
+- (void)removeObjectForKey:(id)key;
+
+// Deletes all segment files.
+- (void)removeAllObjects;
+
+// Calls 'completionHandler' on 'queue' when all requests made so far have been processed, including the compactions
+// they have started.
+- (void)synchronizeOnQueue:(id<PWDispatchQueueing>)queue completionHandler:(PWDispatchBlock)completionHandler;
+
+// Closes the segment files. Later requests are ignored.
+- (void)close;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,805 @@
+//
+//  PWCacheSpillStore.mm
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import "PWCacheSpillStore.h"
+#import "PWDispatchIOMappedChannel.h"
+#import <fcntl.h>
+#import <unistd.h>
+#import <zlib.h>
+#import <os/lock.h>
+#import <map>
+#import <unordered_map>
+#import <unordered_set>
+
+NS_ASSUME_NONNULL_BEGIN
+
+static NSString* const PWCacheSpillStoreSegmentExtension = @"pwspill";
+
+static const uint32_t           PWCacheSpillRecordMagic                 = 0x52535750;   // "PWSR"
+static const unsigned long long PWCacheSpillStoreMinimumSegmentSize     = 64 * 1024;
+static const NSUInteger         PWCacheSpillStoreWindowLength           = 1024 * 1024;
+static const NSUInteger         PWCacheSpillStoreCompactionStepLength   = 256 * 1024;  // bytes scanned before other requests get a turn
+
+// Records are written in host byte order, spilled objects are never moved to another machine.
+struct SpillRecordHeader
+{
+    uint32_t    magic;
+    uint32_t    checksum;           // crc32 of the three lengths and the payload
+    uint32_t    keyLength;
+    uint32_t    classNameLength;    // 0 for removal records
+    uint32_t    valueLength;
+};
+
+struct SpillRecord
+{
+    NSUInteger  length;
+    NSRange     keyRange;
+    NSRange     classNameRange;
+    NSRange     valueRange;
+    bool        isRemoval;
+};
+
+struct Location
+{
+    uint32_t            segment;
+    unsigned long long  offset;
+    uint32_t            length;
+};
+
+struct Hash
+{
+    size_t operator() (id const& obj) const
+    {
+        return [obj hash];
+    }
+};
+
+struct EqualTo
+{
+    bool operator() (id const& obj1, id const& obj2) const
+    {
+        return [obj1 isEqual:obj2];
+    }
+};
+
+struct Segment
+{
+    PWDispatchIOMappedChannel*              channel;
+    unsigned long long                      byteSize;
+    unsigned long long                      liveByteSize;       // the bytes of the records in the index
+    bool                                    isCompacting;
+    std::unordered_set<id, Hash, EqualTo>   objectKeys;         // the keys of all object records, live or not
+};
+
+static uint32_t PWCacheSpillRecordChecksum (const SpillRecordHeader& header, const uint8_t* payload)
+{
+    uLong crc = crc32 (0L, Z_NULL, 0);
+    crc = crc32 (crc, (const Bytef*)&header.keyLength, 3 * sizeof (uint32_t));
+    crc = crc32 (crc, payload, header.keyLength + header.classNameLength + header.valueLength);
+    return (uint32_t)crc;
+}
+
+// Returns NO for a torn or corrupt record.
+static BOOL PWCacheSpillParseRecord (const uint8_t* bytes, NSUInteger availableLength, NSUInteger offset, SpillRecord* outRecord)
+{
+    NSCParameterAssert (outRecord);
+
+    if (availableLength < sizeof (SpillRecordHeader))
+        return NO;
+    SpillRecordHeader header;
+    memcpy (&header, bytes, sizeof header);
+    if (header.magic != PWCacheSpillRecordMagic || header.keyLength == 0)
+        return NO;
+    unsigned long long payloadLength = (unsigned long long)header.keyLength + header.classNameLength + header.valueLength;
+    if (payloadLength > availableLength - sizeof header)
+        return NO;
+    if (PWCacheSpillRecordChecksum (header, bytes + sizeof header) != header.checksum)
+        return NO;
+
+    NSUInteger keyOffset = offset + sizeof header;
+    outRecord->length         = sizeof header + (NSUInteger)payloadLength;
+    outRecord->keyRange       = NSMakeRange (keyOffset, header.keyLength);
+    outRecord->classNameRange = NSMakeRange (keyOffset + header.keyLength, header.classNameLength);
+    outRecord->valueRange     = NSMakeRange (keyOffset + header.keyLength + header.classNameLength, header.valueLength);
+    outRecord->isRemoval      = header.classNameLength == 0;
+    return YES;
+}
+
+static NSData* PWCacheSpillRecordData (NSData* keyData, NSData* _Nullable classNameData, NSData* _Nullable valueData)
+{
+    SpillRecordHeader header;
+    header.magic           = PWCacheSpillRecordMagic;
+    header.keyLength       = (uint32_t)keyData.length;
+    header.classNameLength = (uint32_t)classNameData.length;
+    header.valueLength     = (uint32_t)valueData.length;
+
+    NSMutableData* record = [NSMutableData dataWithLength:sizeof header];
+    [record appendData:keyData];
+    if (classNameData)
+        [record appendData:classNameData];
+    if (valueData)
+        [record appendData:valueData];
+    header.checksum = PWCacheSpillRecordChecksum (header, (const uint8_t*)record.bytes + sizeof header);
+    [record replaceBytesInRange:NSMakeRange (0, sizeof header) withBytes:&header];
+    return record;
+}
+
+static id _Nullable PWCacheSpillKeyFromData (NSData* data, NSRange range)
+{
+    return [NSPropertyListSerialization propertyListWithData:[data subdataWithRange:range]
+                                                     options:NSPropertyListImmutable
+                                                      format:NULL
+                                                       error:NULL];
+}
+
+@implementation PWCacheSpillStore
+{
+    PWDispatchQueue*                                        _internalQueue;
+    PWDispatchGroup*                                        _compactionGroup;   // entered for each running compaction
+    unsigned long long                                      _segmentByteSize;
+    unsigned long long                                      _byteSize;
+    std::map<uint32_t, Segment>                             _segments;          // oldest first
+    std::unordered_map<id, Location, Hash, EqualTo>         _index;
+    uint32_t                                                _activeSegmentNumber;
+    uint32_t                                                _nextSegmentNumber;     // never reused, so that pending compaction steps cannot confuse segments
+    int                                                     _writeFileDescriptor;   // of the active segment, -1 if none
+    BOOL                                                    _isClosed;
+
+    // The keys in the index and the keys of spill requests which have not been processed yet, with their number. Read
+    // on any queue, so a miss does not have to wait for the serialization and compaction on the private queue.
+    os_unfair_lock                                          _keysLock;
+    std::unordered_map<id, NSUInteger, Hash, EqualTo>       _pendingSpillCountByKey;    // protected by _keysLock
+}
+
+- (nullable instancetype)initWithDirectoryURL:(NSURL*)directoryURL
+                              maximumByteSize:(unsigned long long)maximumByteSize
+                                        error:(NSError**)outError
+{
+    NSParameterAssert (directoryURL.isFileURL);
+    NSParameterAssert (maximumByteSize > 0);
+
+    if (![NSFileManager.defaultManager createDirectoryAtURL:directoryURL
+                                withIntermediateDirectories:YES
+                                                 attributes:nil
+                                                      error:outError])
+        return nil;
+
+    if ((self = [super init]) != nil)
+    {
+        _directoryURL           = [directoryURL copy];
+        _maximumByteSize        = maximumByteSize;
+        _segmentByteSize        = MAX (maximumByteSize / 16, PWCacheSpillStoreMinimumSegmentSize);
+        _internalQueue          = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWCacheSpillStore"];
+        _compactionGroup        = [[PWDispatchGroup alloc] init];
+        _writeFileDescriptor    = -1;
+        _keysLock               = OS_UNFAIR_LOCK_INIT;
+
+        __block BOOL didRecover;
+        __block NSError* error;
+        [_internalQueue synchronouslyDispatchBlock:^{
+            NSError* recoveryError;
+            didRecover = [self recoverWithError:&recoveryError];
+            error = recoveryError;
+        }];
+        if (!didRecover)
+        {
+            if (outError)
+                *outError = error;
+            return nil;
+        }
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    if (_writeFileDescriptor != -1)
+        close (_writeFileDescriptor);
+}
+
+- (unsigned long long)byteSize
+{
+    __block unsigned long long byteSize;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        byteSize = _byteSize;
+    }];
+    return byteSize;
+}
+
+- (NSUInteger)count
+{
+    __block NSUInteger count;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        count = _index.size();
+    }];
+    return count;
+}
+
+- (BOOL)mayContainObjectForKey:(id)key
+{
+    NSParameterAssert (key);
+
+    os_unfair_lock_lock (&_keysLock);
+    BOOL mayContainObject = _pendingSpillCountByKey.find (key) != _pendingSpillCountByKey.end();
+    os_unfair_lock_unlock (&_keysLock);
+    return mayContainObject;
+}
+
+#pragma mark - Requests
+
+- (void)spillObject:(id<PWCacheSpillable>)object forKey:(id)key
+{
+    NSParameterAssert (object);
+    NSParameterAssert ([NSPropertyListSerialization propertyList:key isValidForFormat:NSPropertyListBinaryFormat_v1_0]);
+
+    id keyCopy = [key copy];
+    os_unfair_lock_lock (&_keysLock);
+    ++_pendingSpillCountByKey[keyCopy];
+    os_unfair_lock_unlock (&_keysLock);
+
+    [_internalQueue asynchronouslyDispatchBlock:^{
+        if (!_isClosed)
+            [self appendObject:object forKey:keyCopy];
+
+        os_unfair_lock_lock (&_keysLock);
+        auto it = _pendingSpillCountByKey.find (keyCopy);
+        if (it != _pendingSpillCountByKey.end() && --it->second == 0 && _index.find (keyCopy) == _index.end())
+            _pendingSpillCountByKey.erase (it);
+        os_unfair_lock_unlock (&_keysLock);
+    }];
+}
+
+- (void)takeObjectForKey:(id)key
+                   queue:(id<PWDispatchQueueing>)queue
+       completionHandler:(void (^)(id _Nullable object))completionHandler
+{
+    NSParameterAssert (key);
+    NSParameterAssert (queue);
+    NSParameterAssert (completionHandler);
+
+    [_internalQueue asynchronouslyDispatchBlock:^{
+        auto it = _isClosed ? _index.end() : _index.find (key);
+        if (it == _index.end())
+        {
+            [queue asynchronouslyDispatchBlock:^{
+                completionHandler (nil);
+            }];
+            return;
+        }
+
+        // The record is mapped right away, so it stays readable when its segment is dropped afterwards.
+        Location location = it->second;
+        auto segment = _segments.find (location.segment);
+        PWDispatchIOMappedChannel* channel = segment != _segments.end() ? segment->second.channel : nil;
+        if (channel)
+            [channel readDataStartingFromOffset:(NSUInteger)location.offset
+                                         length:location.length
+                                          queue:_internalQueue
+                                        handler:^(BOOL done, NSData* data, NSError* errorOrNil) {
+                                            id object = [self objectFromRecordData:data];
+                                            [queue asynchronouslyDispatchBlock:^{
+                                                completionHandler (object);
+                                            }];
+                                        }];
+        else
+            [queue asynchronouslyDispatchBlock:^{
+                completionHandler (nil);
+            }];
+        [self removeEntryForKey:key];
+    }];
+}
+
+- (void)removeObjectForKey:(id)key
+{
+    NSParameterAssert (key);
+
+    [_internalQueue asynchronouslyDispatchBlock:^{
+        if (!_isClosed)
+            [self removeEntryForKey:key];
+    }];
+}
+
+- (void)removeAllObjects
+{
+    [_internalQueue asynchronouslyDispatchBlock:^{
+        if (_isClosed)
+            return;
+        while (!_segments.empty())
+            [self deleteSegment:_segments.begin()->first];
+        [self clearIndex];
+    }];
+}
+
+- (void)synchronizeOnQueue:(id<PWDispatchQueueing>)queue completionHandler:(PWDispatchBlock)completionHandler
+{
+    NSParameterAssert (queue);
+    NSParameterAssert (completionHandler);
+
+    [_internalQueue asynchronouslyDispatchBlock:^{
+        [_compactionGroup onCompletionDispatchBlock:^{
+            [queue asynchronouslyDispatchBlock:completionHandler];
+        } onQueue:_internalQueue];
+    }];
+}
+
+- (void)close
+{
+    [_internalQueue synchronouslyDispatchBlock:^{
+        if (_isClosed)
+            return;
+        _isClosed = YES;
+        if (_writeFileDescriptor != -1)
+        {
+            close (_writeFileDescriptor);
+            _writeFileDescriptor = -1;
+        }
+        for (auto& iSegment : _segments)
+            [iSegment.second.channel close];
+        _segments.clear();
+        [self clearIndex];
+        _byteSize = 0;
+    }];
+}
+
+#pragma mark - Records
+
+- (void)appendObject:(id<PWCacheSpillable>)object forKey:(id)key
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    NSData* valueData = [object spillData];
+    NSData* keyData   = [self dataForKey:key];
+    if (!valueData || !keyData)
+    {
+        [self removeEntryForKey:key];
+        return;
+    }
+
+    NSData* classNameData = [NSStringFromClass ([object class]) dataUsingEncoding:NSUTF8StringEncoding];
+    Location location;
+    if ([self appendRecord:PWCacheSpillRecordData (keyData, classNameData, valueData) location:&location])
+    {
+        auto it = _index.find (key);
+        if (it != _index.end())
+        {
+            Location previousLocation = it->second;
+            it->second = location;
+            [self didSupersedeRecordAtLocation:previousLocation];
+        }
+        else
+            _index[key] = location;
+        Segment& segment = _segments[location.segment];
+        segment.liveByteSize += location.length;
+        segment.objectKeys.insert (key);
+    }
+    else
+        // The old object must not come back in place of the new one.
+        [self removeEntryForKey:key];
+    [self enforceMaximumByteSize];
+}
+
+// Needs to be called after the key has been erased from the index.
+- (void)didEraseKeyFromIndex:(id)key
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    os_unfair_lock_lock (&_keysLock);
+    auto it = _pendingSpillCountByKey.find (key);
+    if (it != _pendingSpillCountByKey.end() && it->second == 0)
+        _pendingSpillCountByKey.erase (it);
+    os_unfair_lock_unlock (&_keysLock);
+}
+
+- (void)clearIndex
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    _index.clear();
+    os_unfair_lock_lock (&_keysLock);
+    for (auto it = _pendingSpillCountByKey.begin(); it != _pendingSpillCountByKey.end(); )
+        it = it->second == 0 ? _pendingSpillCountByKey.erase (it) : std::next (it);
+    os_unfair_lock_unlock (&_keysLock);
+}
+
+- (nullable NSData*)dataForKey:(id)key
+{
+    return [NSPropertyListSerialization dataWithPropertyList:key
+                                                      format:NSPropertyListBinaryFormat_v1_0
+                                                     options:0
+                                                       error:NULL];
+}
+
+- (nullable id)objectFromRecordData:(NSData*)data
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    SpillRecord record;
+    if (!PWCacheSpillParseRecord ((const uint8_t*)data.bytes, data.length, 0, &record) || record.isRemoval)
+        return nil;
+    NSString* className = [[NSString alloc] initWithData:[data subdataWithRange:record.classNameRange]
+                                                encoding:NSUTF8StringEncoding];
+    Class objectClass = className ? NSClassFromString (className) : Nil;
+    if (![objectClass conformsToProtocol:@protocol(PWCacheSpillable)])
+        return nil;
+    return [(Class<PWCacheSpillable>)objectClass objectWithSpillData:[data subdataWithRange:record.valueRange]];
+}
+
+// Appends a removal record, so the object does not come back when the index is recovered.
+- (void)removeEntryForKey:(id)key
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    auto it = _index.find (key);
+    if (it == _index.end())
+        return;
+    Location location = it->second;
+    _index.erase (it);
+    [self didEraseKeyFromIndex:key];
+
+    NSData* keyData = [self dataForKey:key];
+    Location removalLocation;
+    if (keyData)
+        [self appendRecord:PWCacheSpillRecordData (keyData, nil, nil) location:&removalLocation];
+    [self didSupersedeRecordAtLocation:location];
+    [self enforceMaximumByteSize];
+}
+
+- (void)didSupersedeRecordAtLocation:(Location)location
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    auto segment = _segments.find (location.segment);
+    if (segment != _segments.end())
+    {
+        segment->second.liveByteSize -= MIN (segment->second.liveByteSize, (unsigned long long)location.length);
+        [self compactSegmentIfNeeded:location.segment];
+    }
+}
+
+- (BOOL)appendRecord:(NSData*)record location:(Location*)outLocation
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+    NSParameterAssert (outLocation);
+
+    if (_writeFileDescriptor == -1 || (_segments[_activeSegmentNumber].byteSize > 0 &&
+                                       _segments[_activeSegmentNumber].byteSize + record.length > _segmentByteSize))
+        if (![self startSegment])
+            return NO;
+
+    Segment& segment = _segments[_activeSegmentNumber];
+    const uint8_t* bytes = (const uint8_t*)record.bytes;
+    NSUInteger remainingLength = record.length;
+    off_t offset = (off_t)segment.byteSize;
+    while (remainingLength > 0)
+    {
+        ssize_t writtenLength = pwrite (_writeFileDescriptor, bytes, remainingLength, offset);
+        if (writtenLength < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            // Cuts off the partial record, so the segment stays readable to its end.
+            ftruncate (_writeFileDescriptor, (off_t)segment.byteSize);
+            return NO;
+        }
+        bytes           += writtenLength;
+        offset          += writtenLength;
+        remainingLength -= (NSUInteger)writtenLength;
+    }
+
+    *outLocation = Location { _activeSegmentNumber, segment.byteSize, (uint32_t)record.length };
+    segment.byteSize += record.length;
+    _byteSize        += record.length;
+    return YES;
+}
+
+#pragma mark - Segments
+
+- (NSURL*)URLOfSegment:(uint32_t)number
+{
+    NSString* name = [NSString stringWithFormat:@"%08u.%@", number, PWCacheSpillStoreSegmentExtension];
+    return [_directoryURL URLByAppendingPathComponent:name isDirectory:NO];
+}
+
+- (void)closeActiveSegment
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    if (_writeFileDescriptor == -1)
+        return;
+    close (_writeFileDescriptor);
+    _writeFileDescriptor = -1;
+    [self compactSegmentIfNeeded:_activeSegmentNumber];
+}
+
+- (BOOL)startSegment
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    [self closeActiveSegment];
+
+    uint32_t number = _nextSegmentNumber++;
+    NSURL* URL = [self URLOfSegment:number];
+    int fileDescriptor = open (URL.path.fileSystemRepresentation, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fileDescriptor == -1)
+        return NO;
+    PWDispatchIOMappedChannel* channel = [[PWDispatchIOMappedChannel alloc] initWithURL:URL
+                                                                           windowLength:PWCacheSpillStoreWindowLength
+                                                                          accessPattern:PWDispatchIOAccessPatternRandom
+                                                                                  error:NULL];
+    if (!channel)
+    {
+        close (fileDescriptor);
+        unlink (URL.path.fileSystemRepresentation);
+        return NO;
+    }
+
+    _segments[number]       = Segment { channel, 0, 0, false, {} };
+    _activeSegmentNumber    = number;
+    _writeFileDescriptor    = fileDescriptor;
+    return YES;
+}
+
+- (void)deleteSegment:(uint32_t)number
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    auto segment = _segments.find (number);
+    if (segment == _segments.end())
+        return;
+    if (number == _activeSegmentNumber && _writeFileDescriptor != -1)
+    {
+        close (_writeFileDescriptor);
+        _writeFileDescriptor = -1;
+    }
+    [segment->second.channel close];
+    unlink ([self URLOfSegment:number].path.fileSystemRepresentation);
+    _byteSize -= MIN (_byteSize, segment->second.byteSize);
+    _segments.erase (segment);
+}
+
+// Drops the oldest segments with all their objects until the store fits. The active segment is never dropped.
+- (void)enforceMaximumByteSize
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    while (_byteSize > _maximumByteSize && _segments.size() > 1)
+    {
+        uint32_t number = _segments.begin()->first;
+        NSData* data = [NSData dataWithContentsOfURL:[self URLOfSegment:number] options:NSDataReadingMappedAlways error:NULL];
+        const uint8_t* bytes = (const uint8_t*)data.bytes;
+        SpillRecord record;
+        for (NSUInteger offset = 0; offset < data.length && PWCacheSpillParseRecord (bytes + offset, data.length - offset, offset, &record); offset += record.length)
+        {
+            if (record.isRemoval)
+                continue;
+            id key = PWCacheSpillKeyFromData (data, record.keyRange);
+            auto it = key ? _index.find (key) : _index.end();
+            if (it != _index.end() && it->second.segment == number && it->second.offset == offset)
+            {
+                _index.erase (it);
+                [self didEraseKeyFromIndex:key];
+            }
+        }
+        [self deleteSegment:number];
+    }
+}
+
+#pragma mark - Compaction
+
+- (void)compactSegmentIfNeeded:(uint32_t)number
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    auto segment = _segments.find (number);
+    if (segment == _segments.end() || segment->second.isCompacting || (number == _activeSegmentNumber && _writeFileDescriptor != -1))
+        return;
+    if (segment->second.liveByteSize * 2 >= segment->second.byteSize)
+        return;
+
+    NSData* data = [NSData dataWithContentsOfURL:[self URLOfSegment:number] options:NSDataReadingMappedAlways error:NULL];
+    if (!data)
+        return;
+    segment->second.isCompacting = true;
+    [_compactionGroup enter];
+    [self compactSegment:number data:data fromOffset:0];
+}
+
+// Copies the live records of the segment to the active segment in steps, then deletes it. Removal records are copied if
+// an older segment still contains an object record for the key and no newer object for the key exists. Otherwise they
+// would be copied forward again and again, although there is nothing left for them to hide.
+- (void)compactSegment:(uint32_t)number data:(NSData*)data fromOffset:(NSUInteger)startOffset
+{
+    [_internalQueue asynchronouslyDispatchBlock:^{
+        if (_segments.find (number) == _segments.end())
+        {
+            [_compactionGroup leave];
+            return;
+        }
+
+        const uint8_t* bytes = (const uint8_t*)data.bytes;
+        NSUInteger stepEnd = MIN (data.length, startOffset + PWCacheSpillStoreCompactionStepLength);
+        NSUInteger offset = startOffset;
+        SpillRecord record;
+        while (offset < stepEnd && PWCacheSpillParseRecord (bytes + offset, data.length - offset, offset, &record))
+        {
+            id key = PWCacheSpillKeyFromData (data, record.keyRange);
+            auto it = key ? _index.find (key) : _index.end();
+            NSData* recordData = [data subdataWithRange:NSMakeRange (offset, record.length)];
+            Location location;
+            if (!record.isRemoval)
+            {
+                if (it != _index.end() && it->second.segment == number && it->second.offset == offset)
+                {
+                    if ([self appendRecord:recordData location:&location])
+                    {
+                        _segments[number].liveByteSize -= MIN (_segments[number].liveByteSize, (unsigned long long)record.length);
+                        Segment& segment = _segments[location.segment];
+                        segment.liveByteSize += location.length;
+                        segment.objectKeys.insert (it->first);
+                        it->second = location;
+                    }
+                    else
+                    {
+                        _index.erase (it);
+                        [self didEraseKeyFromIndex:key];
+                    }
+                }
+            }
+            else if (it == _index.end() && key && [self hasObjectRecordForKey:key beforeSegment:number])
+                [self appendRecord:recordData location:&location];
+            offset += record.length;
+        }
+
+        if (offset < stepEnd || offset >= data.length)
+        {
+            // Done, or the rest of the segment is unreadable. Objects still pointing there are lost.
+            for (auto it = _index.begin(); it != _index.end(); )
+            {
+                if (it->second.segment != number)
+                {
+                    ++it;
+                    continue;
+                }
+                id lostKey = it->first;
+                it = _index.erase (it);
+                [self didEraseKeyFromIndex:lostKey];
+            }
+            [self deleteSegment:number];
+            [self enforceMaximumByteSize];
+            [_compactionGroup leave];
+        }
+        else
+        {
+            [self enforceMaximumByteSize];
+            [self compactSegment:number data:data fromOffset:offset];
+        }
+    }];
+}
+
+- (BOOL)hasObjectRecordForKey:(id)key beforeSegment:(uint32_t)number
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    for (auto it = _segments.begin(); it != _segments.end() && it->first < number; ++it)
+        if (it->second.objectKeys.count (key) > 0)
+            return YES;
+    return NO;
+}
+
+#pragma mark - Recovery
+
+// Rebuilds the index from the segments in the directory. Torn records at the end of a segment are cut off.
+- (BOOL)recoverWithError:(NSError**)outError
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    NSArray<NSURL*>* URLs = [NSFileManager.defaultManager contentsOfDirectoryAtURL:_directoryURL
+                                                        includingPropertiesForKeys:nil
+                                                                           options:NSDirectoryEnumerationSkipsHiddenFiles
+                                                                             error:outError];
+    if (!URLs)
+        return NO;
+
+    std::map<uint32_t, NSURL*> segmentURLs;
+    for (NSURL* iURL in URLs)
+    {
+        NSInteger number = iURL.lastPathComponent.stringByDeletingPathExtension.integerValue;
+        if ([iURL.pathExtension isEqualToString:PWCacheSpillStoreSegmentExtension] && number > 0 && number <= UINT32_MAX)
+            segmentURLs[(uint32_t)number] = iURL;
+    }
+    _nextSegmentNumber = segmentURLs.empty() ? 1 : segmentURLs.rbegin()->first + 1;
+
+    for (auto& iSegmentURL : segmentURLs)
+    {
+        uint32_t number = iSegmentURL.first;
+        const char* path = iSegmentURL.second.path.fileSystemRepresentation;
+        NSData* data = [NSData dataWithContentsOfURL:iSegmentURL.second options:NSDataReadingMappedAlways error:NULL];
+        if (!data)
+        {
+            unlink (path);
+            continue;
+        }
+
+        const uint8_t* bytes = (const uint8_t*)data.bytes;
+        NSUInteger offset = 0;
+        SpillRecord record;
+        while (offset < data.length && PWCacheSpillParseRecord (bytes + offset, data.length - offset, offset, &record))
+        {
+            id key = PWCacheSpillKeyFromData (data, record.keyRange);
+            if (key)
+            {
+                auto it = _index.find (key);
+                if (it != _index.end())
+                {
+                    _segments[it->second.segment].liveByteSize -= it->second.length;
+                    _index.erase (it);
+                }
+                if (!record.isRemoval)
+                {
+                    _index[key] = Location { number, offset, (uint32_t)record.length };
+                    _segments[number].liveByteSize += record.length;
+                    _segments[number].objectKeys.insert (key);
+                }
+            }
+            offset += record.length;
+        }
+        if (offset < data.length)
+            truncate (path, (off_t)offset);
+
+        PWDispatchIOMappedChannel* channel = [[PWDispatchIOMappedChannel alloc] initWithURL:iSegmentURL.second
+                                                                               windowLength:PWCacheSpillStoreWindowLength
+                                                                              accessPattern:PWDispatchIOAccessPatternRandom
+                                                                                      error:NULL];
+        Segment& segment = _segments[number];
+        segment.channel  = channel;
+        segment.byteSize = offset;
+        _byteSize += offset;
+    }
+
+    // Segments which could not be opened are dropped with their objects.
+    for (auto it = _segments.begin(); it != _segments.end(); )
+    {
+        if (it->second.channel)
+        {
+            ++it;
+            continue;
+        }
+        uint32_t number = it->first;
+        for (auto entry = _index.begin(); entry != _index.end(); )
+            entry = entry->second.segment == number ? _index.erase (entry) : std::next (entry);
+        unlink ([self URLOfSegment:number].path.fileSystemRepresentation);
+        _byteSize -= MIN (_byteSize, it->second.byteSize);
+        it = _segments.erase (it);
+    }
+
+    // Appending continues in the newest segment if it has room.
+    if (!_segments.empty() && _segments.rbegin()->second.byteSize < _segmentByteSize)
+    {
+        uint32_t number = _segments.rbegin()->first;
+        int fileDescriptor = open ([self URLOfSegment:number].path.fileSystemRepresentation, O_WRONLY | O_CLOEXEC);
+        if (fileDescriptor != -1)
+        {
+            _activeSegmentNumber = number;
+            _writeFileDescriptor = fileDescriptor;
+        }
+    }
+
+    os_unfair_lock_lock (&_keysLock);
+    for (auto& iEntry : _index)
+        _pendingSpillCountByKey.emplace (iEntry.first, 0);
+    os_unfair_lock_unlock (&_keysLock);
+
+    for (auto& iSegment : _segments)
+        [self compactSegmentIfNeeded:iSegment.first];
+    [self enforceMaximumByteSize];
+    return YES;
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -6,11 +6,26 @@
 //  Copyright © 2015 ProjectWizards. All rights reserved.
 //
 
+#import <PWFoundation/PWCacheBudgetCoordinator.h>
+
 NS_ASSUME_NONNULL_BEGIN
 
 @class PWLRUCache;
 @protocol PWDispatchQueueing;
 
+// The replacement policies of PWLRUCache and PWAsyncLRUCache.
+typedef NS_ENUM(NSInteger, PWLRUCachePolicy)
+{
+    // Evicts the least recently used object.
+    PWLRUCachePolicyLRU,
+
+    // W-TinyLFU: a small LRU window for new objects in front of a main region which only admits objects used more often
+    // than the ones they would displace, estimated by a frequency sketch with periodic aging. A scan touching many
+    // objects once does not flush the objects which are used repeatedly. The sketch takes eight bytes per object of
+    // capacity.
+    PWLRUCachePolicyWTinyLFU,
+};
+
 @protocol PWLRUCacheDelegate <NSObject>
 // Tis delegation can refuse to evict an object because it is long unused.
 // This is useful, if the object is currently
@@ -21,7 +36,7 @@ NS_ASSUME_NONNULL_BEGIN
 @end
 
 // Simple implementation of a least-recently-used cache
-@interface PWLRUCache <KeyType, ObjectType> : NSObject
+@interface PWLRUCache <KeyType, ObjectType> : NSObject <PWBudgetedCache>
 
 - (instancetype)init NS_UNAVAILABLE;
 
@@ -30,11 +45,19 @@ NS_ASSUME_NONNULL_BEGIN
 // to be evicted.
 // The receiver's method may only be called on the given dispatch queue.
 // The same queue is used for asynchronously evicting objects when the system comes under memory pressure.
+// The policy only decides which object is evicted, the delegate is asked the same way for all policies.
+- (instancetype)initWithCapacity:(NSUInteger)capacity
+                        delegate:(nullable id<PWLRUCacheDelegate>)delegate
+                   dispatchQueue:(id <PWDispatchQueueing>)dispatchQueue
+                          policy:(PWLRUCachePolicy)policy NS_DESIGNATED_INITIALIZER;
+
+// Uses PWLRUCachePolicyLRU.
 - (instancetype)initWithCapacity:(NSUInteger)capacity
                         delegate:(nullable id<PWLRUCacheDelegate>)delegate
-                   dispatchQueue:(id <PWDispatchQueueing>)dispatchQueue NS_DESIGNATED_INITIALIZER;
+                   dispatchQueue:(id <PWDispatchQueueing>)dispatchQueue;
 
 @property (nonatomic, readonly)         NSUInteger              capacity;
+@property (nonatomic, readonly)         PWLRUCachePolicy        policy;
 @property (nonatomic, readonly)         NSUInteger              count;
 @property (nonatomic, readonly, weak)   id<PWLRUCacheDelegate>  delegate;
 @property (nonatomic, readonly, strong) id<PWDispatchQueueing>  dispatchQueue;
@@ -49,6 +72,15 @@ NS_ASSUME_NONNULL_BEGIN
 
 // Is called when memory pressure occurs.
 - (void)evictAsManyObjectsAsPossible;
+
+// Makes the receiver share the budget of 'coordinator', which then also handles memory pressure for it. Can only be
+// called once. Evictions on behalf of the coordinator ask the delegate like all other evictions.
+- (void)joinBudgetCoordinator:(PWCacheBudgetCoordinator*)coordinator
+                         name:(NSString*)name
+                       weight:(double)weight
+                costEstimator:(nullable PWCacheCostEstimator)costEstimator;
+
+@property (nonatomic, readonly, strong, nullable) PWCacheBudgetRegistration* budgetRegistration;
 @end
 
 
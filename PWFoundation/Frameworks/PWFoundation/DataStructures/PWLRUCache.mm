@@ -10,6 +10,7 @@
 #import <unordered_map>
 #import <list>
 #import "PWDispatch.h"
+#import "PWCachePolicy.hpp"
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -29,12 +30,21 @@ struct EqualTo
     }
 };
 
-typedef std::pair<id, id> KeyObjectPair;
-typedef std::list<KeyObjectPair>::iterator ListIterator;
+// The cost is only estimated while the cache has joined a budget coordinator.
+struct KeyObjectPair
+{
+    id                              first;
+    id                              second;
+    NSUInteger                      cost;
+    PWFoundation::cache_segment     segment;
+};
+
+typedef PWFoundation::cache_policy<KeyObjectPair, Hash> Policy;
+typedef Policy::iterator ListIterator;
 
 @implementation PWLRUCache
 {
-    std::list<KeyObjectPair> _leastRecentUsageList;
+    Policy _policy;
     std::unordered_map<__unsafe_unretained id, ListIterator, Hash, EqualTo> _map;
     PWDispatchMemoryPressureObserver* _memoryPressureObserver;
 }
@@ -42,12 +52,14 @@ typedef std::list<KeyObjectPair>::iterator ListIterator;
 - (instancetype)initWithCapacity:(NSUInteger)capacity
                         delegate:(nullable id<PWLRUCacheDelegate>)delegate
                    dispatchQueue:(id <PWDispatchQueueing>)dispatchQueue
+                          policy:(PWLRUCachePolicy)policy
 {
     NSParameterAssert(capacity != NSNotFound && capacity > 0);
 
     self = [super init];
 
     _capacity = capacity;
+    _policy.configure(capacity, /* tiny_lfu */ policy == PWLRUCachePolicyWTinyLFU);
     _delegate = delegate;
     _dispatchQueue = dispatchQueue;
     [self createMemoryPressureObserver];
@@ -55,14 +67,28 @@ typedef std::list<KeyObjectPair>::iterator ListIterator;
     return self;
 }
 
+- (instancetype)initWithCapacity:(NSUInteger)capacity
+                        delegate:(nullable id<PWLRUCacheDelegate>)delegate
+                   dispatchQueue:(id <PWDispatchQueueing>)dispatchQueue
+{
+    return [self initWithCapacity:capacity delegate:delegate dispatchQueue:dispatchQueue policy:PWLRUCachePolicyLRU];
+}
+
+- (PWLRUCachePolicy)policy
+{
+    return _policy.is_tiny_lfu() ? PWLRUCachePolicyWTinyLFU : PWLRUCachePolicyLRU;
+}
+
 - (void)dealloc
 {
     [_dispatchQueue synchronouslyDispatchBlock:^{
         [_memoryPressureObserver cancel];
         id <PWLRUCacheDelegate> delegate = _delegate;
         if(delegate)
-            for(auto iPair : _leastRecentUsageList)
+            _policy.for_each([&](KeyObjectPair& iPair) {
                 [delegate cache:self willRemoveObject:iPair.second];
+            });
+        [_budgetRegistration invalidate];
     }];
 }
 
@@ -85,7 +111,7 @@ typedef std::list<KeyObjectPair>::iterator ListIterator;
         [self _setObject:object forKey:key];
 
         if (self.count > _capacity)
-            [self removeLeastRecentlyUsedObject];
+            [self removeVictimObject];
     }
 }
 
@@ -93,20 +119,20 @@ typedef std::list<KeyObjectPair>::iterator ListIterator;
 {
     NSAssert(_dispatchQueue.isCurrentDispatchQueue, nil);
 
-    _leastRecentUsageList.push_front(KeyObjectPair(key, object));
-    _map[key] = _leastRecentUsageList.begin();
+    NSUInteger cost = _budgetRegistration ? [_budgetRegistration costForKey:key object:object] : 0;
+    _map[key] = _policy.insert(KeyObjectPair{key, object, cost});
+    [_budgetRegistration didAddCost:cost];
 }
 
-- (BOOL)removeLeastRecentlyUsedObject
+- (BOOL)removeVictimObject
 {
     NSAssert(_dispatchQueue.isCurrentDispatchQueue, nil);
 
-    if(_leastRecentUsageList.empty())
+    // The least recently used object, or the less frequently used one of two candidates in W-TinyLFU mode.
+    ListIterator last;
+    if(!_policy.victim(last))
         return NO;
 
-    auto last = _leastRecentUsageList.end();
-    last--;
-
     // We first ask the delegate for permission, if it refuses, we do not evict.
     id<PWLRUCacheDelegate> delegate = _delegate;    // weak -> strong
     if(delegate)
@@ -116,8 +142,9 @@ typedef std::list<KeyObjectPair>::iterator ListIterator;
         [delegate cache:self willRemoveObject:last->second];
     }
 
+    [_budgetRegistration didRemoveCost:last->cost evicted:YES];
     _map.erase(last->first);
-    _leastRecentUsageList.pop_back();
+    _policy.erase(last);
     return YES;
 }
 
@@ -127,11 +154,17 @@ typedef std::list<KeyObjectPair>::iterator ListIterator;
 
     auto match = _map.find(key);
     if (match == _map.end())
+    {
+        [_budgetRegistration recordMiss];
+        _policy.record_miss(key);
         return nil;
+    }
     else
     {
-        // Everytime an object is returned, move it to the front of the least recent usage list.
-        _leastRecentUsageList.splice(_leastRecentUsageList.begin(), _leastRecentUsageList, match->second);
+        [_budgetRegistration recordHit];
+
+        // Everytime an object is returned, move it to the front of its usage list.
+        _policy.touch(match->second);
         return match->second->second;
     }
 }
@@ -144,7 +177,8 @@ typedef std::list<KeyObjectPair>::iterator ListIterator;
     if (it != _map.end())
     {
         [_delegate cache:self willRemoveObject:it->second->second];
-        _leastRecentUsageList.erase(it->second);
+        [_budgetRegistration didRemoveCost:it->second->cost evicted:NO];
+        _policy.erase(it->second);
         _map.erase(it);
     }
 }
@@ -154,12 +188,13 @@ typedef std::list<KeyObjectPair>::iterator ListIterator;
     NSAssert(_dispatchQueue.isCurrentDispatchQueue, nil);
 
     id <PWLRUCacheDelegate> delegate = _delegate;
-    if(delegate)
-        for(auto it : _leastRecentUsageList)
-            [delegate cache:self willRemoveObject:it.second];
+    _policy.for_each([&](KeyObjectPair& iPair) {
+        [delegate cache:self willRemoveObject:iPair.second];
+        [_budgetRegistration didRemoveCost:iPair.cost evicted:NO];
+    });
 
     _map.clear();
-    _leastRecentUsageList.clear();
+    _policy.clear();
 }
 
 - (void)evictAsManyObjectsAsPossible
@@ -173,20 +208,75 @@ typedef std::list<KeyObjectPair>::iterator ListIterator;
         return;
     }
 
-    auto it = _leastRecentUsageList.begin();
-    while(it != _leastRecentUsageList.end())
+    for(auto list : _policy.lists_in_eviction_order())
     {
-        if([delegate cache:self canEvictObject:it->second])
+        auto it = list->begin();
+        while(it != list->end())
         {
-            [delegate cache:self willRemoveObject:it->second];
-            _map.erase(it->first);
-            it = _leastRecentUsageList.erase(it);
+            if([delegate cache:self canEvictObject:it->second])
+            {
+                [delegate cache:self willRemoveObject:it->second];
+                [_budgetRegistration didRemoveCost:it->cost evicted:YES];
+                _map.erase(it->first);
+                it = _policy.erase(it);
+            }
+            else
+                ++it;
         }
-        else
-            ++it;
     }
 }
 
+#pragma mark - Budget
+
+- (void)joinBudgetCoordinator:(PWCacheBudgetCoordinator*)coordinator
+                         name:(NSString*)name
+                       weight:(double)weight
+                costEstimator:(nullable PWCacheCostEstimator)costEstimator
+{
+    NSParameterAssert(coordinator);
+    NSAssert(_dispatchQueue.isCurrentDispatchQueue, nil);
+    NSAssert(!_budgetRegistration, @"cache has already joined a budget coordinator");
+
+    _budgetRegistration = [coordinator registerCache:self name:name weight:weight costEstimator:costEstimator];
+    _policy.for_each([&](KeyObjectPair& iPair) {
+        iPair.cost = [_budgetRegistration costForKey:iPair.first object:iPair.second];
+        [_budgetRegistration didAddCost:iPair.cost];
+    });
+
+    // From now on the coordinator handles memory pressure.
+    [_memoryPressureObserver cancel];
+    _memoryPressureObserver = nil;
+}
+
+- (void)shedBytes:(unsigned long long)byteCount completionHandler:(PWDispatchBlock)completionHandler
+{
+    NSParameterAssert(completionHandler);
+
+    [_dispatchQueue asynchronouslyDispatchBlock:^{
+        id <PWLRUCacheDelegate> delegate = _delegate;
+        unsigned long long shedByteCount = 0;
+        for(auto list : _policy.lists_in_eviction_order())
+        {
+            auto it = list->end();
+            while(shedByteCount < byteCount && it != list->begin())
+            {
+                --it;
+                if(delegate)
+                {
+                    if(![delegate cache:self canEvictObject:it->second])
+                        continue;
+                    [delegate cache:self willRemoveObject:it->second];
+                }
+                shedByteCount += it->cost;
+                [_budgetRegistration didRemoveCost:it->cost evicted:YES];
+                _map.erase(it->first);
+                it = _policy.erase(it);
+            }
+        }
+        completionHandler();
+    }];
+}
+
 #pragma mark - Keyed Subscripting
 
 - (nullable id)objectForKeyedSubscript:(id)key
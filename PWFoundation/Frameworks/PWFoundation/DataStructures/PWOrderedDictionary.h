@@ -13,8 +13,9 @@
  A dictionary which remembers the order in which keys were added and enumerates in this order.
  Introduced to have control over the order in plist-based YAML exports.
  
- Removing and replacing existing keys is O(N), all other operations have the same time complexity as for
- NSMutableDictionary.
+ Insertion, lookup, replacement and removal of keys are O(1) like for NSMutableDictionary. Removed keys leave gaps in
+ the internal entry array, which are squeezed out once they make up half of the array, so that enumeration stays linear
+ in the number of keys.
  
  Note: the immutable variant can be added when it is needed.
  */
@@ -28,4 +29,10 @@
 @property (nonatomic, readonly, strong) ObjectType firstObject;
 @property (nonatomic, readonly, strong) ObjectType lastObject;
 
+// Access by position in the key order. These are O(1) as long as keys have only been added or removed at the front or
+// back. After removals from the middle, the first of these calls squeezes out the gaps in O(N).
+- (NSUInteger) indexOfKey:(KeyType)aKey;                // NSNotFound if the key is not contained
+- (KeyType) keyAtIndex:(NSUInteger)index;               // raises NSRangeException if index >= count
+- (ObjectType) objectAtIndex:(NSUInteger)index;         // raises NSRangeException if index >= count
+
 @end
@@ -0,0 +1,382 @@
+//
+//  PWOrderedDictionary.mm
+//  PWFoundation
+//
+//  Created by Kai on 2.6.10.
+//
+//
+
+#import "PWOrderedDictionary.h"
+#import <vector>
+#import <unordered_map>
+
+namespace PW
+{
+    struct OrderedKeyHash
+    {
+        size_t operator() (__unsafe_unretained id const& key) const
+        {
+            return [key hash];
+        }
+    };
+
+    struct OrderedKeyEqualTo
+    {
+        bool operator() (__unsafe_unretained id const& key1, __unsafe_unretained id const& key2) const
+        {
+            return [key1 isEqual:key2];
+        }
+    };
+
+    struct OrderedEntry
+    {
+        id  key;        // nil for a removed entry
+        id  object;
+    };
+
+    // Position of an enumeration. Compactions keep the order of the entries, so an enumeration which is interrupted
+    // by a compaction continues at the position of the next unvisited entry.
+    struct OrderedCursor
+    {
+        size_t          position;
+        size_t          visitedCount;
+        unsigned long   generation;
+    };
+
+    // Entries in key order with a hash index of their positions. Removed entries are left as gaps, so removal never
+    // shifts the entry array. The gaps are squeezed out once they make up half of the entries or when indexed access
+    // needs them gone.
+    class OrderedHashMap
+    {
+    public:
+        size_t count() const
+        {
+            return positions_.size();
+        }
+
+        void reserve(size_t capacity)
+        {
+            entries_.reserve(capacity);
+            positions_.reserve(capacity);
+        }
+
+        id firstKey() const
+        {
+            return entries_.empty() ? nil : entries_[head_].key;
+        }
+
+        id lastKey() const
+        {
+            return entries_.empty() ? nil : entries_.back().key;
+        }
+
+        id objectForKey(__unsafe_unretained id key) const
+        {
+            auto iter = positions_.find(key);
+            return iter != positions_.end() ? entries_[iter->second].object : nil;
+        }
+
+        // 'key' must not be contained yet.
+        void append(id key, id object)
+        {
+            entries_.push_back(OrderedEntry{key, object});
+            positions_.emplace(entries_.back().key, entries_.size() - 1);
+        }
+
+        bool remove(__unsafe_unretained id key)
+        {
+            auto iter = positions_.find(key);
+            if (iter == positions_.end())
+                return false;
+
+            size_t position = iter->second;
+            positions_.erase(iter);     // before releasing the key which the index points to
+            entries_[position].key    = nil;
+            entries_[position].object = nil;
+            ++gapCount_;
+
+            // Keep the first and last entries valid, so that firstKey and lastKey are O(1).
+            while (!entries_.empty() && !entries_.back().key) {
+                entries_.pop_back();
+                --gapCount_;
+            }
+            if (entries_.empty())
+                head_ = 0;
+            else if (position == head_)
+                while (!entries_[head_].key)
+                    ++head_;
+
+            if (gapCount_ > MinGapCountForCompaction && gapCount_ * 2 > entries_.size())
+                compact();
+            return true;
+        }
+
+        void removeAll()
+        {
+            positions_.clear();
+            entries_.clear();
+            head_     = 0;
+            gapCount_ = 0;
+        }
+
+        size_t indexOfKey(__unsafe_unretained id key)
+        {
+            auto iter = positions_.find(key);
+            if (iter == positions_.end())
+                return NSNotFound;
+            if (!hasOnlyLeadingGaps()) {
+                compact();
+                return positions_.find(key)->second;
+            }
+            return iter->second - head_;
+        }
+
+        // 'index' must be less than count().
+        const OrderedEntry& entryAtIndex(size_t index)
+        {
+            if (!hasOnlyLeadingGaps())
+                compact();
+            return entries_[head_ + index];
+        }
+
+        OrderedCursor cursor() const
+        {
+            return OrderedCursor{head_, 0, generation_};
+        }
+
+        // Returns the next entry or NULL at the end. The entry is only valid until the map is changed.
+        const OrderedEntry* next(OrderedCursor& cursor) const
+        {
+            if (cursor.generation != generation_) {
+                cursor.position   = cursor.visitedCount;
+                cursor.generation = generation_;
+            }
+            if (cursor.position < head_)
+                cursor.position = head_;
+            while (cursor.position < entries_.size() && !entries_[cursor.position].key)
+                ++cursor.position;
+            if (cursor.position >= entries_.size())
+                return NULL;
+            ++cursor.visitedCount;
+            return &entries_[cursor.position++];
+        }
+
+    private:
+        static const size_t MinGapCountForCompaction = 16;
+
+        std::vector<OrderedEntry>                                                       entries_;
+        std::unordered_map<__unsafe_unretained id, size_t, OrderedKeyHash, OrderedKeyEqualTo> positions_;
+        size_t                                                                          head_ = 0;       // entries before are gaps
+        size_t                                                                          gapCount_ = 0;
+        unsigned long                                                                   generation_ = 0; // incremented by compactions
+
+        // If so, positions and indexes differ by head_ only.
+        bool hasOnlyLeadingGaps() const
+        {
+            return gapCount_ == head_;
+        }
+
+        void compact()
+        {
+            size_t count = 0;
+            for (size_t position = head_; position < entries_.size(); ++position) {
+                OrderedEntry& entry = entries_[position];
+                if (!entry.key)
+                    continue;
+                if (position != count) {
+                    positions_.find(entry.key)->second = count;
+                    entries_[count] = std::move(entry);
+                }
+                ++count;
+            }
+            entries_.resize(count);
+            head_     = 0;
+            gapCount_ = 0;
+            ++generation_;
+        }
+    };
+}
+
+using namespace PW;
+
+
+@interface PWOrderedDictionaryKeyEnumerator : NSEnumerator
+- (instancetype) initWithDictionary:(PWMutableOrderedDictionary*)dictionary map:(const OrderedHashMap*)map;
+@end
+
+@implementation PWOrderedDictionaryKeyEnumerator
+{
+    PWMutableOrderedDictionary* dictionary_;    // keeps map_ alive
+    const OrderedHashMap*       map_;
+    OrderedCursor               cursor_;
+}
+
+- (instancetype) initWithDictionary:(PWMutableOrderedDictionary*)dictionary map:(const OrderedHashMap*)map
+{
+    if ((self = [super init]) != nil) {
+        dictionary_ = dictionary;
+        map_        = map;
+        cursor_     = map->cursor();
+    }
+    return self;
+}
+
+- (id) nextObject
+{
+    const OrderedEntry* entry = map_ ? map_->next(cursor_) : NULL;
+    if (!entry) {
+        dictionary_ = nil;
+        map_        = NULL;
+        return nil;
+    }
+    return entry->key;
+}
+
+@end
+
+#pragma mark
+
+@implementation PWMutableOrderedDictionary
+{
+    OrderedHashMap  map_;
+    unsigned long   mutationCount_;     // for fast enumeration
+}
+
+
+- (instancetype) initWithCapacity:(NSUInteger)numItems
+{
+    if ((self = [super init]) != nil)
+        map_.reserve(numItems);
+
+    return self;
+}
+
+#pragma mark NSDictionary Primitives
+
+- (id)firstObject
+{
+    return self[self.firstKey];
+}
+
+- (id)lastObject
+{
+    return self[self.lastKey];
+}
+
+- (id)firstKey
+{
+    return map_.firstKey();
+}
+
+- (id)lastKey
+{
+    return map_.lastKey();
+}
+
+- (NSUInteger) count
+{
+    return map_.count();
+}
+
+- (id) objectForKey:(id)aKey
+{
+    return aKey ? map_.objectForKey(aKey) : nil;
+}
+
+- (NSEnumerator*) keyEnumerator
+{
+    return [[PWOrderedDictionaryKeyEnumerator alloc] initWithDictionary:self map:&map_];
+}
+
+#pragma mark NSMutableDictionary Primitives
+
+- (void) setObject:(id)anObject forKey:(id)aKey
+{
+    NSParameterAssert (anObject);
+    NSParameterAssert (aKey);
+
+    // Replacing a key moves it to the back.
+    map_.remove(aKey);
+    map_.append([aKey copy], anObject);
+    ++mutationCount_;
+}
+
+- (void) removeObjectForKey:(id)aKey
+{
+    if (aKey && map_.remove(aKey))
+        ++mutationCount_;
+}
+
+#pragma mark Indexed Access
+
+- (NSUInteger) indexOfKey:(id)aKey
+{
+    return aKey ? map_.indexOfKey(aKey) : NSNotFound;
+}
+
+- (id) keyAtIndex:(NSUInteger)index
+{
+    if (index >= map_.count())
+        [NSException raise:NSRangeException format:@"index %lu beyond count %lu", (unsigned long)index, (unsigned long)map_.count()];
+    return map_.entryAtIndex(index).key;
+}
+
+- (id) objectAtIndex:(NSUInteger)index
+{
+    if (index >= map_.count())
+        [NSException raise:NSRangeException format:@"index %lu beyond count %lu", (unsigned long)index, (unsigned long)map_.count()];
+    return map_.entryAtIndex(index).object;
+}
+
+#pragma mark Non-Primitive Methods
+
+- (void) removeAllObjects
+{
+    map_.removeAll();
+    ++mutationCount_;
+}
+
+// -enumerateKeysAndObjectsUsingBlock: is used by YAML writing, therefore I implement it directly for better efficiency.
+- (void) enumerateKeysAndObjectsUsingBlock:(void (^)(id key, id obj, BOOL* stop))block
+{
+    NSParameterAssert (block);
+
+    OrderedCursor cursor = map_.cursor();
+    BOOL stop = NO;
+    while (const OrderedEntry* entry = map_.next(cursor)) {
+        // The block may cause a compaction by indexed access, which moves the entry.
+        id key    = entry->key;
+        id object = entry->object;
+        block (key, object, &stop);
+        if (stop)
+            break;
+    }
+}
+
+- (NSUInteger) countByEnumeratingWithState:(NSFastEnumerationState*)state
+                                   objects:(id __unsafe_unretained [])stackbuf
+                                     count:(NSUInteger)len
+{
+    NSParameterAssert (state);
+
+    // The cursor is kept in state->extra.
+    static_assert (sizeof(OrderedCursor) <= sizeof(state->extra), "cursor does not fit into NSFastEnumerationState");
+    OrderedCursor* cursor = (OrderedCursor*)state->extra;
+    if (state->state == 0) {
+        *cursor = map_.cursor();
+        state->mutationsPtr = &mutationCount_;
+        state->state = 1;
+    }
+    state->itemsPtr = stackbuf;
+
+    NSUInteger count = 0;
+    while (count < len) {
+        const OrderedEntry* entry = map_.next(*cursor);
+        if (!entry)
+            break;
+        stackbuf[count++] = entry->key;
+    }
+    return count;
+}
+
+@end
@@ -0,0 +1,40 @@
+//
+//  PWPersistentDictionary.h
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+NS_ASSUME_NONNULL_BEGIN
+
+// An immutable dictionary whose updating methods return new dictionaries which share almost all of their storage with
+// the receiver. Entries are kept in a hash array mapped trie, so setting or removing a single key costs O(log n) time and
+// memory instead of the O(n) of copying the dictionary. Building up a dictionary by a sequence of such updates, like
+// configurations are merged, is therefore no longer quadratic.
+//
+// It is a regular NSDictionary, so it can be passed wherever dictionaries are expected. Lookups are somewhat slower than
+// for NSDictionary, though, so dictionaries which are read much more often than updated should be converted back by
+// -[NSDictionary initWithDictionary:] once they are built up.
+//
+// The copy-on-modify helpers of NSDictionary (PWExtensions) return persistent dictionaries for receivers which are
+// persistent or have at least PWPersistentDictionaryMinimumCount entries.
+@interface PWPersistentDictionary<KeyType, ObjectType> : NSDictionary<KeyType, ObjectType>
+
+// Returns 'dictionary' itself if it is a persistent dictionary.
++ (PWPersistentDictionary<KeyType, ObjectType>*) persistentDictionaryWithDictionary:(nullable NSDictionary<KeyType, ObjectType>*)dictionary;
+
+- (PWPersistentDictionary<KeyType, ObjectType>*) dictionaryBySettingObject:(ObjectType)object forKey:(KeyType <NSCopying>)key;
+- (PWPersistentDictionary<KeyType, ObjectType>*) dictionaryByRemovingObjectForKey:(KeyType)key;
+
+// Overrides of NSDictionary (PWExtensions) which share the storage of the receiver.
+- (PWPersistentDictionary<KeyType, ObjectType>*) dictionaryByAddingEntriesFromDictionary:(nullable NSDictionary<KeyType, ObjectType>*)dictionary;
+- (PWPersistentDictionary<KeyType, ObjectType>*) dictionaryByRemovingObjectsForKeys:(nullable NSArray<KeyType>*)keys;
+- (nullable PWPersistentDictionary<KeyType, ObjectType>*) reducedDictionary:(BOOL (^)(id key, id value))block;
+
+@end
+
+// Below this count the helpers of NSDictionary (PWExtensions) copy plain dictionaries, which is cheaper for small ones.
+extern const NSUInteger PWPersistentDictionaryMinimumCount;
+
+NS_ASSUME_NONNULL_END
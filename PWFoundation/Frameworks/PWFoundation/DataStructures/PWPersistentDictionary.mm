@@ -0,0 +1,590 @@
+//
+//  PWPersistentDictionary.mm
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import "PWPersistentDictionary.h"
+#import <vector>
+#import <memory>
+#import <algorithm>
+
+NS_ASSUME_NONNULL_BEGIN
+
+const NSUInteger PWPersistentDictionaryMinimumCount = 64;
+
+namespace PW
+{
+    struct PersistentEntry
+    {
+        id          key;
+        id          object;
+        NSUInteger  hash;       // mixed hash of the key
+    };
+
+    struct PersistentNode;
+    typedef std::shared_ptr<const PersistentNode> PersistentNodeRef;
+
+    // A trie node in the CHAMP layout: entries and child nodes are kept in separate arrays, each ordered by the hash
+    // fragments of its bitmap. Below the last hash fragment, a node is a collision node without bitmaps whose entries
+    // all have the same hash.
+    // Nodes are never changed once they are part of a dictionary, so they can be shared by any number of dictionaries
+    // on any thread. Child nodes always contain at least two entries, which keeps the trie canonical.
+    struct PersistentNode
+    {
+        uint32_t                        entryMap = 0;
+        uint32_t                        childMap = 0;
+        std::vector<PersistentEntry>    entries;
+        std::vector<PersistentNodeRef>  children;
+
+        bool hasSingleEntry() const
+        {
+            return entries.size() == 1 && children.empty();
+        }
+    };
+
+    static const unsigned BitsPerLevel = 5;
+    static const unsigned HashBits     = sizeof(NSUInteger) * 8;
+
+    // Spreads the bits of -hash, which are often clustered, e.g. for NSNumber.
+    static NSUInteger PersistentHash(id key)
+    {
+        uint64_t hash = [key hash];
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ULL;
+        hash ^= hash >> 33;
+        return (NSUInteger)hash;
+    }
+
+    static inline uint32_t BitForHash(NSUInteger hash, unsigned shift)
+    {
+        return (uint32_t)1 << ((hash >> shift) & 31);
+    }
+
+    static inline size_t IndexOfBit(uint32_t map, uint32_t bit)
+    {
+        return __builtin_popcount(map & (bit - 1));
+    }
+
+    static inline bool EntryHasKey(const PersistentEntry& entry, id key, NSUInteger hash)
+    {
+        return entry.key == key || (entry.hash == hash && [entry.key isEqual:key]);
+    }
+
+    static const PersistentEntry* FindEntry(const PersistentNode* node, id key, NSUInteger hash)
+    {
+        for (unsigned shift = 0; node; shift += BitsPerLevel)
+        {
+            if (shift >= HashBits)
+            {
+                for (const PersistentEntry& entry : node->entries)
+                    if (EntryHasKey(entry, key, hash))
+                        return &entry;
+                return NULL;
+            }
+
+            uint32_t bit = BitForHash(hash, shift);
+            if (node->entryMap & bit)
+            {
+                const PersistentEntry& entry = node->entries[IndexOfBit(node->entryMap, bit)];
+                return EntryHasKey(entry, key, hash) ? &entry : NULL;
+            }
+            if (!(node->childMap & bit))
+                return NULL;
+            node = node->children[IndexOfBit(node->childMap, bit)].get();
+        }
+        return NULL;
+    }
+
+    static PersistentNodeRef MergeEntries(const PersistentEntry& entry1, const PersistentEntry& entry2, unsigned shift)
+    {
+        auto node = std::make_shared<PersistentNode>();
+        if (shift >= HashBits)
+        {
+            node->entries = { entry1, entry2 };
+            return node;
+        }
+
+        uint32_t bit1 = BitForHash(entry1.hash, shift);
+        uint32_t bit2 = BitForHash(entry2.hash, shift);
+        if (bit1 == bit2)
+        {
+            node->childMap = bit1;
+            node->children.push_back(MergeEntries(entry1, entry2, shift + BitsPerLevel));
+        }
+        else
+        {
+            node->entryMap = bit1 | bit2;
+            if (bit1 < bit2)
+                node->entries = { entry1, entry2 };
+            else
+                node->entries = { entry2, entry1 };
+        }
+        return node;
+    }
+
+    // Returns 'node' itself if nothing changes.
+    static PersistentNodeRef SetEntry(const PersistentNodeRef& node, const PersistentEntry& entry, unsigned shift, bool& added)
+    {
+        if (shift >= HashBits)
+        {
+            for (size_t index = 0; index < node->entries.size(); ++index)
+                if (EntryHasKey(node->entries[index], entry.key, entry.hash))
+                {
+                    if (node->entries[index].object == entry.object)
+                        return node;
+                    auto copy = std::make_shared<PersistentNode>(*node);
+                    copy->entries[index].object = entry.object;
+                    return copy;
+                }
+            auto copy = std::make_shared<PersistentNode>(*node);
+            copy->entries.push_back(entry);
+            added = true;
+            return copy;
+        }
+
+        uint32_t bit = BitForHash(entry.hash, shift);
+        if (node->entryMap & bit)
+        {
+            size_t index = IndexOfBit(node->entryMap, bit);
+            const PersistentEntry& existingEntry = node->entries[index];
+            if (EntryHasKey(existingEntry, entry.key, entry.hash))
+            {
+                if (existingEntry.object == entry.object)
+                    return node;
+                auto copy = std::make_shared<PersistentNode>(*node);
+                copy->entries[index].object = entry.object;
+                return copy;
+            }
+
+            auto copy = std::make_shared<PersistentNode>(*node);
+            PersistentNodeRef child = MergeEntries(existingEntry, entry, shift + BitsPerLevel);
+            copy->entries.erase(copy->entries.begin() + index);
+            copy->entryMap ^= bit;
+            copy->childMap |= bit;
+            copy->children.insert(copy->children.begin() + IndexOfBit(copy->childMap, bit), child);
+            added = true;
+            return copy;
+        }
+
+        if (node->childMap & bit)
+        {
+            size_t index = IndexOfBit(node->childMap, bit);
+            PersistentNodeRef child = SetEntry(node->children[index], entry, shift + BitsPerLevel, added);
+            if (child == node->children[index])
+                return node;
+            auto copy = std::make_shared<PersistentNode>(*node);
+            copy->children[index] = child;
+            return copy;
+        }
+
+        auto copy = std::make_shared<PersistentNode>(*node);
+        copy->entryMap |= bit;
+        copy->entries.insert(copy->entries.begin() + IndexOfBit(copy->entryMap, bit), entry);
+        added = true;
+        return copy;
+    }
+
+    // Returns 'node' itself if the key is not contained and NULL if the node becomes empty.
+    static PersistentNodeRef RemoveEntry(const PersistentNodeRef& node, id key, NSUInteger hash, unsigned shift, bool& removed)
+    {
+        if (shift >= HashBits)
+        {
+            for (size_t index = 0; index < node->entries.size(); ++index)
+                if (EntryHasKey(node->entries[index], key, hash))
+                {
+                    removed = true;
+                    if (node->entries.size() == 1)
+                        return nullptr;
+                    auto copy = std::make_shared<PersistentNode>(*node);
+                    copy->entries.erase(copy->entries.begin() + index);
+                    return copy;
+                }
+            return node;
+        }
+
+        uint32_t bit = BitForHash(hash, shift);
+        if (node->entryMap & bit)
+        {
+            size_t index = IndexOfBit(node->entryMap, bit);
+            if (!EntryHasKey(node->entries[index], key, hash))
+                return node;
+            removed = true;
+            if (node->hasSingleEntry())
+                return nullptr;
+            auto copy = std::make_shared<PersistentNode>(*node);
+            copy->entries.erase(copy->entries.begin() + index);
+            copy->entryMap ^= bit;
+            return copy;
+        }
+
+        if (node->childMap & bit)
+        {
+            size_t index = IndexOfBit(node->childMap, bit);
+            PersistentNodeRef child = RemoveEntry(node->children[index], key, hash, shift + BitsPerLevel, removed);
+            if (child == node->children[index])
+                return node;
+
+            auto copy = std::make_shared<PersistentNode>(*node);
+            if (child && !child->hasSingleEntry())
+                copy->children[index] = child;
+            else
+            {
+                // Pull a remaining single entry up into this node to keep the trie canonical.
+                copy->children.erase(copy->children.begin() + index);
+                copy->childMap ^= bit;
+                if (child)
+                {
+                    copy->entryMap |= bit;
+                    copy->entries.insert(copy->entries.begin() + IndexOfBit(copy->entryMap, bit), child->entries.front());
+                }
+                else if (copy->entries.empty() && copy->children.empty())
+                    return nullptr;
+            }
+            return copy;
+        }
+
+        return node;
+    }
+
+    // The order of a hash in a depth-first traversal of the trie: the hash fragments with the first one most significant.
+    static uint64_t TrieOrderOfHash(NSUInteger hash)
+    {
+        uint64_t order = 0;
+        for (unsigned shift = 0; shift < HashBits; shift += BitsPerLevel)
+        {
+            unsigned bitCount = std::min(BitsPerLevel, HashBits - shift);
+            order = (order << bitCount) | ((hash >> shift) & ((1u << bitCount) - 1));
+        }
+        return order;
+    }
+
+    // Builds a trie bottom up from entries sorted in trie order. Of entries with equal keys the last one wins.
+    static PersistentNodeRef BuildNode(const PersistentEntry* first, const PersistentEntry* last, unsigned shift, size_t& count)
+    {
+        auto node = std::make_shared<PersistentNode>();
+        if (shift >= HashBits)
+        {
+            for (const PersistentEntry* entry = first; entry != last; ++entry)
+                if (std::none_of(entry + 1, last, [&](const PersistentEntry& laterEntry) {
+                        return EntryHasKey(laterEntry, entry->key, entry->hash);
+                    }))
+                {
+                    node->entries.push_back(*entry);
+                    ++count;
+                }
+            return node;
+        }
+
+        while (first != last)
+        {
+            uint32_t bit = BitForHash(first->hash, shift);
+            const PersistentEntry* groupEnd = first + 1;
+            while (groupEnd != last && BitForHash(groupEnd->hash, shift) == bit)
+                ++groupEnd;
+
+            if (groupEnd - first == 1)
+            {
+                node->entryMap |= bit;
+                node->entries.push_back(*first);
+                ++count;
+            }
+            else
+            {
+                PersistentNodeRef child = BuildNode(first, groupEnd, shift + BitsPerLevel, count);
+                if (child->hasSingleEntry())
+                {
+                    node->entryMap |= bit;
+                    node->entries.push_back(child->entries.front());
+                }
+                else
+                {
+                    node->childMap |= bit;
+                    node->children.push_back(child);
+                }
+            }
+            first = groupEnd;
+        }
+        return node;
+    }
+
+    static void EnumerateEntries(const PersistentNode* node, void (^block)(id key, id object, BOOL* stop), BOOL* stop)
+    {
+        for (const PersistentEntry& entry : node->entries)
+        {
+            block(entry.key, entry.object, stop);
+            if (*stop)
+                return;
+        }
+        for (const PersistentNodeRef& child : node->children)
+        {
+            EnumerateEntries(child.get(), block, stop);
+            if (*stop)
+                return;
+        }
+    }
+
+    // Convenience for the dictionaries, which represent an empty trie by a NULL root.
+    static PersistentNodeRef SetRootEntry(const PersistentNodeRef& root, id key, id object, NSUInteger& count)
+    {
+        NSCParameterAssert(object);
+        NSCParameterAssert(key);
+
+        id keyCopy = [key copy];
+        PersistentEntry entry{keyCopy, object, PersistentHash(keyCopy)};
+        if (!root)
+        {
+            auto newRoot = std::make_shared<PersistentNode>();
+            newRoot->entryMap = BitForHash(entry.hash, 0);
+            newRoot->entries.push_back(entry);
+            count = 1;
+            return newRoot;
+        }
+
+        bool added = false;
+        PersistentNodeRef newRoot = SetEntry(root, entry, 0, added);
+        if (added)
+            ++count;
+        return newRoot;
+    }
+
+    static PersistentNodeRef RemoveRootEntry(const PersistentNodeRef& root, id key, NSUInteger& count)
+    {
+        NSCParameterAssert(key);
+
+        if (!root)
+            return root;
+        bool removed = false;
+        PersistentNodeRef newRoot = RemoveEntry(root, key, PersistentHash(key), 0, removed);
+        if (removed)
+            --count;
+        return newRoot;
+    }
+
+    struct PersistentCursorLevel
+    {
+        const PersistentNode*   node;
+        size_t                  entryIndex;
+        size_t                  childIndex;
+    };
+}
+
+using namespace PW;
+
+@interface PWPersistentDictionaryKeyEnumerator : NSEnumerator
+- (instancetype)initWithRoot:(const PersistentNodeRef&)root;
+@end
+
+@implementation PWPersistentDictionaryKeyEnumerator
+{
+    PersistentNodeRef                   _root;      // keeps the nodes on the stack alive
+    std::vector<PersistentCursorLevel>  _stack;
+}
+
+- (instancetype)initWithRoot:(const PersistentNodeRef&)root
+{
+    if ((self = [super init]) != nil)
+    {
+        _root = root;
+        if (root)
+            _stack.push_back(PersistentCursorLevel{root.get(), 0, 0});
+    }
+    return self;
+}
+
+- (nullable id)nextObject
+{
+    while (!_stack.empty())
+    {
+        PersistentCursorLevel& level = _stack.back();
+        if (level.entryIndex < level.node->entries.size())
+            return level.node->entries[level.entryIndex++].key;
+        if (level.childIndex < level.node->children.size())
+        {
+            const PersistentNode* child = level.node->children[level.childIndex++].get();
+            _stack.push_back(PersistentCursorLevel{child, 0, 0});   // invalidates 'level'
+            continue;
+        }
+        _stack.pop_back();
+    }
+    _root = nullptr;
+    return nil;
+}
+
+@end
+
+#pragma mark
+
+@implementation PWPersistentDictionary
+{
+    PersistentNodeRef   _root;      // NULL if empty
+    NSUInteger          _count;
+}
+
++ (PWPersistentDictionary*) persistentDictionaryWithDictionary:(nullable NSDictionary*)dictionary
+{
+    if ([dictionary isKindOfClass:PWPersistentDictionary.class])
+        return (PWPersistentDictionary*)dictionary;
+
+    std::vector<PersistentEntry> entries;
+    entries.reserve(dictionary.count);
+    [dictionary enumerateKeysAndObjectsUsingBlock:^(id key, id object, BOOL* stop) {
+        entries.push_back(PersistentEntry{[key copy], object, PersistentHash(key)});
+    }];
+    return [[self alloc] initWithEntries:entries];
+}
+
+- (instancetype) init
+{
+    return [self initWithRoot:nullptr count:0];
+}
+
+- (instancetype) initWithObjects:(const id _Nonnull [_Nullable])objects
+                         forKeys:(const id <NSCopying> _Nonnull [_Nullable])keys
+                           count:(NSUInteger)count
+{
+    std::vector<PersistentEntry> entries;
+    entries.reserve(count);
+    for (NSUInteger index = 0; index < count; ++index)
+    {
+        NSParameterAssert(objects[index]);
+        NSParameterAssert(keys[index]);
+        id key = [(id)keys[index] copy];
+        entries.push_back(PersistentEntry{key, objects[index], PersistentHash(key)});
+    }
+    return [self initWithEntries:entries];
+}
+
+- (instancetype) initWithEntries:(std::vector<PersistentEntry>&)entries
+{
+    if (entries.empty())
+        return [self initWithRoot:nullptr count:0];
+
+    // Stable, so that of equal keys the last one wins like for NSDictionary.
+    std::stable_sort(entries.begin(), entries.end(), [](const PersistentEntry& entry1, const PersistentEntry& entry2) {
+        return TrieOrderOfHash(entry1.hash) < TrieOrderOfHash(entry2.hash);
+    });
+    size_t count = 0;
+    PersistentNodeRef root = BuildNode(entries.data(), entries.data() + entries.size(), 0, count);
+    return [self initWithRoot:root count:count];
+}
+
+- (instancetype) initWithRoot:(const PersistentNodeRef&)root count:(NSUInteger)count
+{
+    if ((self = [super init]) != nil)
+    {
+        _root  = root;
+        _count = count;
+    }
+    return self;
+}
+
+- (id) copyWithZone:(nullable NSZone*)zone
+{
+    return self;
+}
+
+- (Class) classForCoder
+{
+    return NSDictionary.class;
+}
+
+#pragma mark NSDictionary Primitives
+
+- (NSUInteger) count
+{
+    return _count;
+}
+
+- (nullable id) objectForKey:(id)aKey
+{
+    if (!aKey || !_root)
+        return nil;
+    const PersistentEntry* entry = FindEntry(_root.get(), aKey, PersistentHash(aKey));
+    return entry ? entry->object : nil;
+}
+
+- (NSEnumerator*) keyEnumerator
+{
+    return [[PWPersistentDictionaryKeyEnumerator alloc] initWithRoot:_root];
+}
+
+#pragma mark Non-Primitive Methods
+
+- (void) enumerateKeysAndObjectsWithOptions:(NSEnumerationOptions)options usingBlock:(void (^)(id key, id obj, BOOL* stop))block
+{
+    NSParameterAssert(block);
+
+    // Concurrent and reverse enumeration have no order guarantees to fulfill for a dictionary.
+    BOOL stop = NO;
+    if (_root)
+        EnumerateEntries(_root.get(), block, &stop);
+}
+
+- (void) enumerateKeysAndObjectsUsingBlock:(void (^)(id key, id obj, BOOL* stop))block
+{
+    [self enumerateKeysAndObjectsWithOptions:0 usingBlock:block];
+}
+
+#pragma mark Updating
+
+- (PWPersistentDictionary*) dictionaryWithRoot:(const PersistentNodeRef&)root count:(NSUInteger)count
+{
+    return root == _root ? self : [[PWPersistentDictionary alloc] initWithRoot:root count:count];
+}
+
+- (PWPersistentDictionary*) dictionaryBySettingObject:(id)object forKey:(id <NSCopying>)key
+{
+    NSUInteger count = _count;
+    PersistentNodeRef root = SetRootEntry(_root, key, object, count);
+    return [self dictionaryWithRoot:root count:count];
+}
+
+- (PWPersistentDictionary*) dictionaryByRemovingObjectForKey:(id)key
+{
+    NSUInteger count = _count;
+    PersistentNodeRef root = RemoveRootEntry(_root, key, count);
+    return [self dictionaryWithRoot:root count:count];
+}
+
+- (PWPersistentDictionary*) dictionaryByAddingEntriesFromDictionary:(nullable NSDictionary*)dictionary
+{
+    __block NSUInteger count = _count;
+    __block PersistentNodeRef root = _root;
+    [dictionary enumerateKeysAndObjectsUsingBlock:^(id key, id object, BOOL* stop) {
+        root = SetRootEntry(root, key, object, count);
+    }];
+    return [self dictionaryWithRoot:root count:count];
+}
+
+- (PWPersistentDictionary*) dictionaryByRemovingObjectsForKeys:(nullable NSArray*)keys
+{
+    NSUInteger count = _count;
+    PersistentNodeRef root = _root;
+    for (id key in keys)
+        root = RemoveRootEntry(root, key, count);
+    return [self dictionaryWithRoot:root count:count];
+}
+
+- (nullable PWPersistentDictionary*) reducedDictionary:(BOOL (^)(id key, id value))block
+{
+    NSParameterAssert(block);
+
+    // Removes the rejected entries, so that a dictionary which is reduced by a few entries keeps sharing its storage.
+    NSMutableArray* rejectedKeys = [NSMutableArray array];
+    [self enumerateKeysAndObjectsUsingBlock:^(id key, id object, BOOL* stop) {
+        if (!block(key, object))
+            [rejectedKeys addObject:key];
+    }];
+    if (rejectedKeys.count == _count)
+        return nil;
+    return [self dictionaryByRemovingObjectsForKeys:rejectedKeys];
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -205,4 +205,101 @@
     XCTAssertNil(cache[key2]);
     XCTAssertNil(cache[key3]);
 }
+
+- (void)testBatchRemovalHandler
+{
+    NSMutableArray<NSNumber*>* batchSizes = [NSMutableArray array];
+    NSMutableArray* removedKeys = [NSMutableArray array];
+    __block BOOL didMixOptionality = NO;
+    __block BOOL expectsOptional = YES;
+    PWAsyncLRUCache<NSNumber*, NSNumber*>* cache;
+    cache = [[PWAsyncLRUCache alloc] initWithCapacity:1000
+                                               policy:PWLRUCachePolicyLRU
+                                  batchRemovalHandler:^(NSArray* keys,
+                                                        NSArray* objects,
+                                                        BOOL isOptional,
+                                                        PWLRUCacheBatchRemovalResponseHandler responseHandler)
+             {
+                 XCTAssertEqual(keys.count, objects.count);
+                 [batchSizes addObject:@(keys.count)];
+                 if(isOptional != expectsOptional)
+                     didMixOptionality = YES;
+
+                 // Odd keys are in use and refuse optional removal.
+                 NSMutableIndexSet* removableIndexes = [NSMutableIndexSet indexSet];
+                 [keys enumerateObjectsUsingBlock:^(NSNumber* key, NSUInteger index, BOOL* stop) {
+                     if(!isOptional || key.integerValue % 2 == 0)
+                     {
+                         [removableIndexes addIndex:index];
+                         [removedKeys addObject:key];
+                     }
+                 }];
+                 responseHandler(removableIndexes);
+             }];
+    cache.removalBatchSize = 100;
+    XCTAssertNil(cache.removalHandler);
+
+    for (NSUInteger key = 0; key < 300; key++)
+        cache[@(key)] = @(key);
+    XCTAssertEqual(cache.count, 300);
+
+    XCTestExpectation* expectEviction = [self expectationWithDescription:@"evict"];
+    [cache evictAsManyObjectsAsPossibleWithCompletionHandler:^{
+        [expectEviction fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:self.shortTimeout handler:nil];
+    XCTAssertEqual(cache.count, 150);
+    XCTAssertEqualObjects(batchSizes, (@[@100, @100, @100]));
+    XCTAssertEqual(removedKeys.count, 150);
+    XCTAssertEqualObjects(removedKeys.firstObject, @0);     // least recently used first
+    XCTAssertNotNil(cache[@1]);
+    XCTAssertNil(cache[@2]);
+
+    // Duplicate and unknown keys are ignored.
+    [batchSizes removeAllObjects];
+    expectsOptional = NO;
+    XCTestExpectation* expectRemoval = [self expectationWithDescription:@"remove"];
+    [cache removeObjectForKeys:@[@1, @1, @3, @4] completionHandler:^{
+        [expectRemoval fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:self.shortTimeout handler:nil];
+    XCTAssertEqualObjects(batchSizes, (@[@2]));
+    XCTAssertEqual(cache.count, 148);
+
+    [batchSizes removeAllObjects];
+    XCTestExpectation* expectDisposal = [self expectationWithDescription:@"dispose"];
+    [cache disposeWithCompletionHandler:^{
+        [expectDisposal fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:self.shortTimeout handler:nil];
+    XCTAssertEqual(cache.count, 0);
+    XCTAssertEqualObjects(batchSizes, (@[@100, @48]));
+    XCTAssertFalse(didMixOptionality);
+}
+
+- (void)testBatchedEvictionPerformance
+{
+    [self measureBlock:^{
+        PWAsyncLRUCache<NSNumber*, NSNumber*>* cache;
+        cache = [[PWAsyncLRUCache alloc] initWithCapacity:100000
+                                                   policy:PWLRUCachePolicyLRU
+                                      batchRemovalHandler:^(NSArray* keys,
+                                                            NSArray* objects,
+                                                            BOOL isOptional,
+                                                            PWLRUCacheBatchRemovalResponseHandler responseHandler)
+                 {
+                     responseHandler([NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, keys.count)]);
+                 }];
+        cache.removalBatchSize = 1000;
+        for (NSUInteger key = 0; key < 100000; key++)
+            [cache setObject:@(key) forKey:@(key)];
+
+        PWDispatchSemaphore* evicted = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+        [cache evictAsManyObjectsAsPossibleWithCompletionHandler:^{
+            [evicted signal];
+        }];
+        XCTAssertTrue([evicted waitWithTimeout:self.longTimeout useWallTime:NO]);
+        XCTAssertEqual(cache.count, 0);
+    }];
+}
 @end
@@ -0,0 +1,231 @@
+//
+//  PWCacheBudgetCoordinatorTest.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import "PWTestCase.h"
+#import "PWLRUCache.h"
+#import "PWAsyncLRUCache.h"
+
+static const NSUInteger PWCacheBudgetCoordinatorTestCost = 100;
+
+@interface PWCacheBudgetCoordinatorTest : PWTestCase
+@end
+
+@implementation PWCacheBudgetCoordinatorTest
+
+- (PWLRUCache*)cacheWithName:(NSString*)name
+                      weight:(double)weight
+                 coordinator:(PWCacheBudgetCoordinator*)coordinator
+                       queue:(PWDispatchQueue*)queue
+{
+    PWLRUCache* cache = [[PWLRUCache alloc] initWithCapacity:1000 delegate:nil dispatchQueue:queue];
+    [queue synchronouslyDispatchBlock:^{
+        [cache joinBudgetCoordinator:coordinator
+                                name:name
+                              weight:weight
+                       costEstimator:^NSUInteger(id key, id object) {
+                           return PWCacheBudgetCoordinatorTestCost;
+                       }];
+    }];
+    return cache;
+}
+
+- (void)fillCache:(PWLRUCache*)cache withCount:(NSUInteger)count
+{
+    [cache.dispatchQueue synchronouslyDispatchBlock:^{
+        for (NSUInteger index = 0; index < count; index++)
+            cache[@(index)] = [NSString stringWithFormat:@"%lu", (unsigned long)index];
+    }];
+}
+
+- (NSUInteger)countOfCache:(PWLRUCache*)cache
+{
+    __block NSUInteger count;
+    [cache.dispatchQueue synchronouslyDispatchBlock:^{
+        count = cache.count;
+    }];
+    return count;
+}
+
+- (void)waitForCoordinator:(PWCacheBudgetCoordinator*)coordinator
+{
+    PWDispatchSemaphore* done = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    [coordinator enforceBudgetWithCompletionHandler:^{ [done signal]; }];
+    XCTAssertTrue([done waitWithTimeout:self.longTimeout useWallTime:NO]);
+}
+
+- (void)testStatistics
+{
+    PWCacheBudgetCoordinator* coordinator = [[PWCacheBudgetCoordinator alloc] initWithByteBudget:0];
+    PWDispatchQueue* queue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWCacheBudgetCoordinatorTest"];
+    PWLRUCache* cache = [[PWLRUCache alloc] initWithCapacity:2 delegate:nil dispatchQueue:queue];
+    [queue synchronouslyDispatchBlock:^{
+        cache[@"a"] = @"A";
+        [cache joinBudgetCoordinator:coordinator
+                                name:@"test"
+                              weight:1.0
+                       costEstimator:^NSUInteger(id key, id object) {
+                           return PWCacheBudgetCoordinatorTestCost;
+                       }];
+        cache[@"b"] = @"B";
+        XCTAssertEqualObjects(cache[@"a"], @"A");
+        XCTAssertEqualObjects(cache[@"b"], @"B");
+        XCTAssertNil(cache[@"c"]);
+        cache[@"c"] = @"C";     // evicts "a"
+    }];
+
+    PWCacheStatistics* statistics = cache.budgetRegistration.statistics;
+    XCTAssertEqualObjects(statistics.name, @"test");
+    XCTAssertEqual(statistics.count, 2);
+    XCTAssertEqual(statistics.byteSize, 2 * PWCacheBudgetCoordinatorTestCost);
+    XCTAssertEqual(statistics.hitCount, 2);
+    XCTAssertEqual(statistics.missCount, 1);
+    XCTAssertEqual(statistics.evictionCount, 1);
+    XCTAssertEqualWithAccuracy(statistics.hitRate, 2.0 / 3.0, 0.001);
+    XCTAssertEqual(coordinator.totalByteSize, 2 * PWCacheBudgetCoordinatorTestCost);
+    XCTAssertEqual(coordinator.statistics.count, 1);
+
+    // Explicit removals are no evictions.
+    [queue synchronouslyDispatchBlock:^{
+        [cache removeAllObjects];
+    }];
+    statistics = cache.budgetRegistration.statistics;
+    XCTAssertEqual(statistics.count, 0);
+    XCTAssertEqual(statistics.evictionCount, 1);
+    XCTAssertEqual(coordinator.totalByteSize, 0);
+}
+
+- (void)testColdCacheShedsMost
+{
+    PWCacheBudgetCoordinator* coordinator = [[PWCacheBudgetCoordinator alloc] initWithByteBudget:0];
+    PWLRUCache* hotCache  = [self cacheWithName:@"hot"
+                                         weight:1.0
+                                    coordinator:coordinator
+                                          queue:[PWDispatchQueue serialDispatchQueueWithLabel:@"PWCacheBudgetCoordinatorTest.hot"]];
+    PWLRUCache* coldCache = [self cacheWithName:@"cold"
+                                         weight:1.0
+                                    coordinator:coordinator
+                                          queue:[PWDispatchQueue serialDispatchQueueWithLabel:@"PWCacheBudgetCoordinatorTest.cold"]];
+    [self fillCache:hotCache withCount:40];
+    [self fillCache:coldCache withCount:70];
+    [hotCache.dispatchQueue synchronouslyDispatchBlock:^{
+        for (NSUInteger index = 0; index < 40; index++)
+            XCTAssertNotNil(hotCache[@(index)]);
+    }];
+    XCTAssertEqual(coordinator.totalByteSize, 110 * PWCacheBudgetCoordinatorTestCost);
+
+    // 2000 bytes are shed to reach 90% of the budget, almost all of them by the cache without hits.
+    coordinator.byteBudget = 100 * PWCacheBudgetCoordinatorTestCost;
+    [self waitForCoordinator:coordinator];
+    XCTAssertEqual([self countOfCache:coldCache], 50);
+    XCTAssertGreaterThanOrEqual([self countOfCache:hotCache], 39);
+    XCTAssertLessThanOrEqual(coordinator.totalByteSize, 90 * PWCacheBudgetCoordinatorTestCost);
+
+    // The least recently used objects go first.
+    [coldCache.dispatchQueue synchronouslyDispatchBlock:^{
+        XCTAssertNil(coldCache[@19]);
+        XCTAssertNotNil(coldCache[@20]);
+    }];
+}
+
+- (void)testGrowingBeyondBudget
+{
+    PWCacheBudgetCoordinator* coordinator = [[PWCacheBudgetCoordinator alloc] initWithByteBudget:10 * PWCacheBudgetCoordinatorTestCost];
+    PWLRUCache* cache = [self cacheWithName:@"test"
+                                     weight:1.0
+                                coordinator:coordinator
+                                      queue:[PWDispatchQueue serialDispatchQueueWithLabel:@"PWCacheBudgetCoordinatorTest"]];
+    [self fillCache:cache withCount:100];
+    [self waitForCoordinator:coordinator];
+    XCTAssertLessThanOrEqual(coordinator.totalByteSize, 10 * PWCacheBudgetCoordinatorTestCost);
+    XCTAssertLessThanOrEqual([self countOfCache:cache], 10);
+    XCTAssertGreaterThanOrEqual(cache.budgetRegistration.statistics.evictionCount, 90);
+}
+
+- (void)testAsyncCache
+{
+    PWCacheBudgetCoordinator* coordinator = [[PWCacheBudgetCoordinator alloc] initWithByteBudget:0];
+    NSMutableArray* evictedKeys = [NSMutableArray array];
+    PWAsyncLRUCache* cache = [[PWAsyncLRUCache alloc] initWithCapacity:100
+                                                        removalHandler:^(id key,
+                                                                         id object,
+                                                                         BOOL isOptional,
+                                                                         PWLRUCacheRemovalResponseHandler responseHandler)
+                              {
+                                  if (isOptional)
+                                      [evictedKeys addObject:key];
+                                  responseHandler(/* shouldRemove */YES);
+                              }];
+    [cache joinBudgetCoordinator:coordinator
+                            name:@"async"
+                          weight:1.0
+                   costEstimator:^NSUInteger(id key, id object) {
+                       return PWCacheBudgetCoordinatorTestCost;
+                   }];
+    for (NSUInteger index = 0; index < 10; index++)
+        cache[@(index)] = @"object";
+    XCTAssertEqual(cache.count, 10);
+    XCTAssertEqual(coordinator.totalByteSize, 10 * PWCacheBudgetCoordinatorTestCost);
+
+    // Shedding to 450 bytes evicts the six oldest objects.
+    coordinator.byteBudget = 5 * PWCacheBudgetCoordinatorTestCost;
+    [self waitForCoordinator:coordinator];
+    XCTAssertEqual(cache.count, 4);
+    XCTAssertEqualObjects(evictedKeys, (@[@0, @1, @2, @3, @4, @5]));
+    XCTAssertEqual(cache.budgetRegistration.statistics.evictionCount, 6);
+
+    PWDispatchSemaphore* disposed = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    [cache disposeWithCompletionHandler:^{ [disposed signal]; }];
+    XCTAssertTrue([disposed waitWithTimeout:self.shortTimeout useWallTime:NO]);
+    XCTAssertEqual(coordinator.totalByteSize, 0);
+    XCTAssertEqual(coordinator.statistics.count, 0);
+}
+
+- (void)testMemoryPressure
+{
+    PWCacheBudgetCoordinator* coordinator = [[PWCacheBudgetCoordinator alloc] initWithByteBudget:0];
+    PWLRUCache* cache1 = [self cacheWithName:@"1"
+                                      weight:1.0
+                                 coordinator:coordinator
+                                       queue:[PWDispatchQueue serialDispatchQueueWithLabel:@"PWCacheBudgetCoordinatorTest.1"]];
+    PWLRUCache* cache2 = [self cacheWithName:@"2"
+                                      weight:1.0
+                                 coordinator:coordinator
+                                       queue:[PWDispatchQueue serialDispatchQueueWithLabel:@"PWCacheBudgetCoordinatorTest.2"]];
+    [self fillCache:cache1 withCount:10];
+    [self fillCache:cache2 withCount:10];
+
+    // A warning halves the caches instead of flushing them.
+    PWDispatchSemaphore* done = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    [coordinator shedForMemoryPressure:DISPATCH_MEMORYPRESSURE_WARN completionHandler:^{ [done signal]; }];
+    XCTAssertTrue([done waitWithTimeout:self.longTimeout useWallTime:NO]);
+    XCTAssertEqual([self countOfCache:cache1], 5);
+    XCTAssertEqual([self countOfCache:cache2], 5);
+
+    [coordinator shedForMemoryPressure:DISPATCH_MEMORYPRESSURE_CRITICAL completionHandler:^{ [done signal]; }];
+    XCTAssertTrue([done waitWithTimeout:self.longTimeout useWallTime:NO]);
+    XCTAssertEqual([self countOfCache:cache1], 0);
+    XCTAssertEqual([self countOfCache:cache2], 0);
+    XCTAssertEqual(coordinator.totalByteSize, 0);
+}
+
+- (void)testDeallocatedCacheLeaves
+{
+    PWCacheBudgetCoordinator* coordinator = [[PWCacheBudgetCoordinator alloc] initWithByteBudget:0];
+    @autoreleasepool {
+        PWLRUCache* cache = [self cacheWithName:@"test"
+                                         weight:1.0
+                                    coordinator:coordinator
+                                          queue:[PWDispatchQueue serialDispatchQueueWithLabel:@"PWCacheBudgetCoordinatorTest"]];
+        [self fillCache:cache withCount:10];
+        XCTAssertEqual(coordinator.totalByteSize, 10 * PWCacheBudgetCoordinatorTestCost);
+    }
+    XCTAssertEqual(coordinator.totalByteSize, 0);
+    XCTAssertEqual(coordinator.statistics.count, 0);
+}
+
+@end
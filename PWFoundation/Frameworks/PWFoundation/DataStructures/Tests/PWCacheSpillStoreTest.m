@@ -0,0 +1,368 @@
+//
+//  PWCacheSpillStoreTest.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import "PWTestCase.h"
+#import "PWCacheSpillStore.h"
+#import "PWAsyncLRUCache.h"
+
+@interface PWCacheSpillStoreTestObject : NSObject <PWCacheSpillable>
+- (instancetype)initWithString:(NSString*)string;
+@property (nonatomic, readonly, copy) NSString* string;
+@end
+
+@implementation PWCacheSpillStoreTestObject
+
+- (instancetype)initWithString:(NSString*)string
+{
+    if (self = [super init])
+        _string = [string copy];
+    return self;
+}
+
+- (BOOL)isEqual:(id)object
+{
+    return [object isKindOfClass:PWCacheSpillStoreTestObject.class] && [[object string] isEqualToString:_string];
+}
+
+- (NSUInteger)hash
+{
+    return _string.hash;
+}
+
+- (nullable NSData*)spillData
+{
+    return [_string dataUsingEncoding:NSUTF8StringEncoding];
+}
+
++ (nullable id)objectWithSpillData:(NSData*)data
+{
+    return [[self alloc] initWithString:[[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding]];
+}
+
+@end
+
+static PWCacheSpillStoreTestObject* PWTestObject (NSUInteger index, NSUInteger length)
+{
+    NSString* prefix = [NSString stringWithFormat:@"%lu:", (unsigned long)index];
+    return [[PWCacheSpillStoreTestObject alloc] initWithString:[prefix stringByPaddingToLength:MAX (length, prefix.length)
+                                                                                     withString:@"x"
+                                                                                startingAtIndex:0]];
+}
+
+@interface PWCacheSpillStoreTest : PWTestCase
+@end
+
+@implementation PWCacheSpillStoreTest
+{
+    NSURL* _directoryURL;
+}
+
+- (void)setUp
+{
+    [super setUp];
+    _directoryURL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"PWCacheSpillStoreTest"]
+                               isDirectory:YES];
+    [NSFileManager.defaultManager removeItemAtURL:_directoryURL error:NULL];
+}
+
+- (void)tearDown
+{
+    [NSFileManager.defaultManager removeItemAtURL:_directoryURL error:NULL];
+    [super tearDown];
+}
+
+- (PWCacheSpillStore*)storeWithMaximumByteSize:(unsigned long long)maximumByteSize
+{
+    NSError* error;
+    PWCacheSpillStore* store = [[PWCacheSpillStore alloc] initWithDirectoryURL:_directoryURL
+                                                               maximumByteSize:maximumByteSize
+                                                                         error:&error];
+    XCTAssertNotNil(store, @"%@", error);
+    return store;
+}
+
+- (void)synchronizeStore:(PWCacheSpillStore*)store
+{
+    PWDispatchSemaphore* done = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    [store synchronizeOnQueue:PWDispatchQueue.globalDefaultPriorityQueue completionHandler:^{
+        [done signal];
+    }];
+    XCTAssertTrue([done waitWithTimeout:self.longTimeout useWallTime:NO]);
+}
+
+- (nullable id)takeObjectForKey:(id)key fromStore:(PWCacheSpillStore*)store
+{
+    __block id result;
+    PWDispatchSemaphore* done = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    [store takeObjectForKey:key queue:PWDispatchQueue.globalDefaultPriorityQueue completionHandler:^(id _Nullable object) {
+        result = object;
+        [done signal];
+    }];
+    XCTAssertTrue([done waitWithTimeout:self.shortTimeout useWallTime:NO]);
+    return result;
+}
+
+- (NSURL*)onlySegmentURL
+{
+    NSArray<NSURL*>* URLs = [NSFileManager.defaultManager contentsOfDirectoryAtURL:_directoryURL
+                                                        includingPropertiesForKeys:nil
+                                                                           options:NSDirectoryEnumerationSkipsHiddenFiles
+                                                                             error:NULL];
+    XCTAssertEqual(URLs.count, 1);
+    return URLs.firstObject;
+}
+
+- (void)testSpillAndTake
+{
+    PWCacheSpillStore* store = [self storeWithMaximumByteSize:1024 * 1024];
+    for (NSUInteger index = 0; index < 3; index++)
+        [store spillObject:PWTestObject (index, 100) forKey:@(index)];
+    [store spillObject:PWTestObject (10, 100) forKey:@1];       // replaces
+    XCTAssertEqual(store.count, 3);
+
+    XCTAssertEqualObjects([self takeObjectForKey:@1 fromStore:store], PWTestObject (10, 100));
+    XCTAssertNil([self takeObjectForKey:@1 fromStore:store]);
+    XCTAssertNil([self takeObjectForKey:@"unknown" fromStore:store]);
+    XCTAssertEqual(store.count, 2);
+
+    [store removeObjectForKey:@0];
+    XCTAssertNil([self takeObjectForKey:@0 fromStore:store]);
+    XCTAssertEqualObjects([self takeObjectForKey:@2 fromStore:store], PWTestObject (2, 100));
+
+    [store spillObject:PWTestObject (3, 100) forKey:@3];
+    [store removeAllObjects];
+    XCTAssertEqual(store.count, 0);
+    XCTAssertEqual(store.byteSize, 0);
+    [store close];
+}
+
+- (void)testMayContainObjectForKey
+{
+    PWCacheSpillStore* store = [self storeWithMaximumByteSize:1024 * 1024];
+    XCTAssertFalse([store mayContainObjectForKey:@1]);
+
+    // Pending requests count as well.
+    [store spillObject:PWTestObject (1, 100) forKey:@1];
+    [store spillObject:PWTestObject (2, 100) forKey:@2];
+    XCTAssertTrue([store mayContainObjectForKey:@1]);
+    XCTAssertFalse([store mayContainObjectForKey:@3]);
+
+    XCTAssertNotNil([self takeObjectForKey:@1 fromStore:store]);
+    XCTAssertFalse([store mayContainObjectForKey:@1]);
+    [store removeObjectForKey:@2];
+    [self synchronizeStore:store];
+    XCTAssertFalse([store mayContainObjectForKey:@2]);
+
+    [store spillObject:PWTestObject (3, 100) forKey:@3];
+    [store close];
+    store = [self storeWithMaximumByteSize:1024 * 1024];
+    XCTAssertTrue([store mayContainObjectForKey:@3]);
+    [store removeAllObjects];
+    [self synchronizeStore:store];
+    XCTAssertFalse([store mayContainObjectForKey:@3]);
+    [store close];
+}
+
+- (void)testRecovery
+{
+    PWCacheSpillStore* store = [self storeWithMaximumByteSize:1024 * 1024];
+    for (NSUInteger index = 0; index < 10; index++)
+        [store spillObject:PWTestObject (index, 1000) forKey:[NSString stringWithFormat:@"key %lu", (unsigned long)index]];
+    [store spillObject:PWTestObject (50, 1000) forKey:@"key 5"];
+    [store removeObjectForKey:@"key 3"];
+    XCTAssertNotNil([self takeObjectForKey:@"key 7" fromStore:store]);
+    unsigned long long byteSize = store.byteSize;
+    [store close];
+
+    store = [self storeWithMaximumByteSize:1024 * 1024];
+    XCTAssertEqual(store.count, 8);
+    XCTAssertEqual(store.byteSize, byteSize);
+    XCTAssertNil([self takeObjectForKey:@"key 3" fromStore:store]);
+    XCTAssertNil([self takeObjectForKey:@"key 7" fromStore:store]);
+    XCTAssertEqualObjects([self takeObjectForKey:@"key 5" fromStore:store], PWTestObject (50, 1000));
+    XCTAssertEqualObjects([self takeObjectForKey:@"key 9" fromStore:store], PWTestObject (9, 1000));
+    [store close];
+}
+
+- (void)testTornRecordIsCutOff
+{
+    PWCacheSpillStore* store = [self storeWithMaximumByteSize:1024 * 1024];
+    [store spillObject:PWTestObject (1, 1000) forKey:@1];
+    [store spillObject:PWTestObject (2, 1000) forKey:@2];
+    unsigned long long byteSize = store.byteSize;
+    [store close];
+
+    // The start of a record whose payload never made it to the disk.
+    uint32_t header[5] = { 0x52535750, 0, 10, 20, 4000 };
+    NSFileHandle* handle = [NSFileHandle fileHandleForWritingToURL:self.onlySegmentURL error:NULL];
+    [handle seekToEndOfFile];
+    [handle writeData:[NSData dataWithBytes:header length:sizeof header]];
+    [handle writeData:[@"partial" dataUsingEncoding:NSUTF8StringEncoding]];
+    [handle closeFile];
+
+    store = [self storeWithMaximumByteSize:1024 * 1024];
+    XCTAssertEqual(store.count, 2);
+    XCTAssertEqual(store.byteSize, byteSize);
+    NSNumber* fileSize;
+    [self.onlySegmentURL getResourceValue:&fileSize forKey:NSURLFileSizeKey error:NULL];
+    XCTAssertEqual(fileSize.unsignedLongLongValue, byteSize);
+
+    // Appending continues behind the last intact record.
+    [store spillObject:PWTestObject (3, 1000) forKey:@3];
+    [store close];
+    store = [self storeWithMaximumByteSize:1024 * 1024];
+    XCTAssertEqual(store.count, 3);
+    XCTAssertEqualObjects([self takeObjectForKey:@3 fromStore:store], PWTestObject (3, 1000));
+    XCTAssertEqualObjects([self takeObjectForKey:@1 fromStore:store], PWTestObject (1, 1000));
+    [store close];
+}
+
+- (void)testMaximumByteSize
+{
+    // Segments of 64 KB.
+    PWCacheSpillStore* store = [self storeWithMaximumByteSize:256 * 1024];
+    for (NSUInteger index = 0; index < 200; index++)
+        [store spillObject:PWTestObject (index, 4000) forKey:@(index)];
+    [self synchronizeStore:store];
+
+    XCTAssertLessThanOrEqual(store.byteSize, 256 * 1024);
+    XCTAssertLessThan(store.count, 200);
+    XCTAssertGreaterThan(store.count, 40);
+    XCTAssertNil([self takeObjectForKey:@0 fromStore:store]);
+    XCTAssertEqualObjects([self takeObjectForKey:@199 fromStore:store], PWTestObject (199, 4000));
+    [store close];
+}
+
+- (void)testCompaction
+{
+    PWCacheSpillStore* store = [self storeWithMaximumByteSize:1024 * 1024];
+    for (NSUInteger index = 0; index < 100; index++)
+        [store spillObject:PWTestObject (index, 4000) forKey:@(index)];
+    [self synchronizeStore:store];
+    unsigned long long fullByteSize = store.byteSize;
+    XCTAssertGreaterThan(fullByteSize, 400 * 1000);
+
+    for (NSUInteger index = 0; index < 80; index++)
+        [store removeObjectForKey:@(index)];
+    [self synchronizeStore:store];
+    XCTAssertEqual(store.count, 20);
+    XCTAssertLessThan(store.byteSize, fullByteSize / 2);
+
+    // The copied records and the removals survive a restart.
+    [store close];
+    store = [self storeWithMaximumByteSize:1024 * 1024];
+    XCTAssertEqual(store.count, 20);
+    XCTAssertNil([self takeObjectForKey:@10 fromStore:store]);
+    for (NSUInteger index = 80; index < 100; index++)
+        XCTAssertEqualObjects([self takeObjectForKey:@(index) fromStore:store], PWTestObject (index, 4000));
+    [store close];
+}
+
+- (void)testRemovalRecordsDoNotPileUp
+{
+    // Segments of 1 MB, about 20 MB are written.
+    PWCacheSpillStore* store = [self storeWithMaximumByteSize:16 * 1024 * 1024];
+    for (NSUInteger round = 0; round < 100; round++)
+    {
+        for (NSUInteger index = 0; index < 50; index++)
+            [store spillObject:PWTestObject (index, 4000) forKey:@(index)];
+        for (NSUInteger index = 0; index < 50; index++)
+            [store removeObjectForKey:@(index)];
+    }
+    [self synchronizeStore:store];
+    XCTAssertEqual(store.count, 0);
+    XCTAssertLessThan(store.byteSize, 2 * 1024 * 1024);
+
+    [store close];
+    store = [self storeWithMaximumByteSize:16 * 1024 * 1024];
+    XCTAssertEqual(store.count, 0);
+    [store close];
+}
+
+- (void)testRemoveAllDuringCompaction
+{
+    // Segments of 1 MB, so compacting the first segment takes several steps.
+    PWCacheSpillStore* store = [self storeWithMaximumByteSize:16 * 1024 * 1024];
+    for (NSUInteger index = 0; index < 300; index++)
+        [store spillObject:PWTestObject (index, 4000) forKey:@(index)];
+    for (NSUInteger index = 0; index < 250; index++)
+        [store removeObjectForKey:@(index)];
+
+    // The new records have the same keys and lengths, so they land at the offsets of the removed ones.
+    [store removeAllObjects];
+    for (NSUInteger index = 0; index < 10; index++)
+        [store spillObject:PWTestObject (index + 1000, 4000) forKey:@(index)];
+    [self synchronizeStore:store];
+
+    XCTAssertEqual(store.count, 10);
+    for (NSUInteger index = 0; index < 10; index++)
+        XCTAssertEqualObjects([self takeObjectForKey:@(index) fromStore:store], PWTestObject (index + 1000, 4000));
+    [store close];
+}
+
+- (void)testAsyncCacheReadsBackSpilledObjects
+{
+    PWCacheSpillStore* store = [self storeWithMaximumByteSize:1024 * 1024];
+    PWAsyncLRUCache<NSString*, PWCacheSpillStoreTestObject*>* cache;
+    cache = [[PWAsyncLRUCache alloc] initWithCapacity:2
+                                       removalHandler:^(id key,
+                                                        id object,
+                                                        BOOL isOptional,
+                                                        PWLRUCacheRemovalResponseHandler responseHandler)
+             {
+                 responseHandler(/* shouldRemove */YES);
+             }];
+    cache.spillStore = store;
+
+    cache[@"a"] = PWTestObject (1, 100);
+    cache[@"b"] = PWTestObject (2, 100);
+    cache[@"c"] = PWTestObject (3, 100);     // evicts "a"
+    XCTAssertEqual(cache.count, 2);
+    [self synchronizeStore:store];
+    XCTAssertEqual(store.count, 1);
+
+    XCTestExpectation* expectLookup = [self expectationWithDescription:@"lookup"];
+    [cache objectForKey:@"a"
+          creationBlock:^(id key, PWLRUCacheObjectResponseBlock responseBlock) {
+              XCTFail(@"spilled object is created again");
+              responseBlock(PWTestObject (0, 100));
+          } completionHandler:^(id object) {
+              XCTAssertEqualObjects(object, PWTestObject (1, 100));
+              [expectLookup fulfill];
+          }];
+    [self waitForExpectationsWithTimeout:self.shortTimeout handler:nil];
+    XCTAssertEqual(store.count, 0);
+
+    // Memory pressure spills everything.
+    XCTestExpectation* expectEviction = [self expectationWithDescription:@"evict"];
+    [cache evictAsManyObjectsAsPossibleWithCompletionHandler:^{
+        [expectEviction fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:self.shortTimeout handler:nil];
+    XCTAssertEqual(cache.count, 0);
+    [self synchronizeStore:store];
+    XCTAssertEqual(store.count, 3);
+
+    // A new object replaces the spilled one.
+    cache[@"b"] = PWTestObject (20, 100);
+    XCTAssertEqual(cache.count, 1);
+    [self synchronizeStore:store];
+    XCTAssertEqual(store.count, 2);
+    XCTAssertEqualObjects(cache[@"b"], PWTestObject (20, 100));
+    XCTAssertEqualObjects(cache[@"c"], PWTestObject (3, 100));
+
+    XCTestExpectation* expectDisposal = [self expectationWithDescription:@"dispose"];
+    [cache disposeWithCompletionHandler:^{
+        [expectDisposal fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:self.shortTimeout handler:nil];
+    XCTAssertEqual(store.count, 0);
+    [store close];
+}
+
+@end
@@ -0,0 +1,227 @@
+//
+//  PWLRUCachePolicyTest.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import "PWTestCase.h"
+#import "PWLRUCache.h"
+#import "PWAsyncLRUCache.h"
+
+// Traces are arrays of uint32_t keys, generated deterministically so the hit rates are comparable between runs.
+
+static uint64_t PWNextRandom (uint64_t* state)
+{
+    // xorshift64*
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+// Appends 'length' keys out of 'keyCount' keys whose popularity follows Zipf's law with the given exponent.
+static void PWAppendZipfKeys (NSMutableData* trace, NSUInteger keyCount, double exponent, NSUInteger length, uint64_t* state)
+{
+    double* cumulative = malloc (keyCount * sizeof (double));
+    double sum = 0.0;
+    for (NSUInteger rank = 0; rank < keyCount; rank++)
+        cumulative[rank] = (sum += 1.0 / pow ((double)(rank + 1), exponent));
+
+    for (NSUInteger index = 0; index < length; index++)
+    {
+        double value = (double)(PWNextRandom (state) >> 11) / (double)(1ULL << 53) * sum;
+        NSUInteger low = 0, high = keyCount - 1;
+        while (low < high)
+        {
+            NSUInteger middle = (low + high) / 2;
+            if (cumulative[middle] < value)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        uint32_t key = (uint32_t)low;
+        [trace appendBytes:&key length:sizeof key];
+    }
+    free (cumulative);
+}
+
+static NSData* PWZipfTrace (void)
+{
+    NSMutableData* trace = [NSMutableData data];
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    PWAppendZipfKeys (trace, 10000, 0.9, 200000, &state);
+    return trace;
+}
+
+// Zipf distributed lookups interrupted by scans through keys which are never used again, like reports touching every
+// record once.
+static NSData* PWScanTrace (void)
+{
+    NSMutableData* trace = [NSMutableData data];
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    uint32_t scanKey = 1000000;
+    for (NSUInteger round = 0; round < 10; round++)
+    {
+        PWAppendZipfKeys (trace, 10000, 0.9, 20000, &state);
+        for (NSUInteger index = 0; index < 5000; index++, scanKey++)
+            [trace appendBytes:&scanKey length:sizeof scanKey];
+    }
+    return trace;
+}
+
+@interface PWLRUCachePolicyTest : PWTestCase
+@end
+
+@implementation PWLRUCachePolicyTest
+
+- (double)hitRateOfReplayingTrace:(NSData*)trace policy:(PWLRUCachePolicy)policy capacity:(NSUInteger)capacity
+{
+    PWDispatchQueue* queue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWLRUCachePolicyTest"];
+    PWLRUCache<NSNumber*, NSNumber*>* cache = [[PWLRUCache alloc] initWithCapacity:capacity
+                                                                          delegate:nil
+                                                                     dispatchQueue:queue
+                                                                            policy:policy];
+    const uint32_t* keys = trace.bytes;
+    NSUInteger count = trace.length / sizeof (uint32_t);
+    __block NSUInteger hitCount = 0;
+    [queue synchronouslyDispatchBlock:^{
+        for (NSUInteger index = 0; index < count; index++)
+            @autoreleasepool {
+                NSNumber* key = @(keys[index]);
+                if (cache[key])
+                    hitCount++;
+                else
+                    cache[key] = key;
+            }
+    }];
+    return (double)hitCount / (double)count;
+}
+
+- (void)testPolicies
+{
+    PWDispatchQueue* queue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWLRUCachePolicyTest"];
+    PWLRUCache* cache = [[PWLRUCache alloc] initWithCapacity:3 delegate:nil dispatchQueue:queue];
+    XCTAssertEqual(cache.policy, PWLRUCachePolicyLRU);
+    cache = [[PWLRUCache alloc] initWithCapacity:3 delegate:nil dispatchQueue:queue policy:PWLRUCachePolicyWTinyLFU];
+    XCTAssertEqual(cache.policy, PWLRUCachePolicyWTinyLFU);
+}
+
+- (void)testScanResistance
+{
+    for (PWLRUCachePolicy policy = PWLRUCachePolicyLRU; policy <= PWLRUCachePolicyWTinyLFU; policy++)
+    {
+        PWDispatchQueue* queue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWLRUCachePolicyTest"];
+        PWLRUCache<NSNumber*, NSNumber*>* cache = [[PWLRUCache alloc] initWithCapacity:100
+                                                                              delegate:nil
+                                                                         dispatchQueue:queue
+                                                                                policy:policy];
+        [queue synchronouslyDispatchBlock:^{
+            for (NSUInteger round = 0; round < 5; round++)
+                for (NSUInteger key = 0; key < 50; key++)
+                    if (!cache[@(key)])
+                        cache[@(key)] = @(key);
+
+            for (NSUInteger key = 1000; key < 2000; key++)
+                if (!cache[@(key)])
+                    cache[@(key)] = @(key);
+            XCTAssertEqual(cache.count, 100);
+
+            NSUInteger survivorCount = 0;
+            for (NSUInteger key = 0; key < 50; key++)
+                if (cache[@(key)])
+                    survivorCount++;
+            if (policy == PWLRUCachePolicyLRU)
+                XCTAssertEqual(survivorCount, 0);
+            else
+                XCTAssertGreaterThanOrEqual(survivorCount, 45);
+        }];
+    }
+}
+
+- (void)testDelegateIsAskedForVictims
+{
+    PWDispatchQueue* queue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWLRUCachePolicyTest"];
+    PWLRUCache<NSNumber*, NSNumber*>* cache = [[PWLRUCache alloc] initWithCapacity:10
+                                                                          delegate:nil
+                                                                     dispatchQueue:queue
+                                                                            policy:PWLRUCachePolicyWTinyLFU];
+    [queue synchronouslyDispatchBlock:^{
+        for (NSUInteger key = 0; key < 100; key++)
+            cache[@(key)] = @(key);
+        XCTAssertEqual(cache.count, 10);
+        [cache evictAsManyObjectsAsPossible];
+        XCTAssertEqual(cache.count, 0);
+    }];
+}
+
+- (void)testAsyncCacheScanResistance
+{
+    NSMutableArray* evictedKeys = [NSMutableArray array];
+    PWAsyncLRUCache<NSNumber*, NSNumber*>* cache;
+    cache = [[PWAsyncLRUCache alloc] initWithCapacity:100
+                                               policy:PWLRUCachePolicyWTinyLFU
+                                       removalHandler:^(id key,
+                                                        id object,
+                                                        BOOL isOptional,
+                                                        PWLRUCacheRemovalResponseHandler responseHandler)
+             {
+                 [evictedKeys addObject:key];
+                 responseHandler(/* shouldRemove */YES);
+             }];
+    XCTAssertEqual(cache.policy, PWLRUCachePolicyWTinyLFU);
+
+    for (NSUInteger round = 0; round < 5; round++)
+        for (NSUInteger key = 0; key < 50; key++)
+            if (!cache[@(key)])
+                cache[@(key)] = @(key);
+    for (NSUInteger key = 1000; key < 2000; key++)
+        if (!cache[@(key)])
+            cache[@(key)] = @(key);
+    XCTAssertEqual(cache.count, 100);
+
+    NSUInteger survivorCount = 0;
+    for (NSUInteger key = 0; key < 50; key++)
+        if (cache[@(key)])
+            survivorCount++;
+    XCTAssertGreaterThanOrEqual(survivorCount, 45);
+    XCTAssertEqual(evictedKeys.count, 950);
+}
+
+#pragma mark - Trace Replay
+
+- (void)testScanTraceHitRates
+{
+    NSData* trace = PWScanTrace();
+    double lruHitRate     = [self hitRateOfReplayingTrace:trace policy:PWLRUCachePolicyLRU      capacity:1000];
+    double tinyLFUHitRate = [self hitRateOfReplayingTrace:trace policy:PWLRUCachePolicyWTinyLFU capacity:1000];
+    // The scans flush the hot keys out of a plain LRU, the admission filter keeps them.
+    XCTAssertGreaterThan(tinyLFUHitRate, lruHitRate + 0.05, @"LRU %.3f, W-TinyLFU %.3f", lruHitRate, tinyLFUHitRate);
+}
+
+- (void)testZipfTraceHitRates
+{
+    NSData* trace = PWZipfTrace();
+    double lruHitRate     = [self hitRateOfReplayingTrace:trace policy:PWLRUCachePolicyLRU      capacity:1000];
+    double tinyLFUHitRate = [self hitRateOfReplayingTrace:trace policy:PWLRUCachePolicyWTinyLFU capacity:1000];
+    XCTAssertGreaterThan(tinyLFUHitRate, lruHitRate, @"LRU %.3f, W-TinyLFU %.3f", lruHitRate, tinyLFUHitRate);
+}
+
+- (void)testLRUReplayPerformance
+{
+    NSData* trace = PWScanTrace();
+    [self measureBlock:^{
+        [self hitRateOfReplayingTrace:trace policy:PWLRUCachePolicyLRU capacity:1000];
+    }];
+}
+
+- (void)testWTinyLFUReplayPerformance
+{
+    NSData* trace = PWScanTrace();
+    [self measureBlock:^{
+        [self hitRateOfReplayingTrace:trace policy:PWLRUCachePolicyWTinyLFU capacity:1000];
+    }];
+}
+
+@end
@@ -0,0 +1,233 @@
+//
+//  PWPersistentDictionaryTest.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import "PWTestCase.h"
+#import "PWPersistentDictionary.h"
+#import "NSDictionary-PWExtensions.h"
+
+// A key whose hash only depends on a part of its value, to test keys with colliding hashes.
+@interface PWCollidingKey : NSObject <NSCopying>
++ (instancetype)keyWithValue:(NSUInteger)value;
+@property (nonatomic, readonly) NSUInteger value;
+@end
+
+@implementation PWCollidingKey
+
++ (instancetype)keyWithValue:(NSUInteger)value
+{
+    PWCollidingKey* key = [[self alloc] init];
+    key->_value = value;
+    return key;
+}
+
+- (id)copyWithZone:(NSZone*)zone
+{
+    return self;
+}
+
+- (NSUInteger)hash
+{
+    return _value / 8;
+}
+
+- (BOOL)isEqual:(id)object
+{
+    return [object isKindOfClass:PWCollidingKey.class] && ((PWCollidingKey*)object).value == _value;
+}
+
+@end
+
+#pragma mark
+
+@interface PWPersistentDictionaryTest : PWTestCase
+@end
+
+@implementation PWPersistentDictionaryTest
+
+- (void)testSettingAndRemoving
+{
+    PWPersistentDictionary<NSString*, NSNumber*>* empty = [[PWPersistentDictionary alloc] init];
+    XCTAssertEqual(empty.count, 0);
+    XCTAssertNil(empty[@"a"]);
+
+    PWPersistentDictionary<NSString*, NSNumber*>* dict1 = [empty dictionaryBySettingObject:@1 forKey:@"a"];
+    PWPersistentDictionary<NSString*, NSNumber*>* dict2 = [dict1 dictionaryBySettingObject:@2 forKey:@"b"];
+    PWPersistentDictionary<NSString*, NSNumber*>* dict3 = [dict2 dictionaryBySettingObject:@3 forKey:@"a"];
+    XCTAssertEqualObjects(dict1, @{@"a": @1});
+    XCTAssertEqualObjects(dict2, (@{@"a": @1, @"b": @2}));
+    XCTAssertEqualObjects(dict3, (@{@"a": @3, @"b": @2}));
+    XCTAssertEqual(empty.count, 0);
+
+    // Updates which change nothing return the receiver.
+    XCTAssertEqual([dict3 dictionaryBySettingObject:@3 forKey:@"a"], dict3);
+    XCTAssertEqual([dict3 dictionaryByRemovingObjectForKey:@"c"], dict3);
+
+    PWPersistentDictionary<NSString*, NSNumber*>* dict4 = [dict3 dictionaryByRemovingObjectForKey:@"a"];
+    XCTAssertEqualObjects(dict4, @{@"b": @2});
+    XCTAssertEqualObjects([dict4 dictionaryByRemovingObjectForKey:@"b"], @{});
+    XCTAssertEqualObjects(dict3, (@{@"a": @3, @"b": @2}));
+
+    // Keys are copied.
+    NSMutableString* key = [NSMutableString stringWithString:@"c"];
+    PWPersistentDictionary<NSString*, NSNumber*>* dict5 = [dict4 dictionaryBySettingObject:@5 forKey:key];
+    [key appendString:@"d"];
+    XCTAssertEqualObjects(dict5[@"c"], @5);
+    XCTAssertNil(dict5[@"cd"]);
+}
+
+- (void)testInitialization
+{
+    NSMutableDictionary* expected = [NSMutableDictionary dictionary];
+    for (NSUInteger index = 0; index < 1000; index++)
+        expected[@(index)] = [NSString stringWithFormat:@"%lu", (unsigned long)index];
+
+    PWPersistentDictionary* dict = [PWPersistentDictionary persistentDictionaryWithDictionary:expected];
+    XCTAssertEqualObjects(dict, expected);
+    XCTAssertEqualObjects([NSSet setWithArray:dict.allKeys], [NSSet setWithArray:expected.allKeys]);
+    XCTAssertEqual([PWPersistentDictionary persistentDictionaryWithDictionary:dict], dict);
+    XCTAssertEqual(dict.copy, dict);
+    XCTAssertTrue([dict.mutableCopy isKindOfClass:NSMutableDictionary.class]);
+    XCTAssertEqualObjects(dict.mutableCopy, expected);
+
+    // Of duplicate keys the last one wins.
+    dict = [PWPersistentDictionary dictionaryWithObjectsAndKeys:@1, @"a", @2, @"b", @3, @"a", nil];
+    XCTAssertEqualObjects(dict, (@{@"a": @3, @"b": @2}));
+
+    __block NSUInteger count = 0;
+    [dict enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL* stop) {
+        count++;
+        *stop = YES;
+    }];
+    XCTAssertEqual(count, 1);
+}
+
+// Compares random updates of all versions with plain dictionaries, using keys with many hash collisions.
+- (void)testRandomUpdatesWithCollisions
+{
+    NSMutableArray<PWPersistentDictionary*>* versions = [NSMutableArray array];
+    NSMutableArray<NSDictionary*>* expectedVersions = [NSMutableArray array];
+    PWPersistentDictionary* dict = [[PWPersistentDictionary alloc] init];
+    NSMutableDictionary* expected = [NSMutableDictionary dictionary];
+    srandom(7);
+
+    for (NSUInteger index = 0; index < 5000; index++)
+    {
+        PWCollidingKey* key = [PWCollidingKey keyWithValue:(NSUInteger)random() % 400];
+        if (random() % 3)
+        {
+            dict = [dict dictionaryBySettingObject:@(index) forKey:key];
+            expected[key] = @(index);
+        }
+        else
+        {
+            dict = [dict dictionaryByRemovingObjectForKey:key];
+            [expected removeObjectForKey:key];
+        }
+        if (index % 250 == 0)
+        {
+            [versions addObject:dict];
+            [expectedVersions addObject:[expected copy]];
+        }
+    }
+
+    XCTAssertEqualObjects(dict, expected);
+    for (NSUInteger index = 0; index < versions.count; index++)
+        XCTAssertEqualObjects(versions[index], expectedVersions[index]);
+}
+
+- (void)testExtensionHelpers
+{
+    NSMutableDictionary* small = [NSMutableDictionary dictionary];
+    NSMutableDictionary* large = [NSMutableDictionary dictionary];
+    for (NSUInteger index = 0; index < PWPersistentDictionaryMinimumCount; index++)
+    {
+        if (index < PWPersistentDictionaryMinimumCount / 2)
+            small[@(index)] = @(index);
+        large[@(index)] = @(index);
+    }
+
+    XCTAssertFalse([[small dictionaryByAddingEntriesFromDictionary:@{@"a": @1}] isKindOfClass:PWPersistentDictionary.class]);
+    XCTAssertFalse([[NSDictionary dictionaryBySettingObject:@1 forKey:@"a" inDictionary:small] isKindOfClass:PWPersistentDictionary.class]);
+
+    NSDictionary* added = [large dictionaryByAddingEntriesFromDictionary:@{@"a": @1}];
+    XCTAssertTrue([added isKindOfClass:PWPersistentDictionary.class]);
+    XCTAssertEqual(added.count, large.count + 1);
+    XCTAssertEqualObjects(added[@"a"], @1);
+
+    NSDictionary* set = [NSDictionary dictionaryBySettingObject:@2 forKey:@"b" inDictionary:added];
+    XCTAssertEqualObjects(set[@"a"], @1);
+    XCTAssertEqualObjects(set[@"b"], @2);
+    XCTAssertNil(added[@"b"]);
+
+    NSDictionary* removed = [set dictionaryByRemovingObjectsForKeys:@[@"a", @"b", @0]];
+    XCTAssertTrue([removed isKindOfClass:PWPersistentDictionary.class]);
+    XCTAssertEqual(removed.count, large.count - 1);
+    XCTAssertNil(removed[@0]);
+
+    NSDictionary* reduced = [removed reducedDictionary:^BOOL(id key, id value) {
+        return [value unsignedIntegerValue] % 2 == 0;
+    }];
+    XCTAssertEqual(reduced.count, PWPersistentDictionaryMinimumCount / 2 - 1);
+    XCTAssertNil([removed reducedDictionary:^BOOL(id key, id value) {
+        return NO;
+    }]);
+}
+
+#pragma mark - Performance
+
+static const NSUInteger PWPersistentDictionaryPerformanceCount = 5000;
+
+- (void)testIncrementalUpdatePerformance
+{
+    [self measureBlock:^{
+        NSDictionary* dict;
+        for (NSUInteger index = 0; index < PWPersistentDictionaryPerformanceCount; index++)
+            dict = [NSDictionary dictionaryBySettingObject:@(index) forKey:@(index) inDictionary:dict];
+        for (NSUInteger index = 0; index < PWPersistentDictionaryPerformanceCount; index += 2)
+            dict = [dict dictionaryByRemovingObjectsForKeys:@[@(index)]];
+        XCTAssertEqual(dict.count, PWPersistentDictionaryPerformanceCount / 2);
+    }];
+}
+
+// The same updates by copying plain dictionaries, as the helpers did before.
+- (void)testIncrementalCopyingPerformance
+{
+    [self measureBlock:^{
+        NSDictionary* dict = @{};
+        for (NSUInteger index = 0; index < PWPersistentDictionaryPerformanceCount; index++)
+        {
+            NSMutableDictionary* copy = [dict mutableCopy];
+            copy[@(index)] = @(index);
+            dict = copy;
+        }
+        for (NSUInteger index = 0; index < PWPersistentDictionaryPerformanceCount; index += 2)
+        {
+            NSMutableDictionary* copy = [dict mutableCopy];
+            [copy removeObjectForKey:@(index)];
+            dict = copy;
+        }
+        XCTAssertEqual(dict.count, PWPersistentDictionaryPerformanceCount / 2);
+    }];
+}
+
+- (void)testLookupPerformance
+{
+    NSMutableDictionary* plain = [NSMutableDictionary dictionary];
+    for (NSUInteger index = 0; index < PWPersistentDictionaryPerformanceCount; index++)
+        plain[[NSString stringWithFormat:@"key%lu", (unsigned long)index]] = @(index);
+    PWPersistentDictionary* dict = [PWPersistentDictionary persistentDictionaryWithDictionary:plain];
+    NSArray* keys = plain.allKeys;
+
+    [self measureBlock:^{
+        for (NSUInteger iteration = 0; iteration < 20; iteration++)
+            for (NSString* key in keys)
+                (void)dict[key];
+    }];
+}
+
+@end
@@ -35,6 +35,9 @@ NS_ASSUME_NONNULL_BEGIN
 // Returns a new dictionary with every key/value pair for which the block returns true.
 - (nullable NSDictionary<KeyType, ObjectType>*) reducedDictionary:(BOOL (^)(id key, id value))block;
 
+// The following helpers return PWPersistentDictionary instances if the receiver (or the given dictionary for
+// +dictionaryBySettingObject:forKey:inDictionary:) is persistent or has at least PWPersistentDictionaryMinimumCount
+// entries. Then each update shares almost all storage with the previous dictionary instead of copying it.
 - (NSDictionary<KeyType, ObjectType>*) dictionaryByAddingEntriesFromDictionary:(nullable NSDictionary<KeyType, ObjectType>*)dictionary;
 - (NSDictionary<KeyType, ObjectType>*) dictionaryByRemovingObjectsForKeys:(nullable NSArray<KeyType>*)keys;
 
@@ -10,6 +10,7 @@
 #import "NSString-PWExtensions.h"
 #import "PWErrors.h"
 #import "NSError-PWExtensions.h"
+#import "PWPersistentDictionary.h"
 
 @implementation NSDictionary (PWExtensions)
 
@@ -168,10 +169,15 @@
 }
 
 
+// PWPersistentDictionary overrides these helpers. Large plain dictionaries are converted to persistent ones, which makes
+// further updates of the result cheap.
+
 - (NSDictionary*) dictionaryByAddingEntriesFromDictionary:(nullable NSDictionary*)dictionary
 {
     if (!dictionary)
         return self;
+    if (self.count >= PWPersistentDictionaryMinimumCount)
+        return [[PWPersistentDictionary persistentDictionaryWithDictionary:self] dictionaryByAddingEntriesFromDictionary:dictionary];
 
     NSMutableDictionary* result = [self mutableCopy];
     [result addEntriesFromDictionary:dictionary];
@@ -182,6 +188,8 @@
 {
     if(keys.count == 0)
         return self;
+    if (self.count >= PWPersistentDictionaryMinimumCount)
+        return [[PWPersistentDictionary persistentDictionaryWithDictionary:self] dictionaryByRemovingObjectsForKeys:keys];
 
     NSMutableDictionary* result = [self mutableCopy];
     [result removeObjectsForKeys:keys];
@@ -194,6 +202,8 @@
 {
     if (!dictionary)
         return @{key:object};
+    if (dictionary.count >= PWPersistentDictionaryMinimumCount || [dictionary isKindOfClass:PWPersistentDictionary.class])
+        return [[PWPersistentDictionary persistentDictionaryWithDictionary:dictionary] dictionaryBySettingObject:object forKey:key];
         
     NSMutableDictionary* result = [dictionary mutableCopy];
     result[key] = object;
@@ -148,6 +148,18 @@ typedef enum PWCSSNameLocation {
 
 + (NSString*)stringFromQuotedPrintableString:(NSString*)quotedPrintableString;
 
+// Batch variants for encoding or decoding many header values at once. They share the per-encoding setup and
+// the conversion buffer between all values. Empty strings are passed through.
++ (NSArray<NSString*>*)quotedPrintableStringsFromStrings:(NSArray<NSString*>*)strings
+                                            prefixLength:(NSUInteger)prefixLength
+                                                encoding:(NSStringEncoding)encoding;
+
+// The prefix length of each value is derived from its key as in "<key>: <value>".
++ (NSDictionary<NSString*, NSString*>*)quotedPrintableHeaderValuesFromHeaders:(NSDictionary<NSString*, NSString*>*)headers
+                                                                     encoding:(NSStringEncoding)encoding;
+
++ (NSArray<NSString*>*)stringsFromQuotedPrintableStrings:(NSArray<NSString*>*)quotedPrintableStrings;
+
 @end
 
 @interface NSString (PWPunycode)
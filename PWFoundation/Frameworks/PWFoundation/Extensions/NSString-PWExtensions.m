@@ -964,186 +964,369 @@
 
 #pragma mark Quoted printable encoding
 
-// value is encoded quoted-printable, with soft line breaks
-// for maximum single lines of 76 chars
-// http://www.faqs.org/rfcs/rfc1521.html
-- (NSString*)quotedPrintableStringWithPrefixLength:(NSUInteger)prefixLength
-                                          encoding:(NSStringEncoding)encoding
++ (NSStringEncoding)stringEncodingFromName:(NSString*)encodingName
 {
-    NSAssert(self.length > 0, nil);
-    
-    // If string only uses ASCII characters then it does not need quoted-printable encoding and
-    // we can return the string itself.
-    if([self canBeConvertedToEncoding:NSASCIIStringEncoding])
-        return self;
-    
-    NSString* encodingName = [NSString IANACharSetNameForNSStringEncoding:encoding];
+    NSParameterAssert(encodingName);
     
-    NSString* softLineStart = [NSString stringWithFormat:@"=?%@?Q?", encodingName];
-    NSString* softLineEnd = @"?=";
+    return CFStringConvertEncodingToNSStringEncoding(CFStringConvertIANACharSetNameToEncoding((__bridge CFStringRef)encodingName));
+}
+
+// Number of characters needed for a byte inside a quoted printable encoded word: 3 for "=XX", 1 otherwise.
+static const UInt8 PWQuotedPrintableByteLengths[256] = {
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 3, 1, 1, 1, 1, 1, 1,     // '\t'
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 3, 1, 3,     // '=', '?' (RFC 2047 4.2)
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 3,     // '_'
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,     // all non-ASCII bytes
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3
+};
+
+static const char PWQuotedPrintableSoftLineEnd[] = "?=";
+static const NSUInteger PWQuotedPrintableSoftLineEndLength = 2;
+static const NSUInteger PWQuotedPrintableMaxLineLength = 76;
+
+// Describes how encoded words are laid out for one encoding and prefix length.
+typedef struct {
+    char        softLineStart[64];          // "=?<charset>?Q?"
+    NSUInteger  softLineStartLength;
+    NSUInteger  firstLineCapacity;          // characters available for encoded bytes in the first encoded word
+    NSUInteger  continuationLineCapacity;   // same for all following ones, which are preceded by a space
+} PWQuotedPrintableLayout;
+
+static void PWQuotedPrintableLayoutSetPrefixLength(PWQuotedPrintableLayout* layout, NSUInteger prefixLength)
+{
     // Note: CRLFs are added when the line-breaking methods replaces spaces on full lines with line breaks
     // We keep the algorithm simple by always keeping headroom for the soft line terminator
-    NSUInteger maxSoftLineLength = 76 - softLineEnd.length;
-    NSParameterAssert(prefixLength < maxSoftLineLength - softLineStart.length);    // we only support short prefixes, like for header keys
-    
-    NSData* utf8Data = [self dataUsingEncoding:encoding];
-    NSUInteger utf8DataLength = utf8Data.length;
-    const UInt8* bytes = (const UInt8*)utf8Data.bytes;
-    
-    NSMutableString* result = [NSMutableString string];
-    [result appendString:softLineStart];
-    
-    NSUInteger remainingSoftLineLength = maxSoftLineLength - softLineStart.length - prefixLength;
-    for(NSUInteger dataIndex = 0; dataIndex < utf8DataLength; dataIndex++)
+    NSUInteger maxSoftLineLength = PWQuotedPrintableMaxLineLength - PWQuotedPrintableSoftLineEndLength;
+    NSCParameterAssert(prefixLength < maxSoftLineLength - layout->softLineStartLength);    // we only support short prefixes, like for header keys
+    layout->firstLineCapacity        = maxSoftLineLength - layout->softLineStartLength - prefixLength;
+    layout->continuationLineCapacity = maxSoftLineLength - layout->softLineStartLength - 1;
+}
+
+static PWQuotedPrintableLayout PWQuotedPrintableLayoutMake(NSStringEncoding encoding, NSUInteger prefixLength)
+{
+    PWQuotedPrintableLayout layout;
+    NSString* encodingName = [NSString IANACharSetNameForNSStringEncoding:encoding];
+    NSCAssert(encodingName, nil);
+    int length = snprintf(layout.softLineStart, sizeof(layout.softLineStart), "=?%s?Q?", encodingName ? encodingName.UTF8String : "");
+    NSCAssert(length > 0 && length < (int)sizeof(layout.softLineStart), nil);
+    layout.softLineStartLength = length;
+    PWQuotedPrintableLayoutSetPrefixLength(&layout, prefixLength);
+    return layout;
+}
+
+// Encodes 'bytes' into encoded words and returns the number of characters needed. If 'output' is NULL, nothing is
+// written, which is used to determine the exact length of the output buffer up front.
+static NSUInteger PWQuotedPrintableEncodeBytes(const UInt8* bytes, NSUInteger length, const PWQuotedPrintableLayout* layout, char* output)
+{
+    static const char hexDigits[] = "0123456789ABCDEF";
+
+    NSUInteger outputLength = layout->softLineStartLength;
+    if(output)
+        memcpy(output, layout->softLineStart, layout->softLineStartLength);
+
+    NSUInteger remainingSoftLineLength = layout->firstLineCapacity;
+    for(NSUInteger index = 0; index < length; index++)
     {
-        UInt8 byte = bytes[dataIndex];
-        NSUInteger quotedLength = quotedPrintableLengthForByte(byte);
+        UInt8 byte = bytes[index];
+        NSUInteger quotedLength = PWQuotedPrintableByteLengths[byte];
         if(remainingSoftLineLength >= quotedLength)
-        {
-            appendQuotedPrintableStringForByteToString(byte, result);
             remainingSoftLineLength -= quotedLength;
-        }
         else
         {
-            [result appendString:softLineEnd];
-            [result appendString:@" "];
-            [result appendString:softLineStart];
-            appendQuotedPrintableStringForByteToString(byte, result);
-            remainingSoftLineLength = maxSoftLineLength - softLineStart.length - 1;
+            if(output)
+            {
+                char* lineBreak = output + outputLength;
+                memcpy(lineBreak, PWQuotedPrintableSoftLineEnd, PWQuotedPrintableSoftLineEndLength);
+                lineBreak[PWQuotedPrintableSoftLineEndLength] = ' ';
+                memcpy(lineBreak + PWQuotedPrintableSoftLineEndLength + 1, layout->softLineStart, layout->softLineStartLength);
+            }
+            outputLength += PWQuotedPrintableSoftLineEndLength + 1 + layout->softLineStartLength;
+            remainingSoftLineLength = layout->continuationLineCapacity;
+        }
+
+        if(output)
+        {
+            char* encoded = output + outputLength;
+            if(quotedLength == 1)
+                encoded[0] = (byte == ' ') ? '_' : (char)byte;
+            else
+            {
+                encoded[0] = '=';
+                encoded[1] = hexDigits[byte >> 4];
+                encoded[2] = hexDigits[byte & 0x0F];
+            }
         }
+        outputLength += quotedLength;
     }
-    [result appendString:softLineEnd];
-    
-    return result;
+
+    if(output)
+        memcpy(output + outputLength, PWQuotedPrintableSoftLineEnd, PWQuotedPrintableSoftLineEndLength);
+    return outputLength + PWQuotedPrintableSoftLineEndLength;
 }
 
-NS_INLINE void appendQuotedPrintableStringForByteToString(UInt8 byte, NSMutableString* string)
+// 'scratchBuffer' receives the encoded bytes of 'string' and may be shared between calls.
+static NSString* PWQuotedPrintableEncodeString(NSString* string,
+                                               NSStringEncoding encoding,
+                                               const PWQuotedPrintableLayout* layout,
+                                               NSMutableData* scratchBuffer)
 {
-    if(byte == 32)
+    NSCParameterAssert(string);
+    NSCParameterAssert(layout);
+    NSCParameterAssert(scratchBuffer);
+
+    // If string only uses ASCII characters then it does not need quoted-printable encoding and
+    // we can return the string itself. For UTF-8 this is checked on the converted bytes below.
+    BOOL isUTF8 = (encoding == NSUTF8StringEncoding);
+    if(!isUTF8 && [string canBeConvertedToEncoding:NSASCIIStringEncoding])
+        return string;
+
+    NSUInteger maxLength = [string maximumLengthOfBytesUsingEncoding:encoding];
+    if(scratchBuffer.length < maxLength)
+        scratchBuffer.length = maxLength;
+    NSUInteger length = 0;
+    [string getBytes:scratchBuffer.mutableBytes
+           maxLength:maxLength
+          usedLength:&length
+            encoding:encoding
+             options:0
+               range:NSMakeRange(0, string.length)
+      remainingRange:NULL];
+    const UInt8* bytes = scratchBuffer.bytes;
+
+    if(isUTF8)
     {
-        UniChar ch = '_';
-        CFStringAppendCharacters((__bridge CFMutableStringRef)string, &ch, 1);
+        BOOL isASCII = YES;
+        for(NSUInteger index = 0; index < length && isASCII; index++)
+            isASCII = bytes[index] < 128;
+        if(isASCII)
+            return string;
     }
-    else if(byte == '\t' || byte == '_' || byte == '=' || byte > 127)
+
+    NSUInteger outputLength = PWQuotedPrintableEncodeBytes(bytes, length, layout, NULL);
+    char* output = malloc(outputLength);
+    NSCAssert(output, nil);
+    NSUInteger writtenLength = PWQuotedPrintableEncodeBytes(bytes, length, layout, output);
+    NSCAssert(writtenLength == outputLength, nil);
+    return [[NSString alloc] initWithBytesNoCopy:output
+                                          length:writtenLength
+                                        encoding:NSASCIIStringEncoding
+                                    freeWhenDone:YES];
+}
+
+// value is encoded quoted-printable, with soft line breaks
+// for maximum single lines of 76 chars
+// http://www.faqs.org/rfcs/rfc1521.html
+- (NSString*)quotedPrintableStringWithPrefixLength:(NSUInteger)prefixLength
+                                          encoding:(NSStringEncoding)encoding
+{
+    NSAssert(self.length > 0, nil);
+
+    PWQuotedPrintableLayout layout = PWQuotedPrintableLayoutMake(encoding, prefixLength);
+    return PWQuotedPrintableEncodeString(self, encoding, &layout, [NSMutableData data]);
+}
+
++ (NSArray<NSString*>*)quotedPrintableStringsFromStrings:(NSArray<NSString*>*)strings
+                                            prefixLength:(NSUInteger)prefixLength
+                                                encoding:(NSStringEncoding)encoding
+{
+    NSParameterAssert(strings);
+
+    PWQuotedPrintableLayout layout = PWQuotedPrintableLayoutMake(encoding, prefixLength);
+    NSMutableData* scratchBuffer = [NSMutableData data];
+    NSMutableArray<NSString*>* results = [NSMutableArray arrayWithCapacity:strings.count];
+    for(NSString* string in strings)
+        [results addObject:string.length > 0 ? PWQuotedPrintableEncodeString(string, encoding, &layout, scratchBuffer) : string];
+    return results;
+}
+
++ (NSDictionary<NSString*, NSString*>*)quotedPrintableHeaderValuesFromHeaders:(NSDictionary<NSString*, NSString*>*)headers
+                                                                     encoding:(NSStringEncoding)encoding
+{
+    NSParameterAssert(headers);
+
+    PWQuotedPrintableLayout layout = PWQuotedPrintableLayoutMake(encoding, 0);
+    NSMutableData* scratchBuffer = [NSMutableData data];
+    NSMutableDictionary<NSString*, NSString*>* results = [NSMutableDictionary dictionaryWithCapacity:headers.count];
+    [headers enumerateKeysAndObjectsUsingBlock:^(NSString* key, NSString* value, BOOL* stop) {
+        if(value.length == 0)
+            results[key] = value;
+        else
+        {
+            PWQuotedPrintableLayout keyLayout = layout;
+            PWQuotedPrintableLayoutSetPrefixLength(&keyLayout, key.length + 2);     // "<key>: "
+            results[key] = PWQuotedPrintableEncodeString(value, encoding, &keyLayout, scratchBuffer);
+        }
+    }];
+    return results;
+}
+
+NS_INLINE int PWHexDigitValue(char ch)
+{
+    if(ch >= '0' && ch <= '9')
+        return ch - '0';
+    if(ch >= 'A' && ch <= 'F')
+        return ch - 'A' + 10;
+    if(ch >= 'a' && ch <= 'f')
+        return ch - 'a' + 10;
+    return -1;
+}
+
+NS_INLINE BOOL PWIsQuotedPrintableWhitespace(char ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+}
+
+// Parses "=?<charset>?Q?" at 'position'. Returns the start of the encoded text or NULL if there is no such header.
+static const char* PWQuotedPrintableParseSoftLineStart(const char* position, const char* end, const char** outCharset, NSUInteger* outCharsetLength)
+{
+    if(end - position < 2 || position[0] != '=' || position[1] != '?')
+        return NULL;
+    const char* charset = position + 2;
+    const char* charsetEnd = charset;
+    while(charsetEnd < end && *charsetEnd != '?')
+        charsetEnd++;
+    if(charsetEnd == charset || end - charsetEnd < 3 || (charsetEnd[1] != 'Q' && charsetEnd[1] != 'q') || charsetEnd[2] != '?')
+        return NULL;
+    *outCharset = charset;
+    *outCharsetLength = charsetEnd - charset;
+    return charsetEnd + 3;
+}
+
+// The last resolved charset is cached, as all values of a batch typically share the same one.
+typedef struct {
+    char                charset[64];
+    NSUInteger          charsetLength;
+    NSStringEncoding    encoding;
+} PWQuotedPrintableCharsetCache;
+
+static NSStringEncoding PWQuotedPrintableEncodingForCharset(const char* charset, NSUInteger length, PWQuotedPrintableCharsetCache* cache)
+{
+    if(cache->charsetLength == length && strncasecmp(cache->charset, charset, length) == 0)
+        return cache->encoding;
+
+    NSStringEncoding encoding;
+    if(length == 5 && strncasecmp(charset, "utf-8", 5) == 0)
+        encoding = NSUTF8StringEncoding;
+    else
     {
-        UniChar ch = '=';
-        CFStringAppendCharacters((__bridge CFMutableStringRef)string, &ch, 1);
-        [string appendIntegerUppercase:byte base:16];
+        NSString* name = [[NSString alloc] initWithBytes:charset length:length encoding:NSASCIIStringEncoding];
+        encoding = name ? [NSString stringEncodingFromName:name] : kCFStringEncodingInvalidId;
     }
-    else
+    if(length < sizeof(cache->charset))
     {
-        UniChar ch = byte;
-        CFStringAppendCharacters((__bridge CFMutableStringRef)string, &ch, 1);
+        memcpy(cache->charset, charset, length);
+        cache->charsetLength = length;
+        cache->encoding = encoding;
     }
+    return encoding;
 }
 
-NS_INLINE NSUInteger quotedPrintableLengthForByte(UInt8 byte)
+// Decodes a sequence of encoded words in a single pass over the bytes. Encoded words with the same charset are
+// joined, whitespace between them is dropped. Text following the last encoded word is kept as is.
+static NSString* PWQuotedPrintableDecodeString(NSString* quotedPrintableString, PWQuotedPrintableCharsetCache* cache)
 {
-    if(byte == '\t' || byte == '_' || byte == '=' || byte > 127)
-        return 3;
-
-    return 1;
-}
+    NSCParameterAssert(quotedPrintableString);
+
+    const char* start = quotedPrintableString.UTF8String;
+    const char* end = start + strlen(start);
+    const char* charset;
+    NSUInteger charsetLength;
+    const char* position = PWQuotedPrintableParseSoftLineStart(start, end, &charset, &charsetLength);
+    if(!position)
+        return quotedPrintableString;
 
-+ (NSString*)stringFromQuotedPrintableString:(NSString*)quotedPrintableString
-{
-    NSParameterAssert(quotedPrintableString.length > 0);
-    
-    NSString* encodingName = [NSString stringEncodingNameFromQuotedPrintableString:quotedPrintableString];
-    if(!encodingName)
+    NSStringEncoding encoding = PWQuotedPrintableEncodingForCharset(charset, charsetLength, cache);
+    if(encoding == kCFStringEncodingInvalidId)
         return quotedPrintableString;
-    
-    NSStringEncoding encoding = [NSString stringEncodingFromName:encodingName];
-    
-    NSString* softLineEnd = @"?=";
-    NSAssert([quotedPrintableString hasSuffix:softLineEnd], nil);
-    
-    // Condense quoted printable strings with multiple lines to a single line
-    NSMutableString* regularExpression = [NSMutableString stringWithString:@"\\?=\\s*=\\?"];
-    [regularExpression appendString:encodingName];
-    [regularExpression appendString:@"\\?Q\\?"];
-    quotedPrintableString = [quotedPrintableString stringByReplacingOccurrencesOfString:regularExpression
-                                                                             withString:@""
-                                                                                options:NSRegularExpressionSearch range:NSMakeRange(0, quotedPrintableString.length)];
-    
-    // Remove the "header" and "footer" of the quoted printable string
-    NSUInteger headerLength = encodingName.length + 5;
-    NSRange substringRange = NSMakeRange(headerLength, quotedPrintableString.length - headerLength - softLineEnd.length);
-    const char* encodedCString = [quotedPrintableString substringWithRange:substringRange].UTF8String;
-    
-    // Actually decode the quoted printable string
-    // Found at http://stackoverflow.com/questions/491678/can-you-translate-php-function-quoted-printable-decode-to-an-nsstring-based-o
-    const char *p = encodedCString;
-    char *ep, *decodedCString = malloc(strlen(encodedCString) * sizeof(char));
-    NSAssert(decodedCString, nil);
-    ep = decodedCString;
-    
-    while(*p)
+
+    char* decoded = malloc(end - start + 1);
+    NSCAssert(decoded, nil);
+    char* output = decoded;
+    while(position < end)
     {
-        switch(*p)
+        char ch = *position;
+        if(ch == '?' && position + 1 < end && position[1] == '=')
         {
-            case '=':
-                NSAssert1( *(p + 1) != 0 && *(p + 2) != 0, @"Malformed quoted printable string: %s", encodedCString);
-                if( *(p + 1) != '\r' )
-                {
-                    int i, byte[2];
-                    for( i = 0; i < 2; i++ )
-                    {
-                        byte[i] = *(p + i + 1);
-                        if( isdigit(byte[i]) )
-                            byte[i] -= 0x30;
-                        else
-                            byte[i] -= 0x37;
-                        NSAssert( byte[i] >= 0 && byte[i] < 16, @"bad encoded character");
-                    }
-                    *(ep++) = (char) (byte[0] << 4) | byte[1];
-                }
-                p += 3;
-                continue;
-            case '_':
-                *(ep++) = ' ';
-                p++;
-                continue;
-            default:
-                *(ep++) = *(p++);
-                continue;
+            // End of an encoded word. Continue with the next one if it uses the same charset.
+            const char* afterWord = position + 2;
+            const char* next = afterWord;
+            while(next < end && PWIsQuotedPrintableWhitespace(*next))
+                next++;
+            const char* nextCharset;
+            NSUInteger nextCharsetLength;
+            const char* nextText = PWQuotedPrintableParseSoftLineStart(next, end, &nextCharset, &nextCharsetLength);
+            if(nextText && nextCharsetLength == charsetLength && strncasecmp(nextCharset, charset, charsetLength) == 0)
+                position = nextText;
+            else
+            {
+                memcpy(output, afterWord, end - afterWord);
+                output += end - afterWord;
+                break;
+            }
+        }
+        else if(ch == '=')
+        {
+            int high = position + 2 < end ? PWHexDigitValue(position[1]) : -1;
+            int low  = high >= 0 ? PWHexDigitValue(position[2]) : -1;
+            if(low >= 0)
+            {
+                *output++ = (char)((high << 4) | low);
+                position += 3;
+            }
+            else if(position + 2 < end && position[1] == '\r' && position[2] == '\n')
+                position += 3;      // soft line break
+            else
+                *output++ = *position++;
+        }
+        else if(ch == '_')
+        {
+            *output++ = ' ';
+            position++;
         }
+        else
+            *output++ = *position++;
     }
-    // null termination of decodedString
-    *ep = '\0';
-    
-    return [[NSString alloc] initWithBytesNoCopy:decodedCString
-                                          length:strlen(decodedCString)
-                                        encoding:encoding
-                                    freeWhenDone:YES];
+
+    NSString* result = [[NSString alloc] initWithBytesNoCopy:decoded
+                                                      length:output - decoded
+                                                    encoding:encoding
+                                                freeWhenDone:YES];
+    if(!result)
+        free(decoded);
+    return result;
 }
 
-+ (NSString*)stringEncodingNameFromQuotedPrintableString:(NSString*)quotedPrintableString
++ (NSString*)stringFromQuotedPrintableString:(NSString*)quotedPrintableString
 {
     NSParameterAssert(quotedPrintableString.length > 0);
-    
-    static NSRegularExpression* regex;
-    PWDispatchOnce(^{
-        regex = [NSRegularExpression regularExpressionWithPattern:@"^=\\?([^?]+)\\?q\\?"
-                                                          options:NSRegularExpressionCaseInsensitive
-                                                            error:NULL];
-    });
-    
-    NSArray* matches = [regex matchesInString:quotedPrintableString
-                                      options:0
-                                        range:NSMakeRange(0, quotedPrintableString.length)];
-    if(matches.count == 0)
-        return nil;
-    
-    NSRange encodingRange = [matches.firstObject rangeAtIndex:1];
-    return [quotedPrintableString substringWithRange:encodingRange];
+
+    PWQuotedPrintableCharsetCache cache = {0};
+    return PWQuotedPrintableDecodeString(quotedPrintableString, &cache);
 }
 
-+ (NSStringEncoding)stringEncodingFromName:(NSString*)encodingName
++ (NSArray<NSString*>*)stringsFromQuotedPrintableStrings:(NSArray<NSString*>*)quotedPrintableStrings
 {
-    NSParameterAssert(encodingName);
-    
-    return CFStringConvertEncodingToNSStringEncoding(CFStringConvertIANACharSetNameToEncoding((__bridge CFStringRef)encodingName));
+    NSParameterAssert(quotedPrintableStrings);
+
+    PWQuotedPrintableCharsetCache cache = {0};
+    NSMutableArray<NSString*>* results = [NSMutableArray arrayWithCapacity:quotedPrintableStrings.count];
+    for(NSString* string in quotedPrintableStrings)
+    {
+        NSString* decoded = string.length > 0 ? PWQuotedPrintableDecodeString(string, &cache) : string;
+        [results addObject:decoded ? decoded : string];
+    }
+    return results;
 }
 
 - (NSString*)URLHostByAddingRequiredBrackets
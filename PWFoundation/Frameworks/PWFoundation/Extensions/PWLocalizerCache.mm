@@ -9,6 +9,7 @@
 #import "PWLocalizerCache.h"
 #import "PWDispatch.h"
 #import "PWLocalizer.h"
+#import "PWCacheBudgetCoordinator.h"
 #import <unordered_map>
 
 namespace PW {
@@ -24,6 +25,12 @@ namespace PW {
         return k1.aClass == k2.aClass && [k1.language isEqualToString:k2.language];
     }
 
+    struct CacheEntry
+    {
+        PWLocalizer* localizer;
+        NSUInteger   cost;
+    };
+
 }
 
 using namespace PW;
@@ -41,10 +48,14 @@ namespace std {
     };
 }
 
+@interface PWLocalizerCache () <PWBudgetedCache>
+@end
+
 @implementation PWLocalizerCache
 {
     PWDispatchQueue*                            _dispatchQueue;
-    std::unordered_map<CacheKey, PWLocalizer*>  _cache;
+    std::unordered_map<CacheKey, CacheEntry>    _cache;
+    PWCacheBudgetRegistration*                  _budgetRegistration;
 }
 
 - (id)init
@@ -52,6 +63,10 @@ namespace std {
     if(self = [super init])
     {
         _dispatchQueue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWLocalizerCache"];
+        _budgetRegistration = [PWCacheBudgetCoordinator.sharedCoordinator registerCache:self
+                                                                                   name:@"PWLocalizerCache"
+                                                                                 weight:1.0
+                                                                          costEstimator:nil];
     }
     return self;
 }
@@ -72,12 +87,43 @@ namespace std {
     __block PWLocalizer* result;
     [_dispatchQueue synchronouslyDispatchBlock:^{
         CacheKey key = {aClass, language};
-        __strong PWLocalizer*& localizer = _cache[key];
-        if(!localizer)
-            localizer = creationBlock(aClass, language);
-        result = localizer;
+        auto match = _cache.find(key);
+        if(match != _cache.end())
+        {
+            [_budgetRegistration recordHit];
+            result = match->second.localizer;
+        }
+        else
+        {
+            [_budgetRegistration recordMiss];
+            result = creationBlock(aClass, language);
+            if(result)
+            {
+                NSUInteger cost = [_budgetRegistration costForKey:language object:result];
+                _cache[key] = CacheEntry{result, cost};
+                [_budgetRegistration didAddCost:cost];
+            }
+        }
     }];
     return result;
 }
 
+#pragma mark - PWBudgetedCache
+
+// Localizers are not ordered by usage, any of them can be recreated on demand.
+- (void)shedBytes:(unsigned long long)byteCount completionHandler:(PWDispatchBlock)completionHandler
+{
+    [_dispatchQueue asynchronouslyDispatchBlock:^{
+        unsigned long long shedByteCount = 0;
+        auto it = _cache.begin();
+        while(shedByteCount < byteCount && it != _cache.end())
+        {
+            shedByteCount += it->second.cost;
+            [_budgetRegistration didRemoveCost:it->second.cost evicted:YES];
+            it = _cache.erase(it);
+        }
+        completionHandler();
+    }];
+}
+
 @end
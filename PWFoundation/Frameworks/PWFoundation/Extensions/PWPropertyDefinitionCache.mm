@@ -9,22 +9,41 @@
 #import "PWPropertyDefinitionCache.h"
 #import "PWDispatch.h"
 #import "NSObject-PWExtensions.h"
+#import "PWCacheBudgetCoordinator.h"
 
 #import <unordered_map>
 #import <objc/message.h>
+#import <os/lock.h>
+
+// Roughly a hash table slot plus the property name.
+static const NSUInteger PWPropertyDefinitionCost = 64;
+
+@interface PWPropertyDefinitionCache () <PWBudgetedCache>
+@end
 
 @implementation PWPropertyDefinitionCache
 {
-    PWDispatchQueue* _dispatchQueue;
-    NSMapTable*      _definitionsByClass;   // Class -> NSDictionary (propertyName -> protocol* or Class)
+    os_unfair_lock              _lock;                  // protects _definitionsByClass
+    NSMapTable*                 _definitionsByClass;    // Class -> NSDictionary (propertyName -> protocol* or Class)
+    PWDispatchQueue*            _dispatchQueue;         // protects the budget accounting below
+    NSMapTable*                 _costByClass;           // Class -> NSNumber, the definitions reported to the budget
+    PWCacheBudgetRegistration*  _budgetRegistration;
 }
 
 - (id)init
 {
     if(self = [super init])
     {
-        _dispatchQueue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWLocalizerCache"];
+        _lock = OS_UNFAIR_LOCK_INIT;
         _definitionsByClass = [NSMapTable strongToStrongObjectsMapTable];
+        _dispatchQueue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWPropertyDefinitionCache"];
+        _costByClass = [NSMapTable strongToStrongObjectsMapTable];
+        _budgetRegistration = [PWCacheBudgetCoordinator.sharedCoordinator registerCache:self
+                                                                                   name:@"PWPropertyDefinitionCache"
+                                                                                 weight:1.0
+                                                                          costEstimator:^NSUInteger(id key, NSDictionary* definitions) {
+                                                                              return definitions.count * PWPropertyDefinitionCost;
+                                                                          }];
     }
     return self;
 }
@@ -50,11 +69,36 @@
     // Get rid of automatic classes like for KVO
     theClass = theClass.class.class;
 
+    // The budget coordinator can shed definitions from any queue, so the table is guarded by a lock. Lookups only hold
+    // it for the table access, the accounting for the budget happens asynchronously on the private queue.
+    os_unfair_lock_lock(&_lock);
     NSDictionary* definitionByPropertyName = [_definitionsByClass objectForKey:theClass];
-    if(!definitionByPropertyName)
+    os_unfair_lock_unlock(&_lock);
+
+    if(definitionByPropertyName)
+        [_budgetRegistration recordHit];
+    else
     {
-        definitionByPropertyName = [self definitionsForClass:theClass];
-        [_definitionsByClass setObject:definitionByPropertyName forKey:theClass];
+        [_budgetRegistration recordMiss];
+        NSDictionary* definitions = [self definitionsForClass:theClass];
+
+        // Another thread may have added the definitions in the meantime.
+        os_unfair_lock_lock(&_lock);
+        definitionByPropertyName = [_definitionsByClass objectForKey:theClass];
+        BOOL isNew = !definitionByPropertyName;
+        if(isNew)
+        {
+            definitionByPropertyName = definitions;
+            [_definitionsByClass setObject:definitions forKey:theClass];
+        }
+        os_unfair_lock_unlock(&_lock);
+
+        if(isNew)
+            [_dispatchQueue asynchronouslyDispatchBlock:^{
+                NSUInteger cost = [_budgetRegistration costForKey:theClass object:definitions];
+                [_costByClass setObject:@(cost) forKey:theClass];
+                [_budgetRegistration didAddCost:cost];
+            }];
     }
 
     id definition = definitionByPropertyName[propertyName];
@@ -94,4 +138,28 @@
     return definitions;
 }
 
+#pragma mark - PWBudgetedCache
+
+// Definitions are not ordered by usage, any of them can be recreated on demand. Only definitions whose cost has been
+// reported are shed, so removals are never reported before the corresponding additions.
+- (void)shedBytes:(unsigned long long)byteCount completionHandler:(PWDispatchBlock)completionHandler
+{
+    [_dispatchQueue asynchronouslyDispatchBlock:^{
+        unsigned long long shedByteCount = 0;
+        for(Class iClass in _costByClass.keyEnumerator.allObjects)
+        {
+            if(shedByteCount >= byteCount)
+                break;
+            NSUInteger cost = [[_costByClass objectForKey:iClass] unsignedIntegerValue];
+            [_costByClass removeObjectForKey:iClass];
+            os_unfair_lock_lock(&_lock);
+            [_definitionsByClass removeObjectForKey:iClass];
+            os_unfair_lock_unlock(&_lock);
+            shedByteCount += cost;
+            [_budgetRegistration didRemoveCost:cost evicted:YES];
+        }
+        completionHandler();
+    }];
+}
+
 @end
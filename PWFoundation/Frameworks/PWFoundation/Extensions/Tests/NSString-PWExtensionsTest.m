@@ -120,6 +120,40 @@
     XCTAssertEqualObjects([NSString stringFromQuotedPrintableString:@"=?utf-8?Q?This_is_a_good_test_with_really_quite_a_lot_of_fancy_characters_?= =?utf-8?Q?which_should_=C3=A4=C3=B6=C3=BC_really_be_broken_into_a_couple_o?= =?utf-8?Q?f_blocks?="], @"This is a good test with really quite a lot of fancy characters which should äöü really be broken into a couple of blocks");
 }
 
+- (void)testQuotedPrintableBatch
+{
+    NSArray<NSString*>* strings = @[@"test", @"täst=", @"", @"This is a good test with really quite a lot of fancy characters which should äöü really be broken into a couple of blocks"];
+    NSArray<NSString*>* encoded = [NSString quotedPrintableStringsFromStrings:strings prefixLength:0 encoding:NSUTF8StringEncoding];
+    XCTAssertEqual(encoded.count, strings.count);
+    [strings enumerateObjectsUsingBlock:^(NSString* string, NSUInteger index, BOOL* stop) {
+        if(string.length > 0)
+            XCTAssertEqualObjects(encoded[index], [string quotedPrintableStringWithPrefixLength:0 encoding:NSUTF8StringEncoding]);
+    }];
+    XCTAssertEqualObjects([NSString stringsFromQuotedPrintableStrings:encoded], strings);
+
+    NSDictionary<NSString*, NSString*>* headers = [NSString quotedPrintableHeaderValuesFromHeaders:@{@"Subject": strings.lastObject, @"To": @"Bob"}
+                                                                                          encoding:NSUTF8StringEncoding];
+    XCTAssertEqualObjects(headers[@"Subject"], [strings.lastObject quotedPrintableStringWithPrefixLength:@"Subject: ".length encoding:NSUTF8StringEncoding]);
+    XCTAssertEqualObjects(headers[@"To"], @"Bob");
+}
+
+- (void)testQuotedPrintableEscapesTab
+{
+    XCTAssertEqualObjects([@"ä\tb" quotedPrintableStringWithPrefixLength:0 encoding:NSUTF8StringEncoding], @"=?utf-8?Q?=C3=A4=09b?=");
+    XCTAssertEqualObjects([NSString stringFromQuotedPrintableString:@"=?utf-8?Q?=C3=A4=09b?="], @"ä\tb");
+}
+
+- (void)testQuotedPrintableEscapesQuestionMark
+{
+    XCTAssertEqualObjects([@"ä?=" quotedPrintableStringWithPrefixLength:0 encoding:NSUTF8StringEncoding], @"=?utf-8?Q?=C3=A4=3F=3D?=");
+    XCTAssertEqualObjects([@"Wer?Äh" quotedPrintableStringWithPrefixLength:0 encoding:NSUTF8StringEncoding], @"=?utf-8?Q?Wer=3F=C3=84h?=");
+    for(NSString* string in @[@"ä?=", @"Wer?Äh", @"?ä?", @"ä??=?=x", @"Frage? Antwort: Jä!"])
+    {
+        NSString* encoded = [string quotedPrintableStringWithPrefixLength:0 encoding:NSUTF8StringEncoding];
+        XCTAssertEqualObjects([NSString stringFromQuotedPrintableString:encoded], string);
+    }
+}
+
 - (void)testBase64Encoding
 {
     NSString* testString = @"This is a string to test the base64 encoding capabilities of NSString and NSData";
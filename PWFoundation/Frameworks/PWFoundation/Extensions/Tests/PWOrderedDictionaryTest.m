@@ -106,4 +106,150 @@
     }
 }
 
+- (void) testIndexedAccess
+{
+    PWMutableOrderedDictionary* dict = [[PWMutableOrderedDictionary alloc] init];
+    for (NSUInteger i = 0; i < 100; ++i)
+        dict[@(i)] = @(i * 10);
+    
+    XCTAssertEqual (        [dict indexOfKey:@42], 42);
+    XCTAssertEqual (        [dict indexOfKey:@100], NSNotFound);
+    XCTAssertEqualObjects ( [dict keyAtIndex:42], @42);
+    XCTAssertEqualObjects ( [dict objectAtIndex:42], @420);
+    XCTAssertThrowsSpecificNamed ([dict keyAtIndex:100], NSException, NSRangeException);
+    
+    // Removal at the front and from the middle.
+    [dict removeObjectForKey:@0];
+    [dict removeObjectForKey:@1];
+    XCTAssertEqualObjects (dict.firstKey, @2);
+    XCTAssertEqual        ([dict indexOfKey:@42], 40);
+    [dict removeObjectForKey:@10];
+    XCTAssertEqual        ([dict indexOfKey:@42], 39);
+    XCTAssertEqualObjects ([dict keyAtIndex:39], @42);
+    
+    // Removal at the back and replacement.
+    [dict removeObjectForKey:@99];
+    XCTAssertEqualObjects (dict.lastKey, @98);
+    dict[@42] = @0;
+    XCTAssertEqualObjects (dict.lastKey, @42);
+    XCTAssertEqual        ([dict indexOfKey:@42], dict.count - 1);
+    XCTAssertEqual        (dict.count, 96);
+    
+    [dict removeAllObjects];
+    XCTAssertEqual (dict.count, 0);
+    XCTAssertNil   (dict.firstKey);
+    XCTAssertNil   (dict.lastKey);
+}
+
+// Compares random insertions and removals with an array of keys.
+- (void) testRandomMutations
+{
+    PWMutableOrderedDictionary* dict = [[PWMutableOrderedDictionary alloc] init];
+    NSMutableArray* orderedKeys = [NSMutableArray array];
+    srandom (42);
+    
+    for (NSUInteger i = 0; i < 20000; ++i) {
+        NSString* key = [NSString stringWithFormat:@"k%ld", random() % 500];
+        if (random() % 2) {
+            dict[key] = key.uppercaseString;
+            [orderedKeys removeObject:key];
+            [orderedKeys addObject:key];
+        } else {
+            [dict removeObjectForKey:key];
+            [orderedKeys removeObject:key];
+        }
+        
+        if (i % 100 == 0) {
+            XCTAssertEqualObjects (dict.allKeys, orderedKeys);
+            if (orderedKeys.count > 0) {
+                NSUInteger index = (NSUInteger)random() % orderedKeys.count;
+                XCTAssertEqualObjects (dict.firstKey, orderedKeys.firstObject);
+                XCTAssertEqualObjects (dict.lastKey, orderedKeys.lastObject);
+                XCTAssertEqual        ([dict indexOfKey:orderedKeys[index]], index);
+                XCTAssertEqualObjects ([dict objectAtIndex:index], [orderedKeys[index] uppercaseString]);
+            }
+        }
+    }
+    XCTAssertEqual (dict.count, orderedKeys.count);
+}
+
+- (void) testIndexedAccessDuringEnumeration
+{
+    PWMutableOrderedDictionary* dict = [[PWMutableOrderedDictionary alloc] init];
+    for (NSUInteger i = 0; i < 200; ++i)
+        dict[@(i)] = @(i);
+    for (NSUInteger i = 0; i < 200; i += 3)
+        [dict removeObjectForKey:@(i)];
+    
+    // Indexed access squeezes out the gaps of the removed keys while the enumerations are running.
+    NSUInteger index = 0;
+    for (NSNumber* key in dict) {
+        XCTAssertEqual ([dict indexOfKey:key], index);
+        ++index;
+    }
+    XCTAssertEqual (index, dict.count);
+    
+    for (NSUInteger i = 1; i < 200; i += 3)
+        [dict removeObjectForKey:@(i)];
+    __block NSUInteger blockIndex = 0;
+    [dict enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL* stop) {
+        XCTAssertEqualObjects ([dict keyAtIndex:blockIndex], key);
+        ++blockIndex;
+    }];
+    XCTAssertEqual (blockIndex, dict.count);
+}
+
+- (void) testMutationDuringFastEnumeration
+{
+    PWMutableOrderedDictionary* dict = [[PWMutableOrderedDictionary alloc] init];
+    for (NSUInteger i = 0; i < 10; ++i)
+        dict[@(i)] = @(i);
+    
+    XCTAssertThrows ({
+        for (NSNumber* key in dict)
+            [dict removeObjectForKey:key];
+    });
+}
+
+#pragma mark - Performance
+
+static const NSUInteger PWOrderedDictionaryPerformanceCount = 100000;
+
+- (void) testRemovalPerformance
+{
+    NSMutableArray* keys = [NSMutableArray array];
+    for (NSUInteger i = 0; i < PWOrderedDictionaryPerformanceCount; ++i)
+        [keys addObject:[NSString stringWithFormat:@"key%lu", (unsigned long)i]];
+    
+    [self measureBlock:^{
+        PWMutableOrderedDictionary* dict = [[PWMutableOrderedDictionary alloc] init];
+        for (NSString* key in keys)
+            dict[key] = key;
+        // Every other key, starting in the middle, to exercise gaps and compaction.
+        for (NSUInteger i = 0; i < keys.count; i += 2)
+            [dict removeObjectForKey:keys[(i + keys.count / 2) % keys.count]];
+        for (NSString* key in dict)
+            (void)[dict indexOfKey:key];
+    }];
+}
+
+- (void) testEnumerationPerformance
+{
+    PWMutableOrderedDictionary* dict = [[PWMutableOrderedDictionary alloc] init];
+    for (NSUInteger i = 0; i < PWOrderedDictionaryPerformanceCount; ++i)
+        dict[@(i)] = @(i);
+    
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < 10; ++i) {
+            __block NSUInteger count = 0;
+            [dict enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL* stop) {
+                ++count;
+            }];
+            for (id key in dict)
+                ++count;
+            XCTAssertEqual (count, 2 * PWOrderedDictionaryPerformanceCount);
+        }
+    }];
+}
+
 @end
@@ -30,4 +30,10 @@ typedef enum PWISODateStyle
 // Variant of getObjectValue:forString:errorDescription: ignoring errors.
 - (NSDate*) dateFromString:(NSString*)string;
 
+// Bulk variants for import and export. The calendar and its time zone are resolved only once per call.
+// The results have the same order as the input. Strings which can not be parsed, as well as empty strings, result
+// in NSNull in the returned array.
+- (NSArray<NSString*>*) stringsFromDates:(NSArray<NSDate*>*)dates;
+- (NSArray*) datesFromStrings:(NSArray<NSString*>*)strings;
+
 @end
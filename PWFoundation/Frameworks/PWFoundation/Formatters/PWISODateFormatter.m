@@ -8,9 +8,457 @@
 
 #import "PWISODateFormatter.h"
 #import "PWDispatch.h"
-#import "NSString-PWExtensions.h"
+#include <xlocale.h>
+
+// Formatting and parsing avoid NSCalendar, NSRegularExpression and NSNumberFormatter for Gregorian calendars and
+// dates between PWISOFastPathFirstYear and PWISOFastPathEndYear. Fields are converted with the civil-from-days
+// algorithms from http://howardhinnant.github.io/date_algorithms.html and the offset from GMT is looked up in a
+// transition table, which is built once per time zone. Everything else, including local times which are skipped or
+// repeated by a transition, is handed to the calendar as before, so both paths give identical results.
+
+static const int64_t PWISOSecondsPerDay                 = 86400;
+static const int64_t PWISOSecondsFrom1970ToReferenceDate = 978307200;
+static const int64_t PWISOFastPathFirstYear             = 1900;
+static const int64_t PWISOFastPathEndYear               = 2200;
+
+#pragma mark - Civil calendar arithmetic
+
+static inline int64_t PWISOFloorDivide(int64_t value, int64_t divisor)
+{
+    return value >= 0 ? value / divisor : (value - divisor + 1) / divisor;
+}
+
+// Days since 1970-01-01 in the proleptic Gregorian calendar.
+static inline int64_t PWISODaysFromCivil(int64_t year, int64_t month, int64_t day)
+{
+    year -= month <= 2;
+    int64_t era = PWISOFloorDivide(year, 400);
+    int64_t yearOfEra  = year - era * 400;
+    int64_t dayOfYear  = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    int64_t dayOfEra   = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+static inline void PWISOCivilFromDays(int64_t days, int64_t* year, int64_t* month, int64_t* day)
+{
+    days += 719468;
+    int64_t era = PWISOFloorDivide(days, 146097);
+    int64_t dayOfEra   = days - era * 146097;
+    int64_t yearOfEra  = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int64_t dayOfYear  = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int64_t shiftedMonth = (5 * dayOfYear + 2) / 153;
+    *day   = dayOfYear - (153 * shiftedMonth + 2) / 5 + 1;
+    *month = shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9;
+    *year  = yearOfEra + era * 400 + (*month <= 2);
+}
+
+static inline int64_t PWISODaysInMonth(int64_t year, int64_t month)
+{
+    static const int8_t days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    if (month == 2 && (year % 4 == 0 && (year % 100 != 0 || year % 400 == 0)))
+        return 29;
+    return days[month - 1];
+}
+
+#pragma mark - Time zone offsets
+
+// The offsets from GMT of one time zone between the start of PWISOFastPathFirstYear and the start of
+// PWISOFastPathEndYear (both UTC). Immutable after creation and shared by all formatters.
+@interface PWISOTimeZoneOffsetTable : NSObject
++ (PWISOTimeZoneOffsetTable*)tableForTimeZone:(NSTimeZone*)timeZone;
+@end
+
+@implementation PWISOTimeZoneOffsetTable
+{
+    NSUInteger  _count;
+    int64_t*    _starts;        // seconds since 1970 at which the offset with the same index becomes valid, ascending
+    int32_t*    _offsets;       // seconds from GMT
+    int64_t     _end;           // seconds since 1970 at which the table stops being valid
+    int64_t     _maxAbsOffset;
+}
+
+- (instancetype)initWithTimeZone:(NSTimeZone*)timeZone
+{
+    NSParameterAssert(timeZone);
+
+    if ((self = [super init]) != nil)
+    {
+        int64_t start = PWISODaysFromCivil(PWISOFastPathFirstYear, 1, 1) * PWISOSecondsPerDay;
+        _end = PWISODaysFromCivil(PWISOFastPathEndYear, 1, 1) * PWISOSecondsPerDay;
+
+        NSUInteger capacity = 16;
+        _starts  = malloc(capacity * sizeof(int64_t));
+        _offsets = malloc(capacity * sizeof(int32_t));
+
+        NSDate* date = [NSDate dateWithTimeIntervalSinceReferenceDate:(NSTimeInterval)(start - PWISOSecondsFrom1970ToReferenceDate)];
+        int64_t seconds = start;
+        while (date && seconds < _end)
+        {
+            if (_count == capacity)
+            {
+                capacity *= 2;
+                _starts  = realloc(_starts,  capacity * sizeof(int64_t));
+                _offsets = realloc(_offsets, capacity * sizeof(int32_t));
+            }
+            int32_t offset = (int32_t)[timeZone secondsFromGMTForDate:date];
+            _starts[_count]  = seconds;
+            _offsets[_count] = offset;
+            _maxAbsOffset = MAX(_maxAbsOffset, (int64_t)ABS(offset));
+            _count++;
+
+            date = [timeZone nextDaylightSavingTimeTransitionAfterDate:date];
+            if (date)
+                seconds = (int64_t)llround(date.timeIntervalSinceReferenceDate) + PWISOSecondsFrom1970ToReferenceDate;
+        }
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    free(_starts);
+    free(_offsets);
+}
+
++ (PWISOTimeZoneOffsetTable*)tableForTimeZone:(NSTimeZone*)timeZone
+{
+    NSParameterAssert(timeZone);
+
+    static PWDispatchQueue* dispatchQueue;
+    static NSMutableDictionary<NSTimeZone*, PWISOTimeZoneOffsetTable*>* tables;
+    PWDispatchOnce(^{
+        dispatchQueue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWISOTimeZoneOffsetTable"];
+        tables = [[NSMutableDictionary alloc] init];
+    });
+
+    __block PWISOTimeZoneOffsetTable* table;
+    [dispatchQueue synchronouslyDispatchBlock:^{
+        table = tables[timeZone];
+        if (!table)
+        {
+            table = [[PWISOTimeZoneOffsetTable alloc] initWithTimeZone:timeZone];
+            tables[timeZone] = table;
+        }
+    }];
+    return table;
+}
+
+// Index of the last entry starting at or before 'seconds'. The caller checks that 'seconds' is not before the first entry.
+static inline NSUInteger PWISOOffsetTableIndex(PWISOTimeZoneOffsetTable* table, int64_t seconds)
+{
+    NSUInteger low = 0;
+    NSUInteger high = table->_count;
+    while (high - low > 1)
+    {
+        NSUInteger middle = (low + high) / 2;
+        if (table->_starts[middle] <= seconds)
+            low = middle;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+static inline BOOL PWISOOffsetTableContains(PWISOTimeZoneOffsetTable* table, int64_t seconds)
+{
+    return table->_count > 0 && seconds >= table->_starts[0] && seconds < table->_end;
+}
+
+static inline BOOL PWISOOffsetForUTCSeconds(PWISOTimeZoneOffsetTable* table, int64_t seconds, int64_t* outOffset)
+{
+    if (!PWISOOffsetTableContains(table, seconds))
+        return NO;
+    *outOffset = table->_offsets[PWISOOffsetTableIndex(table, seconds)];
+    return YES;
+}
+
+// Fails if the local time does not exist or exists more than once, because this is where the calendar has its own rules.
+static inline BOOL PWISOUTCSecondsForLocalSeconds(PWISOTimeZoneOffsetTable* table, int64_t localSeconds, int64_t* outSeconds)
+{
+    if (table->_count == 0)
+        return NO;
+
+    int64_t lowest  = localSeconds - table->_maxAbsOffset;
+    int64_t highest = localSeconds + table->_maxAbsOffset;
+    if (highest < table->_starts[0] || lowest >= table->_end)
+        return NO;
+
+    NSUInteger first = lowest < table->_starts[0] ? 0 : PWISOOffsetTableIndex(table, lowest);
+    NSUInteger last  = PWISOOffsetTableIndex(table, MIN(highest, table->_end - 1));
+    NSUInteger matchCount = 0;
+    for (NSUInteger index = first; index <= last; index++)
+    {
+        int64_t seconds = localSeconds - table->_offsets[index];
+        int64_t end = index + 1 < table->_count ? table->_starts[index + 1] : table->_end;
+        if (seconds >= table->_starts[index] && seconds < end)
+        {
+            *outSeconds = seconds;
+            matchCount++;
+        }
+    }
+    return matchCount == 1;
+}
+
+@end
+
+#pragma mark - Formatting
+
+static inline char* PWISOWriteDigits(char* buffer, int64_t value, NSUInteger count)
+{
+    for (NSUInteger index = count; index > 0; index--)
+    {
+        buffer[index - 1] = '0' + (char)(value % 10);
+        value /= 10;
+    }
+    return buffer + count;
+}
+
+// Writes the representation of 'date' into 'buffer', which must hold at least PWISOMaxStringLength characters.
+// Returns the length, or 0 if the date is outside of the table and needs to be formatted by the calendar.
+static const NSUInteger PWISOMaxStringLength = 32;
+
+static NSUInteger PWISOFormatDate(NSDate* date, PWISODateStyle style, PWISOTimeZoneOffsetTable* table, char* buffer)
+{
+    NSTimeInterval interval = date.timeIntervalSinceReferenceDate;
+    if (!(interval > -1e11 && interval < 1e11))     // also excludes NaN
+        return 0;
+    NSTimeInterval flooredInterval = floor(interval);
+    int64_t seconds = (int64_t)flooredInterval + PWISOSecondsFrom1970ToReferenceDate;
+
+    int64_t offset;
+    if (!PWISOOffsetForUTCSeconds(table, seconds, &offset))
+        return 0;
+
+    int64_t localSeconds = seconds + offset;
+    int64_t days = PWISOFloorDivide(localSeconds, PWISOSecondsPerDay);
+    int64_t secondOfDay = localSeconds - days * PWISOSecondsPerDay;
+    int64_t year, month, day;
+    PWISOCivilFromDays(days, &year, &month, &day);
+
+    char* position = buffer;
+    position = PWISOWriteDigits(position, year, 4);
+    *position++ = '-';
+    position = PWISOWriteDigits(position, month, 2);
+    *position++ = '-';
+    position = PWISOWriteDigits(position, day, 2);
+    if (style == PWISODateOnly)
+        return position - buffer;
+
+    NSCAssert (style == PWISODateAndTime || style == PWISODateAndTimeWithSecondFraction, nil);
+    *position++ = 'T';
+    position = PWISOWriteDigits(position, secondOfDay / 3600, 2);
+    *position++ = ':';
+    position = PWISOWriteDigits(position, secondOfDay / 60 % 60, 2);
+    *position++ = ':';
+    position = PWISOWriteDigits(position, secondOfDay % 60, 2);
+
+    if (style == PWISODateAndTimeWithSecondFraction)
+    {
+        // Same truncation as NSCalendar uses for NSCalendarUnitNanosecond.
+        int64_t nanoseconds = (int64_t)((interval - flooredInterval) * 1e9);
+        if (nanoseconds > 0)
+        {
+            // Mimics +fractionFormatter: at most 8 digits rounded half even, trailing zeros removed but at least one
+            // digit. A value rounded up to 1 loses its integer digit, just like with maximumIntegerDigits = 0.
+            int64_t digits = nanoseconds / 10;
+            int64_t remainder = nanoseconds % 10;
+            if (remainder > 5 || (remainder == 5 && (digits & 1) != 0))
+                digits++;
+            if (digits >= 100000000)
+                digits = 0;
+
+            *position++ = '.';
+            char* fraction = position;
+            position = PWISOWriteDigits(position, digits, 8);
+            while (position > fraction + 1 && position[-1] == '0')
+                position--;
+        }
+    }
+    return position - buffer;
+}
+
+#pragma mark - Parsing
+
+// The fields of a string matching
+// ^([0-9]{1,4})-([0-9]{1,2})-([0-9]{1,2})(?:[tT\s]\s*([0-9]{1,2})(?::([0-9]{2})(?::([0-9]{2})(\.[0-9]+)?)?)?)?$
+// Optional fields which are not present are NSDateComponentUndefined.
+typedef struct PWISODateFields
+{
+    NSInteger year;
+    NSInteger month;
+    NSInteger day;
+    NSInteger hour;
+    NSInteger minute;
+    NSInteger second;
+    NSInteger nanosecond;
+} PWISODateFields;
+
+// Same set as \s in ICU regular expressions (the Unicode White_Space property).
+static inline BOOL PWISOIsWhitespace(UniChar character)
+{
+    return (character >= 0x09 && character <= 0x0D) || character == 0x20 || character == 0x85 || character == 0xA0
+        || character == 0x1680 || (character >= 0x2000 && character <= 0x200A) || character == 0x2028
+        || character == 0x2029 || character == 0x202F || character == 0x205F || character == 0x3000;
+}
+
+// Like '$' in ICU regular expressions, which also matches in front of a line terminator at the end of the input.
+static inline BOOL PWISOIsAtEnd(CFStringInlineBuffer* buffer, CFIndex index, CFIndex length)
+{
+    if (index == length)
+        return YES;
+    UniChar character = CFStringGetCharacterFromInlineBuffer(buffer, index);
+    if (index + 1 == length)
+        return (character >= 0x0A && character <= 0x0D) || character == 0x85 || character == 0x2028 || character == 0x2029;
+    return index + 2 == length && character == '\r' && CFStringGetCharacterFromInlineBuffer(buffer, index + 1) == '\n';
+}
+
+static inline BOOL PWISOScanDigits(CFStringInlineBuffer* buffer, CFIndex* index, CFIndex length,
+                                   NSUInteger minCount, NSUInteger maxCount, NSInteger* outValue)
+{
+    NSInteger value = 0;
+    NSUInteger count = 0;
+    CFIndex position = *index;
+    while (count < maxCount && position < length)
+    {
+        UniChar character = CFStringGetCharacterFromInlineBuffer(buffer, position);
+        if (character < '0' || character > '9')
+            break;
+        value = value * 10 + (character - '0');
+        count++;
+        position++;
+    }
+    if (count < minCount)
+        return NO;
+    *index = position;
+    *outValue = value;
+    return YES;
+}
+
+static inline BOOL PWISOScanCharacter(CFStringInlineBuffer* buffer, CFIndex* index, CFIndex length, UniChar character)
+{
+    if (*index >= length || CFStringGetCharacterFromInlineBuffer(buffer, *index) != character)
+        return NO;
+    (*index)++;
+    return YES;
+}
+
+static BOOL PWISOScanString(NSString* string, PWISODateFields* fields)
+{
+    CFIndex length = (CFIndex)string.length;
+    CFStringInlineBuffer buffer;
+    CFStringInitInlineBuffer((__bridge CFStringRef)string, &buffer, CFRangeMake(0, length));
+
+    fields->hour = fields->minute = fields->second = fields->nanosecond = NSDateComponentUndefined;
+
+    CFIndex index = 0;
+    if (   !PWISOScanDigits(&buffer, &index, length, 1, 4, &fields->year)
+        || !PWISOScanCharacter(&buffer, &index, length, '-')
+        || !PWISOScanDigits(&buffer, &index, length, 1, 2, &fields->month)
+        || !PWISOScanCharacter(&buffer, &index, length, '-')
+        || !PWISOScanDigits(&buffer, &index, length, 1, 2, &fields->day))
+        return NO;
+
+    // The time part is all or nothing: none of its sub-patterns can match a prefix of a longer valid remainder, so
+    // scanning greedily decides the same way as the backtracking regular expression.
+    CFIndex timeIndex = index;
+    if (timeIndex < length)
+    {
+        UniChar separator = CFStringGetCharacterFromInlineBuffer(&buffer, timeIndex);
+        if (separator == 't' || separator == 'T' || PWISOIsWhitespace(separator))
+        {
+            timeIndex++;
+            while (timeIndex < length && PWISOIsWhitespace(CFStringGetCharacterFromInlineBuffer(&buffer, timeIndex)))
+                timeIndex++;
+
+            NSInteger hour;
+            if (PWISOScanDigits(&buffer, &timeIndex, length, 1, 2, &hour))
+            {
+                fields->hour = hour;
+                CFIndex minuteIndex = timeIndex;
+                NSInteger minute;
+                if (   PWISOScanCharacter(&buffer, &minuteIndex, length, ':')
+                    && PWISOScanDigits(&buffer, &minuteIndex, length, 2, 2, &minute))
+                {
+                    fields->minute = minute;
+                    timeIndex = minuteIndex;
+                    CFIndex secondIndex = timeIndex;
+                    NSInteger second;
+                    if (   PWISOScanCharacter(&buffer, &secondIndex, length, ':')
+                        && PWISOScanDigits(&buffer, &secondIndex, length, 2, 2, &second))
+                    {
+                        fields->second = second;
+                        timeIndex = secondIndex;
+                        CFIndex fractionStart = timeIndex;
+                        if (PWISOScanCharacter(&buffer, &timeIndex, length, '.'))
+                        {
+                            while (timeIndex < length)
+                            {
+                                UniChar character = CFStringGetCharacterFromInlineBuffer(&buffer, timeIndex);
+                                if (character < '0' || character > '9')
+                                    break;
+                                timeIndex++;
+                            }
+                            if (timeIndex == fractionStart + 1)
+                                timeIndex = fractionStart;
+                            else
+                            {
+                                // Converted like -[NSString doubleValue] of ".ddd", as before.
+                                CFIndex fractionLength = timeIndex - fractionStart;
+                                char stackDigits[64];
+                                char* digits = fractionLength < (CFIndex)sizeof(stackDigits) ? stackDigits : malloc(fractionLength + 1);
+                                for (CFIndex digitIndex = 0; digitIndex < fractionLength; digitIndex++)
+                                    digits[digitIndex] = (char)CFStringGetCharacterFromInlineBuffer(&buffer, fractionStart + digitIndex);
+                                digits[fractionLength] = 0;
+                                fields->nanosecond = 1e9 * strtod_l(digits, NULL, NULL);
+                                if (digits != stackDigits)
+                                    free(digits);
+                            }
+                        }
+                    }
+                }
+                if (PWISOIsAtEnd(&buffer, timeIndex, length))
+                    return YES;
+                return NO;
+            }
+        }
+    }
+    return PWISOIsAtEnd(&buffer, index, length);
+}
+
+// Returns nil if the fields are outside of the table or need lenient interpretation by the calendar.
+static NSDate* PWISODateFromFields(const PWISODateFields* fields, PWISOTimeZoneOffsetTable* table)
+{
+    if (   fields->year < PWISOFastPathFirstYear - 1 || fields->year > PWISOFastPathEndYear
+        || fields->month < 1 || fields->month > 12
+        || fields->day < 1 || fields->day > PWISODaysInMonth(fields->year, fields->month))
+        return nil;
+
+    NSInteger hour       = fields->hour       == NSDateComponentUndefined ? 0 : fields->hour;
+    NSInteger minute     = fields->minute     == NSDateComponentUndefined ? 0 : fields->minute;
+    NSInteger second     = fields->second     == NSDateComponentUndefined ? 0 : fields->second;
+    NSInteger nanosecond = fields->nanosecond == NSDateComponentUndefined ? 0 : fields->nanosecond;
+    if (hour > 23 || minute > 59 || second > 59 || nanosecond < 0 || nanosecond >= 1000000000)
+        return nil;
+
+    int64_t localSeconds = PWISODaysFromCivil(fields->year, fields->month, fields->day) * PWISOSecondsPerDay
+                         + hour * 3600 + minute * 60 + second;
+    int64_t seconds;
+    if (!PWISOUTCSecondsForLocalSeconds(table, localSeconds, &seconds))
+        return nil;
+
+    NSTimeInterval interval = (NSTimeInterval)(seconds - PWISOSecondsFrom1970ToReferenceDate);
+    if (nanosecond > 0)
+        interval += (double)nanosecond / 1e9;
+    return [NSDate dateWithTimeIntervalSinceReferenceDate:interval];
+}
+
+#pragma mark
 
 @implementation PWISODateFormatter
+{
+    NSTimeZone*                 offsetTableTimeZone_;
+    PWISOTimeZoneOffsetTable*   offsetTable_;
+}
 
 @synthesize calendar = calendar_;
 @synthesize style    = style_;
@@ -22,6 +470,21 @@
     return calendar_;
 }
 
+// Returns nil if the calendar is not Gregorian, which means that all dates are handled by the calendar.
+- (PWISOTimeZoneOffsetTable*) offsetTable
+{
+    NSCalendar* calendar = self.calendar;
+    if (![calendar.calendarIdentifier isEqualToString:NSCalendarIdentifierGregorian])
+        return nil;
+
+    NSTimeZone* timeZone = calendar.timeZone;
+    if (timeZone != offsetTableTimeZone_ && ![timeZone isEqual:offsetTableTimeZone_]) {
+        offsetTable_ = [PWISOTimeZoneOffsetTable tableForTimeZone:timeZone];
+        offsetTableTimeZone_ = timeZone;
+    }
+    return offsetTable_;
+}
+
 + (NSNumberFormatter*)fractionFormatter
 {
     static NSNumberFormatter* formatter;
@@ -38,53 +501,78 @@
     return formatter;
 }
 
-- (NSString*) stringFromDate:(NSDate*)date
+- (NSString*) stringFromDate:(NSDate*)date offsetTable:(PWISOTimeZoneOffsetTable*)offsetTable
 {
-    NSString* string;
     if (!date)
-        string = @"";
+        return @"";
+
+    if (offsetTable) {
+        char buffer[PWISOMaxStringLength];
+        NSUInteger length = PWISOFormatDate(date, style_, offsetTable, buffer);
+        if (length > 0)
+            return [[NSString alloc] initWithBytes:buffer length:length encoding:NSASCIIStringEncoding];
+    }
+
+    NSString* string;
+    if (style_ == PWISODateOnly) {
+        NSDateComponents* comps = [self.calendar components:NSCalendarUnitYear | NSCalendarUnitMonth | NSCalendarUnitDay
+                                                   fromDate:date];
+
+        string = [NSString stringWithFormat:@"%.4li-%.2li-%.2li",(long)comps.year, (long)comps.month, (long)comps.day];
+    }
     else {
-        if (style_ == PWISODateOnly) {
-            NSDateComponents* comps = [self.calendar components:NSCalendarUnitYear | NSCalendarUnitMonth | NSCalendarUnitDay
-                                                       fromDate:date];
-            
-            string = [NSString stringWithFormat:@"%.4li-%.2li-%.2li",(long)comps.year, (long)comps.month, (long)comps.day];
-        }
-        else {
-            NSAssert (style_ == PWISODateAndTime || style_ == PWISODateAndTimeWithSecondFraction, nil);
-
-            NSCalendarUnit components = NSCalendarUnitYear | NSCalendarUnitMonth | NSCalendarUnitDay
-                                      | NSCalendarUnitHour | NSCalendarUnitMinute | NSCalendarUnitSecond;
-            if (style_ == PWISODateAndTimeWithSecondFraction)
-                components |= NSCalendarUnitNanosecond;
-            NSDateComponents* comps = [self.calendar components:components fromDate:date];
-
-            string = [NSString stringWithFormat:@"%.04li-%.02li-%.02liT%.02li:%.02li:%.02li",
-                      (long)comps.year, (long)comps.month, (long)comps.day, (long)comps.hour, (long)comps.minute, (long)comps.second];
-            
-            if (style_ == PWISODateAndTimeWithSecondFraction) {
-                NSInteger nanoseconds = comps.nanosecond;
-                if (nanoseconds > 0) {
-                    double fraction = (double)nanoseconds / 1e9;
-                    NSString* fractionString = [PWISODateFormatter.fractionFormatter stringFromNumber:@(fraction)];
-                    string = [string stringByAppendingString:fractionString];
-                }
+        NSAssert (style_ == PWISODateAndTime || style_ == PWISODateAndTimeWithSecondFraction, nil);
+
+        NSCalendarUnit components = NSCalendarUnitYear | NSCalendarUnitMonth | NSCalendarUnitDay
+                                  | NSCalendarUnitHour | NSCalendarUnitMinute | NSCalendarUnitSecond;
+        if (style_ == PWISODateAndTimeWithSecondFraction)
+            components |= NSCalendarUnitNanosecond;
+        NSDateComponents* comps = [self.calendar components:components fromDate:date];
+
+        string = [NSString stringWithFormat:@"%.04li-%.02li-%.02liT%.02li:%.02li:%.02li",
+                  (long)comps.year, (long)comps.month, (long)comps.day, (long)comps.hour, (long)comps.minute, (long)comps.second];
+
+        if (style_ == PWISODateAndTimeWithSecondFraction) {
+            NSInteger nanoseconds = comps.nanosecond;
+            if (nanoseconds > 0) {
+                double fraction = (double)nanoseconds / 1e9;
+                NSString* fractionString = [PWISODateFormatter.fractionFormatter stringFromNumber:@(fraction)];
+                string = [string stringByAppendingString:fractionString];
             }
         }
     }
     return string;
 }
 
+- (NSString*) stringFromDate:(NSDate*)date
+{
+    return [self stringFromDate:date offsetTable:date ? self.offsetTable : nil];
+}
+
+- (NSArray<NSString*>*) stringsFromDates:(NSArray<NSDate*>*)dates
+{
+    NSParameterAssert (dates);
+
+    PWISOTimeZoneOffsetTable* offsetTable = self.offsetTable;
+    NSMutableArray<NSString*>* strings = [[NSMutableArray alloc] initWithCapacity:dates.count];
+    for (NSDate* date in dates)
+        [strings addObject:[self stringFromDate:date offsetTable:offsetTable]];
+    return strings;
+}
+
 - (NSString*) stringForObjectValue:(id)obj
 {
     if (obj && ![obj isKindOfClass:NSDate.class])
-        [NSException raise:NSInvalidArgumentException 
+        [NSException raise:NSInvalidArgumentException
                     format:@"PWISODateFormatter can not format a %@.", NSStringFromClass ([obj class])];
 
     return [self stringFromDate:obj];
 }
 
-- (BOOL) getObjectValue:(id*)outValue forString:(NSString*)string errorDescription:(NSString**)outDescription
+- (BOOL) getObjectValue:(id*)outValue
+              forString:(NSString*)string
+            offsetTable:(PWISOTimeZoneOffsetTable*)offsetTable
+       errorDescription:(NSString**)outDescription
 {
     NSParameterAssert (outValue);
     if(!string.length)
@@ -92,51 +580,47 @@
         *outValue = nil;
         return YES;
     }
-    BOOL success = NO;
 
-    static NSRegularExpression* regEx;
-    PWDispatchOnce (^{
-        regEx = [NSRegularExpression
-                 regularExpressionWithPattern:@"^([0-9]{1,4})-([0-9]{1,2})-([0-9]{1,2})(?:[tT\\s]\\s*([0-9]{1,2})(?::([0-9]{2})(?::([0-9]{2})(\\.[0-9]+)?)?)?)?$"
-                 options:0 error:NULL];
-    });
-    
-    NSTextCheckingResult* match = [regEx firstMatchInString:string options:0 range:NSMakeRange(0, string.length)];
-    if (match) {
+    PWISODateFields fields;
+    if (!PWISOScanString(string, &fields)) {
+        if (outDescription)
+            *outDescription = [NSString stringWithFormat:@"Invalid ISO date string: %@", string];
+        return NO;
+    }
+
+    // For parsing there’s (so far) no difference between PWISODateAndTime and PWISODateAndTimeWithSecondFraction.
+    if (style_ == PWISODateOnly)
+        fields.hour = fields.minute = fields.second = fields.nanosecond = NSDateComponentUndefined;
+
+    NSDate* date = offsetTable ? PWISODateFromFields(&fields, offsetTable) : nil;
+    if (!date) {
         NSDateComponents* comps = [[NSDateComponents alloc] init];
-        comps.year  = [string substringWithMatch:match rangeIndex:1].integerValue;
-        comps.month = [string substringWithMatch:match rangeIndex:2].integerValue;
-        comps.day   = [string substringWithMatch:match rangeIndex:3].integerValue;
-        
-        // For parsing there’s (so far) no difference between PWISODateAndTime and PWISODateAndTimeWithSecondFraction.
-        if(style_ != PWISODateOnly) {
-            NSString* aNumberString = [string substringWithMatch:match rangeIndex:4];
-            if (aNumberString) {
-                comps.hour = aNumberString.integerValue;
-                
-                aNumberString = [string substringWithMatch:match rangeIndex:5];
-                if (aNumberString) {
-                    comps.minute = aNumberString.integerValue;
-                    
-                    aNumberString = [string substringWithMatch:match rangeIndex:6];
-                    if (aNumberString) {
-                        comps.second = aNumberString.integerValue;
-                        
-                        aNumberString = [string substringWithMatch:match rangeIndex:7];
-                        if (aNumberString)
-                            comps.nanosecond = 1e9 * aNumberString.doubleValue;
-                    }
+        comps.year  = fields.year;
+        comps.month = fields.month;
+        comps.day   = fields.day;
+        if (fields.hour != NSDateComponentUndefined) {
+            comps.hour = fields.hour;
+            if (fields.minute != NSDateComponentUndefined) {
+                comps.minute = fields.minute;
+                if (fields.second != NSDateComponentUndefined) {
+                    comps.second = fields.second;
+                    if (fields.nanosecond != NSDateComponentUndefined)
+                        comps.nanosecond = fields.nanosecond;
                 }
             }
         }
-        *outValue = [self.calendar dateFromComponents:comps];
-        success = YES;
-    }
-    else if (outDescription) {
-        *outDescription = [NSString stringWithFormat:@"Invalid ISO date string: %@", string];
+        date = [self.calendar dateFromComponents:comps];
     }
+    *outValue = date;
+    return YES;
+}
 
-    return success;
+- (BOOL) getObjectValue:(id*)outValue forString:(NSString*)string errorDescription:(NSString**)outDescription
+{
+    return [self getObjectValue:outValue
+                      forString:string
+                    offsetTable:string.length > 0 ? self.offsetTable : nil
+               errorDescription:outDescription];
 }
 
 - (NSDate*) dateFromString:(NSString*)string
@@ -146,4 +630,18 @@
     return date;
 }
 
+- (NSArray*) datesFromStrings:(NSArray<NSString*>*)strings
+{
+    NSParameterAssert (strings);
+
+    PWISOTimeZoneOffsetTable* offsetTable = self.offsetTable;
+    NSMutableArray* dates = [[NSMutableArray alloc] initWithCapacity:strings.count];
+    for (NSString* string in strings) {
+        NSDate* date;
+        [self getObjectValue:&date forString:string offsetTable:offsetTable errorDescription:NULL];
+        [dates addObject:date ?: (id)NSNull.null];
+    }
+    return dates;
+}
+
 @end
@@ -180,4 +180,155 @@
     XCTAssertThrows ([formatter stringForObjectValue:@"no date"]);
 }
 
+- (void) testSyntax
+{
+    PWISODateFormatter* formatter = [[PWISODateFormatter alloc] init];
+    NSDate* date;
+    for (NSString* string in @[@"2010-5-7\n", @"2010-5-7\r\n", @"2010-05-07T08:30:15.5\u2028", @"2010-5-7\u3000 8:30",
+                               @"0001-1-1", @"2010-5-7\n8"])
+        XCTAssertTrue ([formatter getObjectValue:&date forString:string errorDescription:NULL], @"%@", string);
+
+    for (NSString* string in @[@"2010-5-7T", @"2010-5-7T8:3", @"2010-5-7T8:300", @"2010-5-7T8:30:15.", @"12345-1-1",
+                               @"2010-5-7 \n", @"2010-5-7\n\n", @"2010-5-7T8 ", @"2010-5-7T123", @"2010-5-7T8:30.5", @"-2010-5-7",
+                               @"2010-5-7Z", @"２０１０-5-7"])
+        XCTAssertFalse ([formatter getObjectValue:&date forString:string errorDescription:NULL], @"%@", string);
+}
+
+- (void) testLenientFields
+{
+    PWISODateFormatter* formatter = [[PWISODateFormatter alloc] init];
+    for (NSString* string in @[@"2010-13-40", @"2010-0-0T24:60:60", @"2010-2-29", @"2012-2-29T99:99:99.999"]) {
+        NSArray<NSString*>* parts = [string componentsSeparatedByCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@"-T:"]];
+        NSDateComponents* comps = [[NSDateComponents alloc] init];
+        comps.year  = parts[0].integerValue;
+        comps.month = parts[1].integerValue;
+        comps.day   = parts[2].integerValue;
+        if (parts.count > 3) {
+            comps.hour       = parts[3].integerValue;
+            comps.minute     = parts[4].integerValue;
+            comps.second     = parts[5].integerValue;
+            NSRange dot = [string rangeOfString:@"."];
+            if (dot.location != NSNotFound)
+                comps.nanosecond = 1e9 * [string substringFromIndex:dot.location].doubleValue;
+        }
+        XCTAssertEqualObjects ([formatter dateFromString:string], [formatter.calendar dateFromComponents:comps], @"%@", string);
+    }
+}
+
+#pragma mark - Comparison with NSCalendar
+
+// The implementation of -stringFromDate: before it got its own calendar arithmetic.
+- (NSString*) calendarStringFromDate:(NSDate*)date calendar:(NSCalendar*)calendar style:(PWISODateStyle)style
+{
+    NSCalendarUnit units = NSCalendarUnitYear | NSCalendarUnitMonth | NSCalendarUnitDay;
+    if (style == PWISODateOnly) {
+        NSDateComponents* comps = [calendar components:units fromDate:date];
+        return [NSString stringWithFormat:@"%.4li-%.2li-%.2li",(long)comps.year, (long)comps.month, (long)comps.day];
+    }
+
+    units |= NSCalendarUnitHour | NSCalendarUnitMinute | NSCalendarUnitSecond | NSCalendarUnitNanosecond;
+    NSDateComponents* comps = [calendar components:units fromDate:date];
+    NSString* string = [NSString stringWithFormat:@"%.04li-%.02li-%.02liT%.02li:%.02li:%.02li",
+                        (long)comps.year, (long)comps.month, (long)comps.day, (long)comps.hour, (long)comps.minute, (long)comps.second];
+    if (style == PWISODateAndTimeWithSecondFraction && comps.nanosecond > 0) {
+        NSNumberFormatter* formatter = [[NSNumberFormatter alloc] init];
+        formatter.minimumFractionDigits = 1;
+        formatter.maximumFractionDigits = 8;
+        formatter.minimumIntegerDigits  = 0;
+        formatter.maximumIntegerDigits  = 0;
+        formatter.decimalSeparator = @".";
+        formatter.alwaysShowsDecimalSeparator = YES;
+        formatter.locale = [[NSLocale alloc] initWithLocaleIdentifier:@"en-US"];
+        string = [string stringByAppendingString:[formatter stringFromNumber:@((double)comps.nanosecond / 1e9)]];
+    }
+    return string;
+}
+
+- (NSArray<NSDate*>*) sampleDatesWithCount:(NSUInteger)count
+{
+    // Spans the years 1850 to 2250, so both sides of the range covered by the offset tables are included.
+    NSTimeInterval first = -4733510400.0;
+    NSTimeInterval span  = 12623040000.0;
+    NSMutableArray<NSDate*>* dates = [NSMutableArray arrayWithCapacity:count];
+    uint64_t state = 42;
+    for (NSUInteger index = 0; index < count; index++) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        NSTimeInterval interval = first + span * ((double)(state >> 11) / (double)(1ull << 53));
+        switch (index % 4) {
+            case 0:  interval = floor(interval); break;                     // whole seconds
+            case 1:  interval = floor(interval) + 0.5; break;
+            case 2:  interval = floor(interval / 1800.0) * 1800.0; break;  // often hits transitions
+            default: break;
+        }
+        [dates addObject:[NSDate dateWithTimeIntervalSinceReferenceDate:interval]];
+    }
+    return dates;
+}
+
+- (void) testMatchesCalendar
+{
+    NSArray<NSDate*>* dates = [self sampleDatesWithCount:2000];
+    for (NSString* name in @[@"GMT", @"Europe/Berlin", @"America/New_York", @"Australia/Lord_Howe", @"Asia/Kolkata",
+                             @"America/St_Johns", @"America/Sao_Paulo", @"Pacific/Apia"]) {
+        NSCalendar* calendar = [[NSCalendar alloc] initWithCalendarIdentifier:NSCalendarIdentifierGregorian];
+        calendar.timeZone = [NSTimeZone timeZoneWithName:name];
+        PWISODateFormatter* formatter = [[PWISODateFormatter alloc] init];
+        formatter.calendar = calendar;
+
+        for (NSNumber* style in @[@(PWISODateAndTime), @(PWISODateOnly), @(PWISODateAndTimeWithSecondFraction)]) {
+            formatter.style = (PWISODateStyle)style.integerValue;
+            NSArray<NSString*>* strings = [formatter stringsFromDates:dates];
+            XCTAssertEqual (strings.count, dates.count);
+            [dates enumerateObjectsUsingBlock:^(NSDate* date, NSUInteger index, BOOL* stop) {
+                NSString* expected = [self calendarStringFromDate:date calendar:calendar style:formatter.style];
+                XCTAssertEqualObjects (strings[index], expected, @"%@ %@", name, date);
+                XCTAssertEqualObjects ([formatter stringFromDate:date], expected, @"%@ %@", name, date);
+
+                NSDateComponents* comps = [calendar components:NSCalendarUnitYear | NSCalendarUnitMonth | NSCalendarUnitDay
+                                                             | NSCalendarUnitHour | NSCalendarUnitMinute | NSCalendarUnitSecond
+                                                      fromDate:date];
+                if (formatter.style == PWISODateOnly)
+                    comps.hour = comps.minute = comps.second = 0;
+                NSRange dot = [expected rangeOfString:@"."];
+                if (dot.location != NSNotFound)
+                    comps.nanosecond = 1e9 * [expected substringFromIndex:dot.location].doubleValue;
+                XCTAssertEqualObjects ([formatter dateFromString:expected], [calendar dateFromComponents:comps], @"%@ %@", name, expected);
+            }];
+        }
+    }
+}
+
+- (void) testBulkParsing
+{
+    PWISODateFormatter* formatter = [[PWISODateFormatter alloc] init];
+    NSArray* dates = [formatter datesFromStrings:@[@"2010-5-7", @"", @"no date", @"2010-11-13T11:15:59"]];
+    XCTAssertEqual (dates.count, 4);
+    XCTAssertEqualObjects (dates[0], [formatter dateFromString:@"2010-5-7"]);
+    XCTAssertEqualObjects (dates[1], NSNull.null);
+    XCTAssertEqualObjects (dates[2], NSNull.null);
+    XCTAssertEqualObjects ([formatter stringFromDate:dates[3]], @"2010-11-13T11:15:59");
+}
+
+#pragma mark - Performance
+
+- (void) testFormattingPerformance
+{
+    PWISODateFormatter* formatter = [[PWISODateFormatter alloc] init];
+    formatter.style = PWISODateAndTimeWithSecondFraction;
+    NSArray<NSDate*>* dates = [self sampleDatesWithCount:100000];
+    [self measureBlock:^{
+        [formatter stringsFromDates:dates];
+    }];
+}
+
+- (void) testParsingPerformance
+{
+    PWISODateFormatter* formatter = [[PWISODateFormatter alloc] init];
+    formatter.style = PWISODateAndTimeWithSecondFraction;
+    NSArray<NSString*>* strings = [formatter stringsFromDates:[self sampleDatesWithCount:100000]];
+    [self measureBlock:^{
+        [formatter datesFromStrings:strings];
+    }];
+}
+
 @end
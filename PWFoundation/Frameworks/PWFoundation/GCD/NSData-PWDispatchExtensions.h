@@ -7,14 +7,32 @@
 //
 
 #import <dispatch/dispatch.h>
+#import <sys/uio.h>
 
 NS_ASSUME_NONNULL_BEGIN
 
 @interface NSData (PWDispatchExtensions)
 
 + (NSData*)dataWithDispatchData:(dispatch_data_t)dispatchData;      // on 32bit systems, buffer gets copied
-@property (nonatomic, readonly, strong) dispatch_data_t _Nonnull newDispatchData;                                 // buffer gets copied, needs to be released by caller
+
+// Buffer gets copied, unless the receiver has been created by +dataWithDispatchData:. Needs to be released by caller.
+@property (nonatomic, readonly, strong) dispatch_data_t _Nonnull newDispatchData;
+
+// Wraps the bytes of the receiver without copying them. The dispatch data keeps a reference to the receiver until it
+// is destroyed. Mutable data is copied, as its buffer may change. Needs to be released by caller.
+// ATTENTION: Only use this for data which owns its bytes. The buffer of data created with
+//            -initWithBytesNoCopy:length:freeWhenDone:NO must stay valid until the dispatch data is destroyed, which
+//            for asynchronous writes can be long after the call returned.
+@property (nonatomic, readonly, strong) dispatch_data_t _Nonnull newDispatchDataWithoutCopying;
 
 @end
 
+// Calls 'block' with a view on the bytes of 'dispatchData' without copying them. If the data consists of at most one
+// region, 'contiguousBytes' points to its bytes, otherwise it is NULL. 'regions' always describes all regions, ready
+// for gather IO like writev. The pointers are valid during the call only.
+typedef void (^PWDispatchDataBytesBlock)(const void* _Nullable contiguousBytes,
+                                         const struct iovec* regions,
+                                         size_t regionCount);
+void PWDispatchDataAccessBytes(dispatch_data_t dispatchData, NS_NOESCAPE PWDispatchDataBytesBlock block);
+
 NS_ASSUME_NONNULL_END
@@ -30,11 +30,101 @@ NS_ASSUME_NONNULL_BEGIN
 #endif
 }
 
+// Data returned by +dataWithDispatchData: can be cast back.
+- (nullable dispatch_data_t)bridgedDispatchData
+{
+#ifdef __LP64__
+    static Class dispatchDataClass;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        dispatchDataClass = NSClassFromString(@"OS_dispatch_data");
+    });
+    if(dispatchDataClass && [self isKindOfClass:dispatchDataClass])
+        return (dispatch_data_t)self;
+#endif
+    return nil;
+}
+
 - (dispatch_data_t)newDispatchData
 {
-    return dispatch_data_create(self.bytes, self.length, NULL, DISPATCH_DATA_DESTRUCTOR_DEFAULT);
+    dispatch_data_t bridgedData = self.bridgedDispatchData;
+    if(bridgedData)
+        return bridgedData;
+
+    NSUInteger length = self.length;
+    if(length == 0)
+        return dispatch_data_empty;
+    return dispatch_data_create(self.bytes, length, NULL, DISPATCH_DATA_DESTRUCTOR_DEFAULT);
+}
+
+- (dispatch_data_t)newDispatchDataWithoutCopying
+{
+    dispatch_data_t bridgedData = self.bridgedDispatchData;
+    if(bridgedData)
+        return bridgedData;
+
+    NSUInteger length = self.length;
+    if(length == 0)
+        return dispatch_data_empty;
+
+    // Immutable data returns itself from -copy.
+    NSData* data = [self copy];
+    CFTypeRef retainedData = CFBridgingRetain(data);
+    return dispatch_data_create(data.bytes, length, NULL, ^{
+        CFRelease(retainedData);
+    });
 }
 
 @end
 
+void PWDispatchDataAccessBytes(dispatch_data_t dispatchData, NS_NOESCAPE PWDispatchDataBytesBlock block)
+{
+    NSCParameterAssert(dispatchData);
+    NSCParameterAssert(block);
+
+    enum { PWInlineRegionCount = 8 };
+    struct iovec inlineRegions[PWInlineRegionCount];
+    __block struct iovec* regions = inlineRegions;
+    __block size_t capacity = PWInlineRegionCount;
+    __block size_t count = 0;
+
+    dispatch_data_apply(dispatchData, ^bool(dispatch_data_t region, size_t offset, const void* buffer, size_t size) {
+        if(count == capacity)
+        {
+            capacity *= 2;
+            if(regions == inlineRegions)
+            {
+                regions = malloc(capacity * sizeof(struct iovec));
+                if(regions)
+                    memcpy(regions, inlineRegions, sizeof(inlineRegions));
+            }
+            else
+                regions = reallocf(regions, capacity * sizeof(struct iovec));
+            if(!regions)
+                return false;
+        }
+        regions[count].iov_base = (void*)buffer;
+        regions[count].iov_len  = size;
+        count++;
+        return true;
+    });
+
+    if(!regions)
+    {
+        // Without memory for the region list, hand out a contiguous copy instead.
+        const void* bytes;
+        size_t size;
+        NS_VALID_UNTIL_END_OF_SCOPE dispatch_data_t map = dispatch_data_create_map(dispatchData, &bytes, &size);
+        struct iovec mapRegion = { (void*)bytes, size };
+        block(bytes, &mapRegion, 1);
+        return;
+    }
+
+    // The regions are owned by dispatchData, which the caller keeps alive during the call.
+    block(count == 1 ? regions[0].iov_base : (count == 0 ? "" : NULL), regions, count);
+
+    if(regions != inlineRegions)
+        free(regions);
+}
+
 NS_ASSUME_NONNULL_END
@@ -19,6 +19,15 @@ NS_ASSUME_NONNULL_BEGIN
 
 typedef void(^PWDispatchObserverBlock)(NSString* keyPath, id obj, NSDictionary* change);
 
+// Can be added to the options of key value observers. Notifications for the same object and key path which arrive
+// before the observer block has been called for them are coalesced into a single call. So a burst of changes, e.g. by
+// a bulk update of a model object, is delivered by one dispatch to the queue instead of one dispatch per change.
+// If all coalesced changes are settings, the block receives the change dictionary of the last one with the old value
+// of the first one. For other kinds of changes, the change dictionary is nil.
+// Coalescing observers always dispatch asynchronously, therefore PWDispatchQueueDispatchKindSynchronous and
+// NSKeyValueObservingOptionPrior are not supported.
+static const NSKeyValueObservingOptions PWKeyValueObservingOptionCoalescing = (NSKeyValueObservingOptions)(1 << 16);
+
 @interface NSObject (PWDispatchExtensions)
 
 // IMPORTANT: the observer instance returned by the following methods remembers the observed object(s) unsafe_unretained
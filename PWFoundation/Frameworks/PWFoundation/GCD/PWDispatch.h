@@ -13,13 +13,16 @@
 #import <PWFoundation/PWDispatchQueueingHelper.h>
 #import <PWFoundation/PWDispatchGroup.h>
 #import <PWFoundation/PWDispatchTimer.h>
+#import <PWFoundation/PWDispatchTimerWheel.h>
 #import <PWFoundation/PWDispatchFileReader.h>
 #import <PWFoundation/PWDispatchFileWriter.h>
 #import <PWFoundation/PWDispatchFileObserver.h>
 #import <PWFoundation/PWDispatchPathObserver.h>
+#import <PWFoundation/PWDispatchTreeObserver.h>
 #import <PWFoundation/PWDispatchSignalObserver.h>
 #import <PWFoundation/PWDispatchProcessObserver.h>
 #import <PWFoundation/PWDispatchMemoryPressureObserver.h>
+#import <PWFoundation/PWDispatchMemoryPressureMonitor.h>
 #import <PWFoundation/PWDispatchSemaphore.h>
 #import <PWFoundation/NSNotificationCenter-PWDispatchExtensions.h>
 #import <PWFoundation/NSObject-PWDispatchExtensions.h>
@@ -27,9 +30,15 @@
 #import <PWFoundation/PWDispatchObserver.h>
 #import <PWFoundation/PWWeakObjectWrapper.h>
 #import <PWFoundation/PWDispatchIORandomChannel.h>
+#import <PWFoundation/PWDispatchIOMappedChannel.h>
 #import <PWFoundation/PWDispatchIOStreamChannel.h>
+#import <PWFoundation/PWDispatchIOBandwidthLimiter.h>
+#import <PWFoundation/PWDispatchIOBatchReader.h>
+#import <PWFoundation/PWDispatchCompressionStream.h>
 #import <PWFoundation/PWDispatchFIFOBuffer.h>
 #import <PWFoundation/PWKeyedBlockQueue.h>
+#import <PWFoundation/PWKeyedDispatchScheduler.h>
+#import <PWFoundation/PWDispatchTaskGraph.h>
 
 #define PWDispatchOnce(block)                           \
 do                                                      \
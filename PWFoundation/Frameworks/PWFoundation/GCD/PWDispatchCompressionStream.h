@@ -0,0 +1,72 @@
+//
+//  PWDispatchCompressionStream.h
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import <PWFoundation/PWDispatchIOStreamChannel.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM (PWInteger, PWDispatchCompressionMode) {
+    PWDispatchCompressionModeInflate,
+    PWDispatchCompressionModeDeflate
+};
+
+typedef NS_ENUM (PWInteger, PWDispatchCompressionFormat) {
+    PWDispatchCompressionFormatZlib,        // zlib header and adler32 trailer
+    PWDispatchCompressionFormatGzip,        // gzip header and crc32 trailer, like -gunzippedData / -httpGzippedData
+    PWDispatchCompressionFormatRaw,         // plain deflate stream without any header
+    PWDispatchCompressionFormatAutomatic    // inflate only: detects zlib or gzip from the header
+};
+
+// A filter which inflates or deflates dispatch data chunks on their way to a target stream. It is typically used as
+// the target of -[PWDispatchIOStreamChannel copyDataWithLength:inChunksOfLength:toStream:...], so a large gzip file or
+// HTTP body can be decompressed while it is being read, without holding the whole payload in memory.
+//
+// All zlib work is done on a private serial queue, so compression overlaps with the I/O of source and target.
+// Memory usage is bounded: the receiver holds at most the input chunk it currently processes plus one output buffer
+// of 'bufferLength' bytes, which is written to the target stream before any further output is produced.
+// The handler of -writeDispatchData:queue:handler: is called with done == YES only after the whole chunk has been
+// consumed and all output produced so far has been accepted by the target. Writers which wait for done before
+// writing the next chunk (like -copyDataWithLength:...) therefore get backpressure from the target stream.
+@interface PWDispatchCompressionStream : NSObject <PWOutputStream>
+
+- (instancetype) initWithMode:(PWDispatchCompressionMode)mode
+                       format:(PWDispatchCompressionFormat)format
+                 targetStream:(id<PWOutputStream>)targetStream
+                 bufferLength:(NSUInteger)bufferLength;      // size of output chunks passed to targetStream, > 0
+
+// Uses Z_DEFAULT_COMPRESSION and 64 KB output chunks.
+- (instancetype) initWithMode:(PWDispatchCompressionMode)mode
+                       format:(PWDispatchCompressionFormat)format
+                 targetStream:(id<PWOutputStream>)targetStream;
+
+@property (nonatomic, readonly)         PWDispatchCompressionMode   mode;
+@property (nonatomic, readonly)         PWDispatchCompressionFormat format;
+@property (nonatomic, readonly, strong) id<PWOutputStream>          targetStream;
+@property (nonatomic, readonly)         NSUInteger                  bufferLength;
+
+// Deflate only, between 0 and 9. Must be set before the first write. Defaults to Z_DEFAULT_COMPRESSION.
+@property (nonatomic, readwrite)        NSInteger                   compressionLevel;
+
+// Byte counters, read through the internal queue, so they include all writes which have been processed.
+@property (atomic, readonly)            NSUInteger                  totalInputLength;
+@property (atomic, readonly)            NSUInteger                  totalOutputLength;
+
+// Flushes all remaining output to the target stream (for deflate, this writes the stream trailer) without closing
+// the target. For inflate, an error is reported if the compressed stream was truncated.
+// After finishing, further writes fail.
+- (void) finishWithQueue:(id<PWDispatchQueueing>)queue
+       completionHandler:(nullable void (^)(NSError* _Nullable error))completionHandler;
+
+// If immediately==NO, pending writes are completed and the receiver is finished before the target is closed.
+// If immediately==YES, the target is closed right away. A chunk which is being written to the target is abandoned and
+// the handlers of all pending writes are called with done == YES, the unprocessed data and an error.
+- (void)closeImmediately:(BOOL)immediately;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,549 @@
+//
+//  PWDispatchCompressionStream.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import "PWDispatchCompressionStream.h"
+#import "PWDispatchQueue.h"
+#import "PWErrors.h"
+#import "NSData-PWDispatchExtensions.h"
+#include <zlib.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef void (^PWDispatchCompressionCompletion)(NSError* _Nullable error);
+typedef void (^PWDispatchCompressionOperation)(PWDispatchBlock operationDone);
+
+static const NSUInteger PWDispatchCompressionDefaultBufferLength = 64 * 1024;
+
+@implementation PWDispatchCompressionStream
+{
+    PWDispatchQueue*                                    _queue;             // protects all state below
+    NSMutableArray<PWDispatchCompressionOperation>*     _pendingOperations; // writes and finishes, performed one at a time
+    BOOL                                                _isProcessing;
+
+    z_stream                                            _stream;
+    BOOL                                                _isStreamInitialized;
+    BOOL                                                _didReachStreamEnd;  // inflate only
+    BOOL                                                _isFinished;
+    BOOL                                                _isClosed;
+    NSError*                                            _error;
+
+    dispatch_data_t                                     _input;             // chunk currently being consumed
+    size_t                                              _inputOffset;       // offset of the first byte not yet passed to zlib
+    dispatch_data_t                                     _mappedInputRegion; // keeps the bytes behind next_in alive
+    Bytef*                                              _outputBuffer;
+    PWDispatchCompressionCompletion                     _outputCompletion;  // while an output chunk is being written
+    NSUInteger                                          _totalInputLength;
+    NSUInteger                                          _totalOutputLength;
+}
+
+- (instancetype) initWithMode:(PWDispatchCompressionMode)mode
+                       format:(PWDispatchCompressionFormat)format
+                 targetStream:(id<PWOutputStream>)targetStream
+                 bufferLength:(NSUInteger)bufferLength
+{
+    NSParameterAssert(targetStream);
+    NSParameterAssert(bufferLength > 0 && bufferLength <= UINT_MAX);
+    NSParameterAssert(format != PWDispatchCompressionFormatAutomatic || mode == PWDispatchCompressionModeInflate);
+
+    if ((self = [super init]) != nil)
+    {
+        _mode               = mode;
+        _format             = format;
+        _targetStream       = targetStream;
+        _bufferLength       = bufferLength;
+        _compressionLevel   = Z_DEFAULT_COMPRESSION;
+        _queue              = [PWDispatchQueue serialDispatchQueueWithLabel:NSStringFromClass(self.class)];
+        _pendingOperations  = [[NSMutableArray alloc] init];
+    }
+    return self;
+}
+
+- (instancetype) initWithMode:(PWDispatchCompressionMode)mode
+                       format:(PWDispatchCompressionFormat)format
+                 targetStream:(id<PWOutputStream>)targetStream
+{
+    return [self initWithMode:mode
+                       format:format
+                 targetStream:targetStream
+                 bufferLength:PWDispatchCompressionDefaultBufferLength];
+}
+
+- (void)dealloc
+{
+    [self endStream];
+    free(_outputBuffer);
+}
+
+- (BOOL)isOpen
+{
+    __block BOOL isOpen;
+    [_queue synchronouslyDispatchBlock:^{
+        isOpen = !_isClosed;
+    }];
+    return isOpen;
+}
+
+- (NSUInteger)totalInputLength
+{
+    __block NSUInteger length;
+    [_queue synchronouslyDispatchBlock:^{
+        length = _totalInputLength;
+    }];
+    return length;
+}
+
+- (NSUInteger)totalOutputLength
+{
+    __block NSUInteger length;
+    [_queue synchronouslyDispatchBlock:^{
+        length = _totalOutputLength;
+    }];
+    return length;
+}
+
+#pragma mark - zlib
+
+- (int)windowBits
+{
+    switch(_format)
+    {
+        case PWDispatchCompressionFormatGzip:       return MAX_WBITS + 16;
+        case PWDispatchCompressionFormatRaw:        return -MAX_WBITS;
+        case PWDispatchCompressionFormatAutomatic:  return MAX_WBITS + 32;
+        default:                                    return MAX_WBITS;
+    }
+}
+
+- (BOOL)ensureStream
+{
+    PWAssert(_queue.isCurrentDispatchQueue);
+
+    if(_isStreamInitialized)
+        return YES;
+
+    memset(&_stream, 0, sizeof(_stream));
+    int status;
+    if(_mode == PWDispatchCompressionModeInflate)
+        status = inflateInit2(&_stream, self.windowBits);
+    else
+        status = deflateInit2(&_stream, (int)_compressionLevel, Z_DEFLATED, self.windowBits, 8, Z_DEFAULT_STRATEGY);
+    if(status != Z_OK)
+    {
+        _error = [self errorWithStatus:status];
+        return NO;
+    }
+
+    if(!_outputBuffer)
+        _outputBuffer = malloc(_bufferLength);
+    _stream.next_out  = _outputBuffer;
+    _stream.avail_out = (uInt)_bufferLength;
+    _isStreamInitialized = YES;
+    return YES;
+}
+
+- (void)endStream
+{
+    if(!_isStreamInitialized)
+        return;
+    if(_mode == PWDispatchCompressionModeInflate)
+        inflateEnd(&_stream);
+    else
+        deflateEnd(&_stream);
+    _isStreamInitialized = NO;
+}
+
+- (NSError*)errorWithStatus:(int)status
+{
+    NSString* message = [NSString stringWithFormat:@"%@ failed: %d (%s)",
+                         _mode == PWDispatchCompressionModeInflate ? @"inflate" : @"deflate",
+                         status,
+                         _stream.msg ? _stream.msg : zError(status)];
+    return [self errorWithMessage:message];
+}
+
+- (NSError*)errorWithMessage:(NSString*)message
+{
+    NSParameterAssert(message);
+    return [NSError errorWithDomain:PWErrorDomain
+                               code:PWDispatchIOCompressionError
+                           userInfo:@{NSLocalizedDescriptionKey: message}];
+}
+
+#pragma mark - Operations
+
+- (void)enqueueOperation:(PWDispatchCompressionOperation)operation
+{
+    NSParameterAssert(operation);
+
+    [_queue asynchronouslyDispatchBlock:^{
+        [_pendingOperations addObject:[operation copy]];
+        if(!_isProcessing)
+            [self performNextOperation];
+    }];
+}
+
+- (void)performNextOperation
+{
+    PWAssert(_queue.isCurrentDispatchQueue);
+    PWAssert(!_isProcessing);
+
+    if(_pendingOperations.count == 0)
+    {
+        // An immediate close which happened during an operation leaves releasing the zlib state to us.
+        if(_isClosed && !_isFinished)
+            [self didFinish];
+        return;
+    }
+
+    PWDispatchCompressionOperation operation = _pendingOperations[0];
+    [_pendingOperations removeObjectAtIndex:0];
+    _isProcessing = YES;
+    operation(^{
+        PWAssert(_queue.isCurrentDispatchQueue);
+        _isProcessing = NO;
+        // Continue asynchronously so operations which complete synchronously do not recurse.
+        [_queue asynchronouslyDispatchBlock:^{
+            if(!_isProcessing)
+                [self performNextOperation];
+        }];
+    });
+}
+
+- (nullable NSError*)usabilityError
+{
+    if(_error)
+        return _error;
+    if(_isClosed)
+        return [self errorWithMessage:@"Compression stream has been closed"];
+    if(_isFinished)
+        return [self errorWithMessage:@"Compression stream has already been finished"];
+    return nil;
+}
+
+#pragma mark - Writing
+
+- (void)writeDispatchData:(dispatch_data_t)data
+                    queue:(id<PWDispatchQueueing>)queue
+                  handler:(void (^)(BOOL done, dispatch_data_t _Nullable remainingData, NSError* _Nullable error))handler
+{
+    NSParameterAssert(data);
+    NSParameterAssert(queue);
+    NSParameterAssert(handler);
+
+    [self enqueueOperation:^(PWDispatchBlock operationDone) {
+        NSError* error = self.usabilityError;
+        if(!error && [self ensureStream])
+        {
+            _input       = data;
+            _inputOffset = 0;
+            _totalInputLength += dispatch_data_get_size(data);
+            [self processInputWithCompletion:^(NSError* _Nullable processError) {
+                dispatch_data_t remainingData = nil;
+                if(processError)
+                {
+                    size_t consumedLength = _inputOffset - _stream.avail_in;
+                    remainingData = dispatch_data_create_subrange(data, consumedLength, dispatch_data_get_size(data) - consumedLength);
+                }
+                _input = nil;
+                _mappedInputRegion = nil;
+                _stream.next_in  = Z_NULL;
+                _stream.avail_in = 0;
+                [queue asynchronouslyDispatchBlock:^{
+                    handler(YES, remainingData, processError);
+                }];
+                operationDone();
+            }];
+        }
+        else
+        {
+            error = error ? error : _error;
+            [queue asynchronouslyDispatchBlock:^{
+                handler(YES, data, error);
+            }];
+            operationDone();
+        }
+    }];
+}
+
+- (void)writeData:(NSData*)data
+            queue:(id<PWDispatchQueueing>)queue
+          handler:(void (^)(BOOL done, NSUInteger remainingLength, NSError* _Nullable error))handler
+{
+    NSParameterAssert(data);
+    NSParameterAssert(handler);
+
+    [self writeDispatchData:[data newDispatchData]
+                      queue:queue
+                    handler:^(BOOL done, dispatch_data_t _Nullable remainingData, NSError* _Nullable error) {
+                        handler(done, remainingData ? dispatch_data_get_size(remainingData) : 0, error);
+                    }];
+}
+
+// Makes the next contiguous region of _input available to zlib. Returns NO if the input is exhausted.
+- (BOOL)loadNextInputRegion
+{
+    PWAssert(_queue.isCurrentDispatchQueue);
+    PWAssert(_stream.avail_in == 0);
+
+    if(!_input || _inputOffset >= dispatch_data_get_size(_input))
+        return NO;
+
+    size_t regionOffset;
+    dispatch_data_t region = dispatch_data_copy_region(_input, _inputOffset, &regionOffset);
+    const void* regionBytes;
+    size_t regionSize;
+    // A single region is contiguous, so mapping it does not copy.
+    _mappedInputRegion = dispatch_data_create_map(region, &regionBytes, &regionSize);
+
+    size_t delta  = _inputOffset - regionOffset;
+    size_t length = MIN(regionSize - delta, (size_t)UINT_MAX);
+    _stream.next_in  = (Bytef*)regionBytes + delta;
+    _stream.avail_in = (uInt)length;
+    _inputOffset += length;
+    return YES;
+}
+
+// Runs zlib over _input until it is consumed. Whenever the output buffer is full, it is written to the target stream
+// and processing only continues after the target has accepted it.
+- (void)processInputWithCompletion:(PWDispatchCompressionCompletion)completion
+{
+    PWAssert(_queue.isCurrentDispatchQueue);
+    NSParameterAssert(completion);
+
+    while(YES)
+    {
+        NSError* error = self.usabilityError;
+        if(error)
+        {
+            completion(error);
+            return;
+        }
+
+        if(_stream.avail_in == 0 && ![self loadNextInputRegion])
+            break;
+
+        if(_didReachStreamEnd)
+        {
+            // Concatenated gzip members are inflated one after the other, anything else behind the end is ignored.
+            if(_format != PWDispatchCompressionFormatGzip && _format != PWDispatchCompressionFormatAutomatic)
+            {
+                _stream.avail_in = 0;
+                _inputOffset = dispatch_data_get_size(_input);
+                break;
+            }
+            inflateReset(&_stream);
+            _didReachStreamEnd = NO;
+        }
+
+        uInt availableInBefore  = _stream.avail_in;
+        uInt availableOutBefore = _stream.avail_out;
+        int status = _mode == PWDispatchCompressionModeInflate ? inflate(&_stream, Z_NO_FLUSH) : deflate(&_stream, Z_NO_FLUSH);
+        if(status == Z_STREAM_END)
+            _didReachStreamEnd = YES;
+        else if(status == Z_BUF_ERROR && _stream.avail_out > 0 && _stream.avail_in > 0
+                && availableInBefore == _stream.avail_in && availableOutBefore == _stream.avail_out)
+        {
+            // No progress despite input and output space should never happen, but must not end up in a busy loop.
+            _error = [self errorWithStatus:status];
+        }
+        else if(status != Z_OK && status != Z_BUF_ERROR)
+            _error = [self errorWithStatus:status];
+
+        if(!_error && _stream.avail_out == 0)
+        {
+            [self writeOutputWithCompletion:^(NSError* _Nullable writeError) {
+                if(writeError)
+                    completion(writeError);
+                else
+                    [self processInputWithCompletion:completion];
+            }];
+            return;
+        }
+    }
+    completion(nil);
+}
+
+// Passes the filled part of the output buffer to the target stream and installs a fresh buffer.
+- (void)writeOutputWithCompletion:(PWDispatchCompressionCompletion)completion
+{
+    PWAssert(_queue.isCurrentDispatchQueue);
+    NSParameterAssert(completion);
+
+    size_t length = _bufferLength - _stream.avail_out;
+    if(length == 0)
+    {
+        completion(nil);
+        return;
+    }
+
+    // The target owns the filled buffer from now on. Only one output chunk is in flight at any time.
+    dispatch_data_t output = dispatch_data_create(_outputBuffer, length, NULL, DISPATCH_DATA_DESTRUCTOR_FREE);
+    _outputBuffer = malloc(_bufferLength);
+    _stream.next_out  = _outputBuffer;
+    _stream.avail_out = (uInt)_bufferLength;
+    _totalOutputLength += length;
+
+    // An immediate close completes the write through _outputCompletion, so the target may never call back.
+    __block BOOL didComplete = NO;
+    _outputCompletion = ^(NSError* _Nullable error) {
+        if(didComplete)
+            return;
+        didComplete = YES;
+        PWDispatchCompressionCompletion writeCompletion = completion;
+        _outputCompletion = nil;
+        writeCompletion(error);
+    };
+    PWDispatchCompressionCompletion outputCompletion = _outputCompletion;
+    [_targetStream writeDispatchData:output
+                               queue:_queue
+                             handler:^(BOOL done, dispatch_data_t _Nullable remainingData, NSError* _Nullable error) {
+                                 if(didComplete)
+                                     return;
+                                 if(error)
+                                 {
+                                     _error = error;
+                                     outputCompletion(error);
+                                 }
+                                 else if(done)
+                                     outputCompletion(nil);
+                             }];
+}
+
+#pragma mark - Finishing
+
+- (void)finishWithQueue:(id<PWDispatchQueueing>)queue
+      completionHandler:(nullable void (^)(NSError* _Nullable error))completionHandler
+{
+    NSParameterAssert(queue);
+
+    [self enqueueOperation:^(PWDispatchBlock operationDone) {
+        [self finishWithCompletion:^(NSError* _Nullable error) {
+            if(completionHandler)
+                [queue asynchronouslyDispatchBlock:^{
+                    completionHandler(error);
+                }];
+            operationDone();
+        }];
+    }];
+}
+
+- (void)finishWithCompletion:(PWDispatchCompressionCompletion)completion
+{
+    PWAssert(_queue.isCurrentDispatchQueue);
+    NSParameterAssert(completion);
+
+    NSError* error = self.usabilityError;
+    if(error || ![self ensureStream])
+    {
+        completion(error ? error : _error);
+        return;
+    }
+
+    if(_mode == PWDispatchCompressionModeDeflate)
+        [self flushDeflateWithCompletion:completion];
+    else
+    {
+        [self writeOutputWithCompletion:^(NSError* _Nullable writeError) {
+            NSError* finishError = writeError;
+            if(!finishError && !_didReachStreamEnd && _totalInputLength > 0)
+                finishError = _error = [self errorWithMessage:@"Compressed stream ended prematurely"];
+            [self didFinish];
+            completion(finishError);
+        }];
+    }
+}
+
+- (void)flushDeflateWithCompletion:(PWDispatchCompressionCompletion)completion
+{
+    PWAssert(_queue.isCurrentDispatchQueue);
+    NSParameterAssert(completion);
+
+    int status = deflate(&_stream, Z_FINISH);
+    if(status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR)
+    {
+        _error = [self errorWithStatus:status];
+        [self didFinish];
+        completion(_error);
+        return;
+    }
+
+    [self writeOutputWithCompletion:^(NSError* _Nullable writeError) {
+        if(writeError || status == Z_STREAM_END)
+        {
+            [self didFinish];
+            completion(writeError);
+        }
+        else
+            [self flushDeflateWithCompletion:completion];
+    }];
+}
+
+- (void)didFinish
+{
+    PWAssert(_queue.isCurrentDispatchQueue);
+
+    [self endStream];
+    _isFinished = YES;
+    free(_outputBuffer);
+    _outputBuffer = NULL;
+}
+
+#pragma mark - Closing
+
+- (void)closeImmediately:(BOOL)immediately
+{
+    if(immediately)
+    {
+        // Bypasses pending operations. They are answered with done == YES and an error once they get their turn.
+        [_queue asynchronouslyDispatchBlock:^{
+            [self closeTargetImmediately:YES];
+        }];
+    }
+    else
+    {
+        [self enqueueOperation:^(PWDispatchBlock operationDone) {
+            if(_isClosed)
+            {
+                operationDone();
+                return;
+            }
+            PWDispatchCompressionCompletion close = ^(NSError* _Nullable error) {
+                [self closeTargetImmediately:NO];
+                operationDone();
+            };
+            if(_isFinished || _error)
+                close(nil);
+            else
+                [self finishWithCompletion:close];
+        }];
+    }
+}
+
+- (void)closeTargetImmediately:(BOOL)immediately
+{
+    PWAssert(_queue.isCurrentDispatchQueue);
+
+    if(_isClosed)
+        return;
+    [self willChangeValueForKey:@"isOpen"];
+    _isClosed = YES;
+    [self didChangeValueForKey:@"isOpen"];
+    [_targetStream closeImmediately:immediately];
+    PWDispatchCompressionCompletion outputCompletion = _outputCompletion;
+    if(immediately && outputCompletion)
+    {
+        // Abandons the chunk in flight, so the current operation completes and the pending ones get their turn.
+        outputCompletion(self.usabilityError);
+    }
+    if(!_isProcessing)
+        [self didFinish];
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
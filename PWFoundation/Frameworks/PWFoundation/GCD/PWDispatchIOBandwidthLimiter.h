@@ -0,0 +1,56 @@
+//
+//  PWDispatchIOBandwidthLimiter.h
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import <PWFoundation/PWDispatchObject.h>    // for PWDispatchBlock
+
+NS_ASSUME_NONNULL_BEGIN
+
+@protocol PWDispatchQueueing;
+
+// A token bucket which limits the bandwidth of IO channels, see -[PWDispatchIOChannel bandwidthLimiter].
+//
+// The bucket fills with 'rate' bytes per second up to 'burstSize' bytes. A request is granted as soon as the bucket
+// contains its length, or is full for requests larger than the burst size, which then take the bucket into debt.
+// Requests are granted in the order they were made. Waiting requests are rescheduled by a timer, no thread is blocked.
+//
+// Limiters can be nested: a request granted by a limiter is passed on to its parent, so a channel can have a budget of
+// its own and share the budget of a group of channels at the same time.
+//
+// The bucket is accounted by the uptime clock and starts full.
+@interface PWDispatchIOBandwidthLimiter : NSObject
+
+- (instancetype) init NS_UNAVAILABLE;
+
+- (instancetype) initWithRate:(NSUInteger)rate                  // in bytes/s, 0 means unlimited
+                    burstSize:(NSUInteger)burstSize             // in bytes, > 0
+                       parent:(nullable PWDispatchIOBandwidthLimiter*)parent NS_DESIGNATED_INITIALIZER;
+
+- (instancetype) initWithRate:(NSUInteger)rate burstSize:(NSUInteger)burstSize;
+
+// Can be changed at any time. Waiting requests are rescheduled for the new rate.
+@property (atomic, readwrite)                       NSUInteger                      rate;
+@property (nonatomic, readonly)                     NSUInteger                      burstSize;
+@property (nonatomic, readonly, strong, nullable)   PWDispatchIOBandwidthLimiter*   parent;
+
+// Asynchronously calls 'handler' on 'queue' when 'length' bytes have been granted by the receiver and its parents.
+- (void) acquireLength:(NSUInteger)length
+                 queue:(id<PWDispatchQueueing>)queue
+               handler:(PWDispatchBlock)handler;
+
+// Gives back bytes which have been acquired but not transferred, like the unused part of a read which hit EOF.
+- (void) returnUnusedLength:(NSUInteger)length;
+
+// The total number of bytes granted minus the returned ones.
+@property (atomic, readonly)                        unsigned long long              grantedLength;
+
+// The number of requests waiting for the receiver.
+@property (atomic, readonly)                        NSUInteger                      waitingRequestCount;
+
+@end
+
+NS_ASSUME_NONNULL_END
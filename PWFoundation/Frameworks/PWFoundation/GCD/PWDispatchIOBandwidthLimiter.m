@@ -0,0 +1,198 @@
+//
+//  PWDispatchIOBandwidthLimiter.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import "PWDispatchIOBandwidthLimiter.h"
+#import "PWDispatch.h"
+#import <time.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface PWDispatchIOBandwidthRequest : NSObject
+{
+@public
+    NSUInteger                  _length;
+    id<PWDispatchQueueing>      _queue;
+    PWDispatchBlock             _handler;
+}
+@end
+
+@implementation PWDispatchIOBandwidthRequest
+@end
+
+#pragma mark
+
+@implementation PWDispatchIOBandwidthLimiter
+{
+    PWDispatchQueue*                                _internalQueue;
+    NSMutableArray<PWDispatchIOBandwidthRequest*>*  _waitingRequests;
+    PWDispatchTimer* _Nullable                      _timer;
+    double                                          _tokens;            // in bytes, negative while in debt
+    uint64_t                                        _lastRefillTime;    // uptime in nanoseconds
+}
+
+@synthesize rate = _rate;
+@synthesize grantedLength = _grantedLength;
+
+- (instancetype) initWithRate:(NSUInteger)rate
+                    burstSize:(NSUInteger)burstSize
+                       parent:(nullable PWDispatchIOBandwidthLimiter*)parent
+{
+    NSParameterAssert (burstSize > 0);
+
+    if ((self = [super init]) != nil)
+    {
+        _rate            = rate;
+        _burstSize       = burstSize;
+        _parent          = parent;
+        _tokens          = (double)burstSize;
+        _lastRefillTime  = clock_gettime_nsec_np (CLOCK_UPTIME_RAW);
+        _internalQueue   = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWDispatchIOBandwidthLimiter"];
+        _waitingRequests = [[NSMutableArray alloc] init];
+    }
+    return self;
+}
+
+- (instancetype) initWithRate:(NSUInteger)rate burstSize:(NSUInteger)burstSize
+{
+    return [self initWithRate:rate burstSize:burstSize parent:nil];
+}
+
+- (void) dealloc
+{
+    [_timer cancel];
+}
+
+- (NSUInteger) rate
+{
+    __block NSUInteger rate;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        rate = _rate;
+    }];
+    return rate;
+}
+
+- (void) setRate:(NSUInteger)rate
+{
+    [_internalQueue synchronouslyDispatchBlock:^{
+        // Tokens accumulated so far are accounted with the old rate.
+        [self refill];
+        _rate = rate;
+        [self grantWaitingRequests];
+    }];
+}
+
+- (unsigned long long) grantedLength
+{
+    __block unsigned long long length;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        length = _grantedLength;
+    }];
+    return length;
+}
+
+- (NSUInteger) waitingRequestCount
+{
+    __block NSUInteger count;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        count = _waitingRequests.count;
+    }];
+    return count;
+}
+
+- (void) acquireLength:(NSUInteger)length
+                 queue:(id<PWDispatchQueueing>)queue
+               handler:(PWDispatchBlock)handler
+{
+    NSParameterAssert (queue);
+    NSParameterAssert (handler);
+
+    PWDispatchIOBandwidthRequest* request = [[PWDispatchIOBandwidthRequest alloc] init];
+    request->_length  = length;
+    request->_queue   = queue;
+    request->_handler = handler;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        [_waitingRequests addObject:request];
+        [self grantWaitingRequests];
+    }];
+}
+
+- (void) returnUnusedLength:(NSUInteger)length
+{
+    if (length == 0)
+        return;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        [self refill];
+        _tokens = MIN (_tokens + (double)length, (double)_burstSize);
+        _grantedLength -= MIN (_grantedLength, (unsigned long long)length);
+        [self grantWaitingRequests];
+    }];
+    [_parent returnUnusedLength:length];
+}
+
+- (void) refill
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    uint64_t now = clock_gettime_nsec_np (CLOCK_UPTIME_RAW);
+    _tokens = MIN (_tokens + (double)(now - _lastRefillTime) * (double)_rate / (double)NSEC_PER_SEC, (double)_burstSize);
+    _lastRefillTime = now;
+}
+
+- (void) grantWaitingRequests
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    [self refill];
+    while (_waitingRequests.count > 0)
+    {
+        PWDispatchIOBandwidthRequest* request = _waitingRequests[0];
+        if (_rate > 0)
+        {
+            double requiredTokens = (double)MIN (request->_length, _burstSize);
+            if (_tokens < requiredTokens)
+            {
+                [self scheduleTimerWithInterval:(requiredTokens - _tokens) / (double)_rate];
+                return;
+            }
+            _tokens -= (double)request->_length;
+        }
+        [_waitingRequests removeObjectAtIndex:0];
+        _grantedLength += request->_length;
+
+        // Parents are asked in grant order, which keeps the order of requests through all levels.
+        if (_parent)
+            [_parent acquireLength:request->_length queue:request->_queue handler:request->_handler];
+        else
+            [request->_queue asynchronouslyDispatchBlock:request->_handler];
+    }
+}
+
+- (void) scheduleTimerWithInterval:(NSTimeInterval)interval
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    // A late timer only delays the grant, the tokens are accounted by the clock.
+    NSTimeInterval leeway = MIN (interval * 0.1, 0.005);
+    if (!_timer)
+    {
+        __weak PWDispatchIOBandwidthLimiter* weakSelf = self;
+        _timer = [PWDispatchTimer enabledSingleShotTimerWithQueue:_internalQueue
+                                              fireIntervalFromNow:interval
+                                                           leeway:leeway
+                                                      useWallTime:NO
+                                                       eventBlock:^{
+                                                           [weakSelf grantWaitingRequests];
+                                                       }];
+    }
+    else
+        [_timer setFireIntervalFromNow:interval leeway:leeway useWallTime:NO];
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
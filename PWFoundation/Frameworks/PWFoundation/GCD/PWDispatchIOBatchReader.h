@@ -0,0 +1,64 @@
+//
+//  PWDispatchIOBatchReader.h
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import <Foundation/Foundation.h>
+#import <dispatch/dispatch.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@protocol PWDispatchQueueing;
+@protocol PWRandomAccessInput;
+
+// Called once per requested range. 'data' is a subrange of a larger read, no bytes are copied. It is shorter than the
+// requested range if the range extends beyond EOF.
+typedef void (^PWDispatchIOBatchRangeHandler)(NSUInteger rangeIndex, dispatch_data_t data);
+
+// Reads many small ranges of a random or mapped channel with few large reads, for example the records of an index.
+//
+// The ranges of a batch are sorted, and ranges which overlap or are at most 'maximumGap' bytes apart are merged into one
+// read. At most 'maxConcurrentReads' reads are in flight at any time.
+//
+// With a 'readaheadLength' > 0, a batch which continues where the previous batch ended is considered sequential. Its
+// last read is extended by 'readaheadLength' bytes and kept in a buffer, from which ranges of following batches are
+// served without reading. The reader does not notice writes to the channel, so readahead must only be used for files
+// which do not change while they are read.
+@interface PWDispatchIOBatchReader : NSObject
+
+- (instancetype) init NS_UNAVAILABLE;
+
+- (instancetype) initWithChannel:(id<PWRandomAccessInput>)channel
+                      maximumGap:(NSUInteger)maximumGap                 // in bytes
+              maxConcurrentReads:(NSUInteger)maxConcurrentReads         // > 0
+                 readaheadLength:(NSUInteger)readaheadLength            // in bytes, 0 disables readahead
+    NS_DESIGNATED_INITIALIZER;
+
+// Uses a maximum gap of 4 KiB, 4 concurrent reads and no readahead.
+- (instancetype) initWithChannel:(id<PWRandomAccessInput>)channel;
+
+@property (nonatomic, readonly, strong) id<PWRandomAccessInput>     channel;
+@property (nonatomic, readonly)         NSUInteger                  maximumGap;
+@property (nonatomic, readonly)         NSUInteger                  maxConcurrentReads;
+@property (nonatomic, readonly)         NSUInteger                  readaheadLength;
+
+// Reads the given ranges, which may be unsorted and overlapping. The range handler is called on 'queue' for every range
+// of a successful read, the completion handler afterwards, with the first error if a read failed. The ranges of a
+// failed read are not reported.
+- (void) readRanges:(NSArray<NSValue*>*)ranges                          // NSRange values
+              queue:(id<PWDispatchQueueing>)queue
+       rangeHandler:(PWDispatchIOBatchRangeHandler)rangeHandler
+  completionHandler:(void (^)(NSError* _Nullable errorOrNil))completionHandler;
+
+// The number of reads issued to the channel.
+@property (atomic, readonly)            NSUInteger                  issuedReadCount;
+
+// The number of ranges served from the readahead buffer.
+@property (atomic, readonly)            NSUInteger                  readaheadHitCount;
+
+@end
+
+NS_ASSUME_NONNULL_END
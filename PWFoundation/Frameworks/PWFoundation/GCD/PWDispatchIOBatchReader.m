@@ -0,0 +1,329 @@
+//
+//  PWDispatchIOBatchReader.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import "PWDispatchIOBatchReader.h"
+#import "PWDispatch.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class PWDispatchIOBatchSpan;
+
+// The state of one -readRanges:… call.
+@interface PWDispatchIOBatch : NSObject
+{
+@public
+    NSArray<NSValue*>*                      _ranges;
+    id<PWDispatchQueueing>                  _queue;
+    PWDispatchIOBatchRangeHandler           _rangeHandler;
+    void (^_completionHandler)(NSError* _Nullable errorOrNil);
+    PWDispatchGroup*                        _deliveryGroup;         // entered for every pending call of _rangeHandler
+    NSUInteger                              _pendingSpanCount;      // waiting or being read
+    NSError* _Nullable                      _error;
+}
+@end
+
+@implementation PWDispatchIOBatch
+@end
+
+// A merged read which covers one or more ranges of a batch.
+@interface PWDispatchIOBatchSpan : NSObject
+{
+@public
+    PWDispatchIOBatch*                      _batch;
+    NSUInteger                              _offset;
+    NSUInteger                              _length;
+    NSMutableArray<NSNumber*>*              _rangeIndexes;
+    BOOL                                    _keepsReadahead;
+}
+@end
+
+@implementation PWDispatchIOBatchSpan
+@end
+
+#pragma mark
+
+@implementation PWDispatchIOBatchReader
+{
+    PWDispatchQueue*                        _internalQueue;
+    NSMutableArray<PWDispatchIOBatchSpan*>* _waitingSpans;          // of all batches, in the order of the batches
+    NSUInteger                              _activeReadCount;
+
+    NSUInteger                              _previousBatchStart;    // NSNotFound before the first batch
+    NSUInteger                              _previousBatchEnd;
+    dispatch_data_t _Nullable               _readaheadData;
+    NSUInteger                              _readaheadOffset;
+}
+
+@synthesize issuedReadCount = _issuedReadCount;
+@synthesize readaheadHitCount = _readaheadHitCount;
+
+- (instancetype) initWithChannel:(id<PWRandomAccessInput>)channel
+                      maximumGap:(NSUInteger)maximumGap
+              maxConcurrentReads:(NSUInteger)maxConcurrentReads
+                 readaheadLength:(NSUInteger)readaheadLength
+{
+    NSParameterAssert (channel);
+    NSParameterAssert (maxConcurrentReads > 0);
+
+    if ((self = [super init]) != nil)
+    {
+        _channel            = channel;
+        _maximumGap         = maximumGap;
+        _maxConcurrentReads = maxConcurrentReads;
+        _readaheadLength    = readaheadLength;
+        _internalQueue      = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWDispatchIOBatchReader"];
+        _waitingSpans       = [[NSMutableArray alloc] init];
+        _previousBatchStart = NSNotFound;
+    }
+    return self;
+}
+
+- (instancetype) initWithChannel:(id<PWRandomAccessInput>)channel
+{
+    return [self initWithChannel:channel maximumGap:4096 maxConcurrentReads:4 readaheadLength:0];
+}
+
+- (NSUInteger) issuedReadCount
+{
+    __block NSUInteger count;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        count = _issuedReadCount;
+    }];
+    return count;
+}
+
+- (NSUInteger) readaheadHitCount
+{
+    __block NSUInteger count;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        count = _readaheadHitCount;
+    }];
+    return count;
+}
+
+- (void) readRanges:(NSArray<NSValue*>*)ranges
+              queue:(id<PWDispatchQueueing>)queue
+       rangeHandler:(PWDispatchIOBatchRangeHandler)rangeHandler
+  completionHandler:(void (^)(NSError* _Nullable errorOrNil))completionHandler
+{
+    NSParameterAssert (ranges);
+    NSParameterAssert (queue);
+    NSParameterAssert (rangeHandler);
+    NSParameterAssert (completionHandler);
+
+    PWDispatchIOBatch* batch = [[PWDispatchIOBatch alloc] init];
+    batch->_ranges            = [ranges copy];
+    batch->_queue             = queue;
+    batch->_rangeHandler      = rangeHandler;
+    batch->_completionHandler = completionHandler;
+    batch->_deliveryGroup     = [[PWDispatchGroup alloc] init];
+    [_internalQueue synchronouslyDispatchBlock:^{
+        [self startBatch:batch];
+    }];
+}
+
+- (void) startBatch:(PWDispatchIOBatch*)batch
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    NSArray<NSValue*>* ranges = batch->_ranges;
+    NSMutableArray<NSNumber*>* order = [NSMutableArray arrayWithCapacity:ranges.count];
+    NSUInteger batchStart = NSNotFound;
+    NSUInteger batchEnd   = 0;
+    for (NSUInteger index = 0; index < ranges.count; index++)
+    {
+        NSRange range = ranges[index].rangeValue;
+        batchStart = MIN (batchStart, range.location);
+        batchEnd   = MAX (batchEnd, NSMaxRange (range));
+        [order addObject:@(index)];
+    }
+    [order sortUsingComparator:^NSComparisonResult(NSNumber* first, NSNumber* second) {
+        NSUInteger firstLocation  = ranges[first.unsignedIntegerValue].rangeValue.location;
+        NSUInteger secondLocation = ranges[second.unsignedIntegerValue].rangeValue.location;
+        return firstLocation < secondLocation ? NSOrderedAscending : (firstLocation > secondLocation ? NSOrderedDescending : NSOrderedSame);
+    }];
+
+    BOOL isSequential = NO;
+    if (ranges.count > 0)
+    {
+        isSequential = _readaheadLength > 0
+                    && _previousBatchStart != NSNotFound
+                    && batchStart >= _previousBatchStart
+                    && batchStart <= _previousBatchEnd + _maximumGap;
+        _previousBatchStart = batchStart;
+        _previousBatchEnd   = batchEnd;
+    }
+
+    // Ranges in the readahead buffer are served right away, the others are merged into spans.
+    size_t readaheadSize = _readaheadData ? dispatch_data_get_size (_readaheadData) : 0;
+    NSMutableArray<NSNumber*>* servedIndexes = [NSMutableArray array];
+    NSMutableArray* servedSlices = [NSMutableArray array];
+    NSMutableArray<PWDispatchIOBatchSpan*>* spans = [NSMutableArray array];
+    PWDispatchIOBatchSpan* span;
+    for (NSNumber* index in order)
+    {
+        NSRange range = ranges[index.unsignedIntegerValue].rangeValue;
+        if (range.length == 0)
+        {
+            [servedIndexes addObject:index];
+            [servedSlices addObject:dispatch_data_empty];
+        }
+        else if (readaheadSize > 0 && range.location >= _readaheadOffset && NSMaxRange (range) <= _readaheadOffset + readaheadSize)
+        {
+            [servedIndexes addObject:index];
+            [servedSlices addObject:dispatch_data_create_subrange (_readaheadData, range.location - _readaheadOffset, range.length)];
+            _readaheadHitCount++;
+        }
+        else if (span && range.location <= span->_offset + span->_length + _maximumGap)
+        {
+            span->_length = MAX (span->_offset + span->_length, NSMaxRange (range)) - span->_offset;
+            [span->_rangeIndexes addObject:index];
+        }
+        else
+        {
+            span = [[PWDispatchIOBatchSpan alloc] init];
+            span->_batch        = batch;
+            span->_offset       = range.location;
+            span->_length       = range.length;
+            span->_rangeIndexes = [NSMutableArray arrayWithObject:index];
+            [spans addObject:span];
+        }
+    }
+    if (servedIndexes.count > 0)
+        [self deliverSlices:servedSlices forRangeIndexes:servedIndexes ofBatch:batch];
+
+    if (isSequential && spans.count > 0)
+    {
+        PWDispatchIOBatchSpan* lastSpan = spans.lastObject;
+        lastSpan->_length += _readaheadLength;
+        lastSpan->_keepsReadahead = YES;
+    }
+
+    batch->_pendingSpanCount = spans.count;
+    if (spans.count == 0)
+        [self finishBatch:batch];
+    else
+    {
+        [_waitingSpans addObjectsFromArray:spans];
+        [self startReads];
+    }
+}
+
+- (void) startReads
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    while (_activeReadCount < _maxConcurrentReads && _waitingSpans.count > 0)
+    {
+        PWDispatchIOBatchSpan* span = _waitingSpans[0];
+        [_waitingSpans removeObjectAtIndex:0];
+
+        // The remaining spans of a failed batch are not read.
+        if (span->_batch->_error)
+        {
+            if (--span->_batch->_pendingSpanCount == 0)
+                [self finishBatch:span->_batch];
+            continue;
+        }
+        _activeReadCount++;
+        _issuedReadCount++;
+        [self readSpan:span];
+    }
+}
+
+- (void) readSpan:(PWDispatchIOBatchSpan*)span
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    __block dispatch_data_t spanData = dispatch_data_empty;
+    __block NSError* spanError;
+    [_channel readDispatchDataStartingFromOffset:span->_offset
+                                          length:span->_length
+                                           queue:_internalQueue
+                                         handler:^(BOOL done, dispatch_data_t data, NSError* errorOrNil)
+     {
+         if (data && dispatch_data_get_size (data) > 0)
+             spanData = dispatch_data_create_concat (spanData, data);
+         if (errorOrNil && !spanError)
+             spanError = errorOrNil;
+         if (done)
+             [self didReadSpan:span data:spanData error:spanError];
+     }];
+}
+
+- (void) didReadSpan:(PWDispatchIOBatchSpan*)span data:(dispatch_data_t)data error:(nullable NSError*)error
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    _activeReadCount--;
+    PWDispatchIOBatch* batch = span->_batch;
+    if (error)
+    {
+        if (!batch->_error)
+            batch->_error = error;
+    }
+    else
+    {
+        // Slices are shortened at EOF.
+        size_t size = dispatch_data_get_size (data);
+        NSMutableArray* slices = [NSMutableArray arrayWithCapacity:span->_rangeIndexes.count];
+        for (NSNumber* index in span->_rangeIndexes)
+        {
+            NSRange range = batch->_ranges[index.unsignedIntegerValue].rangeValue;
+            size_t sliceOffset = MIN (range.location - span->_offset, size);
+            size_t sliceLength = MIN (range.length, size - sliceOffset);
+            [slices addObject:dispatch_data_create_subrange (data, sliceOffset, sliceLength)];
+        }
+        [self deliverSlices:slices forRangeIndexes:span->_rangeIndexes ofBatch:batch];
+
+        if (span->_keepsReadahead)
+        {
+            _readaheadData   = data;
+            _readaheadOffset = span->_offset;
+        }
+    }
+
+    if (--batch->_pendingSpanCount == 0)
+        [self finishBatch:batch];
+    [self startReads];
+}
+
+- (void) deliverSlices:(NSArray*)slices forRangeIndexes:(NSArray<NSNumber*>*)rangeIndexes ofBatch:(PWDispatchIOBatch*)batch
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+    PWAssert (slices.count == rangeIndexes.count);
+
+    PWDispatchIOBatchRangeHandler rangeHandler = batch->_rangeHandler;
+    PWDispatchGroup* deliveryGroup = batch->_deliveryGroup;
+    [deliveryGroup enter];
+    [batch->_queue asynchronouslyDispatchBlock:^{
+        [rangeIndexes enumerateObjectsUsingBlock:^(NSNumber* index, NSUInteger position, BOOL* stop) {
+            rangeHandler (index.unsignedIntegerValue, slices[position]);
+        }];
+        [deliveryGroup leave];
+    }];
+}
+
+- (void) finishBatch:(PWDispatchIOBatch*)batch
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    // The completion handler waits for the range handlers, which matters for concurrent queues.
+    id<PWDispatchQueueing> queue = batch->_queue;
+    void (^completionHandler)(NSError* _Nullable) = batch->_completionHandler;
+    NSError* error = batch->_error;
+    dispatch_group_notify (batch->_deliveryGroup.underlyingGroup, queue.dispatchQueueForNativeAPIs.underlyingQueue, ^{
+        PWDispatchCallBlockFromNativeAPI (queue, ^{
+            completionHandler (error);
+        });
+    });
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -12,6 +12,7 @@ NS_ASSUME_NONNULL_BEGIN
 
 @protocol PWDispatchQueueing;
 @class PWDispatchIOChannel;
+@class PWDispatchIOBandwidthLimiter;
 
 typedef void(^PWDispatchIOCleanupHandler)(PWDispatchIOChannel* blockChannel, NSError* _Nullable errorOrNil);
 
@@ -46,10 +47,13 @@ typedef void(^PWDispatchIOCleanupHandler)(PWDispatchIOChannel* blockChannel, NSE
 
 - (void)dispatchBarrierBlock:(PWDispatchBlock)block;
 
-#ifndef NDEBUG
-// If set, slows down the performance of sending and receiving data. Only for testing purposes
+// If set, reads and writes are split into packets of at most the burst size of the limiter and each packet is started
+// when the limiter granted its length. Channels sharing a limiter share its bandwidth.
+// Should be set before the first read or write. Note: Concurrent reads of a throttled stream channel are not supported.
+@property (nonatomic, readwrite, strong, nullable)  PWDispatchIOBandwidthLimiter*   bandwidthLimiter;
+
+// Convenience for setting a bandwidth limiter of its own with a burst size of a quarter second.
 @property (nonatomic, readwrite)                    NSUInteger          throttleRate;           // in bytes/s, 0 means no throttling
-#endif
 
 @end
 
@@ -8,10 +8,10 @@
 
 #import "PWDispatchIOChannel.h"
 #import "PWDispatchQueue.h"
+#import "PWDispatchIOBandwidthLimiter.h"
 #import "PWDispatchObject-Internal.h"
 #import "PWErrors.h"
 #import "NSData-PWDispatchExtensions.h"
-#import "NSArray-PWExtensions.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -22,13 +22,7 @@ typedef void(^PWDispatchIONativeCleanupHandler)(int errorCode);
     PWDispatchQueue*                    _handleDispatchQueue;        // Protects the _fileHandle ivar for channels created via via
                                                                      // -initWithType:URL:openFlags:creationMode:queue:cleaupHandler
     BOOL                                _hasCleanedUp;
-#ifndef NDEBUG
-    NSDate*                             _lastReadThrottleDate;
-    NSDate*                             _lastWriteThrottleDate;
-    PWDispatchQueue*                    _throttleWriteDispatchQueue;
-    NSMutableArray<PWDispatchBlock>*    _throttleWriteQueue;
-    BOOL                                _isThrottleWriting;
-#endif
+    PWDispatchQueue* _Nullable          _throttleQueue;              // Receives the grants of the bandwidth limiter
 }
 
 - (dispatch_io_type_t)dispatchIOType
@@ -54,10 +48,6 @@ typedef void(^PWDispatchIONativeCleanupHandler)(int errorCode);
                                                   });
     if (!newChannel)
         return nil;
-#ifndef NDEBUG
-    _throttleWriteDispatchQueue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWDispatchIOChannel_throttle"];
-    _throttleWriteQueue = [[NSMutableArray alloc] init];
-#endif
     if ((self = [super initWithUnderlyingObject:newChannel]) != nil)
     {
         _fileHandle = fileHandle;
@@ -188,35 +178,26 @@ typedef void(^PWDispatchIONativeCleanupHandler)(int errorCode);
     dispatch_io_set_high_water((dispatch_io_t)impl_, value);
 }
 
-#ifndef NDEBUG
+@synthesize bandwidthLimiter = _bandwidthLimiter;
 
-- (void)setThrottleRate:(NSUInteger)throttleRate
+- (void)setBandwidthLimiter:(nullable PWDispatchIOBandwidthLimiter*)bandwidthLimiter
 {
-    _throttleRate = throttleRate;
-    if(throttleRate > 0)
-        self.highWater = throttleRate / 4;
+    if(bandwidthLimiter && !_throttleQueue)
+        _throttleQueue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWDispatchIOChannel_throttle"];
+    _bandwidthLimiter = bandwidthLimiter;
 }
 
-- (void)throttleAfterPacketWithSize:(NSInteger)packetSize isWrite:(BOOL)isWrite
+- (NSUInteger)throttleRate
 {
-    if(_throttleRate > 0 && packetSize > 0)
-    {
-        NSDate* date = isWrite ? _lastWriteThrottleDate : _lastReadThrottleDate;
-        if(date)
-        {
-            NSTimeInterval requiredInterval = (double)packetSize / (double)_throttleRate;
-            NSTimeInterval actualInterval = -date.timeIntervalSinceNow;
-            if(actualInterval < requiredInterval)
-                [NSThread sleepForTimeInterval:requiredInterval-actualInterval];
-        }
-        if(isWrite)
-            _lastWriteThrottleDate = [NSDate date];
-        else
-            _lastReadThrottleDate = [NSDate date];
-    }
+    return _bandwidthLimiter.rate;
 }
 
-#endif
+- (void)setThrottleRate:(NSUInteger)throttleRate
+{
+    self.bandwidthLimiter = throttleRate > 0 ? [[PWDispatchIOBandwidthLimiter alloc] initWithRate:throttleRate
+                                                                                        burstSize:MAX(throttleRate / 4, 1)]
+                                             : nil;
+}
 
 - (void)closeImmediately:(BOOL)immediately // If immediately==NO, all pending actions are completed
 {
@@ -252,16 +233,19 @@ typedef void(^PWDispatchIONativeCleanupHandler)(int errorCode);
     NSParameterAssert(handler);
     NSParameterAssert(queue);
 
+    PWDispatchIOBandwidthLimiter* limiter = _bandwidthLimiter;
+    if(limiter)
+    {
+        [self throttledReadDispatchDataStartingFromOffset:offset length:length limiter:limiter queue:queue handler:handler];
+        return;
+    }
+
     dispatch_io_read((dispatch_io_t)impl_,
                      offset,
                      (length == NSNotFound ? SIZE_MAX : length),
                      queue.dispatchQueueForNativeAPIs.underlyingQueue,
                      ^(bool done, dispatch_data_t data, int errorCode) {
                          PWDispatchCallBlockFromNativeAPI (queue, ^{
-#ifndef NDEBUG
-                             if(!done)
-                                 [self throttleAfterPacketWithSize: data ? dispatch_data_get_size(data) : 0 isWrite:NO];
-#endif
                              handler (done, data, [self errorFromErrorCode:errorCode]);
                          });
                      });
@@ -276,21 +260,20 @@ typedef void(^PWDispatchIONativeCleanupHandler)(int errorCode);
     NSParameterAssert(queue);
     NSParameterAssert(handler);
 
-#ifndef NDEBUG
-    if(_throttleRate > 0.0)
-        [self throttledWriteData:(NSData*)data startingFromOffset:offset queue:queue handler:^(BOOL done, NSUInteger remainingLength, NSError * _Nullable errorOrNil) {
-            dispatch_data_t remainingData = dispatch_data_create_subrange(data, dispatch_data_get_size(data) - remainingLength, remainingLength);
-            handler(done, remainingData, errorOrNil);
-        }];
-    else
-#endif
+    PWDispatchIOBandwidthLimiter* limiter = _bandwidthLimiter;
+    if(limiter)
+    {
+        [self throttledWriteDispatchData:data startingFromOffset:offset limiter:limiter queue:queue handler:handler];
+        return;
+    }
+
     dispatch_io_write((dispatch_io_t)impl_,
                       offset,
                       data,
                       queue.dispatchQueueForNativeAPIs.underlyingQueue,
                       ^(bool done, dispatch_data_t remainingData, int errorCode) {
                           PWDispatchCallBlockFromNativeAPI (queue, ^{
-                              handler (done, data, [self errorFromErrorCode:errorCode]);
+                              handler (done, remainingData, [self errorFromErrorCode:errorCode]);
                           });
                       });
 }
@@ -303,6 +286,19 @@ typedef void(^PWDispatchIONativeCleanupHandler)(int errorCode);
     NSParameterAssert(handler);
     NSParameterAssert(queue);
 
+    PWDispatchIOBandwidthLimiter* limiter = _bandwidthLimiter;
+    if(limiter)
+    {
+        [self throttledReadDispatchDataStartingFromOffset:offset
+                                                   length:length
+                                                  limiter:limiter
+                                                    queue:queue
+                                                  handler:^(BOOL done, dispatch_data_t _Nullable dispatchData, NSError* _Nullable errorOrNil) {
+                                                      handler (done, dispatchData ? [NSData dataWithDispatchData:dispatchData] : nil, errorOrNil);
+                                                  }];
+        return;
+    }
+
     dispatch_io_read((dispatch_io_t)impl_,
                      offset, 
                      (length == NSNotFound ? SIZE_MAX : length),
@@ -310,9 +306,6 @@ typedef void(^PWDispatchIONativeCleanupHandler)(int errorCode);
                      ^(bool done, dispatch_data_t dispatchData, int errorCode) {
                          NSData* data = dispatchData ? [NSData dataWithDispatchData:dispatchData] : nil;
                          PWDispatchCallBlockFromNativeAPI (queue, ^{
-#ifndef NDEBUG
-                             [self throttleAfterPacketWithSize:data.length isWrite:NO];
-#endif
                              handler (done, data, [self errorFromErrorCode:errorCode]);
                          });
                      });
@@ -327,11 +320,16 @@ startingFromOffset:(NSUInteger)offset
     NSParameterAssert(queue);
     NSParameterAssert(handler);
 
-#ifndef NDEBUG
-    if(_throttleRate > 0.0)
-        [self throttledWriteData:data startingFromOffset:offset queue:queue handler:handler];
+    PWDispatchIOBandwidthLimiter* limiter = _bandwidthLimiter;
+    if(limiter)
+        [self throttledWriteDispatchData:[data newDispatchData]
+                      startingFromOffset:offset
+                                 limiter:limiter
+                                   queue:queue
+                                 handler:^(BOOL done, dispatch_data_t _Nullable remainingData, NSError* _Nullable errorOrNil) {
+                                     handler (done, remainingData ? dispatch_data_get_size(remainingData) : 0, errorOrNil);
+                                 }];
     else
-#endif
         [self doWriteData:data startingFromOffset:offset queue:queue handler:handler];
 }
 
@@ -357,97 +355,134 @@ startingFromOffset:(NSUInteger)offset
                       });
 }
 
-#ifndef NDEBUG
+#pragma mark - Bandwidth limiting
 
-- (void) throttledWriteData:(NSData*)data
-         startingFromOffset:(NSUInteger)offset
-                      queue:(id<PWDispatchQueueing>)queue
-                    handler:(void (^)(BOOL done, NSUInteger remainingLength, NSError* _Nullable errorOrNil))handler
+// Reads one packet after the other. A packet is read when the limiter granted its length, the unused part of a packet
+// which hits EOF is returned to the limiter.
+- (void)throttledReadDispatchDataStartingFromOffset:(NSUInteger)offset
+                                             length:(NSUInteger)length
+                                            limiter:(PWDispatchIOBandwidthLimiter*)limiter
+                                              queue:(id<PWDispatchQueueing>)queue
+                                            handler:(void (^)(BOOL done, dispatch_data_t _Nullable data, NSError* _Nullable errorOrNil))handler
 {
-    NSParameterAssert(data);
+    NSParameterAssert(limiter);
     NSParameterAssert(queue);
     NSParameterAssert(handler);
-    NSParameterAssert(offset == 0);     // Other offsets are currently not supported for throttling
-
-    PWDispatchBlock block = ^{
-        PWAssert(_throttleWriteDispatchQueue.isCurrentDispatchQueue);
-        PWAssert(!_isThrottleWriting);
-        _isThrottleWriting = YES;
-
-       __block NSUInteger totalWrittenLength = 0;
-        NSArray<NSData*>* subdatas = [self.class subdatasFromData:data
-                                                    withBlockSize:_throttleRate / 4
-                                                       fromOffset:offset];
-
-        [subdatas asynchronouslyEnumerateObjectsUsingBlock:^(NSData* subData, PWAsynchronousEnumerationObjectCompletionHandler objectCompletionHandler) {
-            __block NSUInteger blockWrittenLength = 0;
-            __block NSUInteger blockStartTotalWrittenLength = totalWrittenLength;
-
-            [self doWriteData:subData startingFromOffset:offset queue:_throttleWriteDispatchQueue handler:^(BOOL done, NSUInteger remainingLength, NSError * _Nullable errorOrNil) {
-                blockWrittenLength = subData.length - remainingLength;
-                totalWrittenLength = blockStartTotalWrittenLength + blockWrittenLength;
-                [queue asynchronouslyDispatchBlock:^{
-                    handler(done && subData == subdatas.lastObject, data.length - totalWrittenLength, errorOrNil);
-                }];
-
-                if(done)
-                    [self throttleAfterPacketWithSize:subData.length isWrite:YES];
-
-                if(errorOrNil)
-                {
-                    objectCompletionHandler(/* stop */ YES, errorOrNil);
-                    return;
-                }
-
-                if(done)
-                {
-                    objectCompletionHandler(/* stop */ NO, errorOrNil);
-                }
-            }];
-        } completionHandler:^(BOOL didFinish, NSError* _Nullable lastError) {
-            _isThrottleWriting = NO;
-            [self performNextThrottleWrite];
+
+    PWDispatchQueue* throttleQueue = _throttleQueue;
+    size_t packetLength = (length == NSNotFound) ? limiter.burstSize : MIN(length, limiter.burstSize);
+    if(packetLength == 0)
+    {
+        [queue asynchronouslyDispatchBlock:^{
+            handler (YES, dispatch_data_empty, nil);
         }];
-    };
+        return;
+    }
 
-    [_throttleWriteDispatchQueue asynchronouslyDispatchBlock:^{
-        [_throttleWriteQueue addObject:[block copy]];
-        if(!_isThrottleWriting)
-            [self performNextThrottleWrite];
+    [limiter acquireLength:packetLength queue:throttleQueue handler:^{
+        __block size_t readLength = 0;
+        dispatch_io_read((dispatch_io_t)impl_,
+                         offset,
+                         packetLength,
+                         throttleQueue.underlyingQueue,
+                         ^(bool packetDone, dispatch_data_t _Nullable data, int errorCode) {
+                             size_t size = data ? dispatch_data_get_size(data) : 0;
+                             readLength += size;
+                             BOOL isLastPacket = errorCode != 0 || readLength < packetLength
+                                              || (length != NSNotFound && length == packetLength);
+                             BOOL done = packetDone && isLastPacket;
+                             if(packetDone && readLength < packetLength)
+                                 [limiter returnUnusedLength:packetLength - readLength];
+
+                             if(size > 0 || done)
+                             {
+                                 NSError* error = [self errorFromErrorCode:errorCode];
+                                 [queue asynchronouslyDispatchBlock:^{
+                                     handler (done, data, error);
+                                 }];
+                             }
+                             if(packetDone && !isLastPacket)
+                                 [self throttledReadDispatchDataStartingFromOffset:offset + readLength
+                                                                            length:(length == NSNotFound) ? NSNotFound : length - readLength
+                                                                           limiter:limiter
+                                                                             queue:queue
+                                                                           handler:handler];
+                         });
     }];
 }
 
-- (void)performNextThrottleWrite
+// Requests all packets at once. The limiter grants them in order on the serial throttle queue, which therefore starts
+// the writes in order, too.
+- (void) throttledWriteDispatchData:(dispatch_data_t)data
+                 startingFromOffset:(NSUInteger)offset
+                            limiter:(PWDispatchIOBandwidthLimiter*)limiter
+                              queue:(id<PWDispatchQueueing>)queue
+                            handler:(void (^)(BOOL done, dispatch_data_t _Nullable remainingData, NSError* _Nullable errorOrNil))handler
 {
-    PWAssert(_throttleWriteDispatchQueue.isCurrentDispatchQueue);
-    PWAssert(!_isThrottleWriting);
+    NSParameterAssert(data);
+    NSParameterAssert(limiter);
+    NSParameterAssert(queue);
+    NSParameterAssert(handler);
 
-    if(_throttleWriteQueue.count > 0)
+    PWDispatchQueue* throttleQueue = _throttleQueue;
+    size_t length = dispatch_data_get_size(data);
+    size_t packetLength = limiter.burstSize;
+    if(length == 0)
     {
-        PWDispatchBlock block = _throttleWriteQueue[0];
-        [_throttleWriteQueue removeObjectAtIndex:0];
-        block();
+        [queue asynchronouslyDispatchBlock:^{
+            handler (YES, nil, nil);
+        }];
+        return;
     }
-}
 
-#endif
-
-+ (NSArray<NSData*>*)subdatasFromData:(NSData*)data
-                        withBlockSize:(NSUInteger)blockSize
-                           fromOffset:(NSUInteger)offset
-{
-    NSParameterAssert(blockSize > 0);
+    // Only accessed on the throttle queue.
+    __block size_t      writtenLength = 0;
+    __block NSUInteger  pendingPacketCount = (length + packetLength - 1) / packetLength;
+    __block NSError*    firstError;
+
+    void (^finishPacket)(void) = ^{
+        pendingPacketCount--;
+        BOOL done = (pendingPacketCount == 0);
+        NSError* error = firstError;
+        // After an error the remaining packets are skipped and only the final result is reported.
+        if(!done && error)
+            return;
+        dispatch_data_t remainingData = (writtenLength < length) ? dispatch_data_create_subrange(data, writtenLength, length - writtenLength) : nil;
+        [queue asynchronouslyDispatchBlock:^{
+            handler (done, remainingData, error);
+        }];
+    };
 
-    NSMutableArray<NSData*>* subdatas = [NSMutableArray array];
-    NSUInteger length = data.length;
-    while(offset < length)
+    for(size_t packetOffset = 0; packetOffset < length; packetOffset += packetLength)
     {
-        NSData* subdata = [data subdataWithRange:NSMakeRange(offset, MIN(blockSize, length - offset))];
-        [subdatas addObject:subdata];
-        offset += subdata.length;
+        size_t packetSize = MIN(packetLength, length - packetOffset);
+        dispatch_data_t packet = dispatch_data_create_subrange(data, packetOffset, packetSize);
+        [limiter acquireLength:packetSize queue:throttleQueue handler:^{
+            if(firstError)
+            {
+                [limiter returnUnusedLength:packetSize];
+                finishPacket();
+                return;
+            }
+            dispatch_io_write((dispatch_io_t)impl_,
+                              offset + packetOffset,
+                              packet,
+                              throttleQueue.underlyingQueue,
+                              ^(bool packetDone, dispatch_data_t _Nullable remainingPacketData, int errorCode) {
+                                  if(!packetDone)
+                                      return;
+                                  size_t remainingSize = remainingPacketData ? dispatch_data_get_size(remainingPacketData) : 0;
+                                  writtenLength += packetSize - remainingSize;
+                                  if(remainingSize > 0)
+                                      [limiter returnUnusedLength:remainingSize];
+                                  if(errorCode != 0 && !firstError)
+                                      firstError = [self errorFromErrorCode:errorCode];
+                                  finishPacket();
+                              });
+        }];
     }
-    return subdatas;
 }
+
 @end
 
 NS_ASSUME_NONNULL_END
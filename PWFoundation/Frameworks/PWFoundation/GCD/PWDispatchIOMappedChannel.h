@@ -0,0 +1,61 @@
+//
+//  PWDispatchIOMappedChannel.h
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import <PWFoundation/PWDispatchIORandomChannel.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM (PWInteger, PWDispatchIOAccessPattern) {
+    PWDispatchIOAccessPatternNormal,
+    PWDispatchIOAccessPatternSequential,    // aggressive readahead, pages behind the reads are freed early
+    PWDispatchIOAccessPatternRandom         // no readahead
+};
+
+// Reads a file through a memory mapping instead of dispatch_io, for random reads of large read-mostly files.
+//
+// A read neither issues a read system call nor allocates a buffer: the returned dispatch data aliases the mapping and
+// keeps it alive, the pages are faulted in when the data is accessed. The file is mapped as a whole or, for very large
+// files, in windows of 'windowLength' bytes. Up to 16 windows stay mapped.
+//
+// The file length is checked with every read, so a file which grows can be read to its new end and a file which is
+// truncated does not return data beyond its new end. Data returned before a truncation must not be accessed beyond the
+// new end of the file though, this causes SIGBUS like for every mapping.
+@interface PWDispatchIOMappedChannel : NSObject <PWRandomAccessInput>
+
+- (instancetype) init NS_UNAVAILABLE;
+
+- (nullable instancetype) initWithURL:(NSURL*)fileURL
+                         windowLength:(NSUInteger)windowLength                  // 0 maps the file as a whole, otherwise rounded up to the page size
+                        accessPattern:(PWDispatchIOAccessPattern)accessPattern  // passed to madvise for every mapping
+                                error:(NSError**)outError NS_DESIGNATED_INITIALIZER;
+
+- (nullable instancetype) initWithURL:(NSURL*)fileURL error:(NSError**)outError;
+
+@property (nonatomic, readonly, copy)   NSURL*                      URL;
+@property (nonatomic, readonly)         NSUInteger                  windowLength;
+@property (nonatomic, readonly)         PWDispatchIOAccessPattern   accessPattern;
+
+// Calls 'handler' once on 'queue', with done set.
+- (void)readDispatchDataStartingFromOffset:(NSUInteger)offset
+                                    length:(NSUInteger)length                 // NSNotFound means: read until EOF
+                                     queue:(id<PWDispatchQueueing>)queue
+                                   handler:(void (^)(BOOL done, dispatch_data_t data, NSError* errorOrNil))handler;
+
+- (void)readDataStartingFromOffset:(NSUInteger)offset
+                            length:(NSUInteger)length                     // NSNotFound means: read until EOF
+                             queue:(id<PWDispatchQueueing>)queue
+                           handler:(void (^)(BOOL done, NSData* data, NSError* errorOrNil))handler;
+
+// Closes the file. Data returned before stays valid, later reads fail.
+- (void)close;
+
+@property (atomic, readonly)            BOOL                        isOpen;
+
+@end
+
+NS_ASSUME_NONNULL_END
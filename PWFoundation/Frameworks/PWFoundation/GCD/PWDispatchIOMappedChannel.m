@@ -0,0 +1,232 @@
+//
+//  PWDispatchIOMappedChannel.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import "PWDispatchIOMappedChannel.h"
+#import "PWDispatch.h"
+#import "PWErrors.h"
+#import <fcntl.h>
+#import <sys/mman.h>
+#import <sys/stat.h>
+#import <unistd.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+static const NSUInteger PWDispatchIOMappedChannelMaxWindowCount = 16;
+
+// Same errors as -[PWDispatchIOChannel errorFromErrorCode:].
+static NSError* PWDispatchIOMappedChannelError(int code)
+{
+    NSString* message = [NSString stringWithFormat:@"Received an error from PWDispatchIOMappedChannel: %d (%s)", code, strerror(code)];
+    NSMutableDictionary* info = [NSMutableDictionary dictionary];
+    info[PWDispatchIOChannelErrorUnderlyingCodeKey] = @(code);
+    info[NSLocalizedDescriptionKey] = message;
+    return [NSError errorWithDomain:PWErrorDomain code:PWDispatchIOChannelError userInfo:info];
+}
+
+@implementation PWDispatchIOMappedChannel
+{
+    PWDispatchQueue*                                    _internalQueue;
+    int                                                 _fileDescriptor;    // -1 when closed
+    NSMutableDictionary<NSNumber*, dispatch_data_t>*    _windows;           // window index -> mapping
+    NSMutableArray<NSNumber*>*                          _windowOrder;       // least recently used first
+}
+
+- (nullable instancetype) initWithURL:(NSURL*)fileURL
+                         windowLength:(NSUInteger)windowLength
+                        accessPattern:(PWDispatchIOAccessPattern)accessPattern
+                                error:(NSError**)outError
+{
+    NSParameterAssert (fileURL.isFileURL);
+
+    int fileDescriptor = open (fileURL.path.fileSystemRepresentation, O_RDONLY | O_CLOEXEC);
+    if (fileDescriptor == -1)
+    {
+        if (outError)
+            *outError = PWDispatchIOMappedChannelError (errno);
+        return nil;
+    }
+
+    if ((self = [super init]) != nil)
+    {
+        NSUInteger pageSize = (NSUInteger)getpagesize();
+        _URL            = [fileURL copy];
+        _windowLength   = (windowLength + pageSize - 1) / pageSize * pageSize;
+        _accessPattern  = accessPattern;
+        _fileDescriptor = fileDescriptor;
+        _internalQueue  = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWDispatchIOMappedChannel"];
+        _windows        = [[NSMutableDictionary alloc] init];
+        _windowOrder    = [[NSMutableArray alloc] init];
+    }
+    else
+        close (fileDescriptor);
+    return self;
+}
+
+- (nullable instancetype) initWithURL:(NSURL*)fileURL error:(NSError**)outError
+{
+    return [self initWithURL:fileURL windowLength:0 accessPattern:PWDispatchIOAccessPatternNormal error:outError];
+}
+
+- (void) dealloc
+{
+    // The mappings are owned by their dispatch data, which may outlive the receiver.
+    if (_fileDescriptor != -1)
+        close (_fileDescriptor);
+}
+
+- (BOOL) isOpen
+{
+    __block BOOL isOpen;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        isOpen = _fileDescriptor != -1;
+    }];
+    return isOpen;
+}
+
+- (void) close
+{
+    [_internalQueue synchronouslyDispatchBlock:^{
+        if (_fileDescriptor != -1)
+        {
+            close (_fileDescriptor);
+            _fileDescriptor = -1;
+        }
+        [_windows removeAllObjects];
+        [_windowOrder removeAllObjects];
+    }];
+}
+
+- (void)readDispatchDataStartingFromOffset:(NSUInteger)offset
+                                    length:(NSUInteger)length
+                                     queue:(id<PWDispatchQueueing>)queue
+                                   handler:(void (^)(BOOL done, dispatch_data_t data, NSError* errorOrNil))handler
+{
+    NSParameterAssert (queue);
+    NSParameterAssert (handler);
+
+    __block dispatch_data_t data;
+    __block NSError* error;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        data = [self mappedDataStartingFromOffset:offset length:length error:&error];
+    }];
+    [queue asynchronouslyDispatchBlock:^{
+        handler (YES, data ?: dispatch_data_empty, error);
+    }];
+}
+
+- (void)readDataStartingFromOffset:(NSUInteger)offset
+                            length:(NSUInteger)length
+                             queue:(id<PWDispatchQueueing>)queue
+                           handler:(void (^)(BOOL done, NSData* data, NSError* errorOrNil))handler
+{
+    NSParameterAssert (handler);
+
+    [self readDispatchDataStartingFromOffset:offset
+                                      length:length
+                                       queue:queue
+                                     handler:^(BOOL done, dispatch_data_t data, NSError* errorOrNil) {
+                                         handler (done, [NSData dataWithDispatchData:data], errorOrNil);
+                                     }];
+}
+
+- (nullable dispatch_data_t) mappedDataStartingFromOffset:(NSUInteger)offset
+                                                   length:(NSUInteger)length
+                                                    error:(NSError**)outError
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+    NSParameterAssert (outError);
+
+    if (_fileDescriptor == -1)
+    {
+        *outError = PWDispatchIOMappedChannelError (EBADF);
+        return nil;
+    }
+
+    // The length is checked with every read, so reads never reach beyond the current end of a truncated file.
+    struct stat info;
+    if (fstat (_fileDescriptor, &info) != 0)
+    {
+        *outError = PWDispatchIOMappedChannelError (errno);
+        return nil;
+    }
+    NSUInteger fileLength = (NSUInteger)info.st_size;
+    if (offset >= fileLength || length == 0)
+        return dispatch_data_empty;
+    NSUInteger end = (length == NSNotFound || length > fileLength - offset) ? fileLength : offset + length;
+
+    NSUInteger pageSize = (NSUInteger)getpagesize();
+    NSUInteger windowLength = _windowLength > 0 ? _windowLength : (fileLength + pageSize - 1) / pageSize * pageSize;
+    dispatch_data_t data = dispatch_data_empty;
+    for (NSUInteger position = offset; position < end; )
+    {
+        NSUInteger windowIndex  = position / windowLength;
+        NSUInteger windowOffset = windowIndex * windowLength;
+        NSUInteger partEnd      = MIN (end, windowOffset + windowLength);
+        dispatch_data_t window  = [self windowAtIndex:windowIndex
+                                               offset:windowOffset
+                                               length:MIN (windowLength, fileLength - windowOffset)
+                                          minimumSize:partEnd - windowOffset
+                                                error:outError];
+        if (!window)
+            return nil;
+        data = dispatch_data_create_concat (data, dispatch_data_create_subrange (window, position - windowOffset, partEnd - position));
+        position = partEnd;
+    }
+    return data;
+}
+
+- (nullable dispatch_data_t) windowAtIndex:(NSUInteger)index
+                                    offset:(NSUInteger)offset
+                                    length:(NSUInteger)length
+                               minimumSize:(NSUInteger)minimumSize
+                                     error:(NSError**)outError
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    NSNumber* key = @(index);
+    dispatch_data_t window = _windows[key];
+    [_windowOrder removeObject:key];
+
+    // A window mapped before the file has grown is replaced. Readers of the old window keep it alive.
+    if (!window || dispatch_data_get_size (window) < minimumSize)
+    {
+        void* address = mmap (NULL, length, PROT_READ, MAP_SHARED, _fileDescriptor, (off_t)offset);
+        if (address == MAP_FAILED)
+        {
+            [_windows removeObjectForKey:key];
+            *outError = PWDispatchIOMappedChannelError (errno);
+            return nil;
+        }
+
+        int advice;
+        switch (_accessPattern)
+        {
+            case PWDispatchIOAccessPatternSequential:   advice = MADV_SEQUENTIAL;   break;
+            case PWDispatchIOAccessPatternRandom:       advice = MADV_RANDOM;       break;
+            default:                                    advice = MADV_NORMAL;       break;
+        }
+        madvise (address, length, advice);
+
+        window = dispatch_data_create (address, length, NULL, ^{
+            munmap (address, length);
+        });
+        _windows[key] = window;
+    }
+
+    [_windowOrder addObject:key];
+    while (_windowOrder.count > PWDispatchIOMappedChannelMaxWindowCount)
+    {
+        [_windows removeObjectForKey:_windowOrder[0]];
+        [_windowOrder removeObjectAtIndex:0];
+    }
+    return window;
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
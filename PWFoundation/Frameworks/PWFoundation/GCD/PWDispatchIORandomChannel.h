@@ -10,10 +10,24 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+// The read interface shared by PWDispatchIORandomChannel and PWDispatchIOMappedChannel.
+@protocol PWRandomAccessInput <NSObject>
+- (void)readDispatchDataStartingFromOffset:(NSUInteger)offset
+                                    length:(NSUInteger)length                 // NSNotFound means: read until EOF
+                                     queue:(id<PWDispatchQueueing>)queue
+                                   handler:(void (^)(BOOL done, dispatch_data_t data, NSError* errorOrNil))handler;
+
+- (void)readDataStartingFromOffset:(NSUInteger)offset
+                            length:(NSUInteger)length                     // NSNotFound means: read until EOF
+                             queue:(id<PWDispatchQueueing>)queue
+                           handler:(void (^)(BOOL done, NSData* data, NSError* errorOrNil))handler;
+@end
+
+
 @interface PWDispatchIORandomChannel : PWDispatchIOChannel
 @end
 
-@interface PWDispatchIORandomChannel (ReadingWriting)
+@interface PWDispatchIORandomChannel (ReadingWriting) <PWRandomAccessInput>
 
 - (void)readDispatchDataStartingFromOffset:(NSUInteger)offset
                                     length:(NSUInteger)length                 // NSNotFound means: read until EOF
@@ -26,9 +40,9 @@ NS_ASSUME_NONNULL_BEGIN
                    handler:(void (^)(BOOL done, dispatch_data_t remainingData, NSError* errorOrNil))handler;
 
 
-// Note: The following two convenience methods are for integrating with NSData objects. They are however not
-// as efficient as the direct... methods because bytes need to be copied between GCD's internal data structures and
-// NSData objects. If the data needs to be represented by NSData objects anyway, these two methods are fine to use.
+// Note: The following two convenience methods are for integrating with NSData objects. Read data is bridged from GCD's
+// internal data structures without copying. Written data is copied, unless it has been read from a channel. To write
+// data which owns its bytes without copying, pass its -newDispatchDataWithoutCopying to the direct... method.
 - (void)readDataStartingFromOffset:(NSUInteger)offset
                             length:(NSUInteger)length                     // NSNotFound means: read until EOF
                              queue:(id<PWDispatchQueueing>)queue
@@ -41,4 +55,29 @@ startingFromOffset:(NSUInteger)offset
 
 @end
 
+#pragma mark
+
+typedef NS_ENUM (PWInteger, PWDispatchIODigestMode) {
+    // SHA-1 of the complete contents, identical to -[NSData sha1] of the file contents. Chunks are read in parallel
+    // but fed into the digest in file order.
+    PWDispatchIODigestModeSequential,
+
+    // SHA-1 over the concatenated SHA-1 digests of all chunks. The chunk digests are computed concurrently, so this
+    // mode scales with the number of cores. Note: the result depends on chunkLength.
+    PWDispatchIODigestModeTree
+};
+
+@interface PWDispatchIORandomChannel (Hashing)
+
+// Reads the channel from offset 0 until EOF and digests its contents without materializing the whole file. At most
+// maxConcurrentReads chunks are read or buffered at any time, so memory use is bounded by
+// chunkLength * maxConcurrentReads.
+- (void)computeSHA1WithMode:(PWDispatchIODigestMode)mode
+                chunkLength:(NSUInteger)chunkLength               // > 0 and <= UINT32_MAX
+         maxConcurrentReads:(NSUInteger)maxConcurrentReads        // > 0
+                      queue:(id<PWDispatchQueueing>)queue
+          completionHandler:(void (^)(NSData* _Nullable digest, NSError* _Nullable errorOrNil))completionHandler;
+
+@end
+
 NS_ASSUME_NONNULL_END
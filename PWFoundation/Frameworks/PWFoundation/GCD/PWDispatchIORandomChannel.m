@@ -11,6 +11,7 @@
 #import "PWDispatchQueue.h"
 #import "PWDispatchObject-Internal.h"
 #import "NSData-PWDispatchExtensions.h"
+#import <CommonCrypto/CommonDigest.h>
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -24,4 +25,221 @@ NS_ASSUME_NONNULL_BEGIN
 
 @end
 
+#pragma mark - Hashing
+
+static void PWUpdateSHA1WithDispatchData(CC_SHA1_CTX* context, dispatch_data_t data)
+{
+    NSCParameterAssert(context);
+    NSCParameterAssert(data);
+
+    dispatch_data_apply(data, ^bool(dispatch_data_t region, size_t offset, const void* buffer, size_t size) {
+        CC_SHA1_Update(context, buffer, (CC_LONG)size);
+        return true;
+    });
+}
+
+// Reads the chunks of a channel with a bounded number of reads in flight and feeds them in order into one digest.
+// All state is protected by _stateQueue, chunk digests of the tree mode are computed on the global queue.
+@interface PWDispatchIOChannelHasher : NSObject
+@end
+
+@implementation PWDispatchIOChannelHasher
+{
+    PWDispatchIORandomChannel*              _channel;
+    PWDispatchIODigestMode                  _mode;
+    NSUInteger                              _chunkLength;
+    NSUInteger                              _maxConcurrentReads;
+    id<PWDispatchQueueing>                  _completionQueue;
+    void (^_completionHandler)(NSData* _Nullable digest, NSError* _Nullable errorOrNil);
+
+    PWDispatchQueue*                        _stateQueue;
+    CC_SHA1_CTX                             _context;
+    NSMutableDictionary<NSNumber*, id>*     _completedChunks;       // chunk index -> dispatch data or chunk digest
+    NSUInteger                              _nextChunkToRead;
+    NSUInteger                              _nextChunkToDigest;
+    NSUInteger                              _endChunk;              // index of the first chunk behind EOF, NSNotFound until known
+    NSUInteger                              _pendingChunkCount;     // read or being digested, not yet in _completedChunks
+    NSError*                                _error;
+    BOOL                                    _didComplete;
+}
+
+- (instancetype)initWithChannel:(PWDispatchIORandomChannel*)channel
+                           mode:(PWDispatchIODigestMode)mode
+                    chunkLength:(NSUInteger)chunkLength
+             maxConcurrentReads:(NSUInteger)maxConcurrentReads
+                          queue:(id<PWDispatchQueueing>)queue
+              completionHandler:(void (^)(NSData* _Nullable digest, NSError* _Nullable errorOrNil))completionHandler
+{
+    NSParameterAssert(channel);
+    NSParameterAssert(chunkLength > 0 && chunkLength <= UINT32_MAX);
+    NSParameterAssert(maxConcurrentReads > 0);
+    NSParameterAssert(queue);
+    NSParameterAssert(completionHandler);
+
+    if ((self = [super init]) != nil)
+    {
+        _channel            = channel;
+        _mode               = mode;
+        _chunkLength        = chunkLength;
+        _maxConcurrentReads = maxConcurrentReads;
+        _completionQueue    = queue;
+        _completionHandler  = [completionHandler copy];
+        _stateQueue         = [PWDispatchQueue serialDispatchQueueWithLabel:NSStringFromClass(self.class)];
+        _completedChunks    = [[NSMutableDictionary alloc] init];
+        _endChunk           = NSNotFound;
+        CC_SHA1_Init(&_context);
+    }
+    return self;
+}
+
+- (void)start
+{
+    // The hasher is kept alive by the blocks of its pending reads.
+    [_stateQueue asynchronouslyDispatchBlock:^{
+        [self readChunks];
+        [self completeIfPossible];
+    }];
+}
+
+- (void)readChunks
+{
+    PWAssert(_stateQueue.isCurrentDispatchQueue);
+
+    // Chunks ahead of the digest position are buffered, so the window is counted from _nextChunkToDigest.
+    while(!_error
+          && _pendingChunkCount < _maxConcurrentReads
+          && _nextChunkToRead < _nextChunkToDigest + _maxConcurrentReads
+          && (_endChunk == NSNotFound || _nextChunkToRead < _endChunk))
+    {
+        [self readChunkAtIndex:_nextChunkToRead++];
+    }
+}
+
+- (void)readChunkAtIndex:(NSUInteger)index
+{
+    PWAssert(_stateQueue.isCurrentDispatchQueue);
+
+    _pendingChunkCount++;
+    __block dispatch_data_t chunk = dispatch_data_empty;
+    [_channel readDispatchDataStartingFromOffset:index * _chunkLength
+                                          length:_chunkLength
+                                           queue:_stateQueue
+                                         handler:^(BOOL done, dispatch_data_t _Nullable data, NSError* _Nullable errorOrNil)
+     {
+         if(data && dispatch_data_get_size(data) > 0)
+             chunk = dispatch_data_create_concat(chunk, data);
+         if(errorOrNil && !_error)
+             _error = errorOrNil;
+         if(done)
+             [self didReadChunk:chunk atIndex:index];
+     }];
+}
+
+- (void)didReadChunk:(dispatch_data_t)chunk atIndex:(NSUInteger)index
+{
+    PWAssert(_stateQueue.isCurrentDispatchQueue);
+    NSParameterAssert(chunk);
+
+    size_t length = dispatch_data_get_size(chunk);
+    if(length < _chunkLength)
+        _endChunk = MIN(_endChunk, length > 0 ? index + 1 : index);
+
+    if(_error || index >= _endChunk)
+    {
+        _pendingChunkCount--;
+        [self completeIfPossible];
+        return;
+    }
+
+    if(_mode == PWDispatchIODigestModeTree)
+    {
+        [PWDispatchQueue.globalDefaultPriorityQueue asynchronouslyDispatchBlock:^{
+            CC_SHA1_CTX chunkContext;
+            CC_SHA1_Init(&chunkContext);
+            PWUpdateSHA1WithDispatchData(&chunkContext, chunk);
+            unsigned char digest[CC_SHA1_DIGEST_LENGTH];
+            CC_SHA1_Final(digest, &chunkContext);
+            NSData* digestData = [NSData dataWithBytes:digest length:CC_SHA1_DIGEST_LENGTH];
+            [_stateQueue asynchronouslyDispatchBlock:^{
+                [self didCompleteChunk:digestData atIndex:index];
+            }];
+        }];
+    }
+    else
+        [self didCompleteChunk:chunk atIndex:index];
+}
+
+- (void)didCompleteChunk:(id)chunk atIndex:(NSUInteger)index
+{
+    PWAssert(_stateQueue.isCurrentDispatchQueue);
+    NSParameterAssert(chunk);
+
+    _pendingChunkCount--;
+    _completedChunks[@(index)] = chunk;
+
+    // Feed all chunks which are now contiguous with the digest position.
+    id nextChunk;
+    while(_nextChunkToDigest < _endChunk && (nextChunk = _completedChunks[@(_nextChunkToDigest)]) != nil)
+    {
+        if(_mode == PWDispatchIODigestModeTree)
+            CC_SHA1_Update(&_context, [nextChunk bytes], CC_SHA1_DIGEST_LENGTH);
+        else
+            PWUpdateSHA1WithDispatchData(&_context, nextChunk);
+        [_completedChunks removeObjectForKey:@(_nextChunkToDigest)];
+        _nextChunkToDigest++;
+    }
+
+    [self readChunks];
+    [self completeIfPossible];
+}
+
+- (void)completeIfPossible
+{
+    PWAssert(_stateQueue.isCurrentDispatchQueue);
+
+    if(_didComplete || _pendingChunkCount > 0)
+        return;
+
+    NSData* digestData;
+    NSError* error = _error;
+    if(!error)
+    {
+        if(_endChunk == NSNotFound || _nextChunkToDigest < _endChunk)
+            return;
+        unsigned char digest[CC_SHA1_DIGEST_LENGTH];
+        CC_SHA1_Final(digest, &_context);
+        digestData = [NSData dataWithBytes:digest length:CC_SHA1_DIGEST_LENGTH];
+    }
+
+    _didComplete = YES;
+    [_completedChunks removeAllObjects];
+    void (^completionHandler)(NSData* _Nullable, NSError* _Nullable) = _completionHandler;
+    [_completionQueue asynchronouslyDispatchBlock:^{
+        completionHandler(digestData, error);
+    }];
+}
+
+@end
+
+#pragma mark
+
+@implementation PWDispatchIORandomChannel (Hashing)
+
+- (void)computeSHA1WithMode:(PWDispatchIODigestMode)mode
+                chunkLength:(NSUInteger)chunkLength
+         maxConcurrentReads:(NSUInteger)maxConcurrentReads
+                      queue:(id<PWDispatchQueueing>)queue
+          completionHandler:(void (^)(NSData* _Nullable digest, NSError* _Nullable errorOrNil))completionHandler
+{
+    PWDispatchIOChannelHasher* hasher = [[PWDispatchIOChannelHasher alloc] initWithChannel:self
+                                                                                      mode:mode
+                                                                               chunkLength:chunkLength
+                                                                        maxConcurrentReads:maxConcurrentReads
+                                                                                     queue:queue
+                                                                         completionHandler:completionHandler];
+    [hasher start];
+}
+
+@end
+
 NS_ASSUME_NONNULL_END
@@ -37,9 +37,9 @@ NS_ASSUME_NONNULL_BEGIN
                              queue:(id<PWDispatchQueueing>)queue
                            handler:(void (^)(BOOL done, dispatch_data_t _Nullable data, NSError* _Nullable error))handler;
 
-// Note: The following two convenience methods are for integrating with NSData objects. They are however not
-// as efficient as the direct... methods because bytes need to be copied between GCD's internal data structures and
-// NSData objects. If the data needs to be represented by NSData objects anyway, these two methods are fine to use.
+// Note: The following two convenience methods are for integrating with NSData objects. Read data is bridged from GCD's
+// internal data structures without copying. Written data is copied, unless it has been read from a channel. To write
+// data which owns its bytes without copying, pass its -newDispatchDataWithoutCopying to the direct... method.
 - (void)readDataWithLength:(NSUInteger)length                // NSNotFound means: read until EOF
                      queue:(id<PWDispatchQueueing>)queue
                    handler:(void (^)(BOOL done, NSData* _Nullable data, NSError* _Nullable error))handler;
@@ -25,7 +25,7 @@ typedef void(^PWDispatchKeyValueObserverBlock)(NSString *_Nullable keyPath, id _
                    keyPaths:(id<PWEnumerable>)keyPaths
                     options:(NSKeyValueObservingOptions)options;
 
-@property (nonatomic, readonly, copy, nullable) PWDispatchKeyValueObserverBlock observerBlock;  // nil after dispose
+@property (nonatomic, readonly, copy, nullable) PWDispatchKeyValueObserverBlock observerBlock;  // nil after dispose, can be read on any queue
 @property (nonatomic, readonly, copy)           id <PWEnumerable>               keyPaths;
 
 // Note: observedObjects are currently not accessible, because they are kept in a std::vector internally. An accessor
@@ -12,6 +12,10 @@
 #import "NSObject-PWExtensions.h"
 #import "PWWeakReferenceProxy.h"
 #import "PWInlineVector.hpp"
+#import <atomic>
+#import <thread>
+#import <vector>
+#import <unordered_map>
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -28,11 +32,66 @@ NS_ASSUME_NONNULL_BEGIN
 typedef PWFoundation::inline_vector<__unsafe_unretained id,    1> UnretainedObjects;
 typedef PWFoundation::inline_vector<__unsafe_unretained Class, 1> Classes;
 
+namespace
+{
+    // A notification which waits for delivery by a coalescing observer.
+    struct PendingChange
+    {
+        id              object;
+        NSString*       keyPath;
+        NSDictionary*   change;
+    };
+
+    struct PendingChangeKey
+    {
+        __unsafe_unretained id          object;     // retained by the pending change
+        __unsafe_unretained NSString*   keyPath;    // retained by the pending change
+
+        bool operator== (const PendingChangeKey& other) const
+        {
+            return object == other.object && [keyPath isEqualToString:other.keyPath];
+        }
+    };
+
+    struct PendingChangeKeyHash
+    {
+        size_t operator() (const PendingChangeKey& key) const
+        {
+            return std::hash<void*>()((__bridge void*)key.object) ^ key.keyPath.hash;
+        }
+    };
+
+    // Settings are merged into one change from the first old to the last new value. Other kinds of changes can not be
+    // represented by a single change dictionary.
+    NSDictionary* _Nullable MergedChange(NSDictionary* _Nullable firstChange, NSDictionary* _Nullable lastChange)
+    {
+        if (!firstChange || !lastChange
+            || [firstChange[NSKeyValueChangeKindKey] unsignedIntegerValue] != NSKeyValueChangeSetting
+            || [lastChange[NSKeyValueChangeKindKey] unsignedIntegerValue] != NSKeyValueChangeSetting)
+            return nil;
+
+        NSMutableDictionary* change = [lastChange mutableCopy];
+        change[NSKeyValueChangeOldKey] = firstChange[NSKeyValueChangeOldKey];
+        return change;
+    }
+}
+
 @implementation PWDispatchKeyValueObserver
 {
     UnretainedObjects   _observedObjects;
     // The classes of the observed objects are remembered to support hunting for undisposed observers.
     Classes             _observedObjectsClasses;
+
+    // The observer block is read for every notification, possibly on several queues at once. To avoid a hop to the
+    // internal queue for each read, it is kept as a retained pointer which is loaded atomically. The reader count keeps
+    // -dispose from releasing the block between loading and retaining it by a reader.
+    std::atomic<void*>          _retainedObserverBlock;
+    std::atomic<NSUInteger>     _observerBlockReaderCount;
+
+    BOOL                        _coalescesNotifications;
+    // Only accessed on the internal queue.
+    std::vector<PendingChange>  _pendingChanges;        // in order of arrival
+    std::unordered_map<PendingChangeKey, size_t, PendingChangeKeyHash> _pendingChangeIndexes;
 #ifndef NDEBUG
     BOOL    _disposed;
 #endif
@@ -49,10 +108,14 @@ typedef PWFoundation::inline_vector<__unsafe_unretained Class, 1> Classes;
     NSParameterAssert(block);
     NSParameterAssert(observedObjects.elementCount > 0);
     NSParameterAssert(keyPaths.elementCount > 0);
+    NSParameterAssert(!(options & PWKeyValueObservingOptionCoalescing) || dispatchKind != PWDispatchQueueDispatchKindSynchronous);
+    NSParameterAssert(!(options & PWKeyValueObservingOptionCoalescing) || !(options & NSKeyValueObservingOptionPrior));
 
     if(self = [super initWithDispatchQueue:queue dispatchKind:dispatchKind])
     {
-        _observerBlock   = [block copy];
+        _retainedObserverBlock = (__bridge_retained void*)[block copy];
+        _coalescesNotifications = (options & PWKeyValueObservingOptionCoalescing) != 0;
+        options &= ~PWKeyValueObservingOptionCoalescing;
         _keyPaths        = [(id)keyPaths respondsToSelector:@selector(copyWithZone:)] ? [(id)keyPaths copy] : keyPaths;
         for (id iObject in observedObjects) {
             _observedObjects.push_back (iObject);
@@ -65,34 +128,93 @@ typedef PWFoundation::inline_vector<__unsafe_unretained Class, 1> Classes;
     return self;
 }
 
+- (nullable PWDispatchKeyValueObserverBlock)observerBlock
+{
+    _observerBlockReaderCount.fetch_add(1);
+    void* block = _retainedObserverBlock.load();
+    if(block)
+        CFRetain(block);
+    _observerBlockReaderCount.fetch_sub(1);
+    return (__bridge_transfer PWDispatchKeyValueObserverBlock)block;
+}
+
 - (void)observeValueForKeyPath:(nullable NSString*)keyPath
                       ofObject:(nullable id)object
                         change:(nullable NSDictionary*)change
                        context:(nullable void*)context
 {
-    if(!self.isDisabled)
+    if(self.isDisabled)
+        return;
+
+    if(_coalescesNotifications)
+        [self addPendingChange:change forKeyPath:keyPath ofObject:object];
+    else
         [self.dispatchQueue withDispatchKind:self.dispatchKind
                                dispatchBlock:^
          {
-             __block PWDispatchKeyValueObserverBlock observerBlock;
-             [self.internalQueue synchronouslyDispatchBlock:^{
-                 observerBlock = _observerBlock;
-             }];
+             PWDispatchKeyValueObserverBlock observerBlock = self.observerBlock;
              if(observerBlock)
                  observerBlock(keyPath, object, change);
          }];
 }
 
-- (void)dispose
+#pragma mark Coalescing
+
+- (void)addPendingChange:(nullable NSDictionary*)change forKeyPath:(nullable NSString*)keyPath ofObject:(nullable id)object
 {
-    __block PWDispatchKeyValueObserverBlock observerBlock;
+    __block BOOL needsDispatch = NO;
     [self.internalQueue synchronouslyDispatchBlock:^{
-        observerBlock = _observerBlock; // Make sure that dealloc of observerBlock is done on the dispatch queue of the caller
-        _observerBlock = nil;
+        auto iter = _pendingChangeIndexes.find(PendingChangeKey{object, keyPath});
+        if(iter != _pendingChangeIndexes.end())
+        {
+            PendingChange& pendingChange = _pendingChanges[iter->second];
+            pendingChange.change = MergedChange(pendingChange.change, change);
+        }
+        else
+        {
+            // Only the first pending change needs a dispatch, the others are delivered along with it.
+            needsDispatch = _pendingChanges.empty();
+            _pendingChanges.push_back(PendingChange{object, keyPath, change});
+            const PendingChange& pendingChange = _pendingChanges.back();
+            _pendingChangeIndexes.emplace(PendingChangeKey{pendingChange.object, pendingChange.keyPath}, _pendingChanges.size() - 1);
+        }
     }];
 
-    if(observerBlock)
+    if(needsDispatch)
+        [self.dispatchQueue asynchronouslyDispatchBlock:^{
+            [self deliverPendingChanges];
+        }];
+}
+
+- (void)deliverPendingChanges
+{
+    // Changes arriving during delivery are delivered by the next dispatch.
+    __block std::vector<PendingChange> pendingChanges;
+    [self.internalQueue synchronouslyDispatchBlock:^{
+        pendingChanges.swap(_pendingChanges);
+        _pendingChangeIndexes.clear();
+    }];
+
+    for(const PendingChange& iPendingChange : pendingChanges)
     {
+        PWDispatchKeyValueObserverBlock observerBlock = self.observerBlock;    // the previous call may have disposed
+        if(!observerBlock)
+            break;
+        observerBlock(iPendingChange.keyPath, iPendingChange.object, iPendingChange.change);
+    }
+}
+
+- (void)dispose
+{
+    void* retainedObserverBlock = _retainedObserverBlock.exchange(NULL);
+    if(retainedObserverBlock)
+    {
+        if(_coalescesNotifications)
+            [self.internalQueue synchronouslyDispatchBlock:^{
+                _pendingChanges.clear();
+                _pendingChangeIndexes.clear();
+            }];
+
         const auto count = _observedObjects.size();
         for (auto i = 0; i < count; ++i) {
             // If accessing the object crashes because it has already been deallocated, annotate the crash report
@@ -117,6 +239,12 @@ typedef PWFoundation::inline_vector<__unsafe_unretained Class, 1> Classes;
                                                            [object removeObserver:self forKeyPath:keyPath];
                                                    });
         }
+
+        // Release the block only after readers which have loaded it have retained it. Releasing it here makes sure that
+        // its dealloc is done on the dispatch queue of the caller.
+        while(_observerBlockReaderCount.load() > 0)
+            std::this_thread::yield();
+        CFRelease(retainedObserverBlock);
     }
     
     [super dispose];
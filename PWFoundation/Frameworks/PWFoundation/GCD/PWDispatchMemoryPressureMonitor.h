@@ -0,0 +1,62 @@
+//
+//  PWDispatchMemoryPressureMonitor.h
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import <Foundation/Foundation.h>
+#import <dispatch/dispatch.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class PWDispatchMemoryPressureObserver;
+
+// Derives memory pressure levels from Linux pressure stall information (PSI) and the cgroup v2 memory controller, for
+// systems on which DISPATCH_SOURCE_TYPE_MEMORYPRESSURE never fires, like Linux containers.
+//
+// The level is DISPATCH_MEMORYPRESSURE_CRITICAL if any of the critical conditions holds, DISPATCH_MEMORYPRESSURE_WARN if
+// any of the warning conditions holds and DISPATCH_MEMORYPRESSURE_NORMAL otherwise:
+// - 'some avg10' of <root>/proc/pressure/memory reaches psiWarningThreshold, 'full avg10' reaches psiCriticalThreshold.
+// - memory.current of the cgroup of the process reaches usageWarningRatio resp. usageCriticalRatio of memory.max.
+// - memory.events of the cgroup counted new 'high' events (warning) or new 'max' or 'oom' events (critical).
+// Missing files are ignored, so the monitor works without PSI or outside of a limited cgroup.
+//
+// A started monitor reads the files every pollInterval. On Linux, it also installs PSI triggers for both thresholds,
+// which wake it as soon as a stall is reported. Observers attached to the monitor receive an event whenever the level
+// changes to a level contained in their flags, and whenever the cgroup reports new events at a level in their flags.
+@interface PWDispatchMemoryPressureMonitor : NSObject
+
+- (instancetype) init NS_UNAVAILABLE;
+
+// 'rootPath' is "/" for the real system, tests pass the root of a fake file tree.
+- (instancetype) initWithRootPath:(NSString*)rootPath NS_DESIGNATED_INITIALIZER;
+
+// Used by observers created with -[PWDispatchMemoryPressureObserver initWithFlags:dispatchQueue:] instead of the
+// system's memory pressure source. On Linux, this is a started monitor of "/" unless set otherwise, elsewhere it is nil.
+@property (class, atomic, readwrite, strong, nullable) PWDispatchMemoryPressureMonitor* sharedMonitor;
+
+@property (nonatomic, readonly, copy)   NSString*       rootPath;
+
+@property (atomic, readwrite)           double          psiWarningThreshold;    // in percent, default 10
+@property (atomic, readwrite)           double          psiCriticalThreshold;   // in percent, default 5
+@property (atomic, readwrite)           double          usageWarningRatio;      // default 0.85
+@property (atomic, readwrite)           double          usageCriticalRatio;     // default 0.95
+@property (atomic, readwrite)           NSTimeInterval  pollInterval;           // default 1 second, applies on the next start
+
+- (void) start;
+
+- (void) stop;
+
+// Reads the files once, notifies the observers and returns the new level.
+- (dispatch_source_memorypressure_flags_t) update;
+
+@property (atomic, readonly)            dispatch_source_memorypressure_flags_t  level;
+
+// Called by PWDispatchMemoryPressureObserver. Observers are not retained.
+- (void) addObserver:(PWDispatchMemoryPressureObserver*)observer;
+
+@end
+
+NS_ASSUME_NONNULL_END
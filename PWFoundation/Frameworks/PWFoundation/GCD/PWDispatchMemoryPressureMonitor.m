@@ -0,0 +1,341 @@
+//
+//  PWDispatchMemoryPressureMonitor.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import "PWDispatchMemoryPressureMonitor.h"
+#import "PWDispatch.h"
+
+#if defined(__linux__)
+#import <fcntl.h>
+#import <sys/epoll.h>
+#import <unistd.h>
+#endif
+
+NS_ASSUME_NONNULL_BEGIN
+
+// PSI averages stalls over the last 10 seconds. Triggers use a window of two seconds, because unprivileged processes,
+// like those in containers, may only install triggers whose window is a multiple of two seconds.
+static const uint64_t PWPSITriggerWindow = 2000000; // in microseconds
+
+// Returns the value of 'key' (like "avg10") in the line starting with 'kind' (like "some") of a PSI file, or -1.
+static double PWPSIValue(NSString* contents, NSString* kind, NSString* key)
+{
+    for(NSString* line in [contents componentsSeparatedByString:@"\n"])
+    {
+        NSArray<NSString*>* fields = [line componentsSeparatedByString:@" "];
+        if(fields.count == 0 || ![fields[0] isEqualToString:kind])
+            continue;
+        NSString* prefix = [key stringByAppendingString:@"="];
+        for(NSString* field in fields)
+            if([field hasPrefix:prefix])
+                return [field substringFromIndex:prefix.length].doubleValue;
+    }
+    return -1.0;
+}
+
+// Parses the "key value" lines of memory.events.
+static NSDictionary<NSString*, NSNumber*>* PWCgroupEvents(NSString* contents)
+{
+    NSMutableDictionary<NSString*, NSNumber*>* events = [NSMutableDictionary dictionary];
+    for(NSString* line in [contents componentsSeparatedByString:@"\n"])
+    {
+        NSArray<NSString*>* fields = [line componentsSeparatedByString:@" "];
+        if(fields.count == 2)
+            events[fields[0]] = @(strtoull(fields[1].UTF8String, NULL, 10));
+    }
+    return events;
+}
+
+@implementation PWDispatchMemoryPressureMonitor
+{
+    PWDispatchQueue*                                        _internalQueue;
+    NSHashTable<PWDispatchMemoryPressureObserver*>*         _observers;
+    PWDispatchTimer* _Nullable                              _pollTimer;
+    NSDictionary<NSString*, NSNumber*>* _Nullable           _previousEvents;
+#if defined(__linux__)
+    PWDispatchFileReader* _Nullable                         _triggerReader;
+    int                                                     _triggerDescriptors[2];
+#endif
+}
+
+@synthesize level = _level;
+
+static PWDispatchMemoryPressureMonitor* _Nullable PWSharedMemoryPressureMonitor;
+static BOOL PWSharedMemoryPressureMonitorIsSet;
+
++ (nullable PWDispatchMemoryPressureMonitor*) sharedMonitor
+{
+    @synchronized(self)
+    {
+#if defined(__linux__)
+        if(!PWSharedMemoryPressureMonitorIsSet)
+        {
+            PWSharedMemoryPressureMonitor = [[PWDispatchMemoryPressureMonitor alloc] initWithRootPath:@"/"];
+            [PWSharedMemoryPressureMonitor start];
+            PWSharedMemoryPressureMonitorIsSet = YES;
+        }
+#endif
+        return PWSharedMemoryPressureMonitor;
+    }
+}
+
++ (void) setSharedMonitor:(nullable PWDispatchMemoryPressureMonitor*)monitor
+{
+    @synchronized(self)
+    {
+        PWSharedMemoryPressureMonitor = monitor;
+        PWSharedMemoryPressureMonitorIsSet = YES;
+    }
+}
+
+- (instancetype) initWithRootPath:(NSString*)rootPath
+{
+    NSParameterAssert(rootPath);
+
+    if((self = [super init]) != nil)
+    {
+        _rootPath             = [rootPath copy];
+        _psiWarningThreshold  = 10.0;
+        _psiCriticalThreshold = 5.0;
+        _usageWarningRatio    = 0.85;
+        _usageCriticalRatio   = 0.95;
+        _pollInterval         = 1.0;
+        _level                = DISPATCH_MEMORYPRESSURE_NORMAL;
+        _internalQueue        = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWDispatchMemoryPressureMonitor"];
+        _observers            = [NSHashTable weakObjectsHashTable];
+#if defined(__linux__)
+        _triggerDescriptors[0] = _triggerDescriptors[1] = -1;
+#endif
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    [_pollTimer cancel];
+#if defined(__linux__)
+    [_triggerReader cancel];
+    for(NSUInteger index = 0; index < 2; index++)
+        if(_triggerDescriptors[index] != -1)
+            close(_triggerDescriptors[index]);
+#endif
+}
+
+- (dispatch_source_memorypressure_flags_t) level
+{
+    __block dispatch_source_memorypressure_flags_t level;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        level = _level;
+    }];
+    return level;
+}
+
+- (void) addObserver:(PWDispatchMemoryPressureObserver*)observer
+{
+    NSParameterAssert(observer);
+
+    [_internalQueue synchronouslyDispatchBlock:^{
+        [_observers addObject:observer];
+    }];
+}
+
+- (void) start
+{
+    NSTimeInterval pollInterval = self.pollInterval;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        if(_pollTimer)
+            return;
+        __weak PWDispatchMemoryPressureMonitor* weakSelf = self;
+        _pollTimer = [PWDispatchTimer enabledTimerWithQueue:_internalQueue
+                                       startIntervalFromNow:0.0
+                                         repetitionInterval:pollInterval
+                                                     leeway:pollInterval * 0.1
+                                                useWallTime:NO
+                                                 eventBlock:^{
+                                                     [weakSelf updateLevel];
+                                                 }];
+#if defined(__linux__)
+        [self installPSITriggers];
+#endif
+    }];
+}
+
+- (void) stop
+{
+    [_internalQueue synchronouslyDispatchBlock:^{
+        [_pollTimer cancel];
+        _pollTimer = nil;
+#if defined(__linux__)
+        [self removePSITriggers];
+#endif
+    }];
+}
+
+- (dispatch_source_memorypressure_flags_t) update
+{
+    __block dispatch_source_memorypressure_flags_t level;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        level = [self updateLevel];
+    }];
+    return level;
+}
+
+#pragma mark - Evaluation
+
+- (nullable NSString*) contentsOfFile:(NSString*)relativePath
+{
+    NSString* path = [_rootPath stringByAppendingPathComponent:relativePath];
+    return [NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:NULL];
+}
+
+// The directory of the cgroup of the process, from the "0::<path>" line of /proc/self/cgroup.
+- (nullable NSString*) cgroupDirectory
+{
+    for(NSString* line in [[self contentsOfFile:@"proc/self/cgroup"] componentsSeparatedByString:@"\n"])
+        if([line hasPrefix:@"0::"])
+            return [@"sys/fs/cgroup" stringByAppendingPathComponent:[line substringFromIndex:3]];
+    return nil;
+}
+
+- (dispatch_source_memorypressure_flags_t) updateLevel
+{
+    PWAssert(_internalQueue.isCurrentDispatchQueue);
+
+    BOOL isWarning  = NO;
+    BOOL isCritical = NO;
+
+    NSString* pressure = [self contentsOfFile:@"proc/pressure/memory"];
+    if(pressure)
+    {
+        isWarning  |= PWPSIValue(pressure, @"some", @"avg10") >= self.psiWarningThreshold;
+        isCritical |= PWPSIValue(pressure, @"full", @"avg10") >= self.psiCriticalThreshold;
+    }
+
+    BOOL hasNewEvents = NO;
+    NSString* cgroupDirectory = self.cgroupDirectory;
+    if(cgroupDirectory)
+    {
+        NSString* limit   = [[self contentsOfFile:[cgroupDirectory stringByAppendingPathComponent:@"memory.max"]]
+                             stringByTrimmingCharactersInSet:NSCharacterSet.whitespaceAndNewlineCharacterSet];
+        NSString* current = [self contentsOfFile:[cgroupDirectory stringByAppendingPathComponent:@"memory.current"]];
+        double limitValue = limit ? strtod(limit.UTF8String, NULL) : 0.0;
+        if(current && limitValue > 0.0 && ![limit isEqualToString:@"max"])
+        {
+            double ratio = strtod(current.UTF8String, NULL) / limitValue;
+            isWarning  |= ratio >= self.usageWarningRatio;
+            isCritical |= ratio >= self.usageCriticalRatio;
+        }
+
+        // Counters which existed before the first update do not count as new events.
+        NSString* eventsContents = [self contentsOfFile:[cgroupDirectory stringByAppendingPathComponent:@"memory.events"]];
+        if(eventsContents)
+        {
+            NSDictionary<NSString*, NSNumber*>* events = PWCgroupEvents(eventsContents);
+            NSDictionary<NSString*, NSNumber*>* previousEvents = _previousEvents ?: events;
+            BOOL (^increased)(NSString*) = ^BOOL(NSString* key) {
+                return events[key].unsignedLongLongValue > previousEvents[key].unsignedLongLongValue;
+            };
+            BOOL newWarning  = increased(@"high");
+            BOOL newCritical = increased(@"max") || increased(@"oom") || increased(@"oom_kill");
+            isWarning   |= newWarning;
+            isCritical  |= newCritical;
+            hasNewEvents = newWarning || newCritical;
+            _previousEvents = events;
+        }
+    }
+
+    dispatch_source_memorypressure_flags_t level = isCritical ? DISPATCH_MEMORYPRESSURE_CRITICAL
+                                                 : (isWarning ? DISPATCH_MEMORYPRESSURE_WARN : DISPATCH_MEMORYPRESSURE_NORMAL);
+    if(level != _level || hasNewEvents)
+    {
+        _level = level;
+        for(PWDispatchMemoryPressureObserver* observer in _observers)
+            if(observer.flags & level)
+                dispatch_source_merge_data(observer.underlyingSource, level);
+    }
+    return level;
+}
+
+#pragma mark - PSI triggers
+
+#if defined(__linux__)
+
+// A trigger fires when the stall time within the window exceeds the threshold. The trigger descriptors are watched with
+// an epoll descriptor, which is readable while a trigger has fired, because dispatch sources do not support POLLPRI.
+- (void) installPSITriggers
+{
+    PWAssert(_internalQueue.isCurrentDispatchQueue);
+
+    NSString* path = [_rootPath stringByAppendingPathComponent:@"proc/pressure/memory"];
+    int epollDescriptor = epoll_create1(EPOLL_CLOEXEC);
+    if(epollDescriptor == -1)
+        return;
+
+    NSArray<NSString*>* kinds = @[@"some", @"full"];
+    double thresholds[2] = { self.psiWarningThreshold, self.psiCriticalThreshold };
+    for(NSUInteger index = 0; index < 2; index++)
+    {
+        int descriptor = open(path.fileSystemRepresentation, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if(descriptor == -1)
+            continue;
+        uint64_t stall = (uint64_t)(thresholds[index] / 100.0 * (double)PWPSITriggerWindow);
+        NSString* trigger = [NSString stringWithFormat:@"%@ %llu %llu", kinds[index], stall, PWPSITriggerWindow];
+        struct epoll_event event = { .events = EPOLLPRI };
+        if(write(descriptor, trigger.UTF8String, strlen(trigger.UTF8String) + 1) < 0
+           || epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, descriptor, &event) != 0)
+        {
+            // Not a PSI file, like in a fake file tree or on kernels without PSI, or triggers are not permitted.
+            // Polling still works.
+            int error = errno;
+            static dispatch_once_t onceToken;
+            dispatch_once(&onceToken, ^{
+                NSLog(@"PWDispatchMemoryPressureMonitor: could not install PSI trigger \"%@\" (%s), falling back to polling",
+                      trigger, strerror(error));
+            });
+            close(descriptor);
+            continue;
+        }
+        _triggerDescriptors[index] = descriptor;
+    }
+
+    if(_triggerDescriptors[0] == -1 && _triggerDescriptors[1] == -1)
+    {
+        close(epollDescriptor);
+        return;
+    }
+    _triggerReader = [[PWDispatchFileReader alloc] initWithFileHandle:[[NSFileHandle alloc] initWithFileDescriptor:epollDescriptor
+                                                                                                    closeOnDealloc:YES]
+                                                              onQueue:_internalQueue];
+    __weak PWDispatchMemoryPressureMonitor* weakSelf = self;
+    _triggerReader.eventBlock = ^{
+        // Waiting consumes the fired triggers.
+        struct epoll_event events[2];
+        epoll_wait(epollDescriptor, events, 2, 0);
+        [weakSelf updateLevel];
+    };
+    [_triggerReader enable];
+}
+
+- (void) removePSITriggers
+{
+    PWAssert(_internalQueue.isCurrentDispatchQueue);
+
+    [_triggerReader cancel];
+    _triggerReader = nil;
+    for(NSUInteger index = 0; index < 2; index++)
+        if(_triggerDescriptors[index] != -1)
+        {
+            close(_triggerDescriptors[index]);
+            _triggerDescriptors[index] = -1;
+        }
+}
+
+#endif
+
+@end
+
+NS_ASSUME_NONNULL_END
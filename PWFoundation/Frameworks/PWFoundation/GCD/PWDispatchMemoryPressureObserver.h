@@ -10,14 +10,26 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+@class PWDispatchMemoryPressureMonitor;
+
 /**
  * A dispatch source that is triggered by memory pressure events signaled by the system (both OS X and iOS).
+ *
+ * If +[PWDispatchMemoryPressureMonitor sharedMonitor] is set, which it is by default on Linux, the events come from
+ * that monitor instead, because the system source never fires there.
  */
 @interface PWDispatchMemoryPressureObserver : PWDispatchSource
 
 - (instancetype)initWithFlags:(dispatch_source_memorypressure_flags_t)flags
                 dispatchQueue:(id<PWDispatchQueueing>)dispatchQueue;
 
+// Receives the levels of 'monitor' instead of the system's events.
+- (instancetype)initWithFlags:(dispatch_source_memorypressure_flags_t)flags
+                dispatchQueue:(id<PWDispatchQueueing>)dispatchQueue
+                      monitor:(PWDispatchMemoryPressureMonitor*)monitor;
+
+@property (nonatomic, readonly) dispatch_source_memorypressure_flags_t flags;
+
 @end
 
 NS_ASSUME_NONNULL_END
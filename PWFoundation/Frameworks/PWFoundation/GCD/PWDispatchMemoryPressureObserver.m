@@ -7,6 +7,7 @@
 //
 
 #import "PWDispatchMemoryPressureObserver.h"
+#import "PWDispatchMemoryPressureMonitor.h"
 #import "PWDispatchSource-Internal.h"
 
 NS_ASSUME_NONNULL_BEGIN
@@ -18,10 +19,35 @@ NS_ASSUME_NONNULL_BEGIN
 {
     NSParameterAssert(dispatchQueue);
     
-    return [super initWithType:DISPATCH_SOURCE_TYPE_MEMORYPRESSURE
-                        handle:0
-                          mask:flags
-                       onQueue:dispatchQueue];
+    PWDispatchMemoryPressureMonitor* monitor = PWDispatchMemoryPressureMonitor.sharedMonitor;
+    if (monitor)
+        return [self initWithFlags:flags dispatchQueue:dispatchQueue monitor:monitor];
+
+    if ((self = [super initWithType:DISPATCH_SOURCE_TYPE_MEMORYPRESSURE
+                             handle:0
+                               mask:flags
+                            onQueue:dispatchQueue]) != nil)
+        _flags = flags;
+    return self;
+}
+
+- (instancetype)initWithFlags:(dispatch_source_memorypressure_flags_t)flags
+                dispatchQueue:(id<PWDispatchQueueing>)dispatchQueue
+                      monitor:(PWDispatchMemoryPressureMonitor*)monitor
+{
+    NSParameterAssert(dispatchQueue);
+    NSParameterAssert(monitor);
+
+    // The monitor merges its levels into the data of the source, just like the system source reports them.
+    if ((self = [super initWithType:DISPATCH_SOURCE_TYPE_DATA_OR
+                             handle:0
+                               mask:0
+                            onQueue:dispatchQueue]) != nil)
+    {
+        _flags = flags;
+        [monitor addObserver:self];
+    }
+    return self;
 }
 
 @end
@@ -8,12 +8,13 @@
 
 #import "PWDispatchObserver-Private.h"
 #import "PWDispatchQueue.h"
+#import <stdatomic.h>
 
 NS_ASSUME_NONNULL_BEGIN
 
 @implementation PWDispatchObserver
 {
-    NSUInteger          _disableCount;
+    _Atomic(NSUInteger) _disableCount;     // atomic, so that observers can check it without a queue hop
 }
 
 - (instancetype) initWithDispatchQueue:(id<PWDispatchQueueing>)queue
@@ -43,31 +44,23 @@ NS_ASSUME_NONNULL_BEGIN
     }
 }
 
-// TODO: We should code disable counting using atomic methods to protect against sharing accross queues, which we currently do not use
-
 - (void)disable
 {
-    [_internalQueue asynchronouslyDispatchBlock:^{
-        NSAssert(_disableCount < 10, @"unbalanced disable?");
-        _disableCount++;
-    }];
+    NSUInteger previousCount = atomic_fetch_add(&_disableCount, 1);
+    NSAssert(previousCount < 10, @"unbalanced disable?");
+    (void)previousCount;
 }
 
 - (void)enable
 {
-    [_internalQueue asynchronouslyDispatchBlock:^{
-        NSAssert(_disableCount > 0, @"unbalanced enable");
-        _disableCount--;
-    }];
+    NSUInteger previousCount = atomic_fetch_sub(&_disableCount, 1);
+    NSAssert(previousCount > 0, @"unbalanced enable");
+    (void)previousCount;
 }
 
 - (BOOL)isDisabled
 {
-    __block BOOL result;
-    [_internalQueue synchronouslyDispatchBlock:^{
-        result = (_disableCount > 0);
-    }];
-    return result;
+    return atomic_load(&_disableCount) > 0;
 }
 
 @end
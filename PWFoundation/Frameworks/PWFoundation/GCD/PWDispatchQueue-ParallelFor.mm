@@ -0,0 +1,54 @@
+//
+//  PWDispatchQueue-ParallelFor.mm
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import "PWDispatchQueue.h"
+#import "PWParallelFor.hpp"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@implementation PWDispatchQueue (ParallelFor)
+
+- (void) parallelForRange:(NSRange)range
+                grainSize:(NSUInteger)grainSize
+                    block:(void (^)(NSRange chunk))block
+{
+    NSParameterAssert (block);
+
+    PWFoundation::parallel_for (self.underlyingQueue, range.location, NSMaxRange (range), grainSize,
+                                [block](size_t begin, size_t end) {
+                                    block (NSMakeRange (begin, end - begin));
+                                });
+}
+
+- (id) parallelReduceRange:(NSRange)range
+                 grainSize:(NSUInteger)grainSize
+        accumulatorFactory:(id (^)(void))accumulatorFactory
+                     block:(void (^)(NSRange chunk, id accumulator))block
+                 reduction:(id (^)(id accumulator, id otherAccumulator))reduction
+{
+    NSParameterAssert (accumulatorFactory);
+    NSParameterAssert (block);
+    NSParameterAssert (reduction);
+
+    return PWFoundation::parallel_reduce (self.underlyingQueue, range.location, NSMaxRange (range), grainSize,
+                                          [accumulatorFactory]() -> id {
+                                              id accumulator = accumulatorFactory();
+                                              NSCAssert (accumulator, @"accumulator factory returned nil");
+                                              return accumulator;
+                                          },
+                                          [block](size_t begin, size_t end, id accumulator) {
+                                              block (NSMakeRange (begin, end - begin), accumulator);
+                                          },
+                                          [reduction](id accumulator, id otherAccumulator) -> id {
+                                              return reduction (accumulator, otherAccumulator);
+                                          });
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
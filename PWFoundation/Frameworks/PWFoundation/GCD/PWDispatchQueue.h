@@ -78,6 +78,31 @@ NS_ASSUME_NONNULL_BEGIN
 
 #pragma mark
 
+// Range based parallel loops. Unlike -synchronouslyDispatchBlock:times:, the blocks are called once per chunk of
+// indexes, and idle workers steal chunks from busy ones. See PWParallelFor.hpp for the C++ variants, which avoid
+// boxing accumulators.
+// A grain size of 0 selects the chunk size automatically. Nested loops only use processors which are not busy with other
+// parallel loops. Like -synchronouslyDispatchBlock:times:, these methods are never mapped to Foundation by the main queue
+// and, for a serial receiver, must not be called from a block running on it.
+@interface PWDispatchQueue (ParallelFor)
+
+- (void) parallelForRange:(NSRange)range
+                grainSize:(NSUInteger)grainSize
+                    block:(void (^)(NSRange chunk))block;
+
+// Each worker creates its own accumulator by 'accumulatorFactory' and passes it to all blocks it calls, so the
+// accumulators can be updated without synchronization. At the end the accumulators are combined by 'reduction', which
+// must be associative and may return either argument after merging the other one into it.
+- (id) parallelReduceRange:(NSRange)range
+                 grainSize:(NSUInteger)grainSize
+        accumulatorFactory:(id (^)(void))accumulatorFactory
+                     block:(void (^)(NSRange chunk, id accumulator))block
+                 reduction:(id (^)(id accumulator, id otherAccumulator))reduction;
+
+@end
+
+#pragma mark
+
 #ifdef __cplusplus
 extern "C" {
 #endif
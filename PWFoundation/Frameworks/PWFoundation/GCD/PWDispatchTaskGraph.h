@@ -0,0 +1,105 @@
+//
+//  PWDispatchTaskGraph.h
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import <PWFoundation/PWTypes.h>
+#import <PWFoundation/PWDispatchObject.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class PWDispatchQueue;
+@class PWDispatchTask;
+
+// Returns the result of the task, which may be nil. To fail, return nil and set 'outError'.
+// The block can read the results of the dependencies via task.dependencies.
+typedef id _Nullable (^PWDispatchTaskBlock) (PWDispatchTask* task, NSError** outError);
+
+typedef NS_ENUM (PWInteger, PWDispatchTaskState) {
+    PWDispatchTaskStatePending,     // waiting for dependencies or for the graph to run
+    PWDispatchTaskStateScheduled,   // dispatched to its queue
+    PWDispatchTaskStateRunning,
+    PWDispatchTaskStateSucceeded,
+    PWDispatchTaskStateFailed,
+    PWDispatchTaskStateCancelled    // by the graph or because a dependency did not succeed
+};
+
+// Runs tasks with dependencies, like load -> parse -> several independent analyses -> merge. Each task is dispatched to
+// its queue as soon as all of its dependencies have succeeded, so independent tasks run concurrently without wiring
+// groups and semaphores by hand.
+//
+// If a task fails, the tasks depending on it are cancelled with its error and, if cancelsOnFailure is set, all other
+// tasks which did not start yet, too. Running tasks are never interrupted, but can check task.isCancelled.
+//
+// All tasks record when they became ready, started and finished, which allows to find the critical path of the graph.
+@interface PWDispatchTaskGraph : NSObject
+
+// Dependencies must have been added to the receiver before, which keeps the graph acyclic.
+// Tasks can only be added before -run.
+- (PWDispatchTask*) addTaskWithName:(NSString*)name
+                              queue:(PWDispatchQueue*)queue
+                       dependencies:(nullable NSArray<PWDispatchTask*>*)dependencies
+                              block:(PWDispatchTaskBlock)block;
+
+// Starts the tasks without dependencies. Can be called only once.
+- (void) run;
+
+// Cancels all tasks which did not start yet. The error of the graph becomes a user cancelled error unless it failed
+// already.
+- (void) cancel;
+
+- (BOOL) waitForCompletionWithTimeout:(NSTimeInterval)timeout;
+
+// 'block' is called with the error of the graph after all tasks succeeded, failed or have been cancelled.
+- (void) onCompletionDispatchBlock:(void (^)(NSError* _Nullable error))block onQueue:(PWDispatchQueue*)queue;
+
+// Default is YES.
+@property (nonatomic, readwrite)                    BOOL                        cancelsOnFailure;
+
+@property (nonatomic, readonly, copy)               NSArray<PWDispatchTask*>*   tasks;
+@property (nonatomic, readonly)                     BOOL                        isCancelled;
+
+// The error of the first failing task or of -cancel.
+@property (nonatomic, readonly, strong, nullable)   NSError*                    error;
+
+// After completion: the chain of tasks which determined the total duration, in execution order. It ends with the task
+// which finished last and each task in it is the dependency of its successor which finished last.
+@property (nonatomic, readonly, copy)               NSArray<PWDispatchTask*>*   criticalPath;
+
+// After completion: one line per task with its wait and run durations. Tasks on the critical path are marked by '*'.
+@property (nonatomic, readonly, copy)               NSString*                   timingDescription;
+
+@end
+
+#pragma mark
+
+@interface PWDispatchTask : NSObject
+
+- (instancetype) init NS_UNAVAILABLE;
+
+@property (nonatomic, readonly, copy)               NSString*                   name;
+@property (nonatomic, readonly, strong)             PWDispatchQueue*            queue;
+@property (nonatomic, readonly, copy)               NSArray<PWDispatchTask*>*   dependencies;
+
+@property (nonatomic, readonly)                     PWDispatchTaskState         state;
+@property (nonatomic, readonly, strong, nullable)   id                          result;
+@property (nonatomic, readonly, strong, nullable)   NSError*                    error;
+
+// YES if the task or its graph has been cancelled. Long running tasks should check it periodically.
+@property (nonatomic, readonly)                     BOOL                        isCancelled;
+
+// Times in seconds since the graph started to run. 0 if not reached.
+@property (nonatomic, readonly)                     NSTimeInterval              readyTime;
+@property (nonatomic, readonly)                     NSTimeInterval              startTime;
+@property (nonatomic, readonly)                     NSTimeInterval              finishTime;
+
+// Between readyTime and startTime, that is the time spent waiting for the queue.
+@property (nonatomic, readonly)                     NSTimeInterval              waitDuration;
+@property (nonatomic, readonly)                     NSTimeInterval              runDuration;
+
+@end
+
+NS_ASSUME_NONNULL_END
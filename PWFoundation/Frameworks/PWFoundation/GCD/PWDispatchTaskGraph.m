@@ -0,0 +1,442 @@
+//
+//  PWDispatchTaskGraph.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import "PWDispatchTaskGraph.h"
+#import "PWDispatch.h"
+#import "NSError-PWExtensions.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+// All mutable state of a graph and its tasks is protected by the internal queue of the graph.
+@interface PWDispatchTask ()
+{
+@package
+    PWDispatchQueue*                    _internalQueue;
+    PWDispatchTaskBlock _Nullable       _block;
+    NSMutableArray<PWDispatchTask*>*    _dependents;
+    NSUInteger                          _remainingDependencyCount;
+    PWDispatchTaskState                 _state;
+    id _Nullable                        _result;
+    NSError* _Nullable                  _error;
+    BOOL                                _isGraphCancelled;
+    NSTimeInterval                      _readyTime;
+    NSTimeInterval                      _startTime;
+    NSTimeInterval                      _finishTime;
+}
+
+- (instancetype) initWithName:(NSString*)name
+                        queue:(PWDispatchQueue*)queue
+                 dependencies:(NSArray<PWDispatchTask*>*)dependencies
+                internalQueue:(PWDispatchQueue*)internalQueue
+                        block:(PWDispatchTaskBlock)block;
+
+@end
+
+#pragma mark
+
+@implementation PWDispatchTaskGraph
+{
+    PWDispatchQueue*                    _internalQueue;
+    PWDispatchGroup*                    _group;             // entered for each task which is not done when running
+    NSMutableArray<PWDispatchTask*>*    _tasks;
+    NSMutableArray<PWDispatchBlock>*    _completionBlocks;  // registered before -run
+    NSTimeInterval                      _startUptime;
+    BOOL                                _isRunning;
+    BOOL                                _isCancelled;
+    BOOL                                _cancelsOnFailure;
+    NSError* _Nullable                  _error;
+}
+
+- (instancetype) init
+{
+    if ((self = [super init]) != nil)
+    {
+        _internalQueue    = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWDispatchTaskGraph"];
+        _group            = [[PWDispatchGroup alloc] init];
+        _tasks            = [NSMutableArray array];
+        _completionBlocks = [NSMutableArray array];
+        _cancelsOnFailure = YES;
+    }
+    return self;
+}
+
+- (PWDispatchTask*) addTaskWithName:(NSString*)name
+                              queue:(PWDispatchQueue*)queue
+                       dependencies:(nullable NSArray<PWDispatchTask*>*)dependencies
+                              block:(PWDispatchTaskBlock)block
+{
+    NSParameterAssert (name);
+    NSParameterAssert (queue);
+    NSParameterAssert (block);
+
+    // Duplicate dependencies would be counted twice.
+    NSArray<PWDispatchTask*>* uniqueDependencies = dependencies ? [NSOrderedSet orderedSetWithArray:dependencies].array : @[];
+    PWDispatchTask* task = [[PWDispatchTask alloc] initWithName:name
+                                                          queue:queue
+                                                   dependencies:uniqueDependencies
+                                                  internalQueue:_internalQueue
+                                                          block:block];
+    [_internalQueue synchronouslyDispatchBlock:^{
+        NSAssert (!_isRunning, @"tasks can only be added before running the graph");
+        for (PWDispatchTask* dependency in uniqueDependencies)
+        {
+            NSAssert (dependency->_internalQueue == _internalQueue, @"dependency %@ belongs to another graph", dependency.name);
+            [dependency->_dependents addObject:task];
+        }
+        task->_remainingDependencyCount = uniqueDependencies.count;
+        [_tasks addObject:task];
+    }];
+    return task;
+}
+
+- (void) run
+{
+    [_internalQueue synchronouslyDispatchBlock:^{
+        NSAssert (!_isRunning, @"graph is already running");
+        _isRunning   = YES;
+        _startUptime = NSProcessInfo.processInfo.systemUptime;
+
+        for (PWDispatchTask* task in _tasks)
+            if (task->_state == PWDispatchTaskStatePending)
+                [_group enter];
+        for (PWDispatchBlock completionBlock in _completionBlocks)
+            [_group onCompletionDispatchBlock:completionBlock onQueue:_internalQueue];
+        _completionBlocks = nil;
+
+        for (PWDispatchTask* task in _tasks)
+            if (task->_state == PWDispatchTaskStatePending && task->_remainingDependencyCount == 0)
+                [self scheduleTask:task];
+    }];
+}
+
+- (void) cancel
+{
+    [_internalQueue synchronouslyDispatchBlock:^{
+        [self cancelWithError:[NSError userCancelledErrorWithFormat:@"Task graph cancelled"]];
+    }];
+}
+
+- (BOOL) waitForCompletionWithTimeout:(NSTimeInterval)timeout
+{
+    return [_group waitForCompletionWithTimeout:timeout useWallTime:NO];
+}
+
+- (void) onCompletionDispatchBlock:(void (^)(NSError* _Nullable error))block onQueue:(PWDispatchQueue*)queue
+{
+    NSParameterAssert (block);
+    NSParameterAssert (queue);
+
+    PWDispatchBlock completionBlock = ^{
+        NSError* error = _error;    // on the internal queue
+        [queue asynchronouslyDispatchBlock:^{
+            block (error);
+        }];
+    };
+    [_internalQueue synchronouslyDispatchBlock:^{
+        if (_isRunning)
+            [_group onCompletionDispatchBlock:completionBlock onQueue:_internalQueue];
+        else
+            [_completionBlocks addObject:completionBlock];
+    }];
+}
+
+- (BOOL) cancelsOnFailure
+{
+    __block BOOL result;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        result = _cancelsOnFailure;
+    }];
+    return result;
+}
+
+- (void) setCancelsOnFailure:(BOOL)cancelsOnFailure
+{
+    [_internalQueue synchronouslyDispatchBlock:^{
+        _cancelsOnFailure = cancelsOnFailure;
+    }];
+}
+
+- (NSArray<PWDispatchTask*>*) tasks
+{
+    __block NSArray<PWDispatchTask*>* tasks;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        tasks = [_tasks copy];
+    }];
+    return tasks;
+}
+
+- (BOOL) isCancelled
+{
+    __block BOOL result;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        result = _isCancelled;
+    }];
+    return result;
+}
+
+- (nullable NSError*) error
+{
+    __block NSError* error;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        error = _error;
+    }];
+    return error;
+}
+
+- (NSArray<PWDispatchTask*>*) criticalPath
+{
+    NSMutableArray<PWDispatchTask*>* path = [NSMutableArray array];
+    [_internalQueue synchronouslyDispatchBlock:^{
+        PWDispatchTask* task = [self lastFinishedTaskOf:_tasks];
+        while (task)
+        {
+            [path insertObject:task atIndex:0];
+            task = [self lastFinishedTaskOf:task.dependencies];
+        }
+    }];
+    return path;
+}
+
+- (NSString*) timingDescription
+{
+    NSSet<PWDispatchTask*>* criticalTasks = [NSSet setWithArray:self.criticalPath];
+    NSMutableString* description = [NSMutableString string];
+    [_internalQueue synchronouslyDispatchBlock:^{
+        static NSString* const stateNames[] = { @"pending", @"scheduled", @"running", @"succeeded", @"failed", @"cancelled" };
+        for (PWDispatchTask* task in _tasks)
+            [description appendFormat:@"%@ %@ (%@): waited %.3f s, ran %.3f s\n",
+             [criticalTasks containsObject:task] ? @"*" : @" ",
+             task.name,
+             stateNames[task->_state],
+             MAX (task->_startTime - task->_readyTime, 0.0),
+             MAX (task->_finishTime - task->_startTime, 0.0)];
+    }];
+    return description;
+}
+
+#pragma mark - Internal
+
+- (NSTimeInterval) now
+{
+    return NSProcessInfo.processInfo.systemUptime - _startUptime;
+}
+
+- (nullable PWDispatchTask*) lastFinishedTaskOf:(NSArray<PWDispatchTask*>*)tasks
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    PWDispatchTask* lastTask;
+    for (PWDispatchTask* task in tasks)
+        if (   (task->_state == PWDispatchTaskStateSucceeded || task->_state == PWDispatchTaskStateFailed)
+            && (!lastTask || task->_finishTime > lastTask->_finishTime))
+            lastTask = task;
+    return lastTask;
+}
+
+- (void) scheduleTask:(PWDispatchTask*)task
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    task->_state = PWDispatchTaskStateScheduled;
+    task->_readyTime = self.now;
+    [task.queue asynchronouslyDispatchBlock:^{
+        [self performTask:task];
+    }];
+}
+
+- (void) performTask:(PWDispatchTask*)task
+{
+    __block PWDispatchTaskBlock block;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        // The task may have been cancelled after it was scheduled.
+        if (task->_state != PWDispatchTaskStateScheduled)
+            return;
+        task->_state = PWDispatchTaskStateRunning;
+        task->_startTime = self.now;
+        block = task->_block;
+    }];
+    if (!block)
+        return;
+
+    NSError* error;
+    id result = block (task, &error);
+
+    [_internalQueue synchronouslyDispatchBlock:^{
+        task->_finishTime = self.now;
+        task->_block = nil;
+        if (!result && error)
+        {
+            task->_state = PWDispatchTaskStateFailed;
+            task->_error = error;
+            if (!_error)
+                _error = error;
+            for (PWDispatchTask* dependent in task->_dependents)
+                [self cancelTask:dependent withError:error];
+            if (_cancelsOnFailure)
+                [self cancelWithError:error];
+        }
+        else
+        {
+            task->_state = PWDispatchTaskStateSucceeded;
+            task->_result = result;
+            for (PWDispatchTask* dependent in task->_dependents)
+            {
+                NSAssert (dependent->_remainingDependencyCount > 0, @"unbalanced dependency count");
+                if (--dependent->_remainingDependencyCount == 0 && dependent->_state == PWDispatchTaskStatePending)
+                    [self scheduleTask:dependent];
+            }
+        }
+        [_group leave];
+    }];
+}
+
+// Cancels 'task' and, transitively, its dependents if they did not start yet.
+- (void) cancelTask:(PWDispatchTask*)task withError:(NSError*)error
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    if (task->_state != PWDispatchTaskStatePending && task->_state != PWDispatchTaskStateScheduled)
+        return;
+    task->_state = PWDispatchTaskStateCancelled;
+    task->_error = error;
+    task->_block = nil;
+    if (_isRunning)
+        [_group leave];
+    for (PWDispatchTask* dependent in task->_dependents)
+        [self cancelTask:dependent withError:error];
+}
+
+- (void) cancelWithError:(NSError*)error
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    if (_isCancelled)
+        return;
+    _isCancelled = YES;
+    if (!_error)
+        _error = error;
+    for (PWDispatchTask* task in _tasks)
+    {
+        task->_isGraphCancelled = YES;
+        [self cancelTask:task withError:_error];
+    }
+}
+
+@end
+
+#pragma mark
+
+@implementation PWDispatchTask
+
+- (instancetype) initWithName:(NSString*)name
+                        queue:(PWDispatchQueue*)queue
+                 dependencies:(NSArray<PWDispatchTask*>*)dependencies
+                internalQueue:(PWDispatchQueue*)internalQueue
+                        block:(PWDispatchTaskBlock)block
+{
+    if ((self = [super init]) != nil)
+    {
+        _name          = [name copy];
+        _queue         = queue;
+        _dependencies  = [dependencies copy];
+        _internalQueue = internalQueue;
+        _block         = [block copy];
+        _dependents    = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (PWDispatchTaskState) state
+{
+    __block PWDispatchTaskState state;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        state = _state;
+    }];
+    return state;
+}
+
+- (nullable id) result
+{
+    __block id result;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        result = _result;
+    }];
+    return result;
+}
+
+- (nullable NSError*) error
+{
+    __block NSError* error;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        error = _error;
+    }];
+    return error;
+}
+
+- (BOOL) isCancelled
+{
+    __block BOOL result;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        result = _state == PWDispatchTaskStateCancelled || _isGraphCancelled;
+    }];
+    return result;
+}
+
+- (NSTimeInterval) readyTime
+{
+    __block NSTimeInterval time;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        time = _readyTime;
+    }];
+    return time;
+}
+
+- (NSTimeInterval) startTime
+{
+    __block NSTimeInterval time;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        time = _startTime;
+    }];
+    return time;
+}
+
+- (NSTimeInterval) finishTime
+{
+    __block NSTimeInterval time;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        time = _finishTime;
+    }];
+    return time;
+}
+
+- (NSTimeInterval) waitDuration
+{
+    __block NSTimeInterval duration;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        duration = MAX (_startTime - _readyTime, 0.0);
+    }];
+    return duration;
+}
+
+- (NSTimeInterval) runDuration
+{
+    __block NSTimeInterval duration;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        duration = MAX (_finishTime - _startTime, 0.0);
+    }];
+    return duration;
+}
+
+- (NSString*) description
+{
+    return [NSString stringWithFormat:@"<%@ %p %@>", self.class, self, _name];
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,86 @@
+//
+//  PWDispatchTimerWheel.h
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import <PWFoundation/PWDispatchObject.h>    // for PWDispatchBlock
+
+NS_ASSUME_NONNULL_BEGIN
+
+@protocol PWDispatchQueueing;
+@class PWDispatchWheelTimer;
+
+// A timer service for large numbers of timers, like per-connection timeouts which are rescheduled constantly and rarely
+// fire. Every PWDispatchTimer is a dispatch source of its own and each reschedule updates a kernel timer. The timers
+// of a wheel instead live in a hierarchical timing wheel driven by a single dispatch timer. It is armed for the next tick
+// at which a timer fires or timers move to a lower level of the wheel, so long timeouts cause only a few wakeups.
+// Starting, rescheduling and canceling a timer are O(1).
+//
+// Timers fire at the first tick at or after their fire time, that is up to one resolution late. Timers with a leeway
+// are moved to ticks they share with other timers, and all timers which fire at the same tick are delivered to their
+// queue by a single dispatch.
+//
+// Wheel timers always use the uptime clock, like PWDispatchTimer without wall time.
+@interface PWDispatchTimerWheel : NSObject
+
+- (instancetype) init NS_UNAVAILABLE;
+- (instancetype) initWithResolution:(NSTimeInterval)resolution NS_DESIGNATED_INITIALIZER;
+
+// The shapes of these methods correspond to the ones of PWDispatchTimer.
+- (PWDispatchWheelTimer*) enabledTimerWithQueue:(id<PWDispatchQueueing>)queue
+                           startIntervalFromNow:(NSTimeInterval)startInterval
+                             repetitionInterval:(NSTimeInterval)repetitionInterval
+                                         leeway:(NSTimeInterval)leeway
+                                     eventBlock:(PWDispatchBlock)handler;
+
+- (PWDispatchWheelTimer*) enabledSingleShotTimerWithQueue:(id<PWDispatchQueueing>)queue
+                                      fireIntervalFromNow:(NSTimeInterval)fireInterval
+                                                   leeway:(NSTimeInterval)leeway
+                                               eventBlock:(PWDispatchBlock)handler;
+
+@property (nonatomic, readonly) NSTimeInterval  resolution;
+
+// The number of timers waiting to fire.
+@property (nonatomic, readonly) NSUInteger      timerCount;
+
+// Cancels all timers and the underlying dispatch timer.
+- (void) dispose;
+
+#pragma mark - For unit testing
+
+// The number of times the underlying dispatch timer has fired.
+@property (nonatomic, readonly) NSUInteger      wakeupCount;
+
+@end
+
+#pragma mark
+
+// Like a dispatch source, a running timer is retained by its wheel. Repeating timers must therefore be stopped with
+// -cancel when no longer needed. Single shot timers are released after they fired.
+@interface PWDispatchWheelTimer : NSObject
+
+- (instancetype) init NS_UNAVAILABLE;
+
+// Reschedules the timer. Can also restart a single shot timer which fired already, but not a canceled timer.
+- (void) setStartIntervalFromNow:(NSTimeInterval)startInterval
+              repetitionInterval:(NSTimeInterval)repetitionInterval
+                          leeway:(NSTimeInterval)leeway;
+
+- (void) setFireIntervalFromNow:(NSTimeInterval)fireInterval
+                         leeway:(NSTimeInterval)leeway;
+
+- (void) cancel;
+
+@property (nonatomic, readonly, strong) PWDispatchTimerWheel*   wheel;
+@property (nonatomic, readonly, strong) id<PWDispatchQueueing>  queue;
+@property (nonatomic, readonly)         BOOL                    isCancelled;
+
+// Number of times the timer has fired since the last handler invocation. Only valid inside the event block.
+@property (nonatomic, readonly)         NSUInteger              fireCount;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,587 @@
+//
+//  PWDispatchTimerWheel.mm
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import "PWDispatchTimerWheel.h"
+#import "PWDispatch.h"
+#import <time.h>
+#import <vector>
+#import <unordered_map>
+
+NS_ASSUME_NONNULL_BEGIN
+
+namespace PW {
+
+    struct WheelNode {
+        WheelNode* _Nullable                prev_       = nullptr;
+        WheelNode* _Nullable                next_       = nullptr;
+        WheelNode* _Nullable* _Nullable     list_       = nullptr;  // head of the containing slot, nullptr if not in the wheel
+        uint64_t                            expiryTick_ = 0;
+        __unsafe_unretained id _Nullable    owner_      = nil;
+    };
+
+    // A hierarchical timing wheel with LevelCount levels of SlotCount slots each. A node lives at the level of the
+    // highest slot digit in which its expiry tick differs from the current tick. Whenever the current tick reaches the
+    // start of a slot of a higher level, the nodes of this slot are cascaded down to lower levels. Nodes beyond the
+    // range of the highest level wait in an overflow list which is cascaded once per rotation of the highest level.
+    class TimerWheel {
+    public:
+        static const unsigned SlotBits   = 6;
+        static const unsigned SlotCount  = 1 << SlotBits;
+        static const unsigned LevelCount = 4;
+
+        uint64_t currentTick() const { return current_; }
+        size_t   count() const       { return count_; }
+
+        // Only valid while the wheel is empty.
+        void reset (uint64_t tick)
+        {
+            NSCParameterAssert (count_ == 0);
+            current_ = tick;
+        }
+
+        // Nodes which are due already expire at the next tick.
+        void insert (WheelNode* node)
+        {
+            NSCParameterAssert (!node->list_);
+            if (node->expiryTick_ <= current_)
+                node->expiryTick_ = current_ + 1;
+            place (node);
+        }
+
+        void remove (WheelNode* node)
+        {
+            NSCParameterAssert (node->list_);
+            if (node->prev_)
+                node->prev_->next_ = node->next_;
+            else
+                *node->list_ = node->next_;
+            if (node->next_)
+                node->next_->prev_ = node->prev_;
+            node->prev_ = node->next_ = nullptr;
+            node->list_ = nullptr;
+            --count_;
+        }
+
+        // The first tick after the current one at which nodes expire or are cascaded. Only valid while the wheel is not
+        // empty. The nodes of a level lie within the current slot of the next higher level, so the events of a level
+        // all come before those of higher levels.
+        uint64_t nextEventTick () const
+        {
+            NSCParameterAssert (count_ > 0);
+            for (unsigned level = 0; level < LevelCount; ++level)
+            {
+                unsigned shift = level * SlotBits;
+                unsigned digit = (unsigned)(current_ >> shift) & (SlotCount - 1);
+                for (unsigned slot = digit + 1; slot < SlotCount; ++slot)
+                    if (slots_[level][slot])
+                        return (current_ >> (shift + SlotBits) << (shift + SlotBits)) | ((uint64_t)slot << shift);
+            }
+            NSCAssert (overflow_, @"nodes must be in the overflow list");
+            unsigned shift = LevelCount * SlotBits;
+            return ((current_ >> shift) + 1) << shift;
+        }
+
+        // Advances the wheel and passes each expired node, which is no longer in the wheel, to 'expire'. Ticks at which
+        // nothing expires or is cascaded are skipped.
+        // 'expire' may insert the passed node again, but must not otherwise change the wheel.
+        template <class Expire>
+        void advanceTo (uint64_t tick, Expire expire)
+        {
+            while (current_ < tick)
+            {
+                uint64_t t = count_ > 0 ? nextEventTick() : tick + 1;
+                if (t > tick)
+                {
+                    current_ = tick;
+                    break;
+                }
+                current_ = t;
+                if ((t & ((1ull << (LevelCount * SlotBits)) - 1)) == 0)
+                    cascade (&overflow_);
+                for (unsigned level = LevelCount - 1; level > 0; --level)
+                    if ((t & ((1ull << (level * SlotBits)) - 1)) == 0)
+                        cascade (&slots_[level][(t >> (level * SlotBits)) & (SlotCount - 1)]);
+                for (WheelNode* node = detach (&slots_[0][t & (SlotCount - 1)]); node; )
+                {
+                    WheelNode* next = node->next_;
+                    node->next_ = nullptr;
+                    expire (node);
+                    node = next;
+                }
+            }
+        }
+
+        // Removes all nodes and passes them to 'removed'.
+        template <class Removed>
+        void removeAll (Removed removed)
+        {
+            for (unsigned level = 0; level <= LevelCount; ++level)
+                for (unsigned slot = 0; slot < (level < LevelCount ? SlotCount : 1); ++slot)
+                    for (WheelNode* node = detach (level < LevelCount ? &slots_[level][slot] : &overflow_); node; )
+                    {
+                        WheelNode* next = node->next_;
+                        node->next_ = nullptr;
+                        removed (node);
+                        node = next;
+                    }
+        }
+
+    private:
+        // A node which expires at the current tick goes to the level 0 slot which is processed next, which is only
+        // the case while cascading.
+        void place (WheelNode* node)
+        {
+            uint64_t differingBits = node->expiryTick_ ^ current_;
+            unsigned level = differingBits ? (63 - (unsigned)__builtin_clzll (differingBits)) / SlotBits : 0;
+            link (node, level < LevelCount ? &slots_[level][(node->expiryTick_ >> (level * SlotBits)) & (SlotCount - 1)]
+                                           : &overflow_);
+            ++count_;
+        }
+
+        void link (WheelNode* node, WheelNode* _Nullable* list)
+        {
+            node->prev_ = nullptr;
+            node->next_ = *list;
+            if (*list)
+                (*list)->prev_ = node;
+            *list = node;
+            node->list_ = list;
+        }
+
+        // Empties the list and returns its former nodes, which are marked as no longer being in the wheel.
+        WheelNode* _Nullable detach (WheelNode* _Nullable* list)
+        {
+            WheelNode* first = *list;
+            *list = nullptr;
+            for (WheelNode* node = first; node; node = node->next_)
+            {
+                node->prev_ = nullptr;
+                node->list_ = nullptr;
+                --count_;
+            }
+            return first;
+        }
+
+        void cascade (WheelNode* _Nullable* list)
+        {
+            for (WheelNode* node = detach (list); node; )
+            {
+                WheelNode* next = node->next_;
+                node->next_ = nullptr;
+                place (node);
+                node = next;
+            }
+        }
+
+        WheelNode* _Nullable    slots_[LevelCount][SlotCount] = {};
+        WheelNode* _Nullable    overflow_ = nullptr;
+        uint64_t                current_  = 0;
+        size_t                  count_    = 0;
+    };
+
+}   // namespace PW
+
+static uint64_t PWDispatchTimerWheelNanosecondsFromInterval (NSTimeInterval interval)
+{
+    return interval > 0.0 ? (uint64_t)(interval * (double)NSEC_PER_SEC) : 0;
+}
+
+#pragma mark
+
+@interface PWDispatchWheelTimer ()
+{
+@package
+    PW::WheelNode               _node;
+    uint64_t                    _deadline;          // in nanoseconds since the start of the wheel
+    uint64_t                    _interval;          // 0 for single shot timers
+    uint64_t                    _leeway;
+    NSUInteger                  _pendingFireCount;  // accumulated since the last delivery
+    NSUInteger                  _fireCount;
+    PWDispatchBlock _Nullable   _eventBlock;
+    BOOL                        _isCancelled;
+}
+
+- (instancetype) initWithWheel:(PWDispatchTimerWheel*)wheel
+                         queue:(id<PWDispatchQueueing>)queue
+                    eventBlock:(PWDispatchBlock)handler;
+
+@end
+
+@interface PWDispatchTimerWheel ()
+
+- (void) startTimer:(PWDispatchWheelTimer*)timer
+       withInterval:(uint64_t)startInterval
+ repetitionInterval:(uint64_t)repetitionInterval
+             leeway:(uint64_t)leeway;
+
+- (void) cancelTimer:(PWDispatchWheelTimer*)timer;
+
+@property (nonatomic, readonly, strong) PWDispatchQueue*    internalQueue;  // protects all wheel and timer state
+
+@end
+
+#pragma mark
+
+@implementation PWDispatchTimerWheel
+{
+    PW::TimerWheel              _timingWheel;
+    PWDispatchTimer* _Nullable  _tickTimer;         // single shot, armed for _scheduledTick
+    uint64_t                    _startTime;         // uptime in nanoseconds at which tick 0 started
+    uint64_t                    _tickLength;        // in nanoseconds
+    uint64_t                    _scheduledTick;     // 0 if the tick timer is not armed
+    NSUInteger                  _wakeupCount;
+    BOOL                        _isTicking;         // whether the tick timer is resumed
+    BOOL                        _isDisposed;
+}
+
+- (instancetype) initWithResolution:(NSTimeInterval)resolution
+{
+    NSParameterAssert (resolution > 0.0);
+
+    if ((self = [super init]) != nil)
+    {
+        _resolution    = resolution;
+        _tickLength    = MAX (PWDispatchTimerWheelNanosecondsFromInterval (resolution), 1);
+        _startTime     = clock_gettime_nsec_np (CLOCK_UPTIME_RAW);
+        _internalQueue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWDispatchTimerWheel"];
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    [self cancelTickTimer];
+}
+
+- (PWDispatchWheelTimer*) enabledTimerWithQueue:(id<PWDispatchQueueing>)queue
+                           startIntervalFromNow:(NSTimeInterval)startInterval
+                             repetitionInterval:(NSTimeInterval)repetitionInterval
+                                         leeway:(NSTimeInterval)leeway
+                                     eventBlock:(PWDispatchBlock)handler
+{
+    PWDispatchWheelTimer* timer = [[PWDispatchWheelTimer alloc] initWithWheel:self queue:queue eventBlock:handler];
+    [timer setStartIntervalFromNow:startInterval repetitionInterval:repetitionInterval leeway:leeway];
+    return timer;
+}
+
+- (PWDispatchWheelTimer*) enabledSingleShotTimerWithQueue:(id<PWDispatchQueueing>)queue
+                                      fireIntervalFromNow:(NSTimeInterval)fireInterval
+                                                   leeway:(NSTimeInterval)leeway
+                                               eventBlock:(PWDispatchBlock)handler
+{
+    PWDispatchWheelTimer* timer = [[PWDispatchWheelTimer alloc] initWithWheel:self queue:queue eventBlock:handler];
+    [timer setFireIntervalFromNow:fireInterval leeway:leeway];
+    return timer;
+}
+
+- (NSUInteger) timerCount
+{
+    __block NSUInteger count;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        count = _timingWheel.count();
+    }];
+    return count;
+}
+
+- (NSUInteger) wakeupCount
+{
+    __block NSUInteger count;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        count = _wakeupCount;
+    }];
+    return count;
+}
+
+- (void) dispose
+{
+    [_internalQueue synchronouslyDispatchBlock:^{
+        _isDisposed = YES;
+        _timingWheel.removeAll ([](PW::WheelNode* node) {
+            PWDispatchWheelTimer* timer = node->owner_;
+            timer->_isCancelled = YES;
+            timer->_eventBlock = nil;
+            CFRelease ((__bridge CFTypeRef)timer);
+        });
+        [self cancelTickTimer];
+    }];
+}
+
+#pragma mark - Internal
+
+- (uint64_t) now
+{
+    return clock_gettime_nsec_np (CLOCK_UPTIME_RAW) - _startTime;
+}
+
+// The first tick at or after 'deadline'. If the leeway allows, the tick is moved to a multiple of a slot length of a
+// higher level, so that timers with similar deadlines fire together and need not be cascaded.
+- (uint64_t) expiryTickForDeadline:(uint64_t)deadline leeway:(uint64_t)leeway
+{
+    uint64_t earliest = (deadline + _tickLength - 1) / _tickLength;
+    uint64_t latest   = MAX (earliest, (deadline + leeway) / _tickLength);
+    for (unsigned level = PW::TimerWheel::LevelCount - 1; level > 0; --level)
+    {
+        uint64_t slotLength = 1ull << (level * PW::TimerWheel::SlotBits);
+        uint64_t aligned = (earliest + slotLength - 1) / slotLength * slotLength;
+        if (aligned <= latest)
+            return aligned;
+    }
+    return earliest;
+}
+
+- (void) startTimer:(PWDispatchWheelTimer*)timer
+       withInterval:(uint64_t)startInterval
+ repetitionInterval:(uint64_t)repetitionInterval
+             leeway:(uint64_t)leeway
+{
+    [_internalQueue synchronouslyDispatchBlock:^{
+        if (_isDisposed || timer->_isCancelled)
+            return;
+
+        if (timer->_node.list_)
+            _timingWheel.remove (&timer->_node);
+        else
+            CFRetain ((__bridge CFTypeRef)timer);    // running timers are owned by the wheel
+
+        uint64_t now = self.now;
+        if (_timingWheel.count() == 0)
+            _timingWheel.reset (now / _tickLength);
+
+        timer->_deadline = now + startInterval;
+        timer->_interval = repetitionInterval > 0 ? MAX (repetitionInterval, _tickLength) : 0;
+        timer->_leeway   = leeway;
+        timer->_node.expiryTick_ = [self expiryTickForDeadline:timer->_deadline leeway:leeway];
+        _timingWheel.insert (&timer->_node);
+        [self scheduleTickTimer];
+    }];
+}
+
+- (void) cancelTimer:(PWDispatchWheelTimer*)timer
+{
+    [_internalQueue synchronouslyDispatchBlock:^{
+        if (timer->_isCancelled)
+            return;
+        timer->_isCancelled = YES;
+        timer->_eventBlock = nil;
+        if (timer->_node.list_)
+        {
+            _timingWheel.remove (&timer->_node);
+            CFRelease ((__bridge CFTypeRef)timer);
+        }
+        if (_timingWheel.count() == 0)
+            [self scheduleTickTimer];
+    }];
+}
+
+// Arms the tick timer for the next tick at which a timer expires or timers need to be cascaded, so that a wheel with
+// only long timeouts wakes up rarely. A tick timer which is armed for an earlier tick is left alone, it re-arms
+// itself when it fires.
+- (void) scheduleTickTimer
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    if (_timingWheel.count() == 0)
+    {
+        [self stopTickTimer];
+        return;
+    }
+
+    uint64_t tick = _timingWheel.nextEventTick();
+    if (_scheduledTick != 0 && _scheduledTick <= tick)
+        return;
+    _scheduledTick = tick;
+
+    uint64_t deadline = tick * _tickLength;
+    uint64_t now = self.now;
+    NSTimeInterval fireInterval = deadline > now ? (double)(deadline - now) / (double)NSEC_PER_SEC : 0.0;
+    // The leeway of the tick timer lets the system coalesce the wheel's wakeups with other timers.
+    NSTimeInterval leeway = (double)_tickLength / (double)NSEC_PER_SEC * 0.5;
+    if (!_tickTimer)
+    {
+        __weak PWDispatchTimerWheel* weakSelf = self;
+        _tickTimer = [PWDispatchTimer enabledSingleShotTimerWithQueue:_internalQueue
+                                                  fireIntervalFromNow:fireInterval
+                                                               leeway:leeway
+                                                          useWallTime:NO
+                                                           eventBlock:^{
+                                                               [weakSelf tick];
+                                                           }];
+    }
+    else
+    {
+        [_tickTimer setFireIntervalFromNow:fireInterval leeway:leeway useWallTime:NO];
+        if (!_isTicking)
+            [_tickTimer resume];
+    }
+    _isTicking = YES;
+}
+
+- (void) stopTickTimer
+{
+    _scheduledTick = 0;
+    if (!_isTicking)
+        return;
+    _isTicking = NO;
+    [_tickTimer suspend];
+}
+
+- (void) cancelTickTimer
+{
+    if (!_tickTimer)
+        return;
+    if (!_isTicking)
+        [_tickTimer resume];    // suspended dispatch objects must not be released
+    [_tickTimer cancel];
+    _tickTimer = nil;
+    _isTicking = NO;
+    _scheduledTick = 0;
+}
+
+- (void) tick
+{
+    PWAssert (_internalQueue.isCurrentDispatchQueue);
+
+    _scheduledTick = 0;
+    _wakeupCount++;
+
+    // Expired timers are collected in one batch per target queue.
+    NSMutableArray<NSMutableArray<PWDispatchWheelTimer*>*>* batches = [NSMutableArray array];
+    std::unordered_map<void*, NSUInteger> batchIndexByQueue;
+
+    uint64_t now = self.now;
+    _timingWheel.advanceTo (now / _tickLength, [&](PW::WheelNode* node) {
+        PWDispatchWheelTimer* timer = node->owner_;
+
+        auto inserted = batchIndexByQueue.emplace ((__bridge void*)timer.queue, batches.count);
+        if (inserted.second)
+            [batches addObject:[NSMutableArray array]];
+        [batches[inserted.first->second] addObject:timer];
+
+        ++timer->_pendingFireCount;
+        if (timer->_interval > 0)
+        {
+            // Like dispatch sources, repeating timers count the intervals which passed without a tick.
+            timer->_deadline += timer->_interval;
+            if (timer->_deadline <= now)
+            {
+                uint64_t missedCount = (now - timer->_deadline) / timer->_interval + 1;
+                timer->_pendingFireCount += missedCount;
+                timer->_deadline += missedCount * timer->_interval;
+            }
+            node->expiryTick_ = [self expiryTickForDeadline:timer->_deadline leeway:timer->_leeway];
+            _timingWheel.insert (node);
+        }
+        else
+            CFRelease ((__bridge CFTypeRef)timer);  // the batch keeps it alive until delivery
+    });
+
+    for (NSMutableArray<PWDispatchWheelTimer*>* batch in batches)
+        [batch.firstObject.queue asynchronouslyDispatchBlock:^{
+            [self deliverBatch:batch];
+        }];
+
+    [self scheduleTickTimer];
+}
+
+- (void) deliverBatch:(NSArray<PWDispatchWheelTimer*>*)batch
+{
+    // A timer whose count has been taken by an earlier batch which was still pending is skipped, like multiple
+    // firings of a dispatch source are merged into one handler invocation.
+    __block std::vector<NSUInteger> fireCounts (batch.count);
+    __block std::vector<PWDispatchBlock> eventBlocks (batch.count);
+    [_internalQueue synchronouslyDispatchBlock:^{
+        NSUInteger index = 0;
+        for (PWDispatchWheelTimer* timer in batch)
+        {
+            if (!timer->_isCancelled)
+            {
+                fireCounts[index]  = timer->_pendingFireCount;
+                eventBlocks[index] = timer->_eventBlock;
+            }
+            timer->_pendingFireCount = 0;
+            ++index;
+        }
+    }];
+
+    NSUInteger index = 0;
+    for (PWDispatchWheelTimer* timer in batch)
+    {
+        if (fireCounts[index] > 0 && eventBlocks[index])
+        {
+            timer->_fireCount = fireCounts[index];
+            eventBlocks[index]();
+        }
+        ++index;
+    }
+}
+
+@end
+
+#pragma mark
+
+@implementation PWDispatchWheelTimer
+
+- (instancetype) initWithWheel:(PWDispatchTimerWheel*)wheel
+                         queue:(id<PWDispatchQueueing>)queue
+                    eventBlock:(PWDispatchBlock)handler
+{
+    NSParameterAssert (wheel);
+    NSParameterAssert (queue);
+    NSParameterAssert (handler);
+
+    if ((self = [super init]) != nil)
+    {
+        _wheel       = wheel;
+        _queue       = queue;
+        _eventBlock  = [handler copy];
+        _node.owner_ = self;
+    }
+    return self;
+}
+
+- (void) setStartIntervalFromNow:(NSTimeInterval)startInterval
+              repetitionInterval:(NSTimeInterval)repetitionInterval
+                          leeway:(NSTimeInterval)leeway
+{
+    [_wheel startTimer:self
+          withInterval:PWDispatchTimerWheelNanosecondsFromInterval (startInterval)
+    repetitionInterval:PWDispatchTimerWheelNanosecondsFromInterval (repetitionInterval)
+                leeway:PWDispatchTimerWheelNanosecondsFromInterval (leeway)];
+}
+
+- (void) setFireIntervalFromNow:(NSTimeInterval)fireInterval
+                         leeway:(NSTimeInterval)leeway
+{
+    [_wheel startTimer:self
+          withInterval:PWDispatchTimerWheelNanosecondsFromInterval (fireInterval)
+    repetitionInterval:0
+                leeway:PWDispatchTimerWheelNanosecondsFromInterval (leeway)];
+}
+
+- (void) cancel
+{
+    [_wheel cancelTimer:self];
+}
+
+- (BOOL) isCancelled
+{
+    __block BOOL result;
+    [_wheel.internalQueue synchronouslyDispatchBlock:^{
+        result = _isCancelled;
+    }];
+    return result;
+}
+
+- (NSUInteger) fireCount
+{
+    return _fireCount;
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
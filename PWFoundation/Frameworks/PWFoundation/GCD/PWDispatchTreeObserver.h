@@ -0,0 +1,56 @@
+//
+//  PWDispatchTreeObserver.h
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import <PWFoundation/PWDispatchFileObserver.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+// Maps the changed paths of a batch to the PWDispatchFileEventMask values which occurred for them.
+typedef void (^PWDispatchTreeObserverBatchBlock)(NSDictionary<NSString*, NSNumber*>* changes);
+
+// Observes whole directory trees and reports their changes in batches.
+//
+// Changes are collected for 'latency' seconds after the first one and then delivered as one batch, in which every path
+// occurs once with the union of its events. Directories created in an observed tree are observed, too. Entries which
+// existed in a new directory before it was observed are reported as written.
+//
+// On Linux, all trees of an observer share a single inotify descriptor, so the number of descriptors does not grow
+// with the number of directories. Changes are reported for the affected entries; creating, deleting and renaming an
+// entry also reports its directory as written. If the kernel dropped events, the roots are reported with
+// PWDispatchFileRevoke and should be rescanned.
+//
+// Elsewhere, every directory is observed by a PWDispatchFileObserver. Changes are reported for the directories, which
+// are written when their entries change, but not for the files in them.
+@interface PWDispatchTreeObserver : NSObject
+
+- (instancetype) init NS_UNAVAILABLE;
+
+- (nullable instancetype) initWithDirectoryURLs:(NSArray<NSURL*>*)URLs
+                                      eventMask:(PWDispatchFileEventMask)mask
+                                        latency:(NSTimeInterval)latency
+                                        onQueue:(id<PWDispatchQueueing>)queue
+                                     batchBlock:(PWDispatchTreeObserverBatchBlock)batchBlock
+                                          error:(NSError**)outError NS_DESIGNATED_INITIALIZER;
+
+// Observers are created disabled.
+- (void) enable;
+
+- (void) disable;
+
+- (void) dispose;
+
+@property (nonatomic, readonly, copy)   NSArray<NSURL*>*            URLs;
+@property (nonatomic, readonly)         PWDispatchFileEventMask     eventMask;
+@property (nonatomic, readonly)         NSTimeInterval              latency;
+
+// The number of directories currently observed.
+@property (atomic, readonly)            NSUInteger                  observedDirectoryCount;
+
+@end
+
+NS_ASSUME_NONNULL_END
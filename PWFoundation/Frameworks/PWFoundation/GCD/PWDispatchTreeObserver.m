@@ -0,0 +1,428 @@
+//
+//  PWDispatchTreeObserver.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import "PWDispatchTreeObserver.h"
+#import "PWDispatch.h"
+#import "PWDispatchSource-Internal.h"
+#import "PWErrors.h"
+
+#if defined(__linux__)
+#import <sys/inotify.h>
+#import <unistd.h>
+#endif
+
+NS_ASSUME_NONNULL_BEGIN
+
+#if defined(__linux__)
+
+static uint32_t PWInotifyMaskFromEventMask(PWDispatchFileEventMask mask)
+{
+    // Creations, deletions and moves are needed to follow the tree in any case.
+    uint32_t inotifyMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+    if(mask & (PWDispatchFileWrite | PWDispatchFileExtend))
+        inotifyMask |= IN_MODIFY | IN_CLOSE_WRITE;
+    if(mask & (PWDispatchFileAttributes | PWDispatchFileLink))
+        inotifyMask |= IN_ATTRIB;
+    return inotifyMask;
+}
+
+static PWDispatchFileEventMask PWEventMaskFromInotifyMask(uint32_t inotifyMask)
+{
+    PWDispatchFileEventMask mask = 0;
+    if(inotifyMask & (IN_DELETE | IN_DELETE_SELF))
+        mask |= PWDispatchFileDelete;
+    if(inotifyMask & (IN_CREATE | IN_MOVED_TO | IN_MODIFY | IN_CLOSE_WRITE))
+        mask |= PWDispatchFileWrite;
+    if(inotifyMask & IN_ATTRIB)
+        mask |= PWDispatchFileAttributes;
+    if(inotifyMask & (IN_MOVED_FROM | IN_MOVE_SELF))
+        mask |= PWDispatchFileRename;
+    if(inotifyMask & IN_UNMOUNT)
+        mask |= PWDispatchFileRevoke;
+    return mask;
+}
+
+#endif
+
+@implementation PWDispatchTreeObserver
+{
+    PWDispatchQueue*                                            _internalQueue;
+    id<PWDispatchQueueing>                                      _queue;
+    PWDispatchTreeObserverBatchBlock                            _batchBlock;
+    NSMutableDictionary<NSString*, NSNumber*>*                  _pendingChanges;    // path -> PWDispatchFileEventMask
+    PWDispatchTimer* _Nullable                                  _batchTimer;
+    BOOL                                                        _isEnabled;
+    BOOL                                                        _isDisposed;
+#if defined(__linux__)
+    PWDispatchFileReader*                                       _reader;
+    int                                                         _inotifyDescriptor;
+    NSMutableDictionary<NSNumber*, NSString*>*                  _pathsByWatch;
+    NSMutableDictionary<NSString*, NSNumber*>*                  _watchesByPath;
+#else
+    NSMutableDictionary<NSString*, PWDispatchFileObserver*>*    _observersByPath;
+#endif
+}
+
+- (nullable instancetype) initWithDirectoryURLs:(NSArray<NSURL*>*)URLs
+                                      eventMask:(PWDispatchFileEventMask)mask
+                                        latency:(NSTimeInterval)latency
+                                        onQueue:(id<PWDispatchQueueing>)queue
+                                     batchBlock:(PWDispatchTreeObserverBatchBlock)batchBlock
+                                          error:(NSError**)outError
+{
+    NSParameterAssert(URLs.count > 0);
+    NSParameterAssert(latency >= 0.0);
+    NSParameterAssert(queue);
+    NSParameterAssert(batchBlock);
+
+#if defined(__linux__)
+    int inotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(inotifyDescriptor == -1)
+    {
+        if(outError)
+            *outError = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+        return nil;
+    }
+#endif
+
+    if((self = [super init]) != nil)
+    {
+        _URLs           = [URLs copy];
+        _eventMask      = mask;
+        _latency        = latency;
+        _queue          = queue;
+        _batchBlock     = [batchBlock copy];
+        _internalQueue  = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWDispatchTreeObserver"];
+        _pendingChanges = [[NSMutableDictionary alloc] init];
+#if defined(__linux__)
+        _inotifyDescriptor = inotifyDescriptor;
+        _pathsByWatch      = [[NSMutableDictionary alloc] init];
+        _watchesByPath     = [[NSMutableDictionary alloc] init];
+        _reader = [[PWDispatchFileReader alloc] initWithFileHandle:[[NSFileHandle alloc] initWithFileDescriptor:inotifyDescriptor
+                                                                                                 closeOnDealloc:YES]
+                                                           onQueue:_internalQueue];
+        __weak PWDispatchTreeObserver* weakSelf = self;
+        _reader.eventBlock = ^{
+            [weakSelf readInotifyEvents];
+        };
+#else
+        _observersByPath = [[NSMutableDictionary alloc] init];
+#endif
+        [_internalQueue synchronouslyDispatchBlock:^{
+            for(NSURL* URL in _URLs)
+            {
+                NSParameterAssert(URL.isFileURL);
+                [self observeTreeAtPath:URL.path.stringByStandardizingPath reportContents:NO];
+            }
+        }];
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    [self dispose];
+}
+
+- (void) enable
+{
+    [_internalQueue synchronouslyDispatchBlock:^{
+        if(_isEnabled || _isDisposed)
+            return;
+        _isEnabled = YES;
+#if defined(__linux__)
+        [_reader enable];
+#else
+        for(PWDispatchFileObserver* observer in _observersByPath.allValues)
+            [observer enable];
+#endif
+    }];
+}
+
+- (void) disable
+{
+    [_internalQueue synchronouslyDispatchBlock:^{
+        if(!_isEnabled || _isDisposed)
+            return;
+        _isEnabled = NO;
+#if defined(__linux__)
+        [_reader disable];
+#else
+        for(PWDispatchFileObserver* observer in _observersByPath.allValues)
+            [observer disable];
+#endif
+    }];
+}
+
+- (void) dispose
+{
+    [_internalQueue synchronouslyDispatchBlock:^{
+        if(_isDisposed)
+            return;
+        _isDisposed = YES;
+#if defined(__linux__)
+        // Cancelling closes the descriptor, which removes all watches.
+        [_reader enable];
+        [_reader cancel];
+        [_pathsByWatch removeAllObjects];
+        [_watchesByPath removeAllObjects];
+#else
+        for(PWDispatchFileObserver* observer in _observersByPath.allValues)
+            [observer cancel];
+        [_observersByPath removeAllObjects];
+#endif
+        [_batchTimer cancel];
+        _batchTimer = nil;
+        [_pendingChanges removeAllObjects];
+    }];
+}
+
+- (NSUInteger) observedDirectoryCount
+{
+    __block NSUInteger count;
+    [_internalQueue synchronouslyDispatchBlock:^{
+#if defined(__linux__)
+        count = _watchesByPath.count;
+#else
+        count = _observersByPath.count;
+#endif
+    }];
+    return count;
+}
+
+#pragma mark - Batching
+
+- (void) addChangeAtPath:(NSString*)path mask:(PWDispatchFileEventMask)mask
+{
+    PWAssert(_internalQueue.isCurrentDispatchQueue);
+    NSParameterAssert(path);
+
+    // Revocations are reported in any case, as they mean that changes may have been missed.
+    mask &= _eventMask | PWDispatchFileRevoke;
+    if(mask == 0 || _isDisposed)
+        return;
+
+    _pendingChanges[path] = @(_pendingChanges[path].unsignedIntegerValue | mask);
+    if(!_batchTimer)
+    {
+        __weak PWDispatchTreeObserver* weakSelf = self;
+        _batchTimer = [PWDispatchTimer enabledSingleShotTimerWithQueue:_internalQueue
+                                                   fireIntervalFromNow:_latency
+                                                                leeway:_latency * 0.1
+                                                           useWallTime:NO
+                                                            eventBlock:^{
+                                                                [weakSelf deliverBatch];
+                                                            }];
+    }
+}
+
+- (void) deliverBatch
+{
+    PWAssert(_internalQueue.isCurrentDispatchQueue);
+
+    _batchTimer = nil;
+    if(_pendingChanges.count == 0)
+        return;
+    NSDictionary<NSString*, NSNumber*>* changes = [_pendingChanges copy];
+    [_pendingChanges removeAllObjects];
+    PWDispatchTreeObserverBatchBlock batchBlock = _batchBlock;
+    [_queue asynchronouslyDispatchBlock:^{
+        batchBlock(changes);
+    }];
+}
+
+#pragma mark - Tree
+
+// Observes the directory at 'path' and all directories below it. With 'reportContents', all entries found are reported
+// as written, because their creation happened before they could be observed.
+- (void) observeTreeAtPath:(NSString*)path reportContents:(BOOL)reportContents
+{
+    PWAssert(_internalQueue.isCurrentDispatchQueue);
+
+    if(![self observeDirectoryAtPath:path])
+        return;
+
+    // Symbolic links are not followed.
+    NSDirectoryEnumerator<NSString*>* enumerator = [NSFileManager.defaultManager enumeratorAtPath:path];
+    for(NSString* relativePath in enumerator)
+    {
+        NSString* entryPath = [path stringByAppendingPathComponent:relativePath];
+        if([enumerator.fileAttributes[NSFileType] isEqual:NSFileTypeDirectory])
+            [self observeDirectoryAtPath:entryPath];
+        if(reportContents)
+            [self addChangeAtPath:entryPath mask:PWDispatchFileWrite];
+    }
+}
+
+#if defined(__linux__)
+
+// Returns NO if the directory could not be observed, for example because it vanished or the watch limit is reached.
+- (BOOL) observeDirectoryAtPath:(NSString*)path
+{
+    PWAssert(_internalQueue.isCurrentDispatchQueue);
+
+    if(_watchesByPath[path])
+        return YES;
+    int watch = inotify_add_watch(_inotifyDescriptor, path.fileSystemRepresentation, PWInotifyMaskFromEventMask(_eventMask));
+    if(watch == -1)
+        return NO;
+
+    // A directory moved within the tree keeps its watch, which is now known under the new path.
+    NSString* previousPath = _pathsByWatch[@(watch)];
+    if(previousPath)
+        [_watchesByPath removeObjectForKey:previousPath];
+    _pathsByWatch[@(watch)] = path;
+    _watchesByPath[path] = @(watch);
+    return YES;
+}
+
+// Forgets the watches of a directory which has been moved away, its events would be reported with stale paths.
+- (void) stopObservingTreeAtPath:(NSString*)path
+{
+    PWAssert(_internalQueue.isCurrentDispatchQueue);
+
+    NSString* prefix = [path stringByAppendingString:@"/"];
+    for(NSString* watchedPath in _watchesByPath.allKeys)
+    {
+        if(![watchedPath isEqualToString:path] && ![watchedPath hasPrefix:prefix])
+            continue;
+        NSNumber* watch = _watchesByPath[watchedPath];
+        inotify_rm_watch(_inotifyDescriptor, watch.intValue);
+        [_pathsByWatch removeObjectForKey:watch];
+        [_watchesByPath removeObjectForKey:watchedPath];
+    }
+}
+
+- (void) readInotifyEvents
+{
+    PWAssert(_internalQueue.isCurrentDispatchQueue);
+
+    char buffer[64 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+    while(!_isDisposed)
+    {
+        ssize_t length = read(_inotifyDescriptor, buffer, sizeof(buffer));
+        if(length <= 0)
+            break;  // EAGAIN: all events have been read
+        for(char* position = buffer; position < buffer + length; )
+        {
+            const struct inotify_event* event = (const struct inotify_event*)position;
+            [self handleInotifyEvent:event];
+            position += sizeof(struct inotify_event) + event->len;
+        }
+    }
+}
+
+- (void) handleInotifyEvent:(const struct inotify_event*)event
+{
+    PWAssert(_internalQueue.isCurrentDispatchQueue);
+
+    if(event->mask & IN_Q_OVERFLOW)
+    {
+        for(NSURL* URL in _URLs)
+            [self addChangeAtPath:URL.path.stringByStandardizingPath mask:PWDispatchFileRevoke];
+        return;
+    }
+
+    NSString* directory = _pathsByWatch[@(event->wd)];
+    if(!directory)
+        return;
+    if(event->mask & IN_IGNORED)
+    {
+        // The directory has been deleted or unmounted.
+        [_pathsByWatch removeObjectForKey:@(event->wd)];
+        [_watchesByPath removeObjectForKey:directory];
+        return;
+    }
+
+    NSString* name = event->len > 0 ? [NSFileManager.defaultManager stringWithFileSystemRepresentation:event->name
+                                                                                                length:strlen(event->name)] : nil;
+    NSString* path = name ? [directory stringByAppendingPathComponent:name] : directory;
+    [self addChangeAtPath:path mask:PWEventMaskFromInotifyMask(event->mask)];
+    if(name && (event->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)))
+        [self addChangeAtPath:directory mask:PWDispatchFileWrite];
+
+    if(name && (event->mask & IN_ISDIR))
+    {
+        if(event->mask & IN_MOVED_FROM)
+            [self stopObservingTreeAtPath:path];
+        if(event->mask & (IN_CREATE | IN_MOVED_TO))
+            [self observeTreeAtPath:path reportContents:YES];
+    }
+}
+
+#else
+
+// Returns NO if the directory could not be observed, for example because it vanished.
+- (BOOL) observeDirectoryAtPath:(NSString*)path
+{
+    PWAssert(_internalQueue.isCurrentDispatchQueue);
+
+    if(_observersByPath[path])
+        return YES;
+    // Writes are needed to find new directories, deletions and renames to forget observers.
+    PWDispatchFileEventMask mask = _eventMask | PWDispatchFileWrite | PWDispatchFileDelete | PWDispatchFileRename | PWDispatchFileRevoke;
+    PWDispatchFileObserver* observer = [[PWDispatchFileObserver alloc] initWithFileURL:[NSURL fileURLWithPath:path isDirectory:YES]
+                                                                             eventMask:mask
+                                                                               onQueue:_internalQueue];
+    if(!observer)
+        return NO;
+
+    __weak PWDispatchTreeObserver* weakSelf = self;
+    __weak PWDispatchFileObserver* weakObserver = observer;
+    observer.eventBlock = ^{
+        PWDispatchFileObserver* strongObserver = weakObserver;
+        if(strongObserver)
+            [weakSelf handleEvent:(PWDispatchFileEventMask)strongObserver.data atPath:path];
+    };
+    _observersByPath[path] = observer;
+    if(_isEnabled)
+        [observer enable];
+    return YES;
+}
+
+- (void) handleEvent:(PWDispatchFileEventMask)mask atPath:(NSString*)path
+{
+    PWAssert(_internalQueue.isCurrentDispatchQueue);
+
+    if(_isDisposed)
+        return;
+    [self addChangeAtPath:path mask:mask];
+
+    if(mask & (PWDispatchFileDelete | PWDispatchFileRename | PWDispatchFileRevoke))
+    {
+        // The observers below a moved directory would report stale paths.
+        NSString* prefix = [path stringByAppendingString:@"/"];
+        for(NSString* observedPath in _observersByPath.allKeys)
+        {
+            if(![observedPath isEqualToString:path] && ![observedPath hasPrefix:prefix])
+                continue;
+            [_observersByPath[observedPath] cancel];
+            [_observersByPath removeObjectForKey:observedPath];
+        }
+    }
+    else if(mask & PWDispatchFileWrite)
+    {
+        // Entries of the directory have changed, new directories have to be observed.
+        NSArray<NSString*>* names = [NSFileManager.defaultManager contentsOfDirectoryAtPath:path error:NULL];
+        for(NSString* name in names)
+        {
+            NSString* entryPath = [path stringByAppendingPathComponent:name];
+            if(_observersByPath[entryPath])
+                continue;
+            NSDictionary<NSFileAttributeKey, id>* attributes = [NSFileManager.defaultManager attributesOfItemAtPath:entryPath error:NULL];
+            if([attributes[NSFileType] isEqual:NSFileTypeDirectory])
+                [self observeTreeAtPath:entryPath reportContents:YES];
+        }
+    }
+}
+
+#endif
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -7,15 +7,15 @@
 //
 
 #import "PWKeyedBlockQueue.h"
+#import "PWOrderedDictionary.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
 @implementation PWKeyedBlockQueue
 {
-    NSMutableArray*         _keysArray;
-    NSMutableDictionary*    _blockByKey;
-    NSUInteger              _suspendCount;
-    BOOL                    _isDisposed;
+    PWMutableOrderedDictionary* _blockByKey;   // in the order in which the blocks were queued
+    NSUInteger                  _suspendCount;
+    BOOL                        _isDisposed;
 }
 
 - (void)suspend
@@ -48,19 +48,11 @@ NS_ASSUME_NONNULL_BEGIN
 
     if(self.isSuspended)
     {
-        if(!_keysArray)
-        {
-            NSAssert(!_blockByKey, nil);
-            _keysArray  = [[NSMutableArray alloc] init];
-            _blockByKey = [[NSMutableDictionary alloc] init];
-        }
+        if(!_blockByKey)
+            _blockByKey = [[PWMutableOrderedDictionary alloc] init];
 
         if(!_blockByKey[key])
-        {
-            key = [key copy];
             _blockByKey[key] = [block copy];
-            [_keysArray addObject:key];
-        }
     }
     else
         block();
@@ -68,23 +60,12 @@ NS_ASSUME_NONNULL_BEGIN
 
 - (void)performAllPendingBlocks
 {
-    NSArray* keys = _keysArray;
-    NSDictionary* blockByKey = _blockByKey;
-
-    _keysArray  = nil;
+    PWMutableOrderedDictionary* blockByKey = _blockByKey;
     _blockByKey = nil;
 
-    NSNull* null = NSNull.null;
-
-    for(id iKey in keys)
-    {
-        if(iKey != null)
-        {
-            PWDispatchBlock block = blockByKey[iKey];
-            NSAssert(block, nil);
-            block();
-        }
-    }
+    [blockByKey enumerateKeysAndObjectsUsingBlock:^(id key, PWDispatchBlock block, BOOL* stop) {
+        block();
+    }];
 }
 
 - (void)performPendingBlockForKey:(NSString*)key
@@ -96,18 +77,7 @@ NS_ASSUME_NONNULL_BEGIN
     {
         [_blockByKey removeObjectForKey:key];
         if(_blockByKey.count == 0)
-        {
-            _keysArray = nil;
             _blockByKey = nil;
-        }
-        else
-        {
-            // Note: We linarly look for the key which leads to O(n^2) behavior for picked blocks.
-            // But as we expect the total number of blocks to be small (<10) we are fine with this
-            NSUInteger index = [_keysArray indexOfObject:key];
-            NSAssert(index != NSNotFound, nil);
-            _keysArray[index] = NSNull.null;   // remove key by nulling out to avoid further O(n^2) behavior
-        }
         block();
     }
 }
@@ -116,7 +86,6 @@ NS_ASSUME_NONNULL_BEGIN
 {
     // break retain cycles
     _blockByKey = nil;
-    _keysArray = nil;   // keep invariant intact
     _isDisposed = YES;
 }
 @end
@@ -0,0 +1,54 @@
+//
+//  PWKeyedDispatchScheduler.h
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import <PWFoundation/PWDispatchObject.h>    // for PWDispatchBlock
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class PWDispatchQueue;
+
+// Schedules blocks by key on a dispatch queue, e.g. to debounce and parallelize recomputations per document.
+// Like for PWKeyedBlockQueue, at most one block is pending per key, but here the latest block wins: a block scheduled
+// for a key which already has a pending block replaces it.
+// Blocks of the same key are never performed concurrently. If a block is scheduled while the block of its key is
+// running, it stays pending until the running block has finished. Blocks of different keys run concurrently if the
+// queue is concurrent, like a PWConcurrentDispatchQueue or a global queue.
+// All methods can be called on any queue.
+@interface PWKeyedDispatchScheduler<KeyType> : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithDispatchQueue:(PWDispatchQueue*)queue NS_DESIGNATED_INITIALIZER;
+
+@property (nonatomic, readonly, strong) PWDispatchQueue*    dispatchQueue;
+
+- (void)forKey:(KeyType <NSCopying>)key scheduleBlock:(PWDispatchBlock)block;
+
+// Returns whether a pending block has been removed. Does not affect a running block.
+- (BOOL)cancelPendingBlockForKey:(KeyType)key;
+
+// While suspended, blocks stay pending. Resuming dispatches the pending blocks in the order in which their keys were
+// first scheduled. Nests with calls to -resume.
+- (void)suspend;
+- (void)resume;
+@property (nonatomic, readonly) BOOL isSuspended;
+
+// Waits until no blocks are dispatched or running. Blocks kept pending by -suspend do not count.
+- (BOOL)waitUntilIdleWithTimeout:(NSTimeInterval)timeout;
+
+// The number of keys with a pending or running block.
+@property (nonatomic, readonly) NSUInteger  keyCount;
+
+// The number of pending blocks which have been replaced by later ones.
+@property (nonatomic, readonly) NSUInteger  replacedBlockCount;
+
+// Drops all pending blocks and ignores blocks scheduled afterwards. Running blocks are not affected.
+- (void)dispose;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,199 @@
+//
+//  PWKeyedDispatchScheduler.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import "PWKeyedDispatchScheduler.h"
+#import "PWDispatch.h"
+#import "PWOrderedDictionary.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface PWKeyedDispatchSchedulerEntry : NSObject
+{
+@public
+    PWDispatchBlock _Nullable   pendingBlock;
+    BOOL                        isDispatched;   // a dispatched block takes the pending block when it starts running
+}
+@end
+
+@implementation PWKeyedDispatchSchedulerEntry
+@end
+
+#pragma mark
+
+@implementation PWKeyedDispatchScheduler
+{
+    PWDispatchQueue*            _internalQueue;
+    PWDispatchGroup*            _group;             // contains the dispatched blocks
+    // The keys with a pending or dispatched block in the order in which they were first scheduled. The ordered
+    // dictionary removes keys in O(1), so there are no scans when blocks finish or are canceled.
+    PWMutableOrderedDictionary* _entriesByKey;
+    NSUInteger                  _suspendCount;
+    NSUInteger                  _replacedBlockCount;
+    BOOL                        _isDisposed;
+}
+
+- (instancetype)initWithDispatchQueue:(PWDispatchQueue*)queue
+{
+    NSParameterAssert(queue);
+
+    if ((self = [super init]) != nil)
+    {
+        _dispatchQueue = queue;
+        _internalQueue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWKeyedDispatchScheduler"];
+        _group         = [[PWDispatchGroup alloc] init];
+        _entriesByKey  = [[PWMutableOrderedDictionary alloc] init];
+    }
+    return self;
+}
+
+- (void)forKey:(id <NSCopying>)key scheduleBlock:(PWDispatchBlock)block
+{
+    NSParameterAssert(key);
+    NSParameterAssert(block);
+
+    id keyCopy = [(id)key copy];
+    PWDispatchBlock blockCopy = [block copy];
+    [_internalQueue synchronouslyDispatchBlock:^{
+        if (_isDisposed)
+            return;
+
+        PWKeyedDispatchSchedulerEntry* entry = _entriesByKey[keyCopy];
+        if (!entry)
+        {
+            entry = [[PWKeyedDispatchSchedulerEntry alloc] init];
+            _entriesByKey[keyCopy] = entry;
+        }
+        else if (entry->pendingBlock)
+            _replacedBlockCount++;
+        entry->pendingBlock = blockCopy;
+        [self dispatchEntryIfNeeded:entry forKey:keyCopy];
+    }];
+}
+
+- (void)dispatchEntryIfNeeded:(PWKeyedDispatchSchedulerEntry*)entry forKey:(id)key
+{
+    PWAssert(_internalQueue.isCurrentDispatchQueue);
+
+    if (_suspendCount > 0 || entry->isDispatched || !entry->pendingBlock)
+        return;
+
+    entry->isDispatched = YES;
+    [_dispatchQueue asynchronouslyDispatchBlock:^{
+        [self performEntry:entry forKey:key];
+    } inGroup:_group];
+}
+
+- (void)performEntry:(PWKeyedDispatchSchedulerEntry*)entry forKey:(id)key
+{
+    // The pending block is taken when the dispatched block starts, so a block which has been replaced after the
+    // dispatch is never performed.
+    __block PWDispatchBlock block;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        block = entry->pendingBlock;
+        entry->pendingBlock = nil;
+    }];
+
+    if (block)
+        block();
+
+    [_internalQueue synchronouslyDispatchBlock:^{
+        entry->isDispatched = NO;
+        if (entry->pendingBlock)
+            [self dispatchEntryIfNeeded:entry forKey:key];
+        else if (_entriesByKey[key] == entry)
+            [_entriesByKey removeObjectForKey:key];
+    }];
+}
+
+- (BOOL)cancelPendingBlockForKey:(id)key
+{
+    NSParameterAssert(key);
+
+    __block BOOL didCancel = NO;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        PWKeyedDispatchSchedulerEntry* entry = _entriesByKey[key];
+        if (entry && entry->pendingBlock)
+        {
+            entry->pendingBlock = nil;
+            if (!entry->isDispatched)
+                [_entriesByKey removeObjectForKey:key];
+            didCancel = YES;
+        }
+    }];
+    return didCancel;
+}
+
+- (void)suspend
+{
+    [_internalQueue synchronouslyDispatchBlock:^{
+        NSAssert(_suspendCount < 10, @"unbalanced suspend?");
+        _suspendCount++;
+    }];
+}
+
+- (void)resume
+{
+    [_internalQueue synchronouslyDispatchBlock:^{
+        NSAssert(_suspendCount > 0, @"unbalanced resume");
+        if (--_suspendCount == 0)
+            [_entriesByKey enumerateKeysAndObjectsUsingBlock:^(id key, PWKeyedDispatchSchedulerEntry* entry, BOOL* stop) {
+                [self dispatchEntryIfNeeded:entry forKey:key];
+            }];
+    }];
+}
+
+- (BOOL)isSuspended
+{
+    __block BOOL result;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        result = _suspendCount > 0;
+    }];
+    return result;
+}
+
+- (BOOL)waitUntilIdleWithTimeout:(NSTimeInterval)timeout
+{
+    return [_group waitForCompletionWithTimeout:timeout useWallTime:NO];
+}
+
+- (NSUInteger)keyCount
+{
+    __block NSUInteger count;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        count = _entriesByKey.count;
+    }];
+    return count;
+}
+
+- (NSUInteger)replacedBlockCount
+{
+    __block NSUInteger count;
+    [_internalQueue synchronouslyDispatchBlock:^{
+        count = _replacedBlockCount;
+    }];
+    return count;
+}
+
+- (void)dispose
+{
+    // Dispatched blocks find no pending block and remove their keys themselves.
+    [_internalQueue synchronouslyDispatchBlock:^{
+        _isDisposed = YES;
+        NSMutableArray* idleKeys = [NSMutableArray array];
+        [_entriesByKey enumerateKeysAndObjectsUsingBlock:^(id key, PWKeyedDispatchSchedulerEntry* entry, BOOL* stop) {
+            entry->pendingBlock = nil;  // break retain cycles
+            if (!entry->isDispatched)
+                [idleKeys addObject:key];
+        }];
+        [_entriesByKey removeObjectsForKeys:idleKeys];
+    }];
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
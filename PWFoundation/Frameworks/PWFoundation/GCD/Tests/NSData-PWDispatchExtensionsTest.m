@@ -0,0 +1,235 @@
+//
+//  NSData-PWDispatchExtensionsTest.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import <PWFoundation/PWDispatch.h>
+#import <PWFoundation/NSData-PWDispatchExtensions.h>
+#import "PWTestCase.h"
+#include <fcntl.h>
+
+@interface NSData_PWDispatchExtensionsTest : PWTestCase
+@end
+
+@implementation NSData_PWDispatchExtensionsTest
+
+- (NSData*)dataWithLength:(NSUInteger)length
+{
+    NSMutableData* data = [NSMutableData dataWithLength:length];
+    uint8_t* bytes = data.mutableBytes;
+    for (NSUInteger index = 0; index < length; index++)
+        bytes[index] = (uint8_t)(index * 13);
+    return [data copy];
+}
+
+// Returns the number of bytes which have been copied when bridging 'data' to dispatch data.
+- (NSUInteger)copiedLengthOfDispatchData:(dispatch_data_t)dispatchData fromData:(NSData*)data
+{
+    __block NSUInteger copiedLength = 0;
+    PWDispatchDataAccessBytes(dispatchData, ^(const void* contiguousBytes, const struct iovec* regions, size_t regionCount) {
+        XCTAssertEqual(regionCount, 1);
+        if (contiguousBytes != data.bytes)
+            copiedLength = regions[0].iov_len;
+    });
+    return copiedLength;
+}
+
+- (void)testNewDispatchDataCopies
+{
+    NSData* data = [self dataWithLength:100000];
+    dispatch_data_t dispatchData = data.newDispatchData;
+    XCTAssertEqual(dispatch_data_get_size(dispatchData), data.length);
+    XCTAssertEqual([self copiedLengthOfDispatchData:dispatchData fromData:data], data.length);
+    XCTAssertEqualObjects([NSData dataWithDispatchData:dispatchData], data);
+}
+
+// Callers may release a buffer they still own as soon as the data has been bridged.
+- (void)testNewDispatchDataCopiesBorrowedBytes
+{
+    const NSUInteger length = 4096;
+    uint8_t* buffer = malloc(length);
+    memset(buffer, 0x5A, length);
+    NSData* data = [[NSData alloc] initWithBytesNoCopy:buffer length:length freeWhenDone:NO];
+    dispatch_data_t dispatchData = data.newDispatchData;
+    data = nil;
+    memset(buffer, 0, length);
+    free(buffer);
+
+    NSData* bridgedData = [NSData dataWithDispatchData:dispatchData];
+    XCTAssertEqual(bridgedData.length, length);
+    XCTAssertEqual(((const uint8_t*)bridgedData.bytes)[length - 1], 0x5A);
+}
+
+- (void)testNewDispatchDataWithoutCopyingDoesNotCopy
+{
+    NSData* data = [self dataWithLength:100000];
+    dispatch_data_t dispatchData = data.newDispatchDataWithoutCopying;
+    XCTAssertEqual(dispatch_data_get_size(dispatchData), data.length);
+    XCTAssertEqual([self copiedLengthOfDispatchData:dispatchData fromData:data], 0);
+    XCTAssertEqualObjects([NSData dataWithDispatchData:dispatchData], data);
+}
+
+- (void)testNewDispatchDataWithoutCopyingKeepsDataAlive
+{
+    dispatch_data_t dispatchData;
+    @autoreleasepool {
+        dispatchData = [self dataWithLength:100000].newDispatchDataWithoutCopying;
+    }
+    XCTAssertEqualObjects([NSData dataWithDispatchData:dispatchData], [self dataWithLength:100000]);
+}
+
+- (void)testNewDispatchDataWithoutCopyingCopiesMutableData
+{
+    NSMutableData* data = [[self dataWithLength:1000] mutableCopy];
+    dispatch_data_t dispatchData = data.newDispatchDataWithoutCopying;
+    XCTAssertEqual([self copiedLengthOfDispatchData:dispatchData fromData:data], data.length);
+
+    memset(data.mutableBytes, 0, data.length);
+    XCTAssertEqualObjects([NSData dataWithDispatchData:dispatchData], [self dataWithLength:1000]);
+}
+
+- (void)testRoundTrip
+{
+    dispatch_data_t dispatchData = [self dataWithLength:1000].newDispatchData;
+    XCTAssertEqual([NSData dataWithDispatchData:dispatchData].newDispatchData, dispatchData);
+    XCTAssertEqual([NSData dataWithDispatchData:dispatchData].newDispatchDataWithoutCopying, dispatchData);
+    XCTAssertEqual(NSData.data.newDispatchData, dispatch_data_empty);
+    XCTAssertEqual(NSData.data.newDispatchDataWithoutCopying, dispatch_data_empty);
+}
+
+- (void)testContiguousBytes
+{
+    NSData* data = [self dataWithLength:1000];
+    __block BOOL called = NO;
+    PWDispatchDataAccessBytes(data.newDispatchDataWithoutCopying, ^(const void* contiguousBytes, const struct iovec* regions, size_t regionCount) {
+        XCTAssertEqual(contiguousBytes, data.bytes);
+        XCTAssertEqual(regionCount, 1);
+        XCTAssertEqual(regions[0].iov_base, data.bytes);
+        XCTAssertEqual(regions[0].iov_len, data.length);
+        called = YES;
+    });
+    XCTAssertTrue(called);
+
+    PWDispatchDataAccessBytes(dispatch_data_empty, ^(const void* contiguousBytes, const struct iovec* regions, size_t regionCount) {
+        XCTAssertTrue(contiguousBytes != NULL);
+        XCTAssertEqual(regionCount, 0);
+    });
+}
+
+- (void)testGatheredRegions
+{
+    // More regions than fit into the inline buffer.
+    NSMutableArray<NSData*>* parts = [NSMutableArray array];
+    dispatch_data_t dispatchData = dispatch_data_empty;
+    for (NSUInteger index = 0; index < 20; index++)
+    {
+        NSData* part = [self dataWithLength:100 + index];
+        [parts addObject:part];
+        dispatchData = dispatch_data_create_concat(dispatchData, part.newDispatchDataWithoutCopying);
+    }
+
+    __block BOOL called = NO;
+    PWDispatchDataAccessBytes(dispatchData, ^(const void* contiguousBytes, const struct iovec* regions, size_t regionCount) {
+        XCTAssertTrue(contiguousBytes == NULL);
+        XCTAssertEqual(regionCount, parts.count);
+        for (NSUInteger index = 0; index < regionCount; index++)
+        {
+            XCTAssertEqual(regions[index].iov_base, parts[index].bytes);
+            XCTAssertEqual(regions[index].iov_len, parts[index].length);
+        }
+        called = YES;
+    });
+    XCTAssertTrue(called);
+}
+
+- (void)testDispatchDataKeepsBytesAlive
+{
+    // A buffer which is only released by the deallocator of the data, like the buffer of an I/O layer would be.
+    const NSUInteger length = 4096;
+    uint8_t* buffer = malloc(length);
+    memset(buffer, 0x5A, length);
+    __block BOOL deallocated = NO;
+    dispatch_data_t dispatchData;
+    @autoreleasepool {
+        NSData* data = [[NSData alloc] initWithBytesNoCopy:buffer length:length deallocator:^(void* bytes, NSUInteger bytesLength) {
+            deallocated = YES;
+            free(bytes);
+        }];
+        dispatchData = data.newDispatchDataWithoutCopying;
+    }
+    XCTAssertFalse(deallocated);
+    PWDispatchDataAccessBytes(dispatchData, ^(const void* contiguousBytes, const struct iovec* regions, size_t regionCount) {
+        XCTAssertTrue(contiguousBytes == buffer);
+        XCTAssertEqual(((const uint8_t*)contiguousBytes)[length - 1], 0x5A);
+    });
+    dispatchData = nil;
+    XCTAssertTrue(deallocated);
+}
+
+#pragma mark - Performance
+
+static const NSUInteger PWDispatchExtensionsPerformanceLength = 16 * 1024 * 1024;
+static const NSUInteger PWDispatchExtensionsPerformanceCount  = 50;
+
+// -newDispatchData copies the whole buffer, for comparison.
+- (void)testCopyingBridgePerformance
+{
+    NSData* data = [self dataWithLength:PWDispatchExtensionsPerformanceLength];
+    __block NSUInteger copiedLength = 0;
+    __block NSUInteger conversionCount = 0;
+    [self measureBlock:^{
+        for (NSUInteger index = 0; index < PWDispatchExtensionsPerformanceCount; index++)
+        {
+            dispatch_data_t dispatchData = data.newDispatchData;
+            copiedLength += [self copiedLengthOfDispatchData:dispatchData fromData:data];
+            conversionCount++;
+        }
+    }];
+    XCTAssertEqual(copiedLength / conversionCount, data.length);
+}
+
+- (void)testZeroCopyBridgePerformance
+{
+    NSData* data = [self dataWithLength:PWDispatchExtensionsPerformanceLength];
+    __block NSUInteger copiedLength = 0;
+    [self measureBlock:^{
+        for (NSUInteger index = 0; index < PWDispatchExtensionsPerformanceCount; index++)
+            copiedLength += [self copiedLengthOfDispatchData:data.newDispatchDataWithoutCopying fromData:data];
+    }];
+    XCTAssertEqual(copiedLength, 0);
+}
+
+// Writes data which owns its bytes without duplicating the payload.
+- (void)testChannelWritePerformance
+{
+    NSURL* URL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"NSData-PWDispatchExtensionsTest"]];
+    [[NSData data] writeToURL:URL atomically:NO];
+    PWDispatchIORandomChannel* channel = [[PWDispatchIORandomChannel alloc] initWithURL:URL
+                                                                              openFlags:O_RDWR
+                                                                           creationMode:0
+                                                                                  queue:PWDispatchQueue.mainQueue
+                                                                         cleanupHandler:nil];
+    PWDispatchQueue* queue = [PWDispatchQueue serialDispatchQueueWithLabel:@"NSData-PWDispatchExtensionsTest"];
+    NSData* data = [self dataWithLength:PWDispatchExtensionsPerformanceLength];
+
+    [self measureBlock:^{
+        PWDispatchSemaphore* written = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+        [channel writeDispatchData:data.newDispatchDataWithoutCopying
+                startingFromOffset:0
+                             queue:queue
+                           handler:^(BOOL done, dispatch_data_t remainingData, NSError* errorOrNil) {
+                               XCTAssertNil(errorOrNil);
+                               if (done)
+                                   [written signal];
+                           }];
+        XCTAssertTrue([written waitWithTimeout:self.longTimeout useWallTime:NO]);
+    }];
+
+    [channel closeImmediately:NO];
+    [NSFileManager.defaultManager removeItemAtURL:URL error:NULL];
+}
+
+@end
@@ -0,0 +1,178 @@
+//
+//  PWCoroutinesTest.mm
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import <PWFoundation/PWDispatch.h>
+#import <PWFoundation/PWAsyncLRUCache.h>
+#import "PWCoroutines.hpp"
+#import "PWTestCase.h"
+#include <fcntl.h>
+
+using namespace PWFoundation;
+
+@interface PWCoroutinesTest : PWTestCase
+@end
+
+static task<NSInteger> add (NSInteger a, NSInteger b)
+{
+    co_return a + b;
+}
+
+// Each iteration awaits a task which completes synchronously. Without symmetric transfer every completion would resume
+// the loop in a nested call.
+static task<NSInteger> sumOfSynchronousTasks (NSInteger count)
+{
+    NSInteger sum = 0;
+    for (NSInteger index = 0; index < count; index++)
+        sum += co_await add (index, 1) - index;
+    co_return sum;
+}
+
+static task<NSArray<NSNumber*>*> isCurrentAfterHops (PWDispatchQueue* first, PWDispatchQueue* second)
+{
+    NSMutableArray<NSNumber*>* results = [NSMutableArray array];
+    co_await first;
+    [results addObject:@(first.isCurrentDispatchQueue)];
+    co_await second;
+    [results addObject:@(second.isCurrentDispatchQueue && !first.isCurrentDispatchQueue)];
+    co_await resume_on (first);
+    [results addObject:@(first.isCurrentDispatchQueue)];
+    co_return results;
+}
+
+static task<io_result> writeAndReadBack (PWDispatchIORandomChannel* channel, NSData* data, PWDispatchQueue* queue)
+{
+    dispatch_data_t dispatchData = dispatch_data_create (data.bytes, data.length, NULL, DISPATCH_DATA_DESTRUCTOR_DEFAULT);
+    io_result written = co_await async_write (channel, dispatchData, 3, queue);
+    NSCAssert (queue.isCurrentDispatchQueue, nil);
+    if (written.error)
+        co_return written;
+    co_return co_await async_read (channel, 0, NSNotFound, queue);
+}
+
+static task<NSArray*> lookUp (PWAsyncLRUCache* cache, NSArray* keys, PWDispatchQueue* queue)
+{
+    NSMutableArray* objects = [NSMutableArray array];
+    for (NSUInteger index = 0; index < keys.count; index++) {
+        id object = co_await async_object_for_key (cache, keys[index], ^(id blockKey, PWLRUCacheObjectResponseBlock responseBlock) {
+            responseBlock ([blockKey uppercaseString]);
+        }, queue);
+        NSCAssert (queue.isCurrentDispatchQueue, nil);
+        [objects addObject:object];
+    }
+    co_return objects;
+}
+
+@implementation PWCoroutinesTest
+
+- (void)testTaskChain
+{
+    XCTAssertEqual(sync_wait (add (1, 2)), 3);
+    XCTAssertEqual(sync_wait (sumOfSynchronousTasks (1000000)), 1000000);
+}
+
+- (void)testQueueHops
+{
+    PWDispatchQueue* first  = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWCoroutinesTest.first"];
+    PWDispatchQueue* second = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWCoroutinesTest.second"];
+    XCTAssertEqualObjects(sync_wait (isCurrentAfterHops (first, second)), (@[@YES, @YES, @YES]));
+}
+
+- (void)testRandomChannel
+{
+    NSURL* URL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"PWCoroutinesTest"]];
+    [[NSData data] writeToURL:URL atomically:NO];
+    PWDispatchIORandomChannel* channel = [[PWDispatchIORandomChannel alloc] initWithURL:URL
+                                                                              openFlags:O_RDWR
+                                                                           creationMode:0
+                                                                                  queue:PWDispatchQueue.mainQueue
+                                                                         cleanupHandler:nil];
+    PWDispatchQueue* queue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWCoroutinesTest"];
+    NSMutableData* data = [NSMutableData dataWithLength:100000];
+    memset(data.mutableBytes, 'x', data.length);
+
+    io_result result = sync_wait (writeAndReadBack (channel, data, queue));
+    XCTAssertNil(result.error);
+    XCTAssertEqual(dispatch_data_get_size (result.data), data.length + 3);
+    [channel closeImmediately:NO];
+    [NSFileManager.defaultManager removeItemAtURL:URL error:NULL];
+}
+
+- (void)testCacheLookup
+{
+    PWAsyncLRUCache<NSString*, NSString*>* cache;
+    cache = [[PWAsyncLRUCache alloc] initWithCapacity:3
+                                       removalHandler:^(id key,
+                                                        id object,
+                                                        BOOL isOptional,
+                                                        PWLRUCacheRemovalResponseHandler responseHandler)
+             {
+                 responseHandler(/* shouldRemove */YES);
+             }];
+    cache[@"b"] = @"cached";
+    PWDispatchQueue* queue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWCoroutinesTest"];
+
+    XCTAssertEqualObjects(sync_wait (lookUp (cache, @[@"a", @"b", @"a"], queue)), (@[@"A", @"cached", @"A"]));
+    XCTAssertEqual(cache.count, 2);
+}
+
+- (void)testFramesAreReused
+{
+    sync_wait (add (1, 2));
+    size_t count = coroutine_detail::frame_pool::cached_frame_count();
+    XCTAssertGreaterThan(count, 0);
+    for (NSUInteger index = 0; index < 100; index++)
+        sync_wait (add (1, 2));
+    XCTAssertEqual(coroutine_detail::frame_pool::cached_frame_count(), count);
+}
+
+#pragma mark - Performance
+
+static const NSUInteger PWCoroutinesPerformanceHopCount = 100000;
+
+static void hopWithBlocks (PWDispatchQueue* first, PWDispatchQueue* second, NSUInteger remaining, PWDispatchBlock completion)
+{
+    if (remaining == 0) {
+        completion();
+        return;
+    }
+    [first asynchronouslyDispatchBlock:^{
+        [second asynchronouslyDispatchBlock:^{
+            hopWithBlocks (first, second, remaining - 1, completion);
+        }];
+    }];
+}
+
+static task<void> hopWithCoroutine (PWDispatchQueue* first, PWDispatchQueue* second, NSUInteger count)
+{
+    for (NSUInteger index = 0; index < count; index++) {
+        co_await first;
+        co_await second;
+    }
+}
+
+- (void)testBlockHopPerformance
+{
+    PWDispatchQueue* first  = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWCoroutinesTest.first"];
+    PWDispatchQueue* second = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWCoroutinesTest.second"];
+    [self measureBlock:^{
+        PWDispatchSemaphore* done = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+        hopWithBlocks (first, second, PWCoroutinesPerformanceHopCount, ^{ [done signal]; });
+        XCTAssertTrue([done waitWithTimeout:self.longTimeout useWallTime:NO]);
+    }];
+}
+
+- (void)testCoroutineHopPerformance
+{
+    PWDispatchQueue* first  = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWCoroutinesTest.first"];
+    PWDispatchQueue* second = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWCoroutinesTest.second"];
+    [self measureBlock:^{
+        sync_wait (hopWithCoroutine (first, second, PWCoroutinesPerformanceHopCount));
+    }];
+}
+
+@end
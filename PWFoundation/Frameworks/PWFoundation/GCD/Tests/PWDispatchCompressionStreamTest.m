@@ -0,0 +1,245 @@
+//
+//  PWDispatchCompressionStreamTest.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import "PWTestCase.h"
+#import "PWDispatchCompressionStream.h"
+#import "NSData-PWExtensions.h"
+#import "NSData-PWDispatchExtensions.h"
+
+// Collects everything written to it and records the largest chunk it received.
+@interface PWCompressionTestCollector : NSObject <PWOutputStream>
+@property (nonatomic, readonly, strong) NSMutableData*  data;
+@property (nonatomic, readonly)         NSUInteger      maxChunkLength;
+@property (nonatomic, readonly)         BOOL            isOpen;
+@property (nonatomic, readwrite)        BOOL            stalls;     // never answers dispatch data writes
+@end
+
+@implementation PWCompressionTestCollector
+
+- (instancetype)init
+{
+    if ((self = [super init]) != nil)
+    {
+        _data = [NSMutableData data];
+        _isOpen = YES;
+    }
+    return self;
+}
+
+- (void)writeDispatchData:(dispatch_data_t)data
+                    queue:(id<PWDispatchQueueing>)queue
+                  handler:(void (^)(BOOL done, dispatch_data_t _Nullable remainingData, NSError* _Nullable error))handler
+{
+    [_data appendData:[NSData dataWithDispatchData:data]];
+    _maxChunkLength = MAX(_maxChunkLength, dispatch_data_get_size(data));
+    if(_stalls)
+        return;
+    [queue asynchronouslyDispatchBlock:^{
+        handler(YES, nil, nil);
+    }];
+}
+
+- (void)writeData:(NSData*)data
+            queue:(id<PWDispatchQueueing>)queue
+          handler:(void (^)(BOOL done, NSUInteger remainingLength, NSError* _Nullable error))handler
+{
+    [_data appendData:data];
+    [queue asynchronouslyDispatchBlock:^{
+        handler(YES, 0, nil);
+    }];
+}
+
+- (void)closeImmediately:(BOOL)immediately
+{
+    _isOpen = NO;
+}
+
+@end
+
+#pragma mark
+
+@interface PWDispatchCompressionStreamTest : PWTestCase
+@end
+
+@implementation PWDispatchCompressionStreamTest
+
+- (NSData*)sampleData
+{
+    NSMutableString* string = [NSMutableString string];
+    for(NSUInteger index=0; index<20000; index++)
+        [string appendFormat:@"line %lu of the sample data\n", (unsigned long)index];
+    return [string dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+// Writes 'data' in chunks of 'chunkLength' through a new stream and finishes it. Returns nil on error.
+- (NSData*)filterData:(NSData*)data
+                 mode:(PWDispatchCompressionMode)mode
+               format:(PWDispatchCompressionFormat)format
+          chunkLength:(NSUInteger)chunkLength
+         bufferLength:(NSUInteger)bufferLength
+{
+    PWCompressionTestCollector* collector = [[PWCompressionTestCollector alloc] init];
+    PWDispatchCompressionStream* stream = [[PWDispatchCompressionStream alloc] initWithMode:mode
+                                                                                     format:format
+                                                                               targetStream:collector
+                                                                               bufferLength:bufferLength];
+    PWDispatchQueue* queue = [PWDispatchQueue serialDispatchQueueWithLabel:NSStringFromSelector(_cmd)];
+    __block BOOL failed = NO;
+    for(NSUInteger offset = 0; offset < data.length; offset += chunkLength)
+    {
+        PWDispatchSemaphore* semaphore = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+        NSData* chunk = [data subdataWithRange:NSMakeRange(offset, MIN(chunkLength, data.length - offset))];
+        [stream writeData:chunk queue:queue handler:^(BOOL done, NSUInteger remainingLength, NSError* error) {
+            if(error)
+                failed = YES;
+            if(done)
+                [semaphore signal];
+        }];
+        XCTAssertTrue([semaphore waitWithTimeout:self.normalTimeout useWallTime:NO]);
+    }
+
+    PWDispatchSemaphore* semaphore = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    [stream finishWithQueue:queue completionHandler:^(NSError* error) {
+        if(error)
+            failed = YES;
+        [semaphore signal];
+    }];
+    XCTAssertTrue([semaphore waitWithTimeout:self.normalTimeout useWallTime:NO]);
+    XCTAssertLessThanOrEqual(collector.maxChunkLength, bufferLength);
+    XCTAssertEqual(stream.totalInputLength, data.length);
+    XCTAssertEqual(stream.totalOutputLength, collector.data.length);
+    return failed ? nil : collector.data;
+}
+
+- (void)testGzipRoundTrip
+{
+    NSData* data = self.sampleData;
+    NSData* compressed = [self filterData:data
+                                     mode:PWDispatchCompressionModeDeflate
+                                   format:PWDispatchCompressionFormatGzip
+                              chunkLength:10000
+                             bufferLength:4096];
+    XCTAssertNotNil(compressed);
+    XCTAssertLessThan(compressed.length, data.length);
+    XCTAssertEqualObjects(compressed.gunzippedData, data);
+
+    NSData* inflated = [self filterData:compressed
+                                   mode:PWDispatchCompressionModeInflate
+                                 format:PWDispatchCompressionFormatAutomatic
+                            chunkLength:333
+                           bufferLength:1000];
+    XCTAssertEqualObjects(inflated, data);
+}
+
+- (void)testInflateOfHTTPGzippedData
+{
+    NSData* data = self.sampleData;
+    NSData* inflated = [self filterData:data.httpGzippedData
+                                   mode:PWDispatchCompressionModeInflate
+                                 format:PWDispatchCompressionFormatGzip
+                            chunkLength:1024
+                           bufferLength:8192];
+    XCTAssertEqualObjects(inflated, data);
+}
+
+- (void)testZlibRoundTrip
+{
+    NSData* data = self.sampleData;
+    NSData* compressed = [self filterData:data
+                                     mode:PWDispatchCompressionModeDeflate
+                                   format:PWDispatchCompressionFormatZlib
+                              chunkLength:data.length
+                             bufferLength:100];
+    NSData* inflated = [self filterData:compressed
+                                   mode:PWDispatchCompressionModeInflate
+                                 format:PWDispatchCompressionFormatZlib
+                            chunkLength:7
+                           bufferLength:65536];
+    XCTAssertEqualObjects(inflated, data);
+}
+
+- (void)testTruncatedInput
+{
+    NSData* compressed = self.sampleData.httpGzippedData;
+    NSData* truncated = [compressed subdataWithRange:NSMakeRange(0, compressed.length / 2)];
+    XCTAssertNil([self filterData:truncated
+                             mode:PWDispatchCompressionModeInflate
+                           format:PWDispatchCompressionFormatGzip
+                      chunkLength:1024
+                     bufferLength:1024]);
+}
+
+- (void)testCopyFromChannel
+{
+    NSData* data = self.sampleData;
+    NSURL* sourceURL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"testCompressionStreamSource.gz"]];
+    [NSFileManager.defaultManager removeItemAtURL:sourceURL error:nil];
+    [data.httpGzippedData writeToURL:sourceURL atomically:NO];
+
+    PWDispatchIOStreamChannel* sourceChannel = [[PWDispatchIOStreamChannel alloc] initWithURL:sourceURL
+                                                                                    openFlags:O_RDONLY
+                                                                                 creationMode:0
+                                                                                        queue:PWDispatchQueue.mainQueue
+                                                                               cleanupHandler:nil];
+    PWCompressionTestCollector* collector = [[PWCompressionTestCollector alloc] init];
+    PWDispatchCompressionStream* stream = [[PWDispatchCompressionStream alloc] initWithMode:PWDispatchCompressionModeInflate
+                                                                                     format:PWDispatchCompressionFormatAutomatic
+                                                                               targetStream:collector
+                                                                               bufferLength:4096];
+    PWDispatchQueue* queue = [PWDispatchQueue serialDispatchQueueWithLabel:NSStringFromSelector(_cmd)];
+    PWDispatchSemaphore* semaphore = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    [sourceChannel copyDataWithLength:NSNotFound
+                     inChunksOfLength:1000
+                             toStream:stream
+                                queue:queue
+                      progressHandler:nil
+                    completionHandler:^(NSUInteger writtenLength, NSError *errorOrNil) {
+                        XCTAssertNil(errorOrNil);
+                        [stream closeImmediately:NO];
+                        [semaphore signal];
+                    }];
+    XCTAssertTrue([semaphore waitWithTimeout:self.normalTimeout useWallTime:NO]);
+    XCTAssertTrue([self waitWithTimeout:self.normalTimeout untilPassingTest:^BOOL{ return !collector.isOpen; }]);
+    XCTAssertEqualObjects(collector.data, data);
+    [sourceChannel closeImmediately:NO];
+}
+
+- (void)testCloseImmediatelyAnswersPendingWrites
+{
+    PWCompressionTestCollector* collector = [[PWCompressionTestCollector alloc] init];
+    collector.stalls = YES;
+    PWDispatchCompressionStream* stream = [[PWDispatchCompressionStream alloc] initWithMode:PWDispatchCompressionModeDeflate
+                                                                                     format:PWDispatchCompressionFormatRaw
+                                                                               targetStream:collector
+                                                                               bufferLength:16];
+    PWDispatchQueue* queue = [PWDispatchQueue serialDispatchQueueWithLabel:NSStringFromSelector(_cmd)];
+    NSData* data = self.sampleData;
+    PWDispatchGroup* group = [[PWDispatchGroup alloc] init];
+    __block NSUInteger failedWriteCount = 0;
+    for(NSUInteger index = 0; index < 3; index++)
+    {
+        [group enter];
+        [stream writeData:data queue:queue handler:^(BOOL done, NSUInteger remainingLength, NSError* error) {
+            XCTAssertTrue(done);
+            XCTAssertNotNil(error);
+            XCTAssertGreaterThan(remainingLength, 0);
+            failedWriteCount++;
+            [group leave];
+        }];
+    }
+    // The first write fills the output buffer and waits for the stalled target.
+    XCTAssertTrue([self waitWithTimeout:self.normalTimeout untilPassingTest:^BOOL{ return stream.totalOutputLength > 0; }]);
+    [stream closeImmediately:YES];
+
+    XCTAssertTrue([group waitForCompletionWithTimeout:self.normalTimeout useWallTime:NO]);
+    XCTAssertEqual(failedWriteCount, 3);
+    XCTAssertFalse(stream.isOpen);
+    XCTAssertFalse(collector.isOpen);
+}
+
+@end
@@ -0,0 +1,165 @@
+//
+//  PWDispatchIOBandwidthLimiterTest.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import <PWFoundation/PWDispatch.h>
+#import "PWTestCase.h"
+#include <fcntl.h>
+
+@interface PWDispatchIOBandwidthLimiterTest : PWTestCase
+@end
+
+@implementation PWDispatchIOBandwidthLimiterTest
+
+// Acquires 'count' packets of 'length' bytes from each limiter and returns the time until all have been granted.
+- (NSTimeInterval)durationOfAcquiringPacketsWithLength:(NSUInteger)length
+                                                 count:(NSUInteger)count
+                                          fromLimiters:(NSArray<PWDispatchIOBandwidthLimiter*>*)limiters
+                                           grantOrders:(NSArray<NSMutableArray*>*)grantOrders
+{
+    PWDispatchQueue* queue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWDispatchIOBandwidthLimiterTest"];
+    PWDispatchGroup* group = [[PWDispatchGroup alloc] init];
+    NSDate* start = [NSDate date];
+    for (NSUInteger index = 0; index < count; index++)
+        [limiters enumerateObjectsUsingBlock:^(PWDispatchIOBandwidthLimiter* limiter, NSUInteger limiterIndex, BOOL* stop) {
+            [group enter];
+            [limiter acquireLength:length queue:queue handler:^{
+                [grantOrders[limiterIndex] addObject:@(index)];
+                [group leave];
+            }];
+        }];
+    XCTAssertTrue([group waitForCompletionWithTimeout:self.longTimeout useWallTime:NO]);
+    return -start.timeIntervalSinceNow;
+}
+
+- (void)testRate
+{
+    PWDispatchIOBandwidthLimiter* limiter = [[PWDispatchIOBandwidthLimiter alloc] initWithRate:100000 burstSize:10000];
+    NSMutableArray* grantOrder = [NSMutableArray array];
+
+    // The first packet is granted from the full bucket, the other 90000 bytes take 0.9 seconds.
+    NSTimeInterval duration = [self durationOfAcquiringPacketsWithLength:10000
+                                                                   count:10
+                                                            fromLimiters:@[limiter]
+                                                             grantOrders:@[grantOrder]];
+    XCTAssertGreaterThan(duration, 0.8);
+    XCTAssertLessThan(duration, 3.0);
+    XCTAssertEqualObjects(grantOrder, (@[@0, @1, @2, @3, @4, @5, @6, @7, @8, @9]));
+    XCTAssertEqual(limiter.grantedLength, 100000);
+    XCTAssertEqual(limiter.waitingRequestCount, 0);
+}
+
+- (void)testPacketsLargerThanBurstSize
+{
+    PWDispatchIOBandwidthLimiter* limiter = [[PWDispatchIOBandwidthLimiter alloc] initWithRate:100000 burstSize:1000];
+    NSMutableArray* grantOrder = [NSMutableArray array];
+
+    // Each packet waits for a full bucket and leaves a debt of 19000 bytes.
+    NSTimeInterval duration = [self durationOfAcquiringPacketsWithLength:20000
+                                                                   count:3
+                                                            fromLimiters:@[limiter]
+                                                             grantOrders:@[grantOrder]];
+    XCTAssertGreaterThan(duration, 0.35);
+    XCTAssertLessThan(duration, 3.0);
+}
+
+- (void)testSharedParent
+{
+    PWDispatchIOBandwidthLimiter* group  = [[PWDispatchIOBandwidthLimiter alloc] initWithRate:200000 burstSize:5000];
+    PWDispatchIOBandwidthLimiter* first  = [[PWDispatchIOBandwidthLimiter alloc] initWithRate:0 burstSize:5000 parent:group];
+    PWDispatchIOBandwidthLimiter* second = [[PWDispatchIOBandwidthLimiter alloc] initWithRate:0 burstSize:5000 parent:group];
+    NSMutableArray* firstOrder  = [NSMutableArray array];
+    NSMutableArray* secondOrder = [NSMutableArray array];
+
+    // Unlimited on their own, the two limiters share the 200000 bytes/s of the group.
+    NSTimeInterval duration = [self durationOfAcquiringPacketsWithLength:5000
+                                                                   count:10
+                                                            fromLimiters:@[first, second]
+                                                             grantOrders:@[firstOrder, secondOrder]];
+    XCTAssertGreaterThan(duration, 0.4);
+    XCTAssertLessThan(duration, 3.0);
+    XCTAssertEqual(firstOrder.count, 10);
+    XCTAssertEqualObjects(firstOrder, secondOrder);
+    XCTAssertEqual(group.grantedLength, 100000);
+    XCTAssertEqual(first.grantedLength, 50000);
+}
+
+- (void)testReturnUnusedLength
+{
+    PWDispatchIOBandwidthLimiter* group   = [[PWDispatchIOBandwidthLimiter alloc] initWithRate:1000 burstSize:1000];
+    PWDispatchIOBandwidthLimiter* limiter = [[PWDispatchIOBandwidthLimiter alloc] initWithRate:1000 burstSize:1000 parent:group];
+    PWDispatchSemaphore* granted = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    PWDispatchQueue* queue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWDispatchIOBandwidthLimiterTest"];
+
+    [limiter acquireLength:1000 queue:queue handler:^{ [granted signal]; }];
+    XCTAssertTrue([granted waitWithTimeout:self.shortTimeout useWallTime:NO]);
+    [limiter returnUnusedLength:600];
+    XCTAssertEqual(limiter.grantedLength, 400);
+    XCTAssertEqual(group.grantedLength, 400);
+
+    // The returned bytes are available immediately.
+    [limiter acquireLength:600 queue:queue handler:^{ [granted signal]; }];
+    XCTAssertTrue([granted waitWithTimeout:0.3 useWallTime:NO]);
+}
+
+- (void)testThrottledChannel
+{
+    NSURL* URL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"PWDispatchIOBandwidthLimiterTest"]];
+    [[NSData data] writeToURL:URL atomically:NO];
+    PWDispatchIORandomChannel* channel = [[PWDispatchIORandomChannel alloc] initWithURL:URL
+                                                                              openFlags:O_RDWR
+                                                                           creationMode:0
+                                                                                  queue:PWDispatchQueue.mainQueue
+                                                                         cleanupHandler:nil];
+    channel.throttleRate = 200000;
+    XCTAssertEqual(channel.throttleRate, 200000);
+    XCTAssertEqual(channel.bandwidthLimiter.burstSize, 50000);
+    PWDispatchQueue* queue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWDispatchIOBandwidthLimiterTest"];
+
+    NSMutableData* data = [NSMutableData dataWithLength:150000];
+    uint8_t* bytes = data.mutableBytes;
+    for (NSUInteger index = 0; index < data.length; index++)
+        bytes[index] = (uint8_t)(index * 7);
+
+    // 50000 bytes from the full bucket, 100000 bytes take 0.5 seconds.
+    PWDispatchSemaphore* written = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    __block NSUInteger doneCount = 0;
+    NSDate* start = [NSDate date];
+    [channel writeData:data startingFromOffset:0 queue:queue handler:^(BOOL done, NSUInteger remainingLength, NSError* errorOrNil) {
+        XCTAssertNil(errorOrNil);
+        if (done)
+        {
+            XCTAssertEqual(remainingLength, 0);
+            doneCount++;
+            [written signal];
+        }
+    }];
+    XCTAssertTrue([written waitWithTimeout:self.longTimeout useWallTime:NO]);
+    XCTAssertGreaterThan(-start.timeIntervalSinceNow, 0.4);
+    XCTAssertEqual(doneCount, 1);
+
+    // Reading until EOF continues at the same rate, the unused part of the last packet is returned.
+    PWDispatchSemaphore* read = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    NSMutableData* readData = [NSMutableData data];
+    start = [NSDate date];
+    [channel readDataStartingFromOffset:0 length:NSNotFound queue:queue handler:^(BOOL done, NSData* chunk, NSError* errorOrNil) {
+        XCTAssertNil(errorOrNil);
+        if (chunk)
+            [readData appendData:chunk];
+        if (done)
+            [read signal];
+    }];
+    XCTAssertTrue([read waitWithTimeout:self.longTimeout useWallTime:NO]);
+    XCTAssertGreaterThan(-start.timeIntervalSinceNow, 0.6);
+    XCTAssertEqualObjects(readData, data);
+    XCTAssertEqual(channel.bandwidthLimiter.grantedLength, 2 * data.length);
+
+    [channel closeImmediately:NO];
+    [NSFileManager.defaultManager removeItemAtURL:URL error:NULL];
+}
+
+@end
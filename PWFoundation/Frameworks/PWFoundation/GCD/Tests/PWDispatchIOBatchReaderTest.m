@@ -0,0 +1,214 @@
+//
+//  PWDispatchIOBatchReaderTest.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import <PWFoundation/PWDispatch.h>
+#import "PWTestCase.h"
+#include <fcntl.h>
+
+@interface PWDispatchIOBatchReaderTest : PWTestCase
+@end
+
+@implementation PWDispatchIOBatchReaderTest
+{
+    NSURL*                      _URL;
+    NSData*                     _contents;
+    PWDispatchIORandomChannel*  _channel;
+    PWDispatchQueue*            _queue;
+}
+
+- (void)setUp
+{
+    [super setUp];
+
+    NSMutableData* contents = [NSMutableData dataWithLength:1024 * 1024];
+    uint8_t* bytes = contents.mutableBytes;
+    for (NSUInteger index = 0; index < contents.length; index++)
+        bytes[index] = (uint8_t)(index * 7 + index / 251);
+    _contents = [contents copy];
+    _URL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"PWDispatchIOBatchReaderTest"]];
+    [_contents writeToURL:_URL atomically:NO];
+    _channel = [[PWDispatchIORandomChannel alloc] initWithURL:_URL
+                                                    openFlags:O_RDONLY
+                                                 creationMode:0
+                                                        queue:PWDispatchQueue.mainQueue
+                                               cleanupHandler:nil];
+    _queue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWDispatchIOBatchReaderTest"];
+}
+
+- (void)tearDown
+{
+    [_channel closeImmediately:NO];
+    [NSFileManager.defaultManager removeItemAtURL:_URL error:NULL];
+    [super tearDown];
+}
+
+// Reads the ranges and returns the delivered data per range index.
+- (NSDictionary<NSNumber*, NSData*>*)readRanges:(NSArray<NSValue*>*)ranges withReader:(PWDispatchIOBatchReader*)reader
+{
+    NSMutableDictionary<NSNumber*, NSData*>* results = [NSMutableDictionary dictionary];
+    PWDispatchSemaphore* completed = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    [reader readRanges:ranges
+                 queue:_queue
+          rangeHandler:^(NSUInteger rangeIndex, dispatch_data_t data) {
+              XCTAssertNil(results[@(rangeIndex)]);
+              results[@(rangeIndex)] = [NSData dataWithDispatchData:data];
+          }
+     completionHandler:^(NSError* errorOrNil) {
+         XCTAssertNil(errorOrNil);
+         [completed signal];
+     }];
+    XCTAssertTrue([completed waitWithTimeout:self.longTimeout useWallTime:NO]);
+    return results;
+}
+
+- (void)assertResults:(NSDictionary<NSNumber*, NSData*>*)results matchRanges:(NSArray<NSValue*>*)ranges
+{
+    XCTAssertEqual(results.count, ranges.count);
+    [ranges enumerateObjectsUsingBlock:^(NSValue* value, NSUInteger index, BOOL* stop) {
+        NSRange range = value.rangeValue;
+        range.length = MIN(NSMaxRange(range), _contents.length) - MIN(range.location, _contents.length);
+        range.location = MIN(range.location, _contents.length);
+        XCTAssertEqualObjects(results[@(index)], [_contents subdataWithRange:range]);
+    }];
+}
+
+- (void)testMergesNearbyRanges
+{
+    PWDispatchIOBatchReader* reader = [[PWDispatchIOBatchReader alloc] initWithChannel:_channel];
+    NSArray<NSValue*>* ranges = @[[NSValue valueWithRange:NSMakeRange(500000, 100)],
+                                  [NSValue valueWithRange:NSMakeRange(100, 10)],
+                                  [NSValue valueWithRange:NSMakeRange(3000, 20)],
+                                  [NSValue valueWithRange:NSMakeRange(105, 50)],
+                                  [NSValue valueWithRange:NSMakeRange(0, 0)],
+                                  [NSValue valueWithRange:NSMakeRange(501000, 100)]];
+
+    [self assertResults:[self readRanges:ranges withReader:reader] matchRanges:ranges];
+    XCTAssertEqual(reader.issuedReadCount, 2);
+}
+
+- (void)testMaximumGap
+{
+    PWDispatchIOBatchReader* reader = [[PWDispatchIOBatchReader alloc] initWithChannel:_channel
+                                                                            maximumGap:0
+                                                                    maxConcurrentReads:2
+                                                                       readaheadLength:0];
+    NSArray<NSValue*>* ranges = @[[NSValue valueWithRange:NSMakeRange(0, 10)],
+                                  [NSValue valueWithRange:NSMakeRange(10, 10)],
+                                  [NSValue valueWithRange:NSMakeRange(21, 10)],
+                                  [NSValue valueWithRange:NSMakeRange(40, 10)],
+                                  [NSValue valueWithRange:NSMakeRange(60, 10)]];
+
+    [self assertResults:[self readRanges:ranges withReader:reader] matchRanges:ranges];
+    XCTAssertEqual(reader.issuedReadCount, 4);
+}
+
+- (void)testRangesBeyondEOF
+{
+    PWDispatchIOBatchReader* reader = [[PWDispatchIOBatchReader alloc] initWithChannel:_channel];
+    NSArray<NSValue*>* ranges = @[[NSValue valueWithRange:NSMakeRange(_contents.length - 10, 100)],
+                                  [NSValue valueWithRange:NSMakeRange(_contents.length + 10, 100)]];
+
+    [self assertResults:[self readRanges:ranges withReader:reader] matchRanges:ranges];
+}
+
+- (void)testReadahead
+{
+    PWDispatchIOBatchReader* reader = [[PWDispatchIOBatchReader alloc] initWithChannel:_channel
+                                                                            maximumGap:0
+                                                                    maxConcurrentReads:4
+                                                                       readaheadLength:64 * 1024];
+    // The first batch has no predecessor, the second one continues it and reads ahead, the following ones are served
+    // from the buffer until it is exhausted.
+    NSUInteger issuedReadCount = 0;
+    for (NSUInteger batchIndex = 0; batchIndex < 20; batchIndex++)
+    {
+        NSArray<NSValue*>* ranges = @[[NSValue valueWithRange:NSMakeRange(batchIndex * 4096, 2048)],
+                                      [NSValue valueWithRange:NSMakeRange(batchIndex * 4096 + 2048, 2048)]];
+        [self assertResults:[self readRanges:ranges withReader:reader] matchRanges:ranges];
+        if (batchIndex == 1)
+            issuedReadCount = reader.issuedReadCount;
+    }
+    XCTAssertEqual(issuedReadCount, 2);
+    XCTAssertLessThan(reader.issuedReadCount, 10);
+    XCTAssertGreaterThan(reader.readaheadHitCount, 30);
+
+    // A jump backwards is not sequential and does not read ahead.
+    NSUInteger hitCount = reader.readaheadHitCount;
+    NSArray<NSValue*>* ranges = @[[NSValue valueWithRange:NSMakeRange(900000, 10)]];
+    [self readRanges:ranges withReader:reader];
+    ranges = @[[NSValue valueWithRange:NSMakeRange(0, 10)]];
+    [self assertResults:[self readRanges:ranges withReader:reader] matchRanges:ranges];
+    XCTAssertEqual(reader.readaheadHitCount, hitCount);
+}
+
+- (void)testReadError
+{
+    PWDispatchIORandomChannel* channel = [[PWDispatchIORandomChannel alloc] initWithURL:[_URL URLByAppendingPathExtension:@"missing"]
+                                                                              openFlags:O_RDONLY
+                                                                           creationMode:0
+                                                                                  queue:PWDispatchQueue.mainQueue
+                                                                         cleanupHandler:nil];
+    PWDispatchIOBatchReader* reader = [[PWDispatchIOBatchReader alloc] initWithChannel:channel];
+    PWDispatchSemaphore* completed = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    __block NSError* error;
+    [reader readRanges:@[[NSValue valueWithRange:NSMakeRange(0, 10)]]
+                 queue:_queue
+          rangeHandler:^(NSUInteger rangeIndex, dispatch_data_t data) {
+              XCTFail(@"no range expected");
+          }
+     completionHandler:^(NSError* errorOrNil) {
+         error = errorOrNil;
+         [completed signal];
+     }];
+    XCTAssertTrue([completed waitWithTimeout:self.longTimeout useWallTime:NO]);
+    XCTAssertNotNil(error);
+}
+
+#pragma mark - Performance
+
+static const NSUInteger PWDispatchIOBatchReaderPerformanceRangeCount = 5000;
+
+- (NSArray<NSValue*>*)performanceRanges
+{
+    NSMutableArray<NSValue*>* ranges = [NSMutableArray array];
+    srandom(42);
+    for (NSUInteger index = 0; index < PWDispatchIOBatchReaderPerformanceRangeCount; index++)
+        [ranges addObject:[NSValue valueWithRange:NSMakeRange((NSUInteger)random() % (_contents.length - 64), 64)]];
+    return ranges;
+}
+
+- (void)testSingleReadPerformance
+{
+    NSArray<NSValue*>* ranges = self.performanceRanges;
+    [self measureBlock:^{
+        PWDispatchGroup* group = [[PWDispatchGroup alloc] init];
+        for (NSValue* value in ranges)
+        {
+            [group enter];
+            [_channel readDispatchDataStartingFromOffset:value.rangeValue.location
+                                                  length:value.rangeValue.length
+                                                   queue:_queue
+                                                 handler:^(BOOL done, dispatch_data_t data, NSError* errorOrNil) {
+                                                     if (done)
+                                                         [group leave];
+                                                 }];
+        }
+        XCTAssertTrue([group waitForCompletionWithTimeout:self.longTimeout useWallTime:NO]);
+    }];
+}
+
+- (void)testBatchReadPerformance
+{
+    NSArray<NSValue*>* ranges = self.performanceRanges;
+    [self measureBlock:^{
+        PWDispatchIOBatchReader* reader = [[PWDispatchIOBatchReader alloc] initWithChannel:_channel];
+        [self readRanges:ranges withReader:reader];
+    }];
+}
+
+@end
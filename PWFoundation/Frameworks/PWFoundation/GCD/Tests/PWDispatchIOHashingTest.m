@@ -0,0 +1,146 @@
+//
+//  PWDispatchIOHashingTest.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import "PWTestCase.h"
+#import "NSData-PWExtensions.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+@interface PWDispatchIOHashingTest : PWTestCase
+@end
+
+@implementation PWDispatchIOHashingTest
+
+// Writes the test file. Without the cache, its pages are not in memory afterwards, which approximates a cold cache.
+- (void)writeFileAtURL:(NSURL*)URL length:(NSUInteger)length bypassingCache:(BOOL)bypassCache
+{
+    int fileDescriptor = open(URL.path.fileSystemRepresentation, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    XCTAssertNotEqual(fileDescriptor, -1);
+    if(bypassCache)
+        fcntl(fileDescriptor, F_NOCACHE, 1);
+    NSMutableData* block = [NSMutableData dataWithLength:MIN(length, (NSUInteger)1024 * 1024)];
+    uint8_t* bytes = block.mutableBytes;
+    for(NSUInteger offset = 0; offset < length; offset += block.length)
+    {
+        NSUInteger blockLength = MIN(block.length, length - offset);
+        for(NSUInteger index = offset; index < offset + blockLength; index++)
+            bytes[index - offset] = (uint8_t)(index * 31 + index / 7);
+        XCTAssertEqual(write(fileDescriptor, bytes, blockLength), (ssize_t)blockLength);
+    }
+    close(fileDescriptor);
+}
+
+- (NSURL*)fileURLWithLength:(NSUInteger)length name:(NSString*)name
+{
+    NSURL* URL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:name]];
+    [self writeFileAtURL:URL length:length bypassingCache:NO];
+    return URL;
+}
+
+- (NSData*)digestOfURL:(NSURL*)URL
+                  mode:(PWDispatchIODigestMode)mode
+           chunkLength:(NSUInteger)chunkLength
+    maxConcurrentReads:(NSUInteger)maxConcurrentReads
+{
+    NSFileHandle* handle = [NSFileHandle fileHandleForReadingFromURL:URL error:NULL];
+    XCTAssertNotNil(handle);
+    PWDispatchIORandomChannel* channel = [[PWDispatchIORandomChannel alloc] initWithHandle:handle
+                                                                                     queue:PWDispatchQueue.mainQueue
+                                                                            cleanupHandler:nil];
+    PWDispatchQueue* queue = [PWDispatchQueue serialDispatchQueueWithLabel:NSStringFromSelector(_cmd)];
+    PWDispatchSemaphore* semaphore = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    __block NSData* result;
+    [channel computeSHA1WithMode:mode
+                     chunkLength:chunkLength
+              maxConcurrentReads:maxConcurrentReads
+                           queue:queue
+               completionHandler:^(NSData* digest, NSError* errorOrNil) {
+                   XCTAssertNil(errorOrNil);
+                   result = digest;
+                   [semaphore signal];
+               }];
+    XCTAssertTrue([semaphore waitWithTimeout:self.longTimeout useWallTime:NO]);
+    [channel closeImmediately:NO];
+    return result;
+}
+
+- (void)testSequentialDigestMatchesSHA1
+{
+    for(NSNumber* length in @[@0, @1, @4095, @4096, @4097, @100000])
+    {
+        NSURL* URL = [self fileURLWithLength:length.unsignedIntegerValue name:@"testSequentialDigest"];
+        NSData* expected = [NSData dataWithContentsOfURL:URL].sha1;
+        XCTAssertEqualObjects([self digestOfURL:URL mode:PWDispatchIODigestModeSequential chunkLength:4096 maxConcurrentReads:4], expected);
+        XCTAssertEqualObjects([self digestOfURL:URL mode:PWDispatchIODigestModeSequential chunkLength:1000 maxConcurrentReads:1], expected);
+    }
+}
+
+- (void)testTreeDigest
+{
+    NSUInteger chunkLength = 4096;
+    NSURL* URL = [self fileURLWithLength:10 * chunkLength + 123 name:@"testTreeDigest"];
+    NSData* contents = [NSData dataWithContentsOfURL:URL];
+
+    NSMutableData* chunkDigests = [NSMutableData data];
+    for(NSUInteger offset = 0; offset < contents.length; offset += chunkLength)
+        [chunkDigests appendData:[contents subdataWithRange:NSMakeRange(offset, MIN(chunkLength, contents.length - offset))].sha1];
+
+    XCTAssertEqualObjects([self digestOfURL:URL mode:PWDispatchIODigestModeTree chunkLength:chunkLength maxConcurrentReads:3],
+                          chunkDigests.sha1);
+    XCTAssertEqualObjects([self digestOfURL:URL mode:PWDispatchIODigestModeTree chunkLength:chunkLength maxConcurrentReads:16],
+                          chunkDigests.sha1);
+}
+
+#pragma mark - Performance
+
+static const NSUInteger PWHashingPerformanceFileLength = 64 * 1024 * 1024;
+
+- (void)testInMemorySHA1Performance
+{
+    NSURL* URL = [self fileURLWithLength:PWHashingPerformanceFileLength name:@"testHashingPerformance"];
+    [self measureBlock:^{
+        (void)[NSData dataWithContentsOfURL:URL].sha1;
+    }];
+}
+
+- (void)measureDigestWithMode:(PWDispatchIODigestMode)mode
+            maxConcurrentReads:(NSUInteger)maxConcurrentReads
+                     coldCache:(BOOL)coldCache
+{
+    NSURL* URL = [self fileURLWithLength:PWHashingPerformanceFileLength name:@"testHashingPerformance"];
+    [self measureMetrics:self.class.defaultPerformanceMetrics automaticallyStartMeasuring:NO forBlock:^{
+        // Rewriting through F_NOCACHE evicts the pages a previous iteration has read.
+        if(coldCache)
+            [self writeFileAtURL:URL length:PWHashingPerformanceFileLength bypassingCache:YES];
+        [self startMeasuring];
+        [self digestOfURL:URL mode:mode chunkLength:1024 * 1024 maxConcurrentReads:maxConcurrentReads];
+        [self stopMeasuring];
+    }];
+}
+
+- (void)testSequentialDigestWarmCachePerformance
+{
+    [self measureDigestWithMode:PWDispatchIODigestModeSequential maxConcurrentReads:4 coldCache:NO];
+}
+
+- (void)testSequentialDigestColdCachePerformance
+{
+    [self measureDigestWithMode:PWDispatchIODigestModeSequential maxConcurrentReads:4 coldCache:YES];
+}
+
+- (void)testTreeDigestWarmCachePerformance
+{
+    [self measureDigestWithMode:PWDispatchIODigestModeTree maxConcurrentReads:8 coldCache:NO];
+}
+
+- (void)testTreeDigestColdCachePerformance
+{
+    [self measureDigestWithMode:PWDispatchIODigestModeTree maxConcurrentReads:8 coldCache:YES];
+}
+
+@end
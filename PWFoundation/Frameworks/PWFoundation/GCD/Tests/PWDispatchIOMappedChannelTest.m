@@ -0,0 +1,279 @@
+//
+//  PWDispatchIOMappedChannelTest.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import <PWFoundation/PWDispatch.h>
+#import <PWFoundation/PWErrors.h>
+#import "PWTestCase.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+@interface PWDispatchIOMappedChannelTest : PWTestCase
+@end
+
+@implementation PWDispatchIOMappedChannelTest
+{
+    NSURL*              _URL;
+    NSData*             _contents;
+    PWDispatchQueue*    _queue;
+}
+
+- (NSData*)contentsWithLength:(NSUInteger)length
+{
+    NSMutableData* contents = [NSMutableData dataWithLength:length];
+    uint8_t* bytes = contents.mutableBytes;
+    for (NSUInteger index = 0; index < length; index++)
+        bytes[index] = (uint8_t)(index * 7 + index / 251);
+    return [contents copy];
+}
+
+- (void)setUp
+{
+    [super setUp];
+
+    _contents = [self contentsWithLength:1024 * 1024 + 1000];
+    _URL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"PWDispatchIOMappedChannelTest"]];
+    [_contents writeToURL:_URL atomically:NO];
+    _queue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWDispatchIOMappedChannelTest"];
+}
+
+- (void)tearDown
+{
+    [NSFileManager.defaultManager removeItemAtURL:_URL error:NULL];
+    [super tearDown];
+}
+
+- (dispatch_data_t)readFromChannel:(id<PWRandomAccessInput>)channel offset:(NSUInteger)offset length:(NSUInteger)length error:(NSError**)outError
+{
+    __block dispatch_data_t result = dispatch_data_empty;
+    __block NSError* error;
+    PWDispatchSemaphore* done = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    [channel readDispatchDataStartingFromOffset:offset length:length queue:_queue handler:^(BOOL isDone, dispatch_data_t data, NSError* errorOrNil) {
+        if (data)
+            result = dispatch_data_create_concat(result, data);
+        if (errorOrNil)
+            error = errorOrNil;
+        if (isDone)
+            [done signal];
+    }];
+    XCTAssertTrue([done waitWithTimeout:self.longTimeout useWallTime:NO]);
+    if (outError)
+        *outError = error;
+    return result;
+}
+
+- (void)assertChannel:(PWDispatchIOMappedChannel*)channel readsOffset:(NSUInteger)offset length:(NSUInteger)length
+{
+    NSError* error;
+    NSData* data = [NSData dataWithDispatchData:[self readFromChannel:channel offset:offset length:length error:&error]];
+    XCTAssertNil(error);
+    NSUInteger end = length == NSNotFound ? _contents.length : MIN(offset + length, _contents.length);
+    XCTAssertEqualObjects(data, [_contents subdataWithRange:NSMakeRange(MIN(offset, end), end - MIN(offset, end))]);
+}
+
+- (void)testReadWholeFileMapping
+{
+    NSError* error;
+    PWDispatchIOMappedChannel* channel = [[PWDispatchIOMappedChannel alloc] initWithURL:_URL error:&error];
+    XCTAssertNotNil(channel, @"%@", error);
+    [self assertChannel:channel readsOffset:0 length:100];
+    [self assertChannel:channel readsOffset:5000 length:70000];
+    [self assertChannel:channel readsOffset:0 length:NSNotFound];
+    [self assertChannel:channel readsOffset:_contents.length - 10 length:100];
+    [self assertChannel:channel readsOffset:_contents.length + 10 length:100];
+}
+
+- (void)testReadAcrossWindows
+{
+    PWDispatchIOMappedChannel* channel = [[PWDispatchIOMappedChannel alloc] initWithURL:_URL
+                                                                           windowLength:10000
+                                                                          accessPattern:PWDispatchIOAccessPatternRandom
+                                                                                  error:NULL];
+    XCTAssertEqual(channel.windowLength % getpagesize(), 0);
+    XCTAssertGreaterThanOrEqual(channel.windowLength, 10000);
+    [self assertChannel:channel readsOffset:channel.windowLength - 10 length:20];
+    [self assertChannel:channel readsOffset:100 length:5 * channel.windowLength];
+
+    // More windows than stay mapped.
+    [self assertChannel:channel readsOffset:0 length:NSNotFound];
+    [self assertChannel:channel readsOffset:0 length:100];
+}
+
+- (void)testDataAliasesMapping
+{
+    PWDispatchIOMappedChannel* channel = [[PWDispatchIOMappedChannel alloc] initWithURL:_URL error:NULL];
+    dispatch_data_t first  = [self readFromChannel:channel offset:4096 length:100 error:NULL];
+    dispatch_data_t second = [self readFromChannel:channel offset:4096 length:100 error:NULL];
+    __block const void* firstBytes;
+    __block const void* secondBytes;
+    PWDispatchDataAccessBytes(first, ^(const void* contiguousBytes, const struct iovec* regions, size_t regionCount) {
+        firstBytes = contiguousBytes;
+    });
+    PWDispatchDataAccessBytes(second, ^(const void* contiguousBytes, const struct iovec* regions, size_t regionCount) {
+        secondBytes = contiguousBytes;
+    });
+    XCTAssertTrue(firstBytes != NULL);
+    XCTAssertEqual(firstBytes, secondBytes);
+
+    // The mapping outlives the channel.
+    [channel close];
+    channel = nil;
+    XCTAssertEqualObjects([NSData dataWithDispatchData:first], [_contents subdataWithRange:NSMakeRange(4096, 100)]);
+}
+
+- (void)testGrowingAndTruncatedFile
+{
+    PWDispatchIOMappedChannel* channel = [[PWDispatchIOMappedChannel alloc] initWithURL:_URL error:NULL];
+    [self assertChannel:channel readsOffset:0 length:NSNotFound];
+
+    _contents = [self contentsWithLength:_contents.length + 50000];
+    [_contents writeToURL:_URL atomically:NO];
+    [self assertChannel:channel readsOffset:_contents.length - 60000 length:NSNotFound];
+
+    XCTAssertEqual(truncate(_URL.path.fileSystemRepresentation, 3000), 0);
+    _contents = [_contents subdataWithRange:NSMakeRange(0, 3000)];
+    [self assertChannel:channel readsOffset:0 length:NSNotFound];
+    [self assertChannel:channel readsOffset:2000 length:5000];
+    [self assertChannel:channel readsOffset:100000 length:10];
+}
+
+- (void)testErrors
+{
+    NSError* error;
+    XCTAssertNil([[PWDispatchIOMappedChannel alloc] initWithURL:[_URL URLByAppendingPathExtension:@"missing"] error:&error]);
+    XCTAssertEqualObjects(error.domain, PWErrorDomain);
+    XCTAssertEqual(error.code, PWDispatchIOChannelError);
+
+    PWDispatchIOMappedChannel* channel = [[PWDispatchIOMappedChannel alloc] initWithURL:_URL error:NULL];
+    XCTAssertTrue(channel.isOpen);
+    [channel close];
+    XCTAssertFalse(channel.isOpen);
+    error = nil;
+    [self readFromChannel:channel offset:0 length:10 error:&error];
+    XCTAssertEqualObjects(error.userInfo[PWDispatchIOChannelErrorUnderlyingCodeKey], @(EBADF));
+}
+
+- (void)testBatchReader
+{
+    PWDispatchIOMappedChannel* channel = [[PWDispatchIOMappedChannel alloc] initWithURL:_URL error:NULL];
+    PWDispatchIOBatchReader* reader = [[PWDispatchIOBatchReader alloc] initWithChannel:channel];
+    PWDispatchSemaphore* completed = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    NSMutableDictionary<NSNumber*, NSData*>* results = [NSMutableDictionary dictionary];
+    [reader readRanges:@[[NSValue valueWithRange:NSMakeRange(10, 10)], [NSValue valueWithRange:NSMakeRange(900000, 10)]]
+                 queue:_queue
+          rangeHandler:^(NSUInteger rangeIndex, dispatch_data_t data) {
+              results[@(rangeIndex)] = [NSData dataWithDispatchData:data];
+          }
+     completionHandler:^(NSError* errorOrNil) {
+         XCTAssertNil(errorOrNil);
+         [completed signal];
+     }];
+    XCTAssertTrue([completed waitWithTimeout:self.longTimeout useWallTime:NO]);
+    XCTAssertEqualObjects(results[@0], [_contents subdataWithRange:NSMakeRange(10, 10)]);
+    XCTAssertEqualObjects(results[@1], [_contents subdataWithRange:NSMakeRange(900000, 10)]);
+}
+
+#pragma mark - Performance
+
+static const NSUInteger PWDispatchIOMappedChannelPerformanceFileLength = 64 * 1024 * 1024;
+static const NSUInteger PWDispatchIOMappedChannelPerformanceReadCount  = 5000;
+static const NSUInteger PWDispatchIOMappedChannelPerformanceReadLength = 4096;
+
+// Writes the performance file. Without the cache, its pages are not in memory afterwards, which approximates a cold
+// cache.
+- (void)writePerformanceFileBypassingCache:(BOOL)bypassCache
+{
+    int fileDescriptor = open(_URL.path.fileSystemRepresentation, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    XCTAssertNotEqual(fileDescriptor, -1);
+    if (bypassCache)
+        fcntl(fileDescriptor, F_NOCACHE, 1);
+    NSData* block = [self contentsWithLength:1024 * 1024];
+    for (NSUInteger offset = 0; offset < PWDispatchIOMappedChannelPerformanceFileLength; offset += block.length)
+        XCTAssertEqual(write(fileDescriptor, block.bytes, block.length), (ssize_t)block.length);
+    close(fileDescriptor);
+}
+
+// Reads random pages and touches every byte, so the mapped reads pay for their page faults.
+- (void)readRandomPagesFromChannel:(id<PWRandomAccessInput>)channel
+{
+    PWDispatchGroup* group = [[PWDispatchGroup alloc] init];
+    srandom(42);
+    __block NSUInteger checksum = 0;
+    for (NSUInteger index = 0; index < PWDispatchIOMappedChannelPerformanceReadCount; index++)
+    {
+        NSUInteger offset = (NSUInteger)random() % (PWDispatchIOMappedChannelPerformanceFileLength / PWDispatchIOMappedChannelPerformanceReadLength)
+                          * PWDispatchIOMappedChannelPerformanceReadLength;
+        [group enter];
+        [channel readDispatchDataStartingFromOffset:offset
+                                             length:PWDispatchIOMappedChannelPerformanceReadLength
+                                              queue:_queue
+                                            handler:^(BOOL done, dispatch_data_t data, NSError* errorOrNil) {
+                                                PWDispatchDataAccessBytes(data, ^(const void* contiguousBytes, const struct iovec* regions, size_t regionCount) {
+                                                    for (size_t regionIndex = 0; regionIndex < regionCount; regionIndex++)
+                                                        for (size_t byteIndex = 0; byteIndex < regions[regionIndex].iov_len; byteIndex++)
+                                                            checksum += ((const uint8_t*)regions[regionIndex].iov_base)[byteIndex];
+                                                });
+                                                if (done)
+                                                    [group leave];
+                                            }];
+    }
+    XCTAssertTrue([group waitForCompletionWithTimeout:self.longTimeout useWallTime:NO]);
+    XCTAssertGreaterThan(checksum, 0);
+}
+
+- (id<PWRandomAccessInput>)newPerformanceChannelMapped:(BOOL)mapped
+{
+    if (mapped)
+        return [[PWDispatchIOMappedChannel alloc] initWithURL:_URL
+                                                 windowLength:0
+                                                accessPattern:PWDispatchIOAccessPatternRandom
+                                                        error:NULL];
+    return [[PWDispatchIORandomChannel alloc] initWithURL:_URL
+                                                openFlags:O_RDONLY
+                                             creationMode:0
+                                                    queue:PWDispatchQueue.mainQueue
+                                           cleanupHandler:nil];
+}
+
+- (void)measureReadsMapped:(BOOL)mapped coldCache:(BOOL)coldCache
+{
+    [self writePerformanceFileBypassingCache:NO];
+    [self measureMetrics:self.class.defaultPerformanceMetrics automaticallyStartMeasuring:NO forBlock:^{
+        if (coldCache)
+            [self writePerformanceFileBypassingCache:YES];
+        id<PWRandomAccessInput> channel = [self newPerformanceChannelMapped:mapped];
+        [self startMeasuring];
+        [self readRandomPagesFromChannel:channel];
+        [self stopMeasuring];
+        if ([channel isKindOfClass:PWDispatchIORandomChannel.class])
+            [(PWDispatchIORandomChannel*)channel closeImmediately:NO];
+        else
+            [(PWDispatchIOMappedChannel*)channel close];
+    }];
+}
+
+- (void)testDispatchIOHotCachePerformance
+{
+    [self measureReadsMapped:NO coldCache:NO];
+}
+
+- (void)testMappedHotCachePerformance
+{
+    [self measureReadsMapped:YES coldCache:NO];
+}
+
+- (void)testDispatchIOColdCachePerformance
+{
+    [self measureReadsMapped:NO coldCache:YES];
+}
+
+- (void)testMappedColdCachePerformance
+{
+    [self measureReadsMapped:YES coldCache:YES];
+}
+
+@end
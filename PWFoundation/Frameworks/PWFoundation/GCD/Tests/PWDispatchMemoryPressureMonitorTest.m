@@ -0,0 +1,187 @@
+//
+//  PWDispatchMemoryPressureMonitorTest.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import <PWFoundation/PWDispatch.h>
+#import <PWFoundation/PWLRUCache.h>
+#import "PWTestCase.h"
+
+@interface PWDispatchMemoryPressureMonitorTest : PWTestCase
+@end
+
+@implementation PWDispatchMemoryPressureMonitorTest
+{
+    NSString*                           _rootPath;
+    PWDispatchMemoryPressureMonitor*    _monitor;
+    PWDispatchQueue*                    _queue;
+}
+
+- (void)setUp
+{
+    [super setUp];
+
+    _rootPath = [NSTemporaryDirectory() stringByAppendingPathComponent:@"PWDispatchMemoryPressureMonitorTest"];
+    [NSFileManager.defaultManager removeItemAtPath:_rootPath error:NULL];
+    [self writeFile:@"proc/self/cgroup" contents:@"0::/app.slice/test\n"];
+    [self writePressureSome:0.0 full:0.0];
+    [self writeFile:@"sys/fs/cgroup/app.slice/test/memory.max" contents:@"1000000\n"];
+    [self writeFile:@"sys/fs/cgroup/app.slice/test/memory.current" contents:@"100000\n"];
+    [self writeEventsHigh:0 max:0 oom:0];
+    _monitor = [[PWDispatchMemoryPressureMonitor alloc] initWithRootPath:_rootPath];
+    _queue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWDispatchMemoryPressureMonitorTest"];
+}
+
+- (void)tearDown
+{
+    [_monitor stop];
+    [NSFileManager.defaultManager removeItemAtPath:_rootPath error:NULL];
+    [super tearDown];
+}
+
+- (void)writeFile:(NSString*)relativePath contents:(NSString*)contents
+{
+    NSString* path = [_rootPath stringByAppendingPathComponent:relativePath];
+    [NSFileManager.defaultManager createDirectoryAtPath:path.stringByDeletingLastPathComponent
+                            withIntermediateDirectories:YES
+                                             attributes:nil
+                                                  error:NULL];
+    XCTAssertTrue([contents writeToFile:path atomically:YES encoding:NSUTF8StringEncoding error:NULL]);
+}
+
+- (void)writePressureSome:(double)some full:(double)full
+{
+    [self writeFile:@"proc/pressure/memory"
+           contents:[NSString stringWithFormat:@"some avg10=%.2f avg60=0.00 avg300=0.00 total=0\n"
+                                               "full avg10=%.2f avg60=0.00 avg300=0.00 total=0\n", some, full]];
+}
+
+- (void)writeEventsHigh:(NSUInteger)high max:(NSUInteger)max oom:(NSUInteger)oom
+{
+    [self writeFile:@"sys/fs/cgroup/app.slice/test/memory.events"
+           contents:[NSString stringWithFormat:@"low 0\nhigh %lu\nmax %lu\noom %lu\noom_kill 0\n",
+                     (unsigned long)high, (unsigned long)max, (unsigned long)oom]];
+}
+
+- (void)testPSI
+{
+    XCTAssertEqual([_monitor update], DISPATCH_MEMORYPRESSURE_NORMAL);
+
+    [self writePressureSome:12.5 full:1.0];
+    XCTAssertEqual([_monitor update], DISPATCH_MEMORYPRESSURE_WARN);
+
+    [self writePressureSome:40.0 full:6.0];
+    XCTAssertEqual([_monitor update], DISPATCH_MEMORYPRESSURE_CRITICAL);
+
+    _monitor.psiCriticalThreshold = 20.0;
+    XCTAssertEqual([_monitor update], DISPATCH_MEMORYPRESSURE_WARN);
+    XCTAssertEqual(_monitor.level, DISPATCH_MEMORYPRESSURE_WARN);
+}
+
+- (void)testCgroupUsage
+{
+    [self writeFile:@"sys/fs/cgroup/app.slice/test/memory.current" contents:@"900000\n"];
+    XCTAssertEqual([_monitor update], DISPATCH_MEMORYPRESSURE_WARN);
+
+    [self writeFile:@"sys/fs/cgroup/app.slice/test/memory.current" contents:@"960000\n"];
+    XCTAssertEqual([_monitor update], DISPATCH_MEMORYPRESSURE_CRITICAL);
+
+    // Without a limit, the usage does not matter.
+    [self writeFile:@"sys/fs/cgroup/app.slice/test/memory.max" contents:@"max\n"];
+    XCTAssertEqual([_monitor update], DISPATCH_MEMORYPRESSURE_NORMAL);
+}
+
+- (void)testCgroupEvents
+{
+    // Events counted before the first update are history.
+    [self writeEventsHigh:5 max:1 oom:0];
+    XCTAssertEqual([_monitor update], DISPATCH_MEMORYPRESSURE_NORMAL);
+
+    [self writeEventsHigh:6 max:1 oom:0];
+    XCTAssertEqual([_monitor update], DISPATCH_MEMORYPRESSURE_WARN);
+
+    [self writeEventsHigh:6 max:1 oom:1];
+    XCTAssertEqual([_monitor update], DISPATCH_MEMORYPRESSURE_CRITICAL);
+
+    XCTAssertEqual([_monitor update], DISPATCH_MEMORYPRESSURE_NORMAL);
+}
+
+- (void)testMissingFiles
+{
+    PWDispatchMemoryPressureMonitor* monitor = [[PWDispatchMemoryPressureMonitor alloc] initWithRootPath:[_rootPath stringByAppendingPathComponent:@"missing"]];
+    XCTAssertEqual([monitor update], DISPATCH_MEMORYPRESSURE_NORMAL);
+}
+
+- (void)testObserver
+{
+    PWDispatchMemoryPressureObserver* observer = [[PWDispatchMemoryPressureObserver alloc] initWithFlags:DISPATCH_MEMORYPRESSURE_CRITICAL
+                                                                                          dispatchQueue:_queue
+                                                                                                monitor:_monitor];
+    PWDispatchSemaphore* fired = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    observer.eventBlock = ^{
+        [fired signal];
+    };
+    [observer enable];
+
+    // Warnings are not in the flags of the observer.
+    [self writePressureSome:12.5 full:0.0];
+    [_monitor update];
+    XCTAssertFalse([fired waitWithTimeout:0.2 useWallTime:NO]);
+
+    [self writePressureSome:12.5 full:8.0];
+    [_monitor update];
+    XCTAssertTrue([fired waitWithTimeout:self.shortTimeout useWallTime:NO]);
+
+    // The level did not change.
+    [_monitor update];
+    XCTAssertFalse([fired waitWithTimeout:0.2 useWallTime:NO]);
+    [observer cancel];
+}
+
+- (void)testPolling
+{
+    _monitor.pollInterval = 0.05;
+    PWDispatchMemoryPressureObserver* observer = [[PWDispatchMemoryPressureObserver alloc] initWithFlags:DISPATCH_MEMORYPRESSURE_WARN
+                                                                                          dispatchQueue:_queue
+                                                                                                monitor:_monitor];
+    PWDispatchSemaphore* fired = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    observer.eventBlock = ^{
+        [fired signal];
+    };
+    [observer enable];
+    [_monitor start];
+
+    [self writeFile:@"sys/fs/cgroup/app.slice/test/memory.current" contents:@"900000\n"];
+    XCTAssertTrue([fired waitWithTimeout:self.shortTimeout useWallTime:NO]);
+    [observer cancel];
+}
+
+- (void)testCachesUseSharedMonitor
+{
+    PWDispatchMemoryPressureMonitor* previousMonitor = PWDispatchMemoryPressureMonitor.sharedMonitor;
+    PWDispatchMemoryPressureMonitor.sharedMonitor = _monitor;
+
+    PWLRUCache<NSString*, NSString*>* cache = [[PWLRUCache alloc] initWithCapacity:10 delegate:nil dispatchQueue:_queue];
+    [_queue synchronouslyDispatchBlock:^{
+        cache[@"a"] = @"1";
+        cache[@"b"] = @"2";
+    }];
+
+    [self writeFile:@"sys/fs/cgroup/app.slice/test/memory.current" contents:@"990000\n"];
+    XCTAssertEqual([_monitor update], DISPATCH_MEMORYPRESSURE_CRITICAL);
+
+    __block NSUInteger count = NSNotFound;
+    NSDate* timeout = [NSDate dateWithTimeIntervalSinceNow:self.shortTimeout];
+    while (count != 0 && timeout.timeIntervalSinceNow > 0)
+        [_queue synchronouslyDispatchBlock:^{
+            count = cache.count;
+        }];
+    XCTAssertEqual(count, 0);
+
+    PWDispatchMemoryPressureMonitor.sharedMonitor = previousMonitor;
+}
+
+@end
@@ -0,0 +1,175 @@
+//
+//  PWDispatchTaskGraphTest.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import <PWFoundation/PWDispatch.h>
+#import "PWTestCase.h"
+#import "PWErrors.h"
+
+@interface PWDispatchTaskGraphTest : PWTestCase
+@end
+
+@implementation PWDispatchTaskGraphTest
+
+- (NSError*)sampleError
+{
+    return [NSError errorWithDomain:PWErrorDomain code:PWGenericError userInfo:nil];
+}
+
+// load -> parse -> two concurrent analyses -> merge
+- (void)testPipeline
+{
+    PWDispatchTaskGraph* graph = [[PWDispatchTaskGraph alloc] init];
+    PWDispatchQueue* serialQueue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWDispatchTaskGraphTest"];
+    PWDispatchQueue* concurrentQueue = [PWDispatchQueue concurrentDispatchQueueWithLabel:@"PWDispatchTaskGraphTest"];
+    PWDispatchSemaphore* aStarted = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    PWDispatchSemaphore* bStarted = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+
+    PWDispatchTask* load = [graph addTaskWithName:@"load" queue:serialQueue dependencies:nil block:^id(PWDispatchTask* task, NSError** outError) {
+        XCTAssertTrue(serialQueue.isCurrentDispatchQueue);
+        return @"1 2 3 4";
+    }];
+    PWDispatchTask* parse = [graph addTaskWithName:@"parse" queue:serialQueue dependencies:@[load] block:^id(PWDispatchTask* task, NSError** outError) {
+        return [task.dependencies.firstObject.result componentsSeparatedByString:@" "];
+    }];
+    // The analyses wait for each other, which only succeeds if they run concurrently.
+    PWDispatchTask* sum = [graph addTaskWithName:@"sum" queue:concurrentQueue dependencies:@[parse] block:^id(PWDispatchTask* task, NSError** outError) {
+        [aStarted signal];
+        XCTAssertTrue([bStarted waitWithTimeout:5.0 useWallTime:NO]);
+        return [parse.result valueForKeyPath:@"@sum.integerValue"];
+    }];
+    PWDispatchTask* count = [graph addTaskWithName:@"count" queue:concurrentQueue dependencies:@[parse] block:^id(PWDispatchTask* task, NSError** outError) {
+        [bStarted signal];
+        XCTAssertTrue([aStarted waitWithTimeout:5.0 useWallTime:NO]);
+        return @([parse.result count]);
+    }];
+    PWDispatchTask* merge = [graph addTaskWithName:@"merge" queue:serialQueue dependencies:@[sum, count, sum] block:^id(PWDispatchTask* task, NSError** outError) {
+        XCTAssertEqual(task.dependencies.count, 2);
+        return @([sum.result doubleValue] / [count.result doubleValue]);
+    }];
+
+    __block NSError* completionError = self.sampleError;
+    PWDispatchSemaphore* completed = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    [graph onCompletionDispatchBlock:^(NSError* error) {
+        completionError = error;
+        [completed signal];
+    } onQueue:serialQueue];
+
+    XCTAssertEqual(merge.state, PWDispatchTaskStatePending);
+    [graph run];
+    XCTAssertTrue([graph waitForCompletionWithTimeout:10.0]);
+    XCTAssertTrue([completed waitWithTimeout:5.0 useWallTime:NO]);
+
+    XCTAssertNil(completionError);
+    XCTAssertNil(graph.error);
+    XCTAssertEqualObjects(merge.result, @2.5);
+    for (PWDispatchTask* task in graph.tasks)
+    {
+        XCTAssertEqual(task.state, PWDispatchTaskStateSucceeded);
+        XCTAssertGreaterThanOrEqual(task.startTime, task.readyTime);
+        XCTAssertGreaterThanOrEqual(task.finishTime, task.startTime);
+    }
+    XCTAssertGreaterThanOrEqual(merge.readyTime, MAX(sum.finishTime, count.finishTime));
+}
+
+- (void)testFailurePropagation
+{
+    PWDispatchTaskGraph* graph = [[PWDispatchTaskGraph alloc] init];
+    graph.cancelsOnFailure = NO;
+    PWDispatchQueue* queue = [PWDispatchQueue concurrentDispatchQueueWithLabel:@"PWDispatchTaskGraphTest"];
+    NSError* sampleError = self.sampleError;
+
+    PWDispatchTask* root = [graph addTaskWithName:@"root" queue:queue dependencies:nil block:^id(PWDispatchTask* task, NSError** outError) {
+        return @1;
+    }];
+    PWDispatchTask* failing = [graph addTaskWithName:@"failing" queue:queue dependencies:@[root] block:^id(PWDispatchTask* task, NSError** outError) {
+        *outError = sampleError;
+        return nil;
+    }];
+    PWDispatchTask* dependent = [graph addTaskWithName:@"dependent" queue:queue dependencies:@[failing] block:^id(PWDispatchTask* task, NSError** outError) {
+        XCTFail(@"must not run");
+        return nil;
+    }];
+    PWDispatchTask* transitive = [graph addTaskWithName:@"transitive" queue:queue dependencies:@[root, dependent] block:^id(PWDispatchTask* task, NSError** outError) {
+        XCTFail(@"must not run");
+        return nil;
+    }];
+    // A task with a nil result and no error succeeds.
+    PWDispatchTask* independent = [graph addTaskWithName:@"independent" queue:queue dependencies:@[root] block:^id(PWDispatchTask* task, NSError** outError) {
+        return nil;
+    }];
+
+    [graph run];
+    XCTAssertTrue([graph waitForCompletionWithTimeout:10.0]);
+
+    XCTAssertEqual(failing.state, PWDispatchTaskStateFailed);
+    XCTAssertEqual(dependent.state, PWDispatchTaskStateCancelled);
+    XCTAssertEqual(transitive.state, PWDispatchTaskStateCancelled);
+    XCTAssertEqual(independent.state, PWDispatchTaskStateSucceeded);
+    XCTAssertEqualObjects(dependent.error, sampleError);
+    XCTAssertEqualObjects(graph.error, sampleError);
+    XCTAssertFalse(graph.isCancelled);
+}
+
+- (void)testCancellation
+{
+    PWDispatchTaskGraph* graph = [[PWDispatchTaskGraph alloc] init];
+    PWDispatchQueue* queue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWDispatchTaskGraphTest"];
+    PWDispatchSemaphore* started = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    PWDispatchSemaphore* cancelled = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    __block BOOL sawCancellation = NO;
+
+    PWDispatchTask* running = [graph addTaskWithName:@"running" queue:queue dependencies:nil block:^id(PWDispatchTask* task, NSError** outError) {
+        [started signal];
+        [cancelled waitWithTimeout:5.0 useWallTime:NO];
+        sawCancellation = task.isCancelled;
+        return @1;
+    }];
+    PWDispatchTask* next = [graph addTaskWithName:@"next" queue:queue dependencies:@[running] block:^id(PWDispatchTask* task, NSError** outError) {
+        XCTFail(@"must not run");
+        return nil;
+    }];
+
+    [graph run];
+    XCTAssertTrue([started waitWithTimeout:5.0 useWallTime:NO]);
+    [graph cancel];
+    [cancelled signal];
+    XCTAssertTrue([graph waitForCompletionWithTimeout:10.0]);
+
+    XCTAssertTrue(sawCancellation);
+    XCTAssertEqual(running.state, PWDispatchTaskStateSucceeded);
+    XCTAssertEqual(next.state, PWDispatchTaskStateCancelled);
+    XCTAssertTrue(graph.isCancelled);
+    XCTAssertEqual(graph.error.code, NSUserCancelledError);
+}
+
+- (void)testCriticalPath
+{
+    PWDispatchTaskGraph* graph = [[PWDispatchTaskGraph alloc] init];
+    PWDispatchQueue* queue = [PWDispatchQueue concurrentDispatchQueueWithLabel:@"PWDispatchTaskGraphTest"];
+    PWDispatchTaskBlock (^sleeping)(NSTimeInterval) = ^PWDispatchTaskBlock(NSTimeInterval duration) {
+        return ^id(PWDispatchTask* task, NSError** outError) {
+            [NSThread sleepForTimeInterval:duration];
+            return @YES;
+        };
+    };
+
+    PWDispatchTask* start = [graph addTaskWithName:@"start" queue:queue dependencies:nil block:sleeping(0.01)];
+    PWDispatchTask* fast  = [graph addTaskWithName:@"fast" queue:queue dependencies:@[start] block:sleeping(0.01)];
+    PWDispatchTask* slow  = [graph addTaskWithName:@"slow" queue:queue dependencies:@[start] block:sleeping(0.2)];
+    PWDispatchTask* end   = [graph addTaskWithName:@"end" queue:queue dependencies:@[fast, slow] block:sleeping(0.01)];
+
+    [graph run];
+    XCTAssertTrue([graph waitForCompletionWithTimeout:10.0]);
+
+    XCTAssertEqualObjects(graph.criticalPath, (@[start, slow, end]));
+    XCTAssertGreaterThanOrEqual(slow.runDuration, 0.2);
+    XCTAssertTrue([graph.timingDescription containsString:@"* slow (succeeded)"]);
+    XCTAssertTrue([graph.timingDescription containsString:@"  fast (succeeded)"]);
+}
+
+@end
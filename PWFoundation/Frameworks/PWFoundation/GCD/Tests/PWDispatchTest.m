@@ -559,6 +559,60 @@
     [observer2 dispose];
 }
 
+- (void)testDispatchKeyValueObserverCoalescing
+{
+    PWDispatchQueue* queue = [PWDispatchQueue serialDispatchQueueWithLabel:NSStringFromSelector(_cmd)];
+    NSMutableDictionary* dict = [[NSMutableDictionary alloc] init];
+    dict[@"a"] = @0;
+    NSMutableArray* receivedKeyPaths = [NSMutableArray array];
+    NSMutableArray* receivedChanges = [NSMutableArray array];
+    PWDispatchObserver* observer = [dict addObserverForKeyPaths:@[@"a", @"b"]
+                                                        options:NSKeyValueObservingOptionOld | NSKeyValueObservingOptionNew | PWKeyValueObservingOptionCoalescing
+                                                  dispatchQueue:queue
+                                                   dispatchKind:PWDispatchQueueDispatchKindAsynchronous
+                                                     usingBlock:^(NSString* keyPath, id obj, NSDictionary* change){
+                                                         XCTAssertTrue(queue.isCurrentDispatchQueue);
+                                                         XCTAssertEqual(obj, dict);
+                                                         [receivedKeyPaths addObject:keyPath];
+                                                         [receivedChanges addObject:change];
+                                                     }];
+
+    // A burst of changes while the queue is busy is delivered by one call per key path.
+    PWDispatchSemaphore* semaphore = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    [queue asynchronouslyDispatchBlock:^{
+        XCTAssertTrue([semaphore waitWithTimeout:self.normalTimeout useWallTime:NO]);
+    }];
+    for (NSUInteger i = 1; i <= 100; ++i)
+    {
+        [dict setValue:@(i) forKey:@"a"];
+        [dict setValue:@(i * 10) forKey:@"b"];
+    }
+    [semaphore signal];
+    [queue synchronouslyDispatchBlock:^{}];
+
+    XCTAssertEqualObjects(receivedKeyPaths, (@[@"a", @"b"]));
+    XCTAssertEqualObjects(receivedChanges[0][NSKeyValueChangeOldKey], @0);
+    XCTAssertEqualObjects(receivedChanges[0][NSKeyValueChangeNewKey], @100);
+    XCTAssertEqualObjects(receivedChanges[1][NSKeyValueChangeOldKey], NSNull.null);    // "b" was absent before
+    XCTAssertEqualObjects(receivedChanges[1][NSKeyValueChangeNewKey], @1000);
+
+    // Later changes are delivered by a new dispatch.
+    [dict setValue:@101 forKey:@"a"];
+    [queue synchronouslyDispatchBlock:^{}];
+    XCTAssertEqual(receivedKeyPaths.count, 3);
+    XCTAssertEqualObjects(receivedChanges[2][NSKeyValueChangeOldKey], @100);
+
+    // Pending changes are dropped by dispose.
+    [queue asynchronouslyDispatchBlock:^{
+        XCTAssertTrue([semaphore waitWithTimeout:self.normalTimeout useWallTime:NO]);
+    }];
+    [dict setValue:@102 forKey:@"a"];
+    [observer dispose];
+    [semaphore signal];
+    [queue synchronouslyDispatchBlock:^{}];
+    XCTAssertEqual(receivedKeyPaths.count, 3);
+}
+
 - (void)testDispatchFileObserverDelete
 {
     NSString* path = [NSTemporaryDirectory() stringByAppendingPathComponent:NSStringFromSelector(_cmd)];
@@ -0,0 +1,189 @@
+//
+//  PWDispatchTimerWheelTest.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import <PWFoundation/PWDispatch.h>
+#import "PWTestCase.h"
+
+@interface PWDispatchTimerWheelTest : PWTestCase
+@end
+
+@implementation PWDispatchTimerWheelTest
+
+- (void)testSingleShotTimer
+{
+    PWDispatchTimerWheel* wheel = [[PWDispatchTimerWheel alloc] initWithResolution:0.01];
+    PWDispatchQueue* queue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWDispatchTimerWheelTest"];
+    PWDispatchSemaphore* fired = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    NSDate* start = [NSDate date];
+    __block NSTimeInterval elapsed = 0.0;
+    __block NSUInteger fireCount = 0;
+
+    __block PWDispatchWheelTimer* timer;
+    timer = [wheel enabledSingleShotTimerWithQueue:queue fireIntervalFromNow:0.1 leeway:0.0 eventBlock:^{
+        XCTAssertTrue(queue.isCurrentDispatchQueue);
+        elapsed = -start.timeIntervalSinceNow;
+        fireCount = timer.fireCount;
+        [fired signal];
+    }];
+    XCTAssertEqual(wheel.timerCount, 1);
+
+    XCTAssertTrue([fired waitWithTimeout:5.0 useWallTime:NO]);
+    XCTAssertGreaterThanOrEqual(elapsed, 0.1);
+    XCTAssertEqual(fireCount, 1);
+    XCTAssertEqual(wheel.timerCount, 0);
+
+    // Fired single shot timers can be restarted.
+    [timer setFireIntervalFromNow:0.0 leeway:0.0];
+    XCTAssertTrue([fired waitWithTimeout:5.0 useWallTime:NO]);
+    [timer cancel];
+}
+
+- (void)testRepeatingTimer
+{
+    PWDispatchTimerWheel* wheel = [[PWDispatchTimerWheel alloc] initWithResolution:0.01];
+    PWDispatchQueue* queue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWDispatchTimerWheelTest"];
+    PWDispatchSemaphore* fired = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    __block NSUInteger totalFireCount = 0;
+
+    __block PWDispatchWheelTimer* timer;
+    timer = [wheel enabledTimerWithQueue:queue startIntervalFromNow:0.02 repetitionInterval:0.02 leeway:0.0 eventBlock:^{
+        totalFireCount += timer.fireCount;
+        if (totalFireCount >= 5)
+            [fired signal];
+    }];
+
+    XCTAssertTrue([fired waitWithTimeout:5.0 useWallTime:NO]);
+    [timer cancel];
+    XCTAssertTrue(timer.isCancelled);
+    XCTAssertEqual(wheel.timerCount, 0);
+
+    // No more events after canceling.
+    [queue synchronouslyDispatchBlock:^{}];
+    NSUInteger countAfterCancel = totalFireCount;
+    [NSThread sleepForTimeInterval:0.1];
+    [queue synchronouslyDispatchBlock:^{}];
+    XCTAssertEqual(totalFireCount, countAfterCancel);
+}
+
+- (void)testLongTimeoutWakesUpRarely
+{
+    PWDispatchTimerWheel* wheel = [[PWDispatchTimerWheel alloc] initWithResolution:0.001];
+    PWDispatchQueue* queue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWDispatchTimerWheelTest"];
+    PWDispatchSemaphore* fired = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    NSDate* start = [NSDate date];
+    __block NSTimeInterval elapsed = 0.0;
+
+    [wheel enabledSingleShotTimerWithQueue:queue fireIntervalFromNow:0.5 leeway:0.0 eventBlock:^{
+        elapsed = -start.timeIntervalSinceNow;
+        [fired signal];
+    }];
+
+    XCTAssertTrue([fired waitWithTimeout:5.0 useWallTime:NO]);
+    XCTAssertGreaterThanOrEqual(elapsed, 0.5);
+    // Ticking with the resolution would take 500 wakeups. Only cascades at slot boundaries and the expiry wake up.
+    XCTAssertLessThan(wheel.wakeupCount, 20);
+    [wheel dispose];
+}
+
+- (void)testReschedulingAndCanceling
+{
+    PWDispatchTimerWheel* wheel = [[PWDispatchTimerWheel alloc] initWithResolution:0.01];
+    PWDispatchQueue* queue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWDispatchTimerWheelTest"];
+    __block NSUInteger firedCount = 0;
+
+    NSMutableArray<PWDispatchWheelTimer*>* timers = [NSMutableArray array];
+    for (NSUInteger index = 0; index < 1000; index++)
+        [timers addObject:[wheel enabledSingleShotTimerWithQueue:queue fireIntervalFromNow:0.05 leeway:0.0 eventBlock:^{
+            ++firedCount;
+        }]];
+    XCTAssertEqual(wheel.timerCount, 1000);
+
+    // Postponed timers and canceled timers do not fire, the others fire once.
+    for (NSUInteger index = 0; index < 1000; index++)
+    {
+        if (index % 3 == 0)
+            [timers[index] setFireIntervalFromNow:3600.0 leeway:0.0];
+        else if (index % 3 == 1)
+            [timers[index] cancel];
+    }
+    XCTAssertEqual(wheel.timerCount, 334);
+
+    [NSThread sleepForTimeInterval:0.3];
+    [queue synchronouslyDispatchBlock:^{}];
+    XCTAssertEqual(firedCount, 333);
+    XCTAssertEqual(wheel.timerCount, 334);
+
+    [wheel dispose];
+    XCTAssertEqual(wheel.timerCount, 0);
+    XCTAssertTrue(timers[0].isCancelled);
+}
+
+- (void)testTimersWithLeewayAreBatched
+{
+    PWDispatchTimerWheel* wheel = [[PWDispatchTimerWheel alloc] initWithResolution:0.001];
+    PWDispatchQueue* queue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWDispatchTimerWheelTest"];
+    PWDispatchGroup* group = [[PWDispatchGroup alloc] init];
+    NSMutableArray<NSDate*>* fireDates = [NSMutableArray array];
+
+    // The leeway of 0.1 s lets the timers with deadlines spread between 0.01 and 0.05 s share one tick.
+    for (NSUInteger index = 0; index < 50; index++)
+    {
+        [group enter];
+        [wheel enabledSingleShotTimerWithQueue:queue fireIntervalFromNow:0.01 + 0.0008 * index leeway:0.1 eventBlock:^{
+            [fireDates addObject:[NSDate date]];
+            [group leave];
+        }];
+    }
+    XCTAssertTrue([group waitForCompletionWithTimeout:5.0 useWallTime:NO]);
+    XCTAssertLessThan([fireDates.lastObject timeIntervalSinceDate:fireDates.firstObject], 0.01);
+}
+
+#pragma mark - Performance
+
+static const NSUInteger PWDispatchTimerWheelPerformanceCount = 20000;
+
+// Starts many timeouts, reschedules each of them several times and cancels them, as connections do which stay active.
+- (void)testTimeoutPerformance
+{
+    PWDispatchTimerWheel* wheel = [[PWDispatchTimerWheel alloc] initWithResolution:0.01];
+    PWDispatchQueue* queue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWDispatchTimerWheelTest"];
+
+    [self measureBlock:^{
+        NSMutableArray<PWDispatchWheelTimer*>* timers = [NSMutableArray array];
+        for (NSUInteger index = 0; index < PWDispatchTimerWheelPerformanceCount; index++)
+            [timers addObject:[wheel enabledSingleShotTimerWithQueue:queue fireIntervalFromNow:60.0 leeway:1.0 eventBlock:^{}]];
+        for (NSUInteger round = 0; round < 5; round++)
+            for (PWDispatchWheelTimer* timer in timers)
+                [timer setFireIntervalFromNow:60.0 leeway:1.0];
+        for (PWDispatchWheelTimer* timer in timers)
+            [timer cancel];
+    }];
+}
+
+// The same with one dispatch source per timeout.
+- (void)testTimeoutPerformanceWithDispatchTimers
+{
+    PWDispatchQueue* queue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWDispatchTimerWheelTest"];
+
+    [self measureBlock:^{
+        NSMutableArray<PWDispatchTimer*>* timers = [NSMutableArray array];
+        for (NSUInteger index = 0; index < PWDispatchTimerWheelPerformanceCount; index++)
+            [timers addObject:[PWDispatchTimer enabledSingleShotTimerWithQueue:queue
+                                                           fireIntervalFromNow:60.0
+                                                                        leeway:1.0
+                                                                   useWallTime:NO
+                                                                    eventBlock:^{}]];
+        for (NSUInteger round = 0; round < 5; round++)
+            for (PWDispatchTimer* timer in timers)
+                [timer setFireIntervalFromNow:60.0 leeway:1.0 useWallTime:NO];
+        for (PWDispatchTimer* timer in timers)
+            [timer cancel];
+    }];
+}
+
+@end
@@ -0,0 +1,138 @@
+//
+//  PWDispatchTreeObserverTest.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import <PWFoundation/PWDispatch.h>
+#import "PWTestCase.h"
+
+@interface PWDispatchTreeObserverTest : PWTestCase
+@end
+
+@implementation PWDispatchTreeObserverTest
+{
+    NSString*                                           _rootPath;
+    PWDispatchTreeObserver*                             _observer;
+    NSMutableArray<NSDictionary<NSString*, NSNumber*>*>* _batches;
+}
+
+- (void)setUp
+{
+    [super setUp];
+
+    // Observers report standardized paths.
+    _rootPath = [[NSTemporaryDirectory() stringByAppendingPathComponent:@"PWDispatchTreeObserverTest"] stringByStandardizingPath];
+    [NSFileManager.defaultManager removeItemAtPath:_rootPath error:NULL];
+    XCTAssertTrue([NSFileManager.defaultManager createDirectoryAtPath:[_rootPath stringByAppendingPathComponent:@"a/b"]
+                                          withIntermediateDirectories:YES
+                                                           attributes:nil
+                                                                error:NULL]);
+    _batches = [NSMutableArray array];
+
+    NSError* error;
+    _observer = [[PWDispatchTreeObserver alloc] initWithDirectoryURLs:@[[NSURL fileURLWithPath:_rootPath isDirectory:YES]]
+                                                            eventMask:PWDispatchFileWrite | PWDispatchFileDelete | PWDispatchFileRename
+                                                              latency:0.2
+                                                              onQueue:PWDispatchQueue.mainQueue
+                                                           batchBlock:^(NSDictionary<NSString*, NSNumber*>* changes) {
+                                                               [_batches addObject:changes];
+                                                           }
+                                                                error:&error];
+    XCTAssertNotNil(_observer, @"%@", error);
+    [_observer enable];
+}
+
+- (void)tearDown
+{
+    [_observer dispose];
+    [NSFileManager.defaultManager removeItemAtPath:_rootPath error:NULL];
+    [super tearDown];
+}
+
+- (NSString*)pathWithComponent:(NSString*)component
+{
+    return [_rootPath stringByAppendingPathComponent:component];
+}
+
+// Waits for the next batch while running the main queue, which receives the batches.
+- (NSDictionary<NSString*, NSNumber*>*)nextBatch
+{
+    NSDate* timeout = [NSDate dateWithTimeIntervalSinceNow:self.longTimeout];
+    while (_batches.count == 0 && timeout.timeIntervalSinceNow > 0)
+        [NSRunLoop.currentRunLoop runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.05]];
+    XCTAssertGreaterThan(_batches.count, 0);
+    if (_batches.count == 0)
+        return @{};
+    NSDictionary<NSString*, NSNumber*>* batch = _batches[0];
+    [_batches removeObjectAtIndex:0];
+    return batch;
+}
+
+- (void)testObservesWholeTree
+{
+    XCTAssertEqual(_observer.observedDirectoryCount, 3);
+
+    [[NSData data] writeToFile:[self pathWithComponent:@"file"] atomically:NO];
+    [[NSData data] writeToFile:[self pathWithComponent:@"a/b/file"] atomically:NO];
+    NSDictionary<NSString*, NSNumber*>* batch = [self nextBatch];
+    XCTAssertTrue(batch[_rootPath].unsignedIntegerValue & PWDispatchFileWrite);
+    XCTAssertTrue(batch[[self pathWithComponent:@"a/b"]].unsignedIntegerValue & PWDispatchFileWrite);
+    XCTAssertNil(batch[[self pathWithComponent:@"a"]]);
+}
+
+- (void)testBatchesAreDeduplicated
+{
+    for (NSUInteger index = 0; index < 50; index++)
+    {
+        NSString* path = [self pathWithComponent:[NSString stringWithFormat:@"a/file%lu", (unsigned long)(index % 5)]];
+        [[NSData dataWithBytes:&index length:sizeof(index)] writeToFile:path atomically:NO];
+    }
+    NSDictionary<NSString*, NSNumber*>* batch = [self nextBatch];
+    XCTAssertTrue(batch[[self pathWithComponent:@"a"]].unsignedIntegerValue & PWDispatchFileWrite);
+    XCTAssertLessThanOrEqual(batch.count, 6);
+
+    // All changes were delivered in one batch.
+    [NSRunLoop.currentRunLoop runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.5]];
+    XCTAssertEqual(_batches.count, 0);
+}
+
+- (void)testObservesNewDirectories
+{
+    NSString* newPath = [self pathWithComponent:@"a/new"];
+    XCTAssertTrue([NSFileManager.defaultManager createDirectoryAtPath:newPath withIntermediateDirectories:NO attributes:nil error:NULL]);
+    NSDictionary<NSString*, NSNumber*>* batch = [self nextBatch];
+    XCTAssertTrue(batch[[self pathWithComponent:@"a"]].unsignedIntegerValue & PWDispatchFileWrite);
+    XCTAssertEqual(_observer.observedDirectoryCount, 4);
+
+    [[NSData data] writeToFile:[newPath stringByAppendingPathComponent:@"file"] atomically:NO];
+    batch = [self nextBatch];
+    XCTAssertTrue(batch[newPath].unsignedIntegerValue & PWDispatchFileWrite);
+}
+
+- (void)testDeletedDirectoriesAreForgotten
+{
+    XCTAssertTrue([NSFileManager.defaultManager removeItemAtPath:[self pathWithComponent:@"a"] error:NULL]);
+    NSDictionary<NSString*, NSNumber*>* batch = [self nextBatch];
+    XCTAssertTrue(batch[_rootPath].unsignedIntegerValue & PWDispatchFileWrite);
+    XCTAssertTrue(batch[[self pathWithComponent:@"a"]].unsignedIntegerValue & PWDispatchFileDelete);
+
+    // The kernel may report the removal of watches after the batch.
+    NSDate* timeout = [NSDate dateWithTimeIntervalSinceNow:self.longTimeout];
+    while (_observer.observedDirectoryCount > 1 && timeout.timeIntervalSinceNow > 0)
+        [NSRunLoop.currentRunLoop runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.05]];
+    XCTAssertEqual(_observer.observedDirectoryCount, 1);
+}
+
+- (void)testDisposeStopsBatches
+{
+    [_observer dispose];
+    [[NSData data] writeToFile:[self pathWithComponent:@"file"] atomically:NO];
+    [NSRunLoop.currentRunLoop runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.5]];
+    XCTAssertEqual(_batches.count, 0);
+    XCTAssertEqual(_observer.observedDirectoryCount, 0);
+}
+
+@end
@@ -0,0 +1,155 @@
+//
+//  PWKeyedDispatchSchedulerTest.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import <PWFoundation/PWDispatch.h>
+#import "PWTestCase.h"
+
+@interface PWKeyedDispatchSchedulerTest : PWTestCase
+@end
+
+@implementation PWKeyedDispatchSchedulerTest
+
+- (PWKeyedDispatchScheduler*)createScheduler
+{
+    return [[PWKeyedDispatchScheduler alloc] initWithDispatchQueue:
+            [PWDispatchQueue concurrentDispatchQueueWithLabel:@"PWKeyedDispatchSchedulerTest"]];
+}
+
+- (void)testLatestBlockWins
+{
+    PWKeyedDispatchScheduler* scheduler = [self createScheduler];
+    PWDispatchQueue* resultQueue = [PWDispatchQueue serialDispatchQueueWithLabel:@"results"];
+    NSMutableArray* results = [NSMutableArray array];
+
+    [scheduler suspend];
+    XCTAssertTrue(scheduler.isSuspended);
+    for (NSString* value in @[@"a1", @"b1", @"a2", @"c1", @"a3"])
+    {
+        NSString* key = [value substringToIndex:1];
+        [scheduler forKey:key scheduleBlock:^{
+            [resultQueue synchronouslyDispatchBlock:^{ [results addObject:value]; }];
+        }];
+    }
+    XCTAssertEqual(scheduler.keyCount, 3);
+    XCTAssertEqual(scheduler.replacedBlockCount, 2);
+    XCTAssertTrue([scheduler waitUntilIdleWithTimeout:1.0]);
+    XCTAssertEqual(results.count, 0);
+
+    [scheduler resume];
+    XCTAssertFalse(scheduler.isSuspended);
+    XCTAssertTrue([scheduler waitUntilIdleWithTimeout:5.0]);
+    XCTAssertEqualObjects([NSSet setWithArray:results], ([NSSet setWithObjects:@"a3", @"b1", @"c1", nil]));
+    XCTAssertEqual(scheduler.keyCount, 0);
+}
+
+- (void)testDifferentKeysRunConcurrently
+{
+    PWKeyedDispatchScheduler* scheduler = [self createScheduler];
+    PWDispatchSemaphore* aStarted = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    PWDispatchSemaphore* bStarted = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    __block BOOL aSawB = NO;
+    __block BOOL bSawA = NO;
+
+    // Each block waits for the other one to start, which only succeeds if both run at the same time.
+    [scheduler forKey:@"a" scheduleBlock:^{
+        [aStarted signal];
+        aSawB = [bStarted waitWithTimeout:5.0 useWallTime:NO];
+    }];
+    [scheduler forKey:@"b" scheduleBlock:^{
+        [bStarted signal];
+        bSawA = [aStarted waitWithTimeout:5.0 useWallTime:NO];
+    }];
+
+    XCTAssertTrue([scheduler waitUntilIdleWithTimeout:10.0]);
+    XCTAssertTrue(aSawB);
+    XCTAssertTrue(bSawA);
+}
+
+- (void)testSameKeyIsSerialized
+{
+    PWKeyedDispatchScheduler* scheduler = [self createScheduler];
+    PWDispatchSemaphore* started = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    PWDispatchSemaphore* proceed = [[PWDispatchSemaphore alloc] initWithInitialValue:0];
+    __block NSInteger runningCount = 0;
+    __block NSInteger maxRunningCount = 0;
+    __block NSUInteger performedCount = 0;
+    PWDispatchQueue* countQueue = [PWDispatchQueue serialDispatchQueueWithLabel:@"count"];
+
+    PWDispatchBlock (^makeBlock)(BOOL) = ^PWDispatchBlock(BOOL blocking) {
+        return ^{
+            [countQueue synchronouslyDispatchBlock:^{
+                maxRunningCount = MAX(maxRunningCount, ++runningCount);
+            }];
+            if (blocking)
+            {
+                [started signal];
+                [proceed waitWithTimeout:5.0 useWallTime:NO];
+            }
+            [countQueue synchronouslyDispatchBlock:^{
+                --runningCount;
+                ++performedCount;
+            }];
+        };
+    };
+
+    [scheduler forKey:@"a" scheduleBlock:makeBlock(YES)];
+    XCTAssertTrue([started waitWithTimeout:5.0 useWallTime:NO]);
+
+    // While the first block runs, the following ones are pending and replace each other.
+    for (NSUInteger index = 0; index < 10; index++)
+        [scheduler forKey:@"a" scheduleBlock:makeBlock(NO)];
+    XCTAssertEqual(scheduler.keyCount, 1);
+    XCTAssertEqual(scheduler.replacedBlockCount, 9);
+
+    [proceed signal];
+    XCTAssertTrue([scheduler waitUntilIdleWithTimeout:5.0]);
+    XCTAssertEqual(maxRunningCount, 1);
+    XCTAssertEqual(performedCount, 2);
+    XCTAssertEqual(scheduler.keyCount, 0);
+}
+
+- (void)testCancelAndDispose
+{
+    PWKeyedDispatchScheduler* scheduler = [self createScheduler];
+    __block BOOL performed = NO;
+
+    [scheduler suspend];
+    [scheduler forKey:@"a" scheduleBlock:^{ performed = YES; }];
+    [scheduler forKey:@"b" scheduleBlock:^{ performed = YES; }];
+    XCTAssertTrue([scheduler cancelPendingBlockForKey:@"a"]);
+    XCTAssertFalse([scheduler cancelPendingBlockForKey:@"a"]);
+    XCTAssertFalse([scheduler cancelPendingBlockForKey:@"c"]);
+    XCTAssertEqual(scheduler.keyCount, 1);
+
+    [scheduler dispose];
+    [scheduler forKey:@"c" scheduleBlock:^{ performed = YES; }];
+    XCTAssertEqual(scheduler.keyCount, 0);
+
+    [scheduler resume];
+    XCTAssertTrue([scheduler waitUntilIdleWithTimeout:5.0]);
+    XCTAssertFalse(performed);
+}
+
+#pragma mark - Performance
+
+// Many keys with repeated submissions, as when edits trigger recomputations of many documents.
+- (void)testSchedulingPerformance
+{
+    [self measureBlock:^{
+        PWKeyedDispatchScheduler* scheduler = [self createScheduler];
+        [scheduler suspend];
+        for (NSUInteger round = 0; round < 10; round++)
+            for (NSUInteger index = 0; index < 2000; index++)
+                [scheduler forKey:@(index) scheduleBlock:^{}];
+        [scheduler resume];
+        XCTAssertTrue([scheduler waitUntilIdleWithTimeout:10.0]);
+        XCTAssertEqual(scheduler.keyCount, 0);
+    }];
+}
+
+@end
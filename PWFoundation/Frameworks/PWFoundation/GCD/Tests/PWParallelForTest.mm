@@ -0,0 +1,170 @@
+//
+//  PWParallelForTest.mm
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import <PWFoundation/PWDispatch.h>
+#import "PWParallelFor.hpp"
+#import "PWTestCase.h"
+#import <atomic>
+#import <numeric>
+#import <vector>
+
+using namespace PWFoundation;
+
+@interface PWParallelForTest : PWTestCase
+@end
+
+@implementation PWParallelForTest
+
+- (void)testEveryIndexIsProcessedOnce
+{
+    PWDispatchQueue* queue = [PWDispatchQueue globalDefaultPriorityQueue];
+    for (NSUInteger grainSize : {0, 1, 7, 1000, 100000})
+    {
+        const NSUInteger count = 10000;
+        std::vector<std::atomic<int>> hits (count);
+        std::atomic<int>* hitsPtr = hits.data();
+        [queue parallelForRange:NSMakeRange(5, count) grainSize:grainSize block:^(NSRange chunk) {
+            XCTAssertGreaterThan(chunk.length, 0);
+            for (NSUInteger index = chunk.location; index < NSMaxRange(chunk); index++)
+                hitsPtr[index - 5]++;
+        }];
+        for (NSUInteger index = 0; index < count; index++)
+            XCTAssertEqual(hits[index].load(), 1);
+    }
+
+    __block BOOL called = NO;
+    [queue parallelForRange:NSMakeRange(3, 0) grainSize:0 block:^(NSRange chunk) {
+        called = YES;
+    }];
+    XCTAssertFalse(called);
+}
+
+- (void)testReduction
+{
+    PWDispatchQueue* queue = [PWDispatchQueue concurrentDispatchQueueWithLabel:@"PWParallelForTest"];
+
+    // A histogram with mutable accumulators.
+    NSArray<NSNumber*>* histogram = [queue parallelReduceRange:NSMakeRange(0, 100000)
+                                                     grainSize:0
+                                            accumulatorFactory:^id{
+                                                NSMutableArray* buckets = [NSMutableArray array];
+                                                for (NSUInteger index = 0; index < 10; index++)
+                                                    [buckets addObject:@0];
+                                                return buckets;
+                                            }
+                                                         block:^(NSRange chunk, NSMutableArray* buckets) {
+                                                             NSUInteger counts[10] = {};
+                                                             for (NSUInteger index = chunk.location; index < NSMaxRange(chunk); index++)
+                                                                 counts[index % 10]++;
+                                                             for (NSUInteger index = 0; index < 10; index++)
+                                                                 buckets[index] = @([buckets[index] unsignedIntegerValue] + counts[index]);
+                                                         }
+                                                     reduction:^id(NSMutableArray* buckets, NSMutableArray* otherBuckets) {
+                                                         for (NSUInteger index = 0; index < 10; index++)
+                                                             buckets[index] = @([buckets[index] unsignedIntegerValue] + [otherBuckets[index] unsignedIntegerValue]);
+                                                         return buckets;
+                                                     }];
+    XCTAssertEqual(histogram.count, 10);
+    for (NSNumber* count in histogram)
+        XCTAssertEqualObjects(count, @10000);
+
+    // An empty range returns a fresh accumulator.
+    id empty = [queue parallelReduceRange:NSMakeRange(0, 0)
+                                grainSize:0
+                       accumulatorFactory:^id{ return @0; }
+                                    block:^(NSRange chunk, id accumulator) { XCTFail(); }
+                                reduction:^id(id accumulator, id otherAccumulator) { return accumulator; }];
+    XCTAssertEqualObjects(empty, @0);
+}
+
+- (void)testCppReduction
+{
+    dispatch_queue_t queue = [PWDispatchQueue globalDefaultPriorityQueue].underlyingQueue;
+
+    uint64_t sum = parallel_reduce (queue, 1, 1000001, 0,
+                                    [] { return (uint64_t)0; },
+                                    [](size_t begin, size_t end, uint64_t& accumulator) {
+                                        for (size_t index = begin; index < end; ++index)
+                                            accumulator += index;
+                                    },
+                                    [](uint64_t a, uint64_t b) { return a + b; });
+    XCTAssertEqual(sum, 500000500000ull);
+
+    // Uneven costs are balanced by stealing. The result does not depend on it.
+    std::vector<int> histogram = parallel_reduce (queue, 0, 2000, 1,
+                                                  [] { return std::vector<int> (4); },
+                                                  [](size_t begin, size_t end, std::vector<int>& buckets) {
+                                                      for (size_t index = begin; index < end; ++index) {
+                                                          if (index < 100)
+                                                              usleep (100);
+                                                          ++buckets[index % 4];
+                                                      }
+                                                  },
+                                                  [](std::vector<int> a, std::vector<int> b) {
+                                                      for (size_t index = 0; index < a.size(); ++index)
+                                                          a[index] += b[index];
+                                                      return a;
+                                                  });
+    XCTAssertTrue(histogram == std::vector<int> (4, 500));
+}
+
+- (void)testNestedLoops
+{
+    PWDispatchQueue* queue = [PWDispatchQueue globalDefaultPriorityQueue];
+    std::atomic<NSUInteger> total (0);
+    std::atomic<NSUInteger>* totalPtr = &total;
+
+    [queue parallelForRange:NSMakeRange(0, 64) grainSize:1 block:^(NSRange chunk) {
+        for (NSUInteger outer = chunk.location; outer < NSMaxRange(chunk); outer++)
+            [queue parallelForRange:NSMakeRange(0, 1000) grainSize:0 block:^(NSRange innerChunk) {
+                *totalPtr += innerChunk.length;
+            }];
+    }];
+    XCTAssertEqual(total.load(), 64000);
+    XCTAssertEqual(parallel_detail::busy_worker_count().load(), 0);
+}
+
+#pragma mark - Performance
+
+static const NSUInteger PWParallelForPerformanceCount = 10000000;
+
+// Sums by one block call per index, combining the results with an atomic.
+- (void)testPerIndexSumPerformance
+{
+    std::vector<double> values (PWParallelForPerformanceCount, 0.5);
+    const double* data = values.data();
+    PWDispatchQueue* queue = [PWDispatchQueue globalDefaultPriorityQueue];
+
+    [self measureBlock:^{
+        std::atomic<uint64_t> sum (0);
+        std::atomic<uint64_t>* sumPtr = &sum;
+        [queue synchronouslyDispatchBlock:^(size_t index) {
+            *sumPtr += (uint64_t)(data[index] * 2.0);
+        } times:PWParallelForPerformanceCount];
+        XCTAssertEqual(sum.load(), PWParallelForPerformanceCount);
+    }];
+}
+
+- (void)testParallelReduceSumPerformance
+{
+    std::vector<double> values (PWParallelForPerformanceCount, 0.5);
+    const double* data = values.data();
+    dispatch_queue_t queue = [PWDispatchQueue globalDefaultPriorityQueue].underlyingQueue;
+
+    [self measureBlock:^{
+        double sum = parallel_reduce (queue, 0, PWParallelForPerformanceCount, 0,
+                                      [] { return 0.0; },
+                                      [data](size_t begin, size_t end, double& accumulator) {
+                                          accumulator += std::accumulate (data + begin, data + end, 0.0);
+                                      },
+                                      [](double a, double b) { return a + b; });
+        XCTAssertEqual(sum, 0.5 * PWParallelForPerformanceCount);
+    }];
+}
+
+@end
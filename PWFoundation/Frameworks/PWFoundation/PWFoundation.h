@@ -15,6 +15,7 @@
 #import <PWFoundation/NSDictionary-PWExtensions.h>
 #import <PWFoundation/NSNull-PWExtensions.h>
 #import <PWFoundation/PWOrderedDictionary.h>
+#import <PWFoundation/PWPersistentDictionary.h>
 #import <PWFoundation/NSError-PWExtensions.h>
 #import <PWFoundation/NSMutableDictionary-PWExtensions.h>
 #import <PWFoundation/NSBundle-PWExtensions.h>
@@ -38,6 +39,7 @@
 #import <PWFoundation/PWDebugOptionMacros.h>
 #import <PWFoundation/PWErrors.h>
 #import <PWFoundation/PWValueType.h>
+#import <PWFoundation/PWValueTypeFormatterPool.h>
 #import <PWFoundation/PWValueGroup.h>
 #import <PWFoundation/PWValueTypes.h>
 #import <PWFoundation/NSPropertyListSerialization-PWExtensions.h>
@@ -18,6 +18,16 @@
     NSString*       _localizedNilValueName;
     NSDictionary*   _localizedNameByValue;
     NSDictionary*   _unlocalizedNameByValue;
+
+    // Reverse tables, so that parsing a string costs a single lookup. If several values share a name, the first one wins.
+    NSDictionary*   _valueByLocalizedName;
+    NSDictionary*   _valueByUnlocalizedName;
+
+    // Only present while capitalizesFirstCharacter is set.
+    NSString*       _capitalizedNilValueName;
+    NSDictionary*   _capitalizedNameByValue;
+    NSString*       _foldedLocalizedNilValueName;   // with lowercase first letter
+    NSDictionary*   _valueByFoldedName;             // localized and unlocalized names with lowercase first letter
 }
 
 - (NSString*)localizedString:(NSString*)key
@@ -40,16 +50,17 @@
 
 - (NSString*)stringForObjectValue:(id)anObject
 {
+    NSDictionary* nameByValue = _capitalizesFirstCharacter ? _capitalizedNameByValue : _localizedNameByValue;
     NSString* string;
     if(anObject)
     {
-        NSString* name = _localizedNameByValue[anObject]; 
-        string = name ? name :  [anObject description];
+        NSString* name = nameByValue[anObject];
+        string = name ? name : [anObject description];
+        if(!name && _capitalizesFirstCharacter)
+            string = string.stringWithUppercaseFirstLetter;
     }
     else
-        string = _localizedNilValueName;
-    if(_capitalizesFirstCharacter)
-        string = string.stringWithUppercaseFirstLetter;
+        string = _capitalizesFirstCharacter ? _capitalizedNilValueName : _localizedNilValueName;
     return string;
 }
 
@@ -68,14 +79,9 @@
         return YES;
     }
     
-    id value = [_localizedNameByValue allKeysForObject:string].firstObject;
-    if(value)
-    {
-        *anObject = value;
-        return YES;
-    }
-    
-    value = [_unlocalizedNameByValue allKeysForObject:string].firstObject;
+    id value = _valueByLocalizedName[string];
+    if(!value)
+        value = _valueByUnlocalizedName[string];
     if(value)
     {
         *anObject = value;
@@ -88,6 +94,22 @@
         return YES;
     }
 
+    // Names which start with an uppercase letter themselves can only be found with their first letter folded.
+    if(_capitalizesFirstCharacter)
+    {
+        value = _valueByFoldedName[string];
+        if(value)
+        {
+            *anObject = value;
+            return YES;
+        }
+        if([_foldedLocalizedNilValueName isEqualToString:string])
+        {
+            *anObject = nil;
+            return YES;
+        }
+    }
+
     if(error)
         *error = [NSString stringWithFormat:@"PWEnumFormatter error: Unknown enum value '%@'. Example values: %@",
                   string, [_localizedNameByValue.allValues componentsJoinedByString:@", "]];
@@ -95,6 +117,42 @@
     return NO;
 }
 
+- (void)setCapitalizesFirstCharacter:(BOOL)capitalizesFirstCharacter
+{
+    if(capitalizesFirstCharacter == _capitalizesFirstCharacter)
+        return;
+    _capitalizesFirstCharacter = capitalizesFirstCharacter;
+
+    if(capitalizesFirstCharacter)
+    {
+        NSMutableDictionary* capitalizedNameByValue = [NSMutableDictionary dictionaryWithCapacity:_localizedNameByValue.count];
+        [_localizedNameByValue enumerateKeysAndObjectsUsingBlock:^(id value, NSString* name, BOOL* stop) {
+            capitalizedNameByValue[value] = name.stringWithUppercaseFirstLetter;
+        }];
+
+        NSMutableDictionary* valueByFoldedName = [NSMutableDictionary dictionaryWithCapacity:2 * _values.count];
+        for(NSDictionary* nameByValue in @[_localizedNameByValue, _unlocalizedNameByValue])
+            for(id value in _values)
+            {
+                NSString* foldedName = [nameByValue[value] stringWithLowercaseFirstLetter];
+                if(!valueByFoldedName[foldedName])
+                    valueByFoldedName[foldedName] = value;
+            }
+
+        _capitalizedNameByValue      = [capitalizedNameByValue copy];
+        _capitalizedNilValueName     = _localizedNilValueName.stringWithUppercaseFirstLetter;
+        _valueByFoldedName           = [valueByFoldedName copy];
+        _foldedLocalizedNilValueName = _localizedNilValueName.stringWithLowercaseFirstLetter;
+    }
+    else
+    {
+        _capitalizedNameByValue      = nil;
+        _capitalizedNilValueName     = nil;
+        _valueByFoldedName           = nil;
+        _foldedLocalizedNilValueName = nil;
+    }
+}
+
 - (instancetype) initWithLocalizer:(PWLocalizer*)localizer
                   values:(NSArray*)theValues      // hashable, copyable,
         unlocalizedNames:(NSArray*)names         // NSString, same count as values
@@ -120,6 +178,20 @@
         
         _localizedNameByValue       = [nameByValue copy];
         _unlocalizedNameByValue     = [unlocNameByValue copy];
+
+        NSMutableDictionary* valueByName = [NSMutableDictionary dictionaryWithCapacity:_values.count];
+        NSMutableDictionary* valueByUnlocName = [NSMutableDictionary dictionaryWithCapacity:_values.count];
+        for(id value in _values)
+        {
+            NSString* name = _localizedNameByValue[value];
+            if(!valueByName[name])
+                valueByName[name] = value;
+            NSString* unlocName = _unlocalizedNameByValue[value];
+            if(!valueByUnlocName[unlocName])
+                valueByUnlocName[unlocName] = value;
+        }
+        _valueByLocalizedName       = [valueByName copy];
+        _valueByUnlocalizedName     = [valueByUnlocName copy];
         _unlocalizedNilValueName    = unlocalizedNilName ? [unlocalizedNilName copy] : @"";
         _localizedNilValueName      = _unlocalizedNilValueName ? [self localizedString:_unlocalizedNilValueName] : nil;
     }
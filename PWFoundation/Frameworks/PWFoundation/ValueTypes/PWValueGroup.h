@@ -68,10 +68,16 @@ typedef NS_OPTIONS(NSUInteger, PWValueCategoryMask)
 - (BOOL)deepEnumerateValuesWithCategories:(PWValueCategoryMask)categories
                                usingBlock:(void (^)(id iValue, PWValueCategory iCategory, BOOL* stop))block;
 
+// For immutable groups, the deep methods below use a flat array of all values and a hash index, which are built on
+// first use. Lookups then cost one hash probe instead of a walk over all sub-groups, so values must not change their
+// hash while they are part of an immutable group.
 - (BOOL)deepContainsValue:(id)value;
 - (BOOL)deepContainsValue:(id)value category:(PWValueCategory*)outCategory;
 - (BOOL)deepContainsValueInCategory:(PWValueCategory)category;
 
+// Returns the index of the first value equal to 'value' in deepValues, or NSNotFound.
+- (NSUInteger)deepIndexOfValue:(id)value;
+
 // Returns the total shallow number of values and groups.
 @property (nonatomic, readonly)         NSUInteger          count;
 
@@ -10,6 +10,8 @@
 #import "PWAsserts.h"
 #import "NSNull-PWExtensions.h"
 #import <vector>
+#import <unordered_map>
+#import <atomic>
 
 typedef enum
 {
@@ -25,13 +27,46 @@ namespace PW
         PWValueCategory         category;
         PWValueGroupItemKind    kind;
     };
+
+    struct ValueHash
+    {
+        size_t operator() (__unsafe_unretained id const& value) const
+        {
+            return [value hash];
+        }
+    };
+
+    struct ValueEqualTo
+    {
+        bool operator() (__unsafe_unretained id const& value1, __unsafe_unretained id const& value2) const
+        {
+            return [value1 isEqual:value2];
+        }
+    };
+
+    struct FlatValue
+    {
+        __unsafe_unretained id  value;                  // retained by the items of the immutable groups
+        PWValueCategory         category;
+        PWValueCategoryMask     requiredCategories;     // categories of the value and of all groups containing it
+    };
+
+    // The values of an immutable group and all its sub-groups in depth-first order, built on first use.
+    struct FlatValueIndex
+    {
+        std::vector<FlatValue>                                                  values;
+        std::unordered_map<__unsafe_unretained id, size_t, ValueHash, ValueEqualTo> positions;  // value -> first position
+        PWValueCategoryMask                                                     categories;     // of all values
+        NSArray*                                                                deepValues;
+    };
 }
 
 using namespace PW;
 
 @implementation PWValueGroup
 {
-    std::vector<ValueGroupItem> _items;
+    std::vector<ValueGroupItem>         _items;
+    std::atomic<FlatValueIndex*>        _flatIndex;     // only for immutable groups
 }
 
 - (instancetype)init
@@ -45,6 +80,11 @@ using namespace PW;
 
 @synthesize isImmutable = _isImmutable;
 
+- (void)dealloc
+{
+    delete _flatIndex.load();
+}
+
 - (void)makeImmutable
 {
     if(!_isImmutable)
@@ -180,6 +220,21 @@ using namespace PW;
 {
     NSParameterAssert(block);
 
+    if(FlatValueIndex* index = self.flatIndex)
+    {
+        BOOL stop = NO;
+        for(const FlatValue& iValue : index->values)
+        {
+            if((iValue.requiredCategories & ~categories) == 0)
+            {
+                block(iValue.value, iValue.category, &stop);
+                if(stop)
+                    return NO;
+            }
+        }
+        return YES;
+    }
+
     BOOL enumeratedAll = YES;
     BOOL stop = NO;
     for(auto iItem : _items)
@@ -216,8 +271,63 @@ using namespace PW;
     return _items.size();
 }
 
+#pragma mark - Flat Index
+
+// Returns NULL for mutable groups. Concurrent first calls may build the index twice, but only one of them is kept.
+- (FlatValueIndex*)flatIndex
+{
+    if(!_isImmutable)
+        return NULL;
+
+    FlatValueIndex* index = _flatIndex.load(std::memory_order_acquire);
+    if(!index)
+    {
+        FlatValueIndex* newIndex = new FlatValueIndex();
+        [self addToFlatIndex:newIndex requiredCategories:0];
+
+        NSUInteger count = newIndex->values.size();
+        std::vector<__unsafe_unretained id> deepValues;
+        deepValues.reserve(count);
+        newIndex->positions.reserve(count);
+        for(size_t position = 0; position < count; position++)
+        {
+            __unsafe_unretained id value = newIndex->values[position].value;
+            deepValues.push_back(value ? value : NSNull.null);
+            newIndex->categories |= 1<<newIndex->values[position].category;
+            if(value)
+                newIndex->positions.emplace(value, position);   // keeps the first position of equal values
+        }
+        newIndex->deepValues = [[NSArray alloc] initWithObjects:deepValues.data() count:count];
+
+        if(_flatIndex.compare_exchange_strong(index, newIndex, std::memory_order_acq_rel))
+            index = newIndex;
+        else
+            delete newIndex;
+    }
+    return index;
+}
+
+- (void)addToFlatIndex:(FlatValueIndex*)index requiredCategories:(PWValueCategoryMask)requiredCategories
+{
+    NSParameterAssert(index);
+
+    for(const ValueGroupItem& iItem : _items)
+    {
+        PWValueCategoryMask itemCategories = requiredCategories | 1<<iItem.category;
+        if(iItem.kind == PWValueGroupItemKindValue)
+            index->values.push_back({iItem.item, iItem.category, itemCategories});
+        else
+            [(PWValueGroup*)iItem.item addToFlatIndex:index requiredCategories:itemCategories];
+    }
+}
+
+#pragma mark
+
 - (NSArray*)deepValues
 {
+    if(FlatValueIndex* index = self.flatIndex)
+        return index->deepValues;
+
     NSMutableArray* values = [NSMutableArray array];
     [self deepEnumerateValuesWithCategories:PWValueCategoryMaskAll
                                  usingBlock:^(id iValue, PWValueCategory iCategory, BOOL *stop)
@@ -238,6 +348,18 @@ using namespace PW;
 
 - (BOOL)deepContainsValue:(id)value category:(PWValueCategory*)outCategory
 {
+    if(FlatValueIndex* index = self.flatIndex)
+    {
+        if(!value)
+            return NO;
+        auto match = index->positions.find(value);
+        if(match == index->positions.end())
+            return NO;
+        if(outCategory)
+            *outCategory = index->values[match->second].category;
+        return YES;
+    }
+
     __block BOOL result = NO;
     [self deepEnumerateValuesWithCategories:PWValueCategoryMaskAll
                                  usingBlock:^(id iValue, PWValueCategory iCategory, BOOL *stop) {
@@ -252,6 +374,31 @@ using namespace PW;
     return result;
 }
 
+- (NSUInteger)deepIndexOfValue:(id)value
+{
+    if(!value)
+        return NSNotFound;
+
+    if(FlatValueIndex* index = self.flatIndex)
+    {
+        auto match = index->positions.find(value);
+        return match != index->positions.end() ? match->second : NSNotFound;
+    }
+
+    __block NSUInteger result = NSNotFound;
+    __block NSUInteger position = 0;
+    [self deepEnumerateValuesWithCategories:PWValueCategoryMaskAll
+                                 usingBlock:^(id iValue, PWValueCategory iCategory, BOOL *stop) {
+                                     if([iValue isEqual:value])
+                                     {
+                                         result = position;
+                                         *stop = YES;
+                                     }
+                                     position++;
+                                 }];
+    return result;
+}
+
 - (BOOL)deepContainsValue:(id)value
 {
     return [self deepContainsValue:value category:NULL];
@@ -259,6 +406,9 @@ using namespace PW;
 
 - (BOOL)deepContainsValueInCategory:(PWValueCategory)category
 {
+    if(FlatValueIndex* index = self.flatIndex)
+        return (index->categories & 1<<category) != 0;
+
     __block BOOL result = NO;
     [self deepEnumerateValuesWithCategories:PWValueCategoryMaskAll
                                  usingBlock:^(id iValue, PWValueCategory iCategory, BOOL *stop) {
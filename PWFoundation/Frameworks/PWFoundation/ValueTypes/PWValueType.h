@@ -12,6 +12,7 @@
 @class PWLocalizer;
 @class PWValueGroup;
 @class PWValueType;
+@class PWValueTypeFormatterPool;
 
 // Note: the protocols declare getters instead of read only properties to avoid trouble with differing lifetime
 // qualifiers in adopting classes.
@@ -86,11 +87,33 @@ typedef PWValueTypePresetValuesMode(^PWPresetValuesBlock)(id <PWValueTypeContext
 // Convenience method, forwards to -formatterForContext:context options:nil.
 - (NSFormatter*)formatterForContext:(id <PWValueTypeContext>)context;
 
+// Variant of -formatterForContext:options:object:keyPath: which can be used on several dispatch queues at once.
+// The formatter is checked out of 'pool' under the key from -formatterCacheKeyForContext:options:object:keyPath:,
+// configured via -configureFormatter:forObject:keyPath:, passed to 'block' and returned to the pool afterwards.
+// It must not be used outside of the block.
+// If the pool has no idle formatter, a new one is created on the calling queue, so the context needs to support
+// being read from several queues, or the pool should be warmed up on the queue of the context.
+// Value types without a cache key get a new formatter on every call.
+- (void)performWithFormatterFromPool:(PWValueTypeFormatterPool*)pool
+                             context:(id <PWValueTypeContext>)context
+                             options:(NSDictionary*)options             // optional
+                              object:(id)object                         // optional
+                             keyPath:(NSString*)keyPath                 // optional
+                               block:(void (^)(NSFormatter* formatter))block;
+
+// Creates up to 'count' formatters for the given context and options and puts them into 'pool'.
+// Does nothing if the receiver does not provide a formatter cache key.
+- (void)warmUpFormatterPool:(PWValueTypeFormatterPool*)pool
+                      count:(NSUInteger)count
+                    context:(id <PWValueTypeContext>)context
+                    options:(NSDictionary*)options;                     // optional
+
 // Can be overridden by subclasses to support caching of created formatters on the value-type context.
 // The returned key has to contain all information from the context, options, object and keyPath which
 // should be used to efficiently cache the formatters created by -directFormatterForContext:options:object:keyPath:
 // The default implementation returns nil which means no caching.
-// It is only called if the value type context also implements -cachedValueTypeFormatterForKey: and -cacheValueTypeFormatter:forKey:.
+// It is only called if the value type context also implements -cachedValueTypeFormatterForKey: and -cacheValueTypeFormatter:forKey:,
+// or if a PWValueTypeFormatterPool is used.
 - (id <NSCopying>)formatterCacheKeyForContext:(id <PWValueTypeContext>)context
                                       options:(NSDictionary*)options    // optional
                                        object:(id)object                // optional
@@ -182,6 +205,7 @@ typedef PWValueTypePresetValuesMode(^PWPresetValuesBlock)(id <PWValueTypeContext
 
 @property (nonatomic, readonly, strong) Class     valueClass;
 @property (nonatomic, readonly, copy)   NSString* fallbackKeyPath;
+@property (nonatomic, readonly, copy)   PWPresetValuesBlock presetValuesBlock;
 
 // Used by -localizerForContext: Defaults to the bundle of the receivers class.
 @property (nonatomic, readonly, strong) NSBundle* localizationBundle;
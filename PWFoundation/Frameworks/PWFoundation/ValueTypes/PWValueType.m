@@ -17,6 +17,7 @@
 #import "PWLocalizer.h"
 #import "PWAsserts.h"
 #import "PWValueGroup.h"
+#import "PWValueTypeFormatterPool.h"
 
 @implementation PWValueType
 {
@@ -24,6 +25,7 @@
 }
 
 @synthesize fallbackKeyPath = fallbackKeyPath_;
+@synthesize presetValuesBlock = presetValuesBlock_;
 
 + (PWDispatchQueue*)dispatchQueue
 {
@@ -170,31 +172,14 @@ static NSString* const SharedInstanceKey = @"net.projectwizards.PWValueType.shar
     id cacheKey;
     if([context respondsToSelector:@selector(cachedValueTypeFormatterForKey:)])
     {
-        cacheKey = [self formatterCacheKeyForContext:context
-                                             options:options
-                                              object:object
-                                             keyPath:keyPath];
+        cacheKey = [self _formatterCacheKeyForContext:context options:options object:object keyPath:keyPath];
         if(cacheKey)
-        {
-            // Note: As fallback key paths are rare, we are ok with performance of wrapping the cacheKey
-            // in an array.
-            if(fallbackKeyPath_)
-                cacheKey = @[fallbackKeyPath_, cacheKey];
             formatter = [context cachedValueTypeFormatterForKey:cacheKey];
-        }
     }
 
     if(!formatter)
     {
-        formatter = [self directFormatterForContext:context
-                                            options:options
-                                             object:object
-                                            keyPath:keyPath];
-        if(fallbackKeyPath_)    // Wrap formatter to create a formatter that for nil values adds a description of the fallback value in parentheses
-            formatter = [[PWFallbackFormatter alloc] initWithFormatter:formatter
-                                                               context:context
-                                                               options:options
-                                                       fallbackKeyPath:fallbackKeyPath_];
+        formatter = [self _createFormatterForContext:context options:options object:object keyPath:keyPath];
         if(cacheKey)
             [context cacheValueTypeFormatter:formatter forKey:cacheKey];
     }
@@ -202,6 +187,72 @@ static NSString* const SharedInstanceKey = @"net.projectwizards.PWValueType.shar
     return formatter;
 }
 
+- (id <NSCopying>)_formatterCacheKeyForContext:(id <PWValueTypeContext>)context
+                                       options:(NSDictionary*)options
+                                        object:(id)object
+                                       keyPath:(NSString*)keyPath
+{
+    id cacheKey = [self formatterCacheKeyForContext:context
+                                            options:options
+                                             object:object
+                                            keyPath:keyPath];
+    // Note: As fallback key paths are rare, we are ok with performance of wrapping the cacheKey
+    // in an array.
+    if(cacheKey && fallbackKeyPath_)
+        cacheKey = @[fallbackKeyPath_, cacheKey];
+    return cacheKey;
+}
+
+- (NSFormatter*)_createFormatterForContext:(id <PWValueTypeContext>)context
+                                   options:(NSDictionary*)options
+                                    object:(id)object
+                                   keyPath:(NSString*)keyPath
+{
+    NSFormatter* formatter = [self directFormatterForContext:context
+                                                     options:options
+                                                      object:object
+                                                     keyPath:keyPath];
+    if(fallbackKeyPath_)    // Wrap formatter to create a formatter that for nil values adds a description of the fallback value in parentheses
+        formatter = [[PWFallbackFormatter alloc] initWithFormatter:formatter
+                                                           context:context
+                                                           options:options
+                                                   fallbackKeyPath:fallbackKeyPath_];
+    return formatter;
+}
+
+- (void)performWithFormatterFromPool:(PWValueTypeFormatterPool*)pool
+                             context:(id <PWValueTypeContext>)context
+                             options:(NSDictionary*)options
+                              object:(id)object
+                             keyPath:(NSString*)keyPath
+                               block:(void (^)(NSFormatter* formatter))block
+{
+    NSParameterAssert(pool);
+    NSParameterAssert(block);
+
+    id cacheKey = [self _formatterCacheKeyForContext:context options:options object:object keyPath:keyPath];
+    NSFormatter* formatter = [pool checkOutFormatterForKey:cacheKey creationBlock:^NSFormatter*{
+        return [self _createFormatterForContext:context options:options object:object keyPath:keyPath];
+    }];
+    [self _configureFormatter:formatter forObject:object keyPath:keyPath];
+    block(formatter);
+    [pool returnFormatter:formatter forKey:cacheKey];
+}
+
+- (void)warmUpFormatterPool:(PWValueTypeFormatterPool*)pool
+                      count:(NSUInteger)count
+                    context:(id <PWValueTypeContext>)context
+                    options:(NSDictionary*)options
+{
+    NSParameterAssert(pool);
+
+    id cacheKey = [self _formatterCacheKeyForContext:context options:options object:nil keyPath:nil];
+    if(cacheKey)
+        [pool warmUpKey:cacheKey count:count creationBlock:^NSFormatter*{
+            return [self _createFormatterForContext:context options:options object:nil keyPath:nil];
+        }];
+}
+
 // Overridden by subclasses
 - (id <NSCopying>)formatterCacheKeyForContext:(id <PWValueTypeContext>)context
                                       options:(NSDictionary*)options
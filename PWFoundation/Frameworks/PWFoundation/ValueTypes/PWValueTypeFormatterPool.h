@@ -0,0 +1,62 @@
+//
+//  PWValueTypeFormatterPool.h
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+NS_ASSUME_NONNULL_BEGIN
+
+// A thread-safe pool of formatters for code which formats values on several dispatch queues at once, like parallel
+// report renderers. Other than the formatter cache of a PWValueTypeContext, which hands out the same instance to
+// every caller and therefore has to be confined to one queue, the pool hands out every formatter exclusively: it is
+// checked out by one caller and returned to the pool when the caller is done with it.
+//
+// Idle formatters are grouped by a cache key, typically the one returned by
+// -[PWValueType formatterCacheKeyForContext:options:object:keyPath:]. The pool keeps idle formatters for at most
+// 'keyCapacity' keys, dropping the least recently used key first, and at most 'maxIdleFormattersPerKey' formatters per
+// key. Formatters returned beyond this limit are discarded. Idle formatters are also dropped under memory pressure.
+//
+// See -[PWValueType performWithFormatterFromPool:context:options:object:keyPath:block:] for the usual way of using
+// a pool.
+@interface PWValueTypeFormatterPool : NSObject
+
+// Uses a key capacity of 64 and one idle formatter per active processor and key.
+- (instancetype)init;
+
+- (instancetype)initWithKeyCapacity:(NSUInteger)keyCapacity                         // > 0
+            maxIdleFormattersPerKey:(NSUInteger)maxIdleFormattersPerKey NS_DESIGNATED_INITIALIZER;     // > 0
+
+@property (nonatomic, readonly)         NSUInteger  keyCapacity;
+@property (nonatomic, readonly)         NSUInteger  maxIdleFormattersPerKey;
+
+// Returns an idle formatter for 'key' or, if there is none, the result of 'creationBlock', which is called on the
+// calling queue outside of any lock. If 'key' is nil, the created formatter is not poolable.
+- (NSFormatter*)checkOutFormatterForKey:(nullable id <NSCopying>)key
+                          creationBlock:(NSFormatter* (^)(void))creationBlock;
+
+// Makes a formatter which has been checked out for 'key' available to other callers. Does nothing for a nil key.
+// The formatter must not be used by the caller afterwards.
+- (void)returnFormatter:(NSFormatter*)formatter forKey:(nullable id <NSCopying>)key;
+
+// Creates formatters with 'creationBlock' until 'count' formatters are idle for 'key' (at most maxIdleFormattersPerKey).
+// Useful for creating the formatters on the queue of a value type context before parallel work starts.
+- (void)warmUpKey:(id <NSCopying>)key
+            count:(NSUInteger)count
+    creationBlock:(NSFormatter* (^)(void))creationBlock;
+
+- (void)removeAllFormatters;
+
+// Statistics since creation or the last -resetStatistics. A check out is a hit if an idle formatter was available
+// and a miss if a formatter had to be created. Formatters which have been returned to a full key are counted as discarded.
+@property (nonatomic, readonly)         NSUInteger  hitCount;
+@property (nonatomic, readonly)         NSUInteger  missCount;
+@property (nonatomic, readonly)         NSUInteger  discardCount;
+@property (nonatomic, readonly)         NSUInteger  idleFormatterCount;
+
+- (void)resetStatistics;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,224 @@
+//
+//  PWValueTypeFormatterPool.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import "PWValueTypeFormatterPool.h"
+#import "PWLRUCache.h"
+#import "PWDispatch.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface PWValueTypeFormatterPool () <PWLRUCacheDelegate>
+@end
+
+@implementation PWValueTypeFormatterPool
+{
+    PWDispatchQueue*                                        _dispatchQueue;
+    PWLRUCache<id, NSMutableArray<NSFormatter*>*>*          _idleFormattersByKey;   // arrays are used as stacks
+    NSUInteger                                              _hitCount;
+    NSUInteger                                              _missCount;
+    NSUInteger                                              _discardCount;
+    NSUInteger                                              _idleFormatterCount;
+}
+
+- (instancetype)init
+{
+    return [self initWithKeyCapacity:64 maxIdleFormattersPerKey:NSProcessInfo.processInfo.activeProcessorCount];
+}
+
+- (instancetype)initWithKeyCapacity:(NSUInteger)keyCapacity maxIdleFormattersPerKey:(NSUInteger)maxIdleFormattersPerKey
+{
+    NSParameterAssert(keyCapacity > 0);
+    NSParameterAssert(maxIdleFormattersPerKey > 0);
+
+    if ((self = [super init]) != nil)
+    {
+        _keyCapacity = keyCapacity;
+        _maxIdleFormattersPerKey = maxIdleFormattersPerKey;
+        _dispatchQueue = [PWDispatchQueue serialDispatchQueueWithLabel:@"PWValueTypeFormatterPool"];
+        _idleFormattersByKey = [[PWLRUCache alloc] initWithCapacity:keyCapacity delegate:self dispatchQueue:_dispatchQueue];
+    }
+    return self;
+}
+
+- (NSFormatter*)checkOutFormatterForKey:(nullable id <NSCopying>)key
+                          creationBlock:(NSFormatter* (^)(void))creationBlock
+{
+    NSParameterAssert(creationBlock);
+
+    __block NSFormatter* formatter;
+    [_dispatchQueue synchronouslyDispatchBlock:^{
+        if (key)
+        {
+            NSMutableArray<NSFormatter*>* idleFormatters = _idleFormattersByKey[key];
+            formatter = idleFormatters.lastObject;
+            if (formatter)
+            {
+                [idleFormatters removeLastObject];
+                _idleFormatterCount--;
+            }
+        }
+        if (formatter)
+            _hitCount++;
+        else
+            _missCount++;
+    }];
+
+    if (!formatter)
+    {
+        formatter = creationBlock();
+        NSAssert(formatter, nil);
+    }
+    return formatter;
+}
+
+- (void)returnFormatter:(NSFormatter*)formatter forKey:(nullable id <NSCopying>)key
+{
+    NSParameterAssert(formatter);
+
+    if (!key)
+        return;
+
+    [_dispatchQueue synchronouslyDispatchBlock:^{
+        [self addIdleFormatter:formatter forKey:key];
+    }];
+}
+
+- (BOOL)addIdleFormatter:(NSFormatter*)formatter forKey:(id <NSCopying>)key
+{
+    NSParameterAssert(formatter);
+    NSParameterAssert(key);
+    PWAssert(_dispatchQueue.isCurrentDispatchQueue);
+
+    NSMutableArray<NSFormatter*>* idleFormatters = _idleFormattersByKey[key];
+    if (!idleFormatters)
+    {
+        idleFormatters = [[NSMutableArray alloc] initWithCapacity:_maxIdleFormattersPerKey];
+        _idleFormattersByKey[[(id)key copy]] = idleFormatters;
+    }
+    if (idleFormatters.count >= _maxIdleFormattersPerKey)
+    {
+        _discardCount++;
+        return NO;
+    }
+    [idleFormatters addObject:formatter];
+    _idleFormatterCount++;
+    return YES;
+}
+
+- (void)warmUpKey:(id <NSCopying>)key
+            count:(NSUInteger)count
+    creationBlock:(NSFormatter* (^)(void))creationBlock
+{
+    NSParameterAssert(key);
+    NSParameterAssert(creationBlock);
+
+    count = MIN(count, _maxIdleFormattersPerKey);
+    for (;;)
+    {
+        __block NSUInteger idleCount;
+        [_dispatchQueue synchronouslyDispatchBlock:^{
+            idleCount = ((NSArray*)_idleFormattersByKey[key]).count;
+        }];
+        if (idleCount >= count)
+            break;
+
+        // Formatters are created outside of the queue, so concurrent check outs are not blocked meanwhile.
+        NSMutableArray<NSFormatter*>* formatters = [[NSMutableArray alloc] initWithCapacity:count - idleCount];
+        for (NSUInteger index = idleCount; index < count; index++)
+        {
+            NSFormatter* formatter = creationBlock();
+            NSAssert(formatter, nil);
+            [formatters addObject:formatter];
+        }
+
+        __block BOOL isFull = NO;
+        [_dispatchQueue synchronouslyDispatchBlock:^{
+            for (NSFormatter* formatter in formatters)
+                if (![self addIdleFormatter:formatter forKey:key])
+                {
+                    _discardCount--;    // not a returned formatter
+                    isFull = YES;
+                    break;
+                }
+        }];
+        if (isFull)
+            break;
+    }
+}
+
+- (void)removeAllFormatters
+{
+    [_dispatchQueue synchronouslyDispatchBlock:^{
+        [_idleFormattersByKey removeAllObjects];
+    }];
+}
+
+#pragma mark - Statistics
+
+- (NSUInteger)hitCount
+{
+    __block NSUInteger count;
+    [_dispatchQueue synchronouslyDispatchBlock:^{
+        count = _hitCount;
+    }];
+    return count;
+}
+
+- (NSUInteger)missCount
+{
+    __block NSUInteger count;
+    [_dispatchQueue synchronouslyDispatchBlock:^{
+        count = _missCount;
+    }];
+    return count;
+}
+
+- (NSUInteger)discardCount
+{
+    __block NSUInteger count;
+    [_dispatchQueue synchronouslyDispatchBlock:^{
+        count = _discardCount;
+    }];
+    return count;
+}
+
+- (NSUInteger)idleFormatterCount
+{
+    __block NSUInteger count;
+    [_dispatchQueue synchronouslyDispatchBlock:^{
+        count = _idleFormatterCount;
+    }];
+    return count;
+}
+
+- (void)resetStatistics
+{
+    [_dispatchQueue synchronouslyDispatchBlock:^{
+        _hitCount     = 0;
+        _missCount    = 0;
+        _discardCount = 0;
+    }];
+}
+
+#pragma mark - PWLRUCacheDelegate
+
+- (BOOL)cache:(PWLRUCache*)cache canEvictObject:(id)object
+{
+    return YES;
+}
+
+- (void)cache:(PWLRUCache*)cache willRemoveObject:(id)object
+{
+    PWAssert(_dispatchQueue.isCurrentDispatchQueue);
+
+    _idleFormatterCount -= ((NSArray*)object).count;
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
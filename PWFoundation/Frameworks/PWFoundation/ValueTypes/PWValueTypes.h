@@ -18,6 +18,13 @@
 // Defaults to nil.
 - (NSString*)localizationKeyPrefixForContext:(id <PWValueTypeContext>)context;
 
+// Whether the preset values may depend on the object or the options passed to the lookups below. Defaults to YES if the
+// receiver has been created with a presetValuesBlock. Subclasses whose preset values only depend on the context can
+// override this to return NO.
+@property (nonatomic, readonly) BOOL presetValuesDependOnObjectOrOptions;
+
+// If the preset values do not depend on the object or the options, the two lookups below are served from tables which
+// the receiver builds once per context. Otherwise they walk the preset values on every call.
 - (NSString*)unlocalizedNameForValue:(id)value 
                              context:(id <PWValueTypeContext>)context
                               object:(id)object 
@@ -32,6 +39,9 @@
 // convenience versions for context- and optionless cases
 - (NSString*)unlocalizedNameForValue:(id)value;
 - (BOOL)value:(id*)outValue forUnlocalizedName:(NSString*)name;
+
+// Needs to be called when the preset values or the names for a context change, so the lookup tables are rebuilt.
+- (void)invalidateUnlocalizedNameLookupTables;
 @end
 
 @interface PWDoubleValueType : PWValueType
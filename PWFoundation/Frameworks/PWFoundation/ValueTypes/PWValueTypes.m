@@ -27,6 +27,8 @@
 #import "NSDateFormatter-PWExtensions.h"
 #import "PWBlockFormatter.h"
 #import "PWValueGroup.h"
+#import "NSNull-PWExtensions.h"
+#import <os/lock.h>
 
 #if UXTARGET_IOS
 #import <MobileCoreServices/MobileCoreServices.h>
@@ -1245,7 +1247,79 @@ NSString* const PWTimeFormatWithTime    = @"withTime";
 
 #pragma mark - Enum
 
-@implementation PWEnumValueType 
+// The name lookup tables of an enum value type for one context. Immutable, so it can be used without locking.
+@interface PWEnumValueLookupTable : NSObject
+- (instancetype)initWithValues:(NSArray*)values
+                         names:(NSArray<NSString*>*)names
+                          mode:(PWValueTypePresetValuesMode)mode
+                  nilValueName:(NSString*)nilValueName;
+@property (nonatomic, readonly)         PWValueTypePresetValuesMode mode;
+@property (nonatomic, readonly, copy)   NSString*                   nilValueName;
+- (NSString*)nameForValue:(id)value;
+- (BOOL)value:(id*)outValue forName:(NSString*)name;
+@end
+
+@implementation PWEnumValueLookupTable
+{
+    NSMapTable*                         _nameByValue;   // values need not be copyable
+    NSDictionary<NSString*, id>*        _valueByName;   // nil values are stored as NSNull
+}
+
+- (instancetype)initWithValues:(NSArray*)values
+                         names:(NSArray<NSString*>*)names
+                          mode:(PWValueTypePresetValuesMode)mode
+                  nilValueName:(NSString*)nilValueName
+{
+    if(self = [super init])
+    {
+        _mode = mode;
+        _nilValueName = [nilValueName copy];
+
+        // The names are parallel to the deep values. For duplicates, the first value or name wins.
+        NSUInteger count = MIN(values.count, names.count);
+        _nameByValue = [NSMapTable strongToStrongObjectsMapTable];
+        NSMutableDictionary<NSString*, id>* valueByName = [NSMutableDictionary dictionaryWithCapacity:count];
+        for(NSUInteger index = 0; index < count; index++)
+        {
+            id value = values[index];
+            NSString* name = names[index];
+            if(![_nameByValue objectForKey:value])
+                [_nameByValue setObject:name forKey:value];
+            if(!valueByName[name])
+                valueByName[name] = value;
+        }
+        _valueByName = [valueByName copy];
+    }
+    return self;
+}
+
+- (NSString*)nameForValue:(id)value
+{
+    NSParameterAssert(value);
+    return [_nameByValue objectForKey:value];
+}
+
+- (BOOL)value:(id*)outValue forName:(NSString*)name
+{
+    NSParameterAssert(outValue);
+    NSParameterAssert(name);
+
+    id value = _valueByName[name];
+    if(!value)
+        return NO;
+    *outValue = PWNilForNull(value);
+    return YES;
+}
+
+@end
+
+@implementation PWEnumValueType
+{
+    os_unfair_lock                      _lookupTablesLock;          // protects the three ivars below
+    PWEnumValueLookupTable*             _lookupTableWithoutContext;
+    NSMapTable*                         _lookupTablesByContext;     // weak context keys, compared by identity
+    NSUInteger                          _lookupTablesGeneration;    // incremented by each invalidation
+}
 
 - (Class)valueClass
 {
@@ -1292,6 +1366,64 @@ NSString* const PWTimeFormatWithTime    = @"withTime";
         return nil;
 }
 
+- (BOOL)presetValuesDependOnObjectOrOptions
+{
+    return self.presetValuesBlock != nil;
+}
+
+- (void)invalidateUnlocalizedNameLookupTables
+{
+    os_unfair_lock_lock(&_lookupTablesLock);
+    _lookupTableWithoutContext = nil;
+    [_lookupTablesByContext removeAllObjects];
+    _lookupTablesGeneration++;
+    os_unfair_lock_unlock(&_lookupTablesLock);
+}
+
+// Preset values and names are requested once per context, each lookup afterwards is a hash probe without any
+// allocations. Concurrent first calls for a context may build the table twice, but only one of them is kept. A table
+// built while the tables are invalidated is used for the current lookup only.
+- (PWEnumValueLookupTable*)lookupTableForContext:(id <PWValueTypeContext>)context
+{
+    os_unfair_lock_lock(&_lookupTablesLock);
+    PWEnumValueLookupTable* table = context ? [_lookupTablesByContext objectForKey:context] : _lookupTableWithoutContext;
+    NSUInteger generation = _lookupTablesGeneration;
+    os_unfair_lock_unlock(&_lookupTablesLock);
+    if(table)
+        return table;
+
+    PWValueGroup* values;
+    PWValueTypePresetValuesMode mode = [self presetValuesModeForContext:context object:nil options:nil values:&values];
+    PWEnumValueLookupTable* newTable = [[PWEnumValueLookupTable alloc] initWithValues:values.deepValues
+                                                                                names:[self unlocalizedValueNamesForContext:context]
+                                                                                 mode:mode
+                                                                         nilValueName:[self unlocalizedNilValueNameForContext:context]];
+
+    os_unfair_lock_lock(&_lookupTablesLock);
+    if(generation != _lookupTablesGeneration)
+        table = newTable;
+    else if(!context)
+    {
+        if(!_lookupTableWithoutContext)
+            _lookupTableWithoutContext = newTable;
+        table = _lookupTableWithoutContext;
+    }
+    else
+    {
+        if(!_lookupTablesByContext)
+            _lookupTablesByContext = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality
+                                                           valueOptions:NSPointerFunctionsStrongMemory];
+        table = [_lookupTablesByContext objectForKey:context];
+        if(!table)
+        {
+            [_lookupTablesByContext setObject:newTable forKey:context];
+            table = newTable;
+        }
+    }
+    os_unfair_lock_unlock(&_lookupTablesLock);
+    return table;
+}
+
 - (NSString*)unlocalizedNameForValue:(id)value
                              context:(id <PWValueTypeContext>)context
                               object:(id)object 
@@ -1299,8 +1431,43 @@ NSString* const PWTimeFormatWithTime    = @"withTime";
 {
     if(!value)
         return [self unlocalizedNilValueNameForContext:context];
+    if(self.presetValuesDependOnObjectOrOptions)
+        return [self walkedUnlocalizedNameForValue:value context:context object:object options:options];
+    return [[self lookupTableForContext:context] nameForValue:value];
+}
+
+- (BOOL)       value:(id*)outValue
+  forUnlocalizedName:(NSString*)name
+             context:(id <PWValueTypeContext>)context
+              object:(id)object
+             options:(NSDictionary*)options
+{
+    NSParameterAssert(outValue);
+
+    if(!name)
+        return NO;
+    if(self.presetValuesDependOnObjectOrOptions)
+        return [self walkedValue:outValue forUnlocalizedName:name context:context object:object options:options];
+
+    PWEnumValueLookupTable* table = [self lookupTableForContext:context];
+    if((table.mode & PWValueTypeNilIsPresetValue) > 0 && [name isEqualToString:table.nilValueName])
+    {
+        *outValue = nil;
+        return YES;
+    }
+    return [table value:outValue forName:name];
+}
+
+// The lookups for preset values which cannot be cached.
+- (NSString*)walkedUnlocalizedNameForValue:(id)value
+                                   context:(id <PWValueTypeContext>)context
+                                    object:(id)object
+                                   options:(NSDictionary*)options
+{
+    NSParameterAssert(value);
+
     PWValueGroup* values;
-    [self presetValuesModeForContext:context object:nil options:options values:&values];
+    [self presetValuesModeForContext:context object:object options:options values:&values];
     NSArray* valueNames = [self unlocalizedValueNamesForContext:context];
     __block NSUInteger index = 0;
     __block NSString* result;
@@ -1309,7 +1476,7 @@ NSString* const PWTimeFormatWithTime    = @"withTime";
      {
          if([iValue isEqual:value])
          {
-             result = valueNames[index];
+             result = index < valueNames.count ? valueNames[index] : nil;
              *stop = YES;
          }
          index++;
@@ -1317,24 +1484,21 @@ NSString* const PWTimeFormatWithTime    = @"withTime";
     return result;
 }
 
-- (BOOL)       value:(id*)outValue
-  forUnlocalizedName:(NSString*)name
-             context:(id <PWValueTypeContext>)context
-              object:(id)object
-             options:(NSDictionary*)options
+- (BOOL)walkedValue:(id*)outValue
+ forUnlocalizedName:(NSString*)name
+            context:(id <PWValueTypeContext>)context
+             object:(id)object
+            options:(NSDictionary*)options
 {
     NSParameterAssert(outValue);
+    NSParameterAssert(name);
 
     PWValueGroup* values;
-
     PWValueTypePresetValuesMode mode = [self presetValuesModeForContext:context object:object options:options values:&values];
-    if((mode & PWValueTypeNilIsPresetValue) > 0)
+    if((mode & PWValueTypeNilIsPresetValue) > 0 && [name isEqualToString:[self unlocalizedNilValueNameForContext:context]])
     {
-        if([name isEqualToString:[self unlocalizedNilValueNameForContext:context]])
-        {
-            *outValue = nil;
-            return YES;
-        }
+        *outValue = nil;
+        return YES;
     }
 
     __block BOOL result = NO;
@@ -1343,8 +1507,7 @@ NSString* const PWTimeFormatWithTime    = @"withTime";
     [values deepEnumerateValuesWithCategories:PWValueCategoryMaskAll
                                    usingBlock:^(id iValue, PWValueCategory iCategory, BOOL *stop)
      {
-         NSString* iValueName = valueNames[index];
-         if([iValueName isEqualToString:name])
+         if(index < valueNames.count && [valueNames[index] isEqualToString:name])
          {
              *outValue = iValue;
              result = YES;
@@ -109,6 +109,77 @@
     XCTAssertFalse(success);
 }
 
+- (void)testCapitalizesFirstCharacter
+{
+    NSNumber* valA = @1;
+    NSNumber* valB = @2;
+    PWEnumFormatter* formatter = [[PWEnumFormatter alloc] initWithLocality:[[PWLocality alloc] initWithLocale:nil language:@"English"]
+                                                                    bundle:[NSBundle bundleForClass:self.class]
+                                                                    values:@[valA, valB]
+                                                          unlocalizedNames:@[@"valueA", @"valueB"]
+                                                   unlocalizedNilValueName:@"nada"
+                                                     localizationKeyPrefix:nil];
+    formatter.capitalizesFirstCharacter = YES;
+
+    XCTAssertEqualObjects([formatter stringForObjectValue:valA], @"Value A");
+    XCTAssertEqualObjects([formatter stringForObjectValue:nil], @"Nada");
+    XCTAssertEqualObjects([formatter stringForObjectValue:@3], @"3");
+
+    NSNumber* value;
+    XCTAssertTrue([formatter getObjectValue:&value forString:@"Value A" errorDescription:nil]);    // round trip
+    XCTAssertEqualObjects(value, valA);
+    XCTAssertTrue([formatter getObjectValue:&value forString:@"ValueB" errorDescription:nil]);
+    XCTAssertEqualObjects(value, valB);
+    XCTAssertTrue([formatter getObjectValue:&value forString:@"valueB" errorDescription:nil]);
+    XCTAssertEqualObjects(value, valB);
+    value = valA;
+    XCTAssertTrue([formatter getObjectValue:&value forString:@"Nada" errorDescription:nil]);
+    XCTAssertNil(value);
+    XCTAssertFalse([formatter getObjectValue:&value forString:@"VALUE A" errorDescription:nil]);
+
+    formatter.capitalizesFirstCharacter = NO;
+    XCTAssertEqualObjects([formatter stringForObjectValue:nil], @"Nada");
+    XCTAssertEqualObjects([formatter stringForObjectValue:valB], @"Value B");
+    XCTAssertFalse([formatter getObjectValue:&value forString:@"ValueB" errorDescription:nil]);
+}
+
+- (void)testDuplicateNames
+{
+    PWEnumFormatter* formatter = [[PWEnumFormatter alloc] initWithLocalizer:nil
+                                                                     values:@[@1, @2, @3]
+                                                           unlocalizedNames:@[@"one", @"same", @"same"]
+                                                    unlocalizedNilValueName:nil
+                                                      localizationKeyPrefix:nil];
+    NSNumber* value;
+    XCTAssertTrue([formatter getObjectValue:&value forString:@"same" errorDescription:nil]);
+    XCTAssertEqualObjects(value, @2);
+    XCTAssertEqualObjects([formatter stringForObjectValue:@3], @"same");
+}
+
+- (void)testParsingPerformance
+{
+    NSMutableArray* values = [NSMutableArray array];
+    NSMutableArray* names = [NSMutableArray array];
+    for(NSUInteger index = 0; index < 1000; index++)
+    {
+        [values addObject:@(index)];
+        [names addObject:[NSString stringWithFormat:@"name%lu", (unsigned long)index]];
+    }
+    PWEnumFormatter* formatter = [[PWEnumFormatter alloc] initWithLocalizer:nil
+                                                                     values:values
+                                                           unlocalizedNames:names
+                                                    unlocalizedNilValueName:nil
+                                                      localizationKeyPrefix:nil];
+    [self measureBlock:^{
+        for(NSUInteger round = 0; round < 100; round++)
+            for(NSString* name in names)
+            {
+                id value;
+                [formatter getObjectValue:&value forString:name errorDescription:nil];
+            }
+    }];
+}
+
 #pragma clang diagnostic pop
 
 @end
@@ -9,6 +9,7 @@
 #import "PWValueGroupTest.h"
 #import "PWValueGroup.h"
 #import "NSArray-PWExtensions.h"
+#import <malloc/malloc.h>
 
 @implementation PWValueGroupTest
 
@@ -128,4 +129,152 @@
                         }];
     return array;
 }
+
+// Builds the same nested structure of 'count' values, mixing categories and including a nil value and duplicates.
+- (PWValueGroup*)groupWithValueCount:(NSUInteger)count
+{
+    PWValueGroup* group = [[PWValueGroup alloc] init];
+    PWValueGroup* subGroup;
+    for(NSUInteger index = 0; index < count; index++)
+    {
+        if(index % 10 == 0)
+        {
+            subGroup = [[PWValueGroup alloc] init];
+            [group addGroup:subGroup withCategory:index % 30 == 0 ? PWValueCategoryExtended : PWValueCategoryBasic];
+        }
+        id value = index == 5 ? nil : @(index % 1000);
+        [subGroup addValue:value withCategory:index % 7 == 0 ? PWValueCategoryExtended : PWValueCategoryBasic];
+    }
+    return group;
+}
+
+- (NSArray*)deepEnumeratedGroup:(PWValueGroup*)group withCategories:(PWValueCategoryMask)categories
+{
+    NSMutableArray* array = [NSMutableArray array];
+    [group deepEnumerateValuesWithCategories:categories
+                                  usingBlock:^(id iValue, PWValueCategory iCategory, BOOL *stop) {
+                                      [array addObject:@[iValue ? iValue : NSNull.null, @(iCategory)]];
+                                  }];
+    return array;
+}
+
+- (void)testFlatIndexMatchesTree
+{
+    PWValueGroup* mutableGroup = [self groupWithValueCount:3000];
+    PWValueGroup* immutableGroup = [mutableGroup copy];
+    XCTAssertTrue(immutableGroup.isImmutable);
+    XCTAssertFalse(mutableGroup.isImmutable);
+
+    XCTAssertEqualObjects(immutableGroup.deepValues, mutableGroup.deepValues);
+    XCTAssertEqualObjects(immutableGroup.deepValues[5], NSNull.null);
+    for(NSNumber* mask in @[@(PWValueCategoryMaskAll), @(PWValueCategoryMaskBasic), @(PWValueCategoryMaskExtended)])
+        XCTAssertEqualObjects([self deepEnumeratedGroup:immutableGroup withCategories:mask.unsignedIntegerValue],
+                              [self deepEnumeratedGroup:mutableGroup withCategories:mask.unsignedIntegerValue]);
+
+    for(NSUInteger index = 0; index < 1100; index++)
+    {
+        PWValueCategory mutableCategory = PWValueCategoryBasic;
+        PWValueCategory immutableCategory = PWValueCategoryBasic;
+        XCTAssertEqual([immutableGroup deepContainsValue:@(index) category:&immutableCategory],
+                       [mutableGroup deepContainsValue:@(index) category:&mutableCategory]);
+        XCTAssertEqual(immutableCategory, mutableCategory);
+    }
+    XCTAssertFalse([immutableGroup deepContainsValue:nil]);
+    XCTAssertFalse([immutableGroup deepContainsValue:NSNull.null]);
+    XCTAssertTrue([immutableGroup deepContainsValueInCategory:PWValueCategoryExtended]);
+
+    __block NSUInteger enumeratedCount = 0;
+    XCTAssertFalse([immutableGroup deepEnumerateValuesWithCategories:PWValueCategoryMaskAll
+                                                          usingBlock:^(id iValue, PWValueCategory iCategory, BOOL *stop) {
+                                                              if(++enumeratedCount == 10)
+                                                                  *stop = YES;
+                                                          }]);
+    XCTAssertEqual(enumeratedCount, 10);
+
+    PWValueGroup* basicGroup = [PWValueGroup groupWithValues:@[@"A", @"B"]];
+    XCTAssertFalse([basicGroup deepContainsValueInCategory:PWValueCategoryExtended]);
+    XCTAssertTrue([basicGroup deepContainsValueInCategory:PWValueCategoryBasic]);
+
+    // A mutable copy of an immutable group does not use the index any more.
+    PWValueGroup* copy = [immutableGroup mutableCopy];
+    [copy addValue:@"new"];
+    XCTAssertTrue([copy deepContainsValue:@"new"]);
+    XCTAssertFalse([immutableGroup deepContainsValue:@"new"]);
+}
+
+#pragma mark - Performance
+
+static const NSUInteger PWValueGroupBenchmarkSizes[] = {10, 100, 1000, 10000, 100000};
+
+- (void)testFlatIndexMemoryUsage
+{
+    for(NSUInteger sizeIndex = 0; sizeIndex < sizeof(PWValueGroupBenchmarkSizes) / sizeof(NSUInteger); sizeIndex++)
+    {
+        NSUInteger size = PWValueGroupBenchmarkSizes[sizeIndex];
+        PWValueGroup* group = [[self groupWithValueCount:size] copy];
+        malloc_statistics_t before;
+        malloc_zone_statistics(NULL, &before);
+        [group deepContainsValue:@0];    // builds the index
+        malloc_statistics_t after;
+        malloc_zone_statistics(NULL, &after);
+        // An entry, its hash node and its slot in the values array need far less than this. Small groups are
+        // dominated by the fixed size of the index.
+        if(size >= 1000)
+            XCTAssertLessThan(((double)after.size_in_use - (double)before.size_in_use) / size, 256.0, @"%lu values", (unsigned long)size);
+    }
+}
+
+- (void)measureDeepContainsForGroup:(PWValueGroup*)group size:(NSUInteger)size
+{
+    [self measureBlock:^{
+        NSUInteger lookupCount = 0;
+        for(NSUInteger round = 0; lookupCount < 100000; round++)
+            for(NSUInteger index = 0; index < MIN(size, 1000) && lookupCount < 100000; index++, lookupCount++)
+                [group deepContainsValue:@(index)];
+    }];
+}
+
+- (void)testDeepContainsPerformanceImmutable10
+{
+    [self measureDeepContainsForGroup:[[self groupWithValueCount:10] copy] size:10];
+}
+
+- (void)testDeepContainsPerformanceMutable10
+{
+    [self measureDeepContainsForGroup:[self groupWithValueCount:10] size:10];
+}
+
+- (void)testDeepContainsPerformanceImmutable1000
+{
+    [self measureDeepContainsForGroup:[[self groupWithValueCount:1000] copy] size:1000];
+}
+
+- (void)testDeepContainsPerformanceMutable1000
+{
+    [self measureDeepContainsForGroup:[self groupWithValueCount:1000] size:1000];
+}
+
+- (void)testDeepContainsPerformanceImmutable100000
+{
+    [self measureDeepContainsForGroup:[[self groupWithValueCount:100000] copy] size:100000];
+}
+
+- (void)testDeepValuesPerformanceImmutable100000
+{
+    PWValueGroup* group = [[self groupWithValueCount:100000] copy];
+    [self measureBlock:^{
+        for(NSUInteger round = 0; round < 100; round++)
+            (void)group.deepValues;
+    }];
+}
+
+- (void)testDeepValuesPerformanceMutable100000
+{
+    PWValueGroup* group = [self groupWithValueCount:100000];
+    [self measureBlock:^{
+        for(NSUInteger round = 0; round < 100; round++)
+            (void)group.deepValues;
+    }];
+}
+
 @end
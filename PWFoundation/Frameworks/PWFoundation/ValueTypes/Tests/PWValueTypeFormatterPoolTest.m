@@ -0,0 +1,209 @@
+//
+//  PWValueTypeFormatterPoolTest.m
+//  PWFoundation
+//
+//  Created by ProjectWizards on 19.10.26.
+//
+//
+
+#import "PWTestCase.h"
+#import "PWValueTypeFormatterPool.h"
+#import "PWValueTypes.h"
+#import "PWLocality.h"
+
+@interface PWFormatterPoolTestContext : NSObject <PWValueTypeContext>
+@property (nonatomic, readwrite, strong) PWLocality* locality;
+@end
+
+@implementation PWFormatterPoolTestContext
+
+- (PWValueType*)valueTypeForKey:(NSString*)key ofClass:(Class)aClass
+{
+    return [NSObject valueTypeForKey:key];
+}
+
+@end
+
+#pragma mark
+
+@interface PWValueTypeFormatterPoolTest : PWTestCase
+@end
+
+@implementation PWValueTypeFormatterPoolTest
+
+- (PWFormatterPoolTestContext*)context
+{
+    PWFormatterPoolTestContext* context = [[PWFormatterPoolTestContext alloc] init];
+    NSLocale* locale = [[NSLocale alloc] initWithLocaleIdentifier:@"en-US"];
+    NSCalendar* calendar = [[locale objectForKey:NSLocaleCalendar] copy];
+    calendar.timeZone = [NSTimeZone timeZoneForSecondsFromGMT:0];
+    context.locality = [[PWLocality alloc] initWithLocale:locale
+                                                 language:@"English"
+                                           currencySymbol:nil
+                                   currencySymbolPosition:PWUnitAfterAmountWithoutSpace
+                                                 calendar:calendar];
+    return context;
+}
+
+- (void)testCheckOutAndReturn
+{
+    PWValueTypeFormatterPool* pool = [[PWValueTypeFormatterPool alloc] initWithKeyCapacity:2 maxIdleFormattersPerKey:2];
+    __block NSUInteger creationCount = 0;
+    NSFormatter* (^creationBlock)(void) = ^NSFormatter*{
+        creationCount++;
+        return [[NSNumberFormatter alloc] init];
+    };
+
+    NSFormatter* formatter1 = [pool checkOutFormatterForKey:@"a" creationBlock:creationBlock];
+    NSFormatter* formatter2 = [pool checkOutFormatterForKey:@"a" creationBlock:creationBlock];
+    XCTAssertNotEqual(formatter1, formatter2);
+    XCTAssertEqual(pool.missCount, 2);
+    XCTAssertEqual(pool.hitCount, 0);
+
+    [pool returnFormatter:formatter1 forKey:@"a"];
+    XCTAssertEqual(pool.idleFormatterCount, 1);
+    XCTAssertEqual([pool checkOutFormatterForKey:@"a" creationBlock:creationBlock], formatter1);
+    XCTAssertEqual(pool.hitCount, 1);
+    XCTAssertEqual(pool.idleFormatterCount, 0);
+
+    // Formatters of other keys are never handed out.
+    [pool returnFormatter:formatter1 forKey:@"a"];
+    XCTAssertNotEqual([pool checkOutFormatterForKey:@"b" creationBlock:creationBlock], formatter1);
+
+    // Beyond maxIdleFormattersPerKey returned formatters are discarded.
+    [pool returnFormatter:formatter2 forKey:@"a"];
+    [pool returnFormatter:[[NSNumberFormatter alloc] init] forKey:@"a"];
+    XCTAssertEqual(pool.idleFormatterCount, 2);
+    XCTAssertEqual(pool.discardCount, 1);
+
+    // Formatters without key are not pooled.
+    NSFormatter* unkeyedFormatter = [pool checkOutFormatterForKey:nil creationBlock:creationBlock];
+    [pool returnFormatter:unkeyedFormatter forKey:nil];
+    XCTAssertNotEqual([pool checkOutFormatterForKey:nil creationBlock:creationBlock], unkeyedFormatter);
+    XCTAssertEqual(creationCount, 5);
+
+    [pool resetStatistics];
+    XCTAssertEqual(pool.hitCount, 0);
+    XCTAssertEqual(pool.missCount, 0);
+    XCTAssertEqual(pool.discardCount, 0);
+
+    [pool removeAllFormatters];
+    XCTAssertEqual(pool.idleFormatterCount, 0);
+}
+
+- (void)testKeyCapacity
+{
+    PWValueTypeFormatterPool* pool = [[PWValueTypeFormatterPool alloc] initWithKeyCapacity:2 maxIdleFormattersPerKey:4];
+    NSFormatter* (^creationBlock)(void) = ^NSFormatter*{
+        return [[NSNumberFormatter alloc] init];
+    };
+
+    NSFormatter* formatterA = [pool checkOutFormatterForKey:@"a" creationBlock:creationBlock];
+    [pool returnFormatter:formatterA forKey:@"a"];
+    [pool returnFormatter:[pool checkOutFormatterForKey:@"b" creationBlock:creationBlock] forKey:@"b"];
+    [pool returnFormatter:[pool checkOutFormatterForKey:@"c" creationBlock:creationBlock] forKey:@"c"];
+
+    // "a" was the least recently used key.
+    XCTAssertEqual(pool.idleFormatterCount, 2);
+    XCTAssertNotEqual([pool checkOutFormatterForKey:@"a" creationBlock:creationBlock], formatterA);
+}
+
+- (void)testWarmUp
+{
+    PWValueTypeFormatterPool* pool = [[PWValueTypeFormatterPool alloc] initWithKeyCapacity:4 maxIdleFormattersPerKey:3];
+    PWFormatterPoolTestContext* context = self.context;
+    PWValueType* type = [PWDoubleValueType valueType];
+
+    [type warmUpFormatterPool:pool count:10 context:context options:nil];
+    XCTAssertEqual(pool.idleFormatterCount, 3);
+    XCTAssertEqual(pool.discardCount, 0);
+
+    [type warmUpFormatterPool:pool count:2 context:context options:nil];
+    XCTAssertEqual(pool.idleFormatterCount, 3);
+
+    [type performWithFormatterFromPool:pool context:context options:nil object:nil keyPath:nil block:^(NSFormatter* formatter) {
+        XCTAssertEqualObjects([formatter stringForObjectValue:@1234.5], @"1,234.5");
+    }];
+    XCTAssertEqual(pool.hitCount, 1);
+    XCTAssertEqual(pool.missCount, 0);
+    XCTAssertEqual(pool.idleFormatterCount, 3);
+}
+
+- (void)testParallelFormatting
+{
+    NSUInteger maxIdleCount = NSProcessInfo.processInfo.activeProcessorCount;
+    PWValueTypeFormatterPool* pool = [[PWValueTypeFormatterPool alloc] initWithKeyCapacity:4 maxIdleFormattersPerKey:maxIdleCount];
+    PWFormatterPoolTestContext* context = self.context;
+    PWValueType* type = [PWDoubleValueType valueType];
+    NSDictionary* options = @{PWNumberOfDecimalsFormatKey: @2};
+
+    NSFormatter* referenceFormatter = [type directFormatterForContext:context options:options object:nil keyPath:nil];
+    NSMutableArray<NSString*>* expectedStrings = [NSMutableArray array];
+    for(NSUInteger value = 0; value < 100; value++)
+        [expectedStrings addObject:[referenceFormatter stringForObjectValue:@(value * 1000.125)]];
+
+    // Records the formatters which are currently checked out, to check that none is used twice at the same time.
+    PWDispatchQueue* checkQueue = [PWDispatchQueue serialDispatchQueueWithLabel:NSStringFromSelector(_cmd)];
+    NSHashTable* formattersInUse = [NSHashTable hashTableWithOptions:NSPointerFunctionsObjectPointerPersonality];
+    __block BOOL didShareFormatter = NO;
+    __block BOOL didFormatWrongly = NO;
+
+    NSUInteger iterations = 10000;
+    [PWDispatchQueue.globalDefaultPriorityQueue synchronouslyDispatchBlock:^(size_t index) {
+        [type performWithFormatterFromPool:pool context:context options:options object:nil keyPath:nil block:^(NSFormatter* formatter) {
+            [checkQueue synchronouslyDispatchBlock:^{
+                if([formattersInUse containsObject:formatter])
+                    didShareFormatter = YES;
+                [formattersInUse addObject:formatter];
+            }];
+            NSUInteger value = index % 100;
+            BOOL isCorrect = [[formatter stringForObjectValue:@(value * 1000.125)] isEqualToString:expectedStrings[value]];
+            [checkQueue synchronouslyDispatchBlock:^{
+                if(!isCorrect)
+                    didFormatWrongly = YES;
+                [formattersInUse removeObject:formatter];
+            }];
+        }];
+    } times:iterations];
+
+    XCTAssertFalse(didShareFormatter);
+    XCTAssertFalse(didFormatWrongly);
+    XCTAssertEqual(pool.hitCount + pool.missCount, iterations);
+    XCTAssertGreaterThan(pool.hitCount, pool.missCount);
+    XCTAssertLessThanOrEqual(pool.idleFormatterCount, maxIdleCount);
+}
+
+#pragma mark - Performance
+
+- (void)testPooledFormattingPerformance
+{
+    PWValueTypeFormatterPool* pool = [[PWValueTypeFormatterPool alloc] init];
+    PWFormatterPoolTestContext* context = self.context;
+    PWValueType* type = [PWDoubleValueType valueType];
+    [type warmUpFormatterPool:pool count:NSProcessInfo.processInfo.activeProcessorCount context:context options:nil];
+
+    [self measureBlock:^{
+        [PWDispatchQueue.globalDefaultPriorityQueue synchronouslyDispatchBlock:^(size_t index) {
+            [type performWithFormatterFromPool:pool context:context options:nil object:nil keyPath:nil block:^(NSFormatter* formatter) {
+                for(NSUInteger value = 0; value < 100; value++)
+                    [formatter stringForObjectValue:@(index * 100 + value)];
+            }];
+        } times:1000];
+    }];
+}
+
+- (void)testUnpooledFormattingPerformance
+{
+    PWFormatterPoolTestContext* context = self.context;
+    PWValueType* type = [PWDoubleValueType valueType];
+
+    [self measureBlock:^{
+        [PWDispatchQueue.globalDefaultPriorityQueue synchronouslyDispatchBlock:^(size_t index) {
+            NSFormatter* formatter = [type directFormatterForContext:context options:nil object:nil keyPath:nil];
+            for(NSUInteger value = 0; value < 100; value++)
+                [formatter stringForObjectValue:@(index * 100 + value)];
+        } times:1000];
+    }];
+}
+
+@end
@@ -70,6 +70,34 @@
 @end
 
 
+// Takes its preset values from the block if it has one, otherwise from the values property.
+@interface PWTestMutableEnumType : PWEnumValueType
+@property (nonatomic, readwrite, copy) NSArray* values;
+@property (nonatomic, readwrite, copy) NSArray* names;
+@end
+
+@implementation PWTestMutableEnumType
+
+- (PWValueTypePresetValuesMode)presetValuesModeForContext:(id <PWValueTypeContext>)context
+                                                   object:(id)object
+                                                  options:(NSDictionary*)options
+                                                  values:(PWValueGroup**)outValues
+{
+    if(self.presetValuesBlock)
+        return [super presetValuesModeForContext:context object:object options:options values:outValues];
+    if(outValues)
+        *outValues = [PWValueGroup groupWithValues:self.values];
+    return PWValueTypeForcesPresetValues;
+}
+
+- (NSArray*)unlocalizedValueNamesForContext:(id <PWValueTypeContext>)context
+{
+    return self.names;
+}
+
+@end
+
+
 @implementation PWValueTypeTest
 {
     PWValueTypeTestContext* germanContext_;
@@ -448,4 +476,127 @@
     // TODO: Write tests for NSBundle.mainBundle.localizations related stuff
 }
 
+- (void)testEnumUnlocalizedNames
+{
+    PWEnumValueType* type = [PWTestEnumType valueType];
+    XCTAssertEqualObjects([type unlocalizedNameForValue:@1], @"valueA");
+    XCTAssertEqualObjects([type unlocalizedNameForValue:@2], @"valueB");
+    XCTAssertEqualObjects([type unlocalizedNameForValue:nil], @"nada");
+    XCTAssertNil([type unlocalizedNameForValue:@3]);
+
+    id value;
+    XCTAssertTrue([type value:&value forUnlocalizedName:@"valueB"]);
+    XCTAssertEqualObjects(value, @2);
+    XCTAssertTrue([type value:&value forUnlocalizedName:@"valueA"]);
+    XCTAssertEqualObjects(value, @1);
+    XCTAssertFalse([type value:&value forUnlocalizedName:@"nada"]);     // nil is no preset value of this type
+    XCTAssertFalse([type value:&value forUnlocalizedName:@"valueC"]);
+    XCTAssertFalse([type value:&value forUnlocalizedName:nil]);
+}
+
+- (void)testEnumNameLookupWithObjectDependentPresetValues
+{
+    PWTestMutableEnumType* type = [[PWTestMutableEnumType alloc] initWithFallbackKeyPath:nil
+                                                                       presetValuesBlock:^PWValueTypePresetValuesMode(id<PWValueTypeContext> context, id object, NSDictionary* options, PWValueGroup** outValues) {
+                                                                           if(outValues)
+                                                                               *outValues = [PWValueGroup groupWithValues:[object boolValue] ? @[@2, @1] : @[@1, @2]];
+                                                                           return PWValueTypeForcesPresetValues;
+                                                                       }];
+    type.names = @[@"valueA", @"valueB"];
+    XCTAssertTrue(type.presetValuesDependOnObjectOrOptions);
+
+    XCTAssertEqualObjects([type unlocalizedNameForValue:@1 context:nil object:@NO options:nil], @"valueA");
+    XCTAssertEqualObjects([type unlocalizedNameForValue:@1 context:nil object:@YES options:nil], @"valueB");
+
+    id value;
+    XCTAssertTrue([type value:&value forUnlocalizedName:@"valueA" context:nil object:@NO options:nil]);
+    XCTAssertEqualObjects(value, @1);
+    XCTAssertTrue([type value:&value forUnlocalizedName:@"valueA" context:nil object:@YES options:nil]);
+    XCTAssertEqualObjects(value, @2);
+}
+
+- (void)testInvalidatingEnumNameLookupTables
+{
+    PWTestMutableEnumType* type = [[PWTestMutableEnumType alloc] initWithFallbackKeyPath:nil presetValuesBlock:nil];
+    type.values = @[@1, @2];
+    type.names  = @[@"valueA", @"valueB"];
+    XCTAssertFalse(type.presetValuesDependOnObjectOrOptions);
+    XCTAssertEqualObjects([type unlocalizedNameForValue:@1], @"valueA");
+
+    // The table is kept until it is invalidated.
+    type.values = @[@1, @2, @3];
+    type.names  = @[@"first", @"second", @"third"];
+    XCTAssertEqualObjects([type unlocalizedNameForValue:@1], @"valueA");
+
+    [type invalidateUnlocalizedNameLookupTables];
+    XCTAssertEqualObjects([type unlocalizedNameForValue:@1], @"first");
+    id value;
+    XCTAssertTrue([type value:&value forUnlocalizedName:@"third"]);
+    XCTAssertEqualObjects(value, @3);
+    XCTAssertFalse([type value:&value forUnlocalizedName:@"valueA"]);
+}
+
+// The lookup before the tables were introduced: preset values and names for every call and a deep walk until the
+// value is found.
+static NSString* PWUnlocalizedNameByWalking(PWEnumValueType* type, id value)
+{
+    PWValueGroup* values;
+    [type presetValuesModeForContext:nil object:nil options:nil values:&values];
+    NSArray* names = [type unlocalizedValueNamesForContext:nil];
+    __block NSUInteger index = 0;
+    __block NSString* result;
+    [values deepEnumerateValuesWithCategories:PWValueCategoryMaskAll
+                                   usingBlock:^(id iValue, PWValueCategory iCategory, BOOL *stop) {
+                                       if([iValue isEqual:value])
+                                       {
+                                           result = names[index];
+                                           *stop = YES;
+                                       }
+                                       index++;
+                                   }];
+    return result;
+}
+
+- (void)testEnumNameLookupMatchesWalking
+{
+    PWEnumValueType* type = [PWStringEncodingValueType valueType];
+    PWValueGroup* group;
+    [type presetValuesModeForContext:nil object:nil options:nil values:&group];
+    for(id value in group.deepValues)
+        XCTAssertEqualObjects([type unlocalizedNameForValue:value], PWUnlocalizedNameByWalking(type, value));
+}
+
+// The walk allocates a value group and a names array per call, for comparison with the lookup below.
+- (void)testEnumNameWalkingPerformance
+{
+    PWEnumValueType* type = [PWStringEncodingValueType valueType];
+    PWValueGroup* group;
+    [type presetValuesModeForContext:nil object:nil options:nil values:&group];
+    NSArray* values = group.deepValues;
+    [self measureBlock:^{
+        for(NSUInteger round = 0; round < 20000; round++)
+            @autoreleasepool {
+                for(id value in values)
+                    PWUnlocalizedNameByWalking(type, value);
+            }
+    }];
+}
+
+- (void)testEnumNameLookupPerformance
+{
+    PWEnumValueType* type = [PWStringEncodingValueType valueType];
+    NSArray* names = [type unlocalizedValueNamesForContext:nil];
+    [self measureBlock:^{
+        for(NSUInteger round = 0; round < 20000; round++)
+            @autoreleasepool {
+                for(NSString* name in names)
+                {
+                    id value;
+                    [type value:&value forUnlocalizedName:name];
+                    [type unlocalizedNameForValue:value];
+                }
+            }
+    }];
+}
+
 @end